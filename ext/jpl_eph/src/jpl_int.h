@@ -45,6 +45,53 @@ struct jpl_eph_data {
    double pvsun_t;
    double *cache;
    struct interpolation_info iinfo;
+   FILE *ifile;
+               /* Set by jpl_init_ephemeris_mapped( ) only.  'records'  */
+               /* points to the first data record,  either inside the   */
+               /* file mapping or inside the byte-swapped 'resident'    */
+               /* copy,  and is NULL for the buffered reader.           */
+   const double *records;
+   long n_records;
+   void *map_base;
+   size_t map_size;
+   void *map_handle;
+   void *resident;
+   char *filename;
+   };
+
+            /* Header of a sub-ephemeris written by make_sub_ephem( ).  Unlike  */
+            /* a DE file,  it's in the byte order of the machine that wrote it, */
+            /* and holds only the records of a time window and the bodies that  */
+            /* were asked for.  Each record is padded to a whole number of      */
+            /* cache lines,  and the records start on a cache line boundary of  */
+            /* the file.  Bodies that were left out have ipt[i][1] == 0.  No    */
+            /* constants are stored,  apart from au and emrat.                  */
+#define JPL_SUB_EPHEM_MAGIC        "JPLSUB01"
+#define JPL_SUB_EPHEM_BYTE_ORDER   0x01020304
+#define JPL_SUB_EPHEM_ALIGNMENT    64
+
+struct jpl_sub_ephem_header {
+   char magic[8];
+   int32_t byte_order;        /* JPL_SUB_EPHEM_BYTE_ORDER, as written */
+   int32_t ephemeris_version;
+   double ephem_start, ephem_end, ephem_step;
+   double au;
+   double emrat;
+   int32_t ipt[13][3];
+   int32_t ncoeff;            /* doubles per (padded) record */
+   int32_t n_records;
+   int32_t records_offset;    /* in bytes from the start of the file */
+   };
+
+            /* Scratch data of one stream of queries,  see jpl_init_context( ). */
+            /* 'cache' and 'ifile' are only used when the ephemeris file isn't  */
+            /* memory mapped.                                                   */
+struct jpl_eph_context {
+   long curr_cache_loc;
+   double pvsun[6];
+   double pvsun_t;
+   struct interpolation_info iinfo;
+   double *cache;
    FILE *ifile;
    };
 #pragma pack()
@@ -59,6 +59,15 @@ details of the implementation encapsulated.
 #include <stdlib.h>
 #include <stdint.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 /**** include variable and type definitions, specific for this C version */
 
 #include "jpleph.h"
@@ -123,10 +132,14 @@ long DLL_FUNC jpl_get_long( const void *ephem, const int value)
 **           computed,  otherwise not.                                      **
 **                                                                          **
 *****************************************************************************/
-int DLL_FUNC jpl_pleph( void *ephem, const double et, const int ntarg,
-                      const int ncent, double rrd[], const int calc_velocity)
+static int state_r( const struct jpl_eph_data *eph, struct jpl_eph_context *ctx,
+                    const double et, const int list[12], double pv[][6],
+                    double nut[4], const int bary);
+
+static int pleph_r( const struct jpl_eph_data *eph, struct jpl_eph_context *ctx,
+                    const double et, const int ntarg, const int ncent,
+                    double rrd[], const int calc_velocity)
 {
-  struct jpl_eph_data *eph = (struct jpl_eph_data *)ephem;
   double pv[13][6];/* pv is the position/velocity array
                              NUMBERED FROM ZERO: 0=Mercury,1=Venus,...
                              8=Pluto,9=Moon,10=Sun,11=SSBary,12=EMBary
@@ -155,7 +168,7 @@ int DLL_FUNC jpl_pleph( void *ephem, const double et, const int ntarg,
       if( eph->ipt[11][1] > 0) /* there is nutation on ephemeris */
          {
          list[10] = list_val;
-         rval = jpl_state( ephem, et, list, pv, rrd, 0);
+         rval = state_r( eph, ctx, et, list, pv, rrd, 0);
          }
       else          /*  no nutations on the ephemeris file  */
          rval = JPL_EPH_NO_NUTATIONS_IN_EPHEMERIS;
@@ -169,7 +182,7 @@ int DLL_FUNC jpl_pleph( void *ephem, const double et, const int ntarg,
       if( eph->ipt[12][1] > 0) /* there are librations on ephemeris file */
          {
          list[11] = list_val;
-         rval = jpl_state( eph, et, list, pv, rrd, 0);
+         rval = state_r( eph, ctx, et, list, pv, rrd, 0);
          for( i = 0; i < 6; ++i)
             rrd[i] = pv[10][i]; /* librations */
          }
@@ -197,11 +210,13 @@ int DLL_FUNC jpl_pleph( void *ephem, const double et, const int ntarg,
 
 /*   make call to state   */
 
-   rval = jpl_state( eph, et, list, pv, rrd, 1);
+   rval = state_r( eph, ctx, et, list, pv, rrd, 1);
+   if( rval)            /* pv[] wasn't filled in,  leave rrd[] zeroed */
+      return( rval);
    /* Solar System barycentric Sun state goes to pv[10][] */
    if( ntarg == 11 || ncent == 11)
       for( i = 0; i < 6; i++)
-         pv[10][i] = eph->pvsun[i];
+         pv[10][i] = ctx->pvsun[i];
 
    /* Solar System Barycenter coordinates & velocities equal to zero */
    if( ntarg == 12 || ncent == 12)
@@ -384,6 +399,39 @@ static void swap_64_bit_val( void *ptr, long count)
       }
 }
 
+/* load_record( ) points 'buf' at the coefficients of record 'nr'.  A  */
+/* mapped ephemeris has every record in core already;  otherwise the    */
+/* record is read into the context's cache,  unless it's there already. */
+
+static int load_record( const struct jpl_eph_data *eph, struct jpl_eph_context *ctx,
+                        const long nr, const double **buf)
+{
+   if( eph->records)
+      {
+      if( nr >= eph->n_records)
+         return( JPL_EPH_READ_ERROR);
+      *buf = eph->records + nr * eph->ncoeff;
+      return( 0);
+      }
+   if( nr != ctx->curr_cache_loc)
+      {
+                  /* The cache holds no record until the read succeeds, */
+                  /* so a failed read isn't taken for a cached record.  */
+      ctx->curr_cache_loc = -1L;
+                  /* Read two blocks ahead to account for header: */
+      if( fseek( ctx->ifile, (nr + 2) * eph->recsize, SEEK_SET))
+         return( JPL_EPH_FSEEK_ERROR);
+      if( fread( ctx->cache, sizeof( double), (size_t)eph->ncoeff, ctx->ifile)
+                               != (size_t)eph->ncoeff)
+         return( JPL_EPH_READ_ERROR);
+      if( eph->swap_bytes)
+         swap_64_bit_val( ctx->cache, eph->ncoeff);
+      ctx->curr_cache_loc = nr;
+      }
+   *buf = ctx->cache;
+   return( 0);
+}
+
 /*****************************************************************************
 **                        jpl_state(ephem,et2,list,pv,nut,bary)             **
 ******************************************************************************
@@ -461,13 +509,13 @@ static void swap_64_bit_val( void *ptr, long count)
 **                       d epsilon dot                                      **
 **                                                                          **
 *****************************************************************************/
-int DLL_FUNC jpl_state( void *ephem, const double et, const int list[12],
-                          double pv[][6], double nut[4], const int bary)
+static int state_r( const struct jpl_eph_data *eph, struct jpl_eph_context *ctx,
+                    const double et, const int list[12], double pv[][6],
+                    double nut[4], const int bary)
 {
-   struct jpl_eph_data *eph = (struct jpl_eph_data *)ephem;
    int i, j, n_intervals;
    long int nr;
-   double *buf = eph->cache;
+   const double *buf;
    double t[2];
    const double block_loc = (et - eph->ephem_start) / eph->ephem_step;
    const double aufac = 1.0 / eph->au;
@@ -477,6 +525,11 @@ int DLL_FUNC jpl_state( void *ephem, const double et, const int list[12],
    if( et < eph->ephem_start || et > eph->ephem_end)
       return( JPL_EPH_OUTSIDE_RANGE);
 
+/*   error return for bodies left out of a sub-ephemeris   */
+   for( i = 0; i < 10; i++)
+      if( list[i] && !eph->ipt[i][1])
+         return( JPL_EPH_BODY_NOT_IN_EPHEMERIS);
+
 /*   calculate record # and relative time in interval   */
 
    nr = (long)block_loc;
@@ -489,24 +542,15 @@ int DLL_FUNC jpl_state( void *ephem, const double et, const int list[12],
 
 /*   read correct record if not in core (static vector buf[])   */
 
-   if( nr != eph->curr_cache_loc)
-      {
-      eph->curr_cache_loc = nr;
-                  /* Read two blocks ahead to account for header: */
-      if( fseek( eph->ifile, (nr + 2) * eph->recsize, SEEK_SET))
-         return( JPL_EPH_FSEEK_ERROR);
-      if( fread( buf, sizeof( double), (size_t)eph->ncoeff, eph->ifile)
-                               != (size_t)eph->ncoeff)
-         return( JPL_EPH_READ_ERROR);
-      if( eph->swap_bytes)
-         swap_64_bit_val( buf, eph->ncoeff);
-      }
+   i = load_record( eph, ctx, nr, &buf);
+   if( i)
+      return( i);
    t[1] = eph->ephem_step;
 
-   if( eph->pvsun_t != et)   /* If several calls are made for the same et, */
+   if( ctx->pvsun_t != et)   /* If several calls are made for the same et, */
       {                      /* don't recompute pvsun each time... only on */
       recompute_pvsun = 1;   /* the first run through.                     */
-      eph->pvsun_t = et;
+      ctx->pvsun_t = et;
       }
    else
       recompute_pvsun = 0;
@@ -516,9 +560,9 @@ int DLL_FUNC jpl_state( void *ephem, const double et, const int list[12],
          if( n_intervals == eph->ipt[i][2] && (list[i] || (i == 10 && recompute_pvsun)))
             {
             const int flag = ((i == 10) ? 2 : list[i]);
-            double *dest = ((i == 10) ? eph->pvsun : pv[i]);
+            double *dest = ((i == 10) ? ctx->pvsun : pv[i]);
 
-            interp( &eph->iinfo, &buf[eph->ipt[i][0]-1], t, (int)eph->ipt[i][1], 3,
+            interp( &ctx->iinfo, &buf[eph->ipt[i][0]-1], t, (int)eph->ipt[i][1], 3,
                                     n_intervals, flag, dest);
                                /* gotta convert units */
             for( j = 0; j < flag * 3; j++)
@@ -528,12 +572,12 @@ int DLL_FUNC jpl_state( void *ephem, const double et, const int list[12],
    if( !bary)                             /* gotta correct everybody for */
       for( i = 0; i < 9; i++)            /* the solar system barycenter */
          for( j = 0; j < list[i] * 3; j++)
-            pv[i][j] -= eph->pvsun[j];
+            pv[i][j] -= ctx->pvsun[j];
 
 /*  do nutations if requested (and if on file)    */
 
    if( list[10] > 0 && eph->ipt[11][1] > 0)
-      interp( &eph->iinfo, &buf[eph->ipt[11][0]-1], t, (int)eph->ipt[11][1], 2,
+      interp( &ctx->iinfo, &buf[eph->ipt[11][0]-1], t, (int)eph->ipt[11][1], 2,
                               (int)eph->ipt[11][2], list[10], nut);
 
 /*  get librations if requested (and if on file)    */
@@ -542,7 +586,7 @@ int DLL_FUNC jpl_state( void *ephem, const double et, const int list[12],
       {
       double pefau[6];
 
-      interp( &eph->iinfo, &buf[eph->ipt[12][0]-1], t, (int)eph->ipt[12][1], 3,
+      interp( &ctx->iinfo, &buf[eph->ipt[12][0]-1], t, (int)eph->ipt[12][1], 3,
                            (int)eph->ipt[12][2], list[11], pefau);
       for( j = 0; j < 6; ++j)
          pv[10][j] = pefau[j];
@@ -550,8 +594,375 @@ int DLL_FUNC jpl_state( void *ephem, const double et, const int list[12],
    return( 0);
 }
 
+/* The original entry points keep their scratch data inside jpl_eph_data. */
+/* They run the reentrant code on a context copied out of it,  and store  */
+/* the context back afterwards.                                           */
+
+static void load_context( const struct jpl_eph_data *eph, struct jpl_eph_context *ctx)
+{
+   ctx->curr_cache_loc = eph->curr_cache_loc;
+   memcpy( ctx->pvsun, eph->pvsun, sizeof( ctx->pvsun));
+   ctx->pvsun_t = eph->pvsun_t;
+   ctx->iinfo = eph->iinfo;
+   ctx->cache = eph->cache;
+   ctx->ifile = eph->ifile;
+}
+
+static void store_context( struct jpl_eph_data *eph, const struct jpl_eph_context *ctx)
+{
+   eph->curr_cache_loc = ctx->curr_cache_loc;
+   memcpy( eph->pvsun, ctx->pvsun, sizeof( eph->pvsun));
+   eph->pvsun_t = ctx->pvsun_t;
+   eph->iinfo = ctx->iinfo;
+}
+
+int DLL_FUNC jpl_state( void *ephem, const double et, const int list[12],
+                          double pv[][6], double nut[4], const int bary)
+{
+   struct jpl_eph_data *eph = (struct jpl_eph_data *)ephem;
+   struct jpl_eph_context ctx;
+   int rval;
+
+   load_context( eph, &ctx);
+   rval = state_r( eph, &ctx, et, list, pv, nut, bary);
+   store_context( eph, &ctx);
+   return( rval);
+}
+
+int DLL_FUNC jpl_pleph( void *ephem, const double et, const int ntarg,
+                      const int ncent, double rrd[], const int calc_velocity)
+{
+   struct jpl_eph_data *eph = (struct jpl_eph_data *)ephem;
+   struct jpl_eph_context ctx;
+   int rval;
+
+   load_context( eph, &ctx);
+   rval = pleph_r( eph, &ctx, et, ntarg, ncent, rrd, calc_velocity);
+   store_context( eph, &ctx);
+   return( rval);
+}
+
+/****************************************************************************
+**    jpl_init_context( ephem)                                             **
+*****************************************************************************
+**                                                                         **
+**    jpl_state( ) and jpl_pleph( ) cache the last record read,  the last  **
+**    barycentric Sun state and the Chebyshev polynomials inside the       **
+**    ephemeris itself,  so they can't be called from several threads at   **
+**    once.  A context holds that scratch data instead:  jpl_state_r( )    **
+**    and jpl_pleph_r( ) only read the ephemeris,  so any number of        **
+**    threads can query one ephemeris at once,  each with its own context. **
+**    A context for an ephemeris that isn't memory mapped opens its own    **
+**    handle on the file.  NULL is returned if the file can't be opened or **
+**    memory isn't alloced.                                                **
+****************************************************************************/
+
+void * DLL_FUNC jpl_init_context( const void *ephem)
+{
+   const struct jpl_eph_data *eph = (const struct jpl_eph_data *)ephem;
+   const size_t cache_size = (eph->records ? 0 : (size_t)eph->recsize);
+   struct jpl_eph_context *rval = (struct jpl_eph_context *)calloc(
+                     sizeof( struct jpl_eph_context) + cache_size, 1);
+
+   if( !rval)
+      return( NULL);
+   rval->iinfo.np = 2;
+   rval->iinfo.nv = 3;
+   rval->iinfo.pc[0] = 1.0;
+   rval->iinfo.pc[1] = 0.0;
+   rval->iinfo.vc[1] = 1.0;
+   rval->curr_cache_loc = -1L;
+   if( !eph->records)
+      {
+      rval->cache = (double *)( rval + 1);
+      rval->ifile = fopen( eph->filename, "rb");
+      if( !rval->ifile)
+         {
+         free( rval);
+         return( NULL);
+         }
+      }
+   return( rval);
+}
+
+void DLL_FUNC jpl_close_context( void *context)
+{
+   struct jpl_eph_context *ctx = (struct jpl_eph_context *)context;
+
+   if( ctx->ifile)
+      fclose( ctx->ifile);
+   free( context);
+}
+
+int DLL_FUNC jpl_state_r( const void *ephem, void *context, const double et,
+                 const int list[12], double pv[][6], double nut[4], const int bary)
+{
+   return( state_r( (const struct jpl_eph_data *)ephem,
+                 (struct jpl_eph_context *)context, et, list, pv, nut, bary));
+}
+
+int DLL_FUNC jpl_pleph_r( const void *ephem, void *context, const double et,
+                 const int ntarg, const int ncent, double rrd[], const int calc_velocity)
+{
+   return( pleph_r( (const struct jpl_eph_data *)ephem,
+                 (struct jpl_eph_context *)context, et, ntarg, ncent, rrd, calc_velocity));
+}
+
+/* Epochs are evaluated in blocks of at most JPL_BATCH_SIZE epochs that  */
+/* all fall in the same record.                                          */
+
+#define JPL_BATCH_SIZE 64
+#define JPL_MAX_COEFFS 18
+
+/*****************************************************************************
+**    interp_batch( coef, ncf, na, t, n, dt, velocity_flag, posvel)        **
+******************************************************************************
+**                                                                          **
+**    same as interp( ) for n epochs of the same record at once.  t[] are   **
+**    the fractional times of the epochs in the record,  dt the length of   **
+**    the record.  The Chebyshev polynomials of all epochs are built first, **
+**    then each component is summed with the epochs in the inner loop,  so  **
+**    the compiler can vectorize the sums.  posvel[c][e] receives component **
+**    c of epoch e,  with c = 3, 4, 5 the velocities if velocity_flag > 1.  **
+**                                                                          **
+*****************************************************************************/
+static void interp_batch( const double coef[], const int ncf, const int na,
+        const double t[], const int n, const double dt, const int velocity_flag,
+        double posvel[6][JPL_BATCH_SIZE])
+{
+   const double dna = (double)na;
+   const double vfac = (dna + dna) / dt;
+   double pc[JPL_MAX_COEFFS][JPL_BATCH_SIZE];
+   double vc[JPL_MAX_COEFFS][JPL_BATCH_SIZE];
+   int offset[JPL_BATCH_SIZE];
+   int c, e, j;
+
+   for( e = 0; e < n; e++)
+      {
+      const double temp = dna * t[e];
+      int l = (int)temp;
+      double tc = 2.0 * (temp - (double)l) - 1.0;
+
+      if( t[e] == 1.)
+         {
+         tc = 1.;
+         l--;
+         }
+      offset[e] = ncf * l * 3;
+      pc[0][e] = 1.0;
+      pc[1][e] = tc;
+      vc[0][e] = 0.0;
+      vc[1][e] = 1.0;
+      }
+
+   for( j = 2; j < ncf; j++)
+      for( e = 0; e < n; e++)
+         {
+         const double twot = pc[1][e] + pc[1][e];
+
+         pc[j][e] = twot * pc[j - 1][e] - pc[j - 2][e];
+         vc[j][e] = twot * vc[j - 1][e] + pc[j - 1][e] + pc[j - 1][e] - vc[j - 2][e];
+         }
+
+   for( c = 0; c < 3; c++)
+      {
+            /* Sum into local arrays:  the compiler can't tell that   */
+            /* posvel[] doesn't alias coef[],  and wouldn't vectorize. */
+      double pos[JPL_BATCH_SIZE], vel[JPL_BATCH_SIZE];
+      const double *coef_c = coef + ncf * c;
+
+      for( e = 0; e < n; e++)
+         pos[e] = vel[e] = 0.0;
+            /* Highest order first,  as in interp( ),  so the sums round */
+            /* the same way and the results are identical.              */
+      for( j = ncf - 1; j >= 0; j--)
+         for( e = 0; e < n; e++)
+            {
+            const double coefficient = coef_c[offset[e] + j];
+
+            pos[e] += pc[j][e] * coefficient;
+            vel[e] += vc[j][e] * coefficient;
+            }
+      for( e = 0; e < n; e++)
+         posvel[c][e] = pos[e];
+      if( velocity_flag > 1)
+         for( e = 0; e < n; e++)
+            posvel[c + 3][e] = vel[e] * vfac;
+      }
+}
+
+/* barycentric_batch( ) combines the interpolated bodies into component  */
+/* 'c' of the Solar System barycentric state of target 'ntarg' (numbered */
+/* as in jpl_pleph( )).                                                  */
+
+static void barycentric_batch( const struct jpl_eph_data *eph,
+        double body[11][6][JPL_BATCH_SIZE], const int ntarg, const int c,
+        const int n, double out[])
+{
+   const double moon_div = 1.0 + eph->emrat;
+   const double *emb = body[2][c], *moon = body[9][c];
+   int e;
+
+   switch( ntarg)
+      {
+      case 3:                          /* earth from EMBary and moon */
+         for( e = 0; e < n; e++)
+            out[e] = emb[e] - moon[e] / moon_div;
+         break;
+      case 10:                         /* moon from EMBary and moon */
+         for( e = 0; e < n; e++)
+            out[e] = emb[e] - moon[e] / moon_div + moon[e];
+         break;
+      case 11:                         /* sun */
+         memcpy( out, body[10][c], n * sizeof( double));
+         break;
+      case 12:                         /* Solar System Barycenter */
+         memset( out, 0, n * sizeof( double));
+         break;
+      case 13:                         /* EMBary */
+         memcpy( out, emb, n * sizeof( double));
+         break;
+      default:                         /* planets */
+         memcpy( out, body[ntarg - 1][c], n * sizeof( double));
+         break;
+      }
+}
+
+/*****************************************************************************
+**    jpl_pleph_batch( ephem,context,et,n_epochs,target_mask,ncent,pv,      **
+**                     calc_velocity)                                       **
+******************************************************************************
+**                                                                          **
+**    Computes the states of several targets with respect to 'ncent' at     **
+**    many epochs in one call.  Targets and center are numbered as in       **
+**    jpl_pleph( ),  but nutations and librations (14 and 15) aren't        **
+**    available.  Bit (ntarg - 1) of 'target_mask' selects target 'ntarg'.  **
+**                                                                          **
+**    Results are written as a structure of arrays:  pv[ntarg - 1][c] must  **
+**    point to an array of n_epochs doubles for each selected target,  and  **
+**    receives component c (x, y, z, then dx, dy, dz if calc_velocity is    **
+**    nonzero) at each epoch.  Units are au and au/day.                     **
+**                                                                          **
+**    Consecutive epochs falling in the same record are evaluated together, **
+**    so epochs should be sorted.  Every file body needed by the targets is **
+**    interpolated once per epoch,  however many targets share it.  Nothing **
+**    is written if any epoch is out of range.  Like jpl_pleph_r( ),  this  **
+**    function only reads the ephemeris,  and its results are identical to  **
+**    those of jpl_pleph_r( ) for each target and epoch.                    **
+**                                                                          **
+**    Returns JPL_EPH_TOO_MANY_COEFFICIENTS if a needed body has more than  **
+**    JPL_MAX_COEFFS coefficients per component,  the size of the buffers   **
+**    of interp_batch( ).                                                   **
+**                                                                          **
+*****************************************************************************/
+int DLL_FUNC jpl_pleph_batch( const void *ephem, void *context, const double et[],
+                 const long n_epochs, const unsigned target_mask, const int ncent,
+                 double *const pv[][6], const int calc_velocity)
+{
+   const struct jpl_eph_data *eph = (const struct jpl_eph_data *)ephem;
+   struct jpl_eph_context *ctx = (struct jpl_eph_context *)context;
+   const int velocity_flag = (calc_velocity ? 2 : 1);
+   const double aufac = 1.0 / eph->au;
+   double body[11][6][JPL_BATCH_SIZE];
+   double t[JPL_BATCH_SIZE], center[JPL_BATCH_SIZE];
+   int needed[11];
+   long start, n, e;
+   int i, c, ntarg;
+
+   if( !target_mask || (target_mask >> 13) || ncent < 1 || ncent > 13)
+      return( JPL_EPH_INVALID_INDEX);
+   for( e = 0; e < n_epochs; e++)
+      if( et[e] < eph->ephem_start || et[e] > eph->ephem_end)
+         return( JPL_EPH_OUTSIDE_RANGE);
+
+/*   find the file bodies (numbered as in jpl_state( )) to interpolate   */
+
+   for( i = 0; i < 11; i++)
+      needed[i] = 0;
+   for( ntarg = 1; ntarg <= 13; ntarg++)
+      if( ((target_mask >> (ntarg - 1)) & 1) || ntarg == ncent)
+         {
+         if( ntarg == 3 || ntarg == 10)
+            needed[2] = needed[9] = 1;
+         else if( ntarg == 13)
+            needed[2] = 1;
+         else if( ntarg != 12)
+            needed[ntarg - 1] = 1;
+         }
+   for( i = 0; i < 11; i++)
+      if( needed[i] && !eph->ipt[i][1])
+         return( JPL_EPH_BODY_NOT_IN_EPHEMERIS);
+   for( i = 0; i < 11; i++)
+      if( needed[i] && eph->ipt[i][1] > JPL_MAX_COEFFS)
+         return( JPL_EPH_TOO_MANY_COEFFICIENTS);
+
+   for( start = 0; start < n_epochs; start += n)
+      {
+      long nr = -1L;
+      const double *buf;
+
+/*   gather the following epochs of the same record   */
+
+      for( n = 0; n < JPL_BATCH_SIZE && start + n < n_epochs; n++)
+         {
+         const double block_loc = (et[start + n] - eph->ephem_start) / eph->ephem_step;
+         long nr_epoch = (long)block_loc;
+         double t_epoch = block_loc - (double)nr_epoch;
+
+         if( et[start + n] == eph->ephem_end)
+            {
+            nr_epoch--;
+            t_epoch = 1. - 1e-16;
+            }
+         if( !n)
+            nr = nr_epoch;
+         else if( nr_epoch != nr)
+            break;
+         t[n] = t_epoch;
+         }
+
+      i = load_record( eph, ctx, nr, &buf);
+      if( i)
+         return( i);
+
+      for( i = 0; i < 11; i++)
+         if( needed[i])
+            {
+            interp_batch( &buf[eph->ipt[i][0]-1], (int)eph->ipt[i][1],
+                      (int)eph->ipt[i][2], t, (int)n, eph->ephem_step, velocity_flag, body[i]);
+            for( c = 0; c < velocity_flag * 3; c++)
+               for( e = 0; e < n; e++)
+                  body[i][c][e] *= aufac;
+            }
+
+      for( c = 0; c < velocity_flag * 3; c++)
+         {
+         barycentric_batch( eph, body, ncent, c, (int)n, center);
+         for( ntarg = 1; ntarg <= 13; ntarg++)
+            if( (target_mask >> (ntarg - 1)) & 1)
+               {
+               double *out = pv[ntarg - 1][c] + start;
+
+               if( (ntarg * ncent) == 30 && (ntarg + ncent) == 13)
+                  {     /* moon from earth or earth from moon,  taken */
+                        /* straight from the file as in pleph_r( )    */
+                  for( e = 0; e < n; e++)
+                     out[e] = (ntarg == 10) ? body[9][c][e] : 0. - body[9][c][e];
+                  continue;
+                  }
+               barycentric_batch( eph, body, ntarg, c, (int)n, out);
+               for( e = 0; e < n; e++)
+                  out[e] -= center[e];
+               }
+         }
+      }
+   return( 0);
+}
+
 static int init_err_code = JPL_INIT_NOT_CALLED;
 
+static void *init_sub_ephem( const char *filename);
+
 int DLL_FUNC jpl_init_error_code( void)
 {
    return( init_err_code);
@@ -586,11 +997,20 @@ void * DLL_FUNC jpl_init_ephemeris( const char *ephemeris_filename,
    struct jpl_eph_data temp_data;
 
    init_err_code = 0;
+            /* Zero everything first:  the whole struct is copied into  */
+            /* the returned block,  and interp( ) relies on iinfo.vc[0] */
+            /* being zero.                                              */
+   memset( &temp_data, 0, sizeof( struct jpl_eph_data));
    temp_data.ifile = ifile;
    if( !ifile)
       init_err_code = JPL_INIT_FILE_NOT_FOUND;
    else if( fread( title, 84, 1, ifile) != 1)
       init_err_code = JPL_INIT_FREAD_FAILED;
+   else if( !memcmp( title, JPL_SUB_EPHEM_MAGIC, 8))
+      {
+      fclose( ifile);
+      return( init_sub_ephem( ephemeris_filename));
+      }
    else if( fseek( ifile, 2652L, SEEK_SET))
       init_err_code = JPL_INIT_FSEEK_FAILED;
    else if( fread( &temp_data, JPL_HEADER_SIZE, 1, ifile) != 1)
@@ -663,6 +1083,15 @@ void * DLL_FUNC jpl_init_ephemeris( const char *ephemeris_filename,
       return( NULL);
       }
    memcpy( rval, &temp_data, sizeof( struct jpl_eph_data));
+   rval->filename = (char *)malloc( strlen( ephemeris_filename) + 1);
+   if( !rval->filename)
+      {
+      init_err_code = JPL_INIT_MEMORY_FAILURE;
+      fclose( ifile);
+      free( rval);
+      return( NULL);
+      }
+   strcpy( rval->filename, ephemeris_filename);
    rval->iinfo.np = 2;
    rval->iinfo.nv = 3;
    rval->iinfo.pc[0] = 1.0;
@@ -692,6 +1121,257 @@ void * DLL_FUNC jpl_init_ephemeris( const char *ephemeris_filename,
    return( rval);
 }
 
+/* map_file( ) and unmap_file( ) give read-only access to a whole file   */
+/* through the virtual memory system.  map_file( ) returns NULL if the   */
+/* file can't be mapped,  e.g. a large DE file on a 32-bit platform.     */
+
+static void *map_file( const char *filename, size_t *map_size, void **map_handle)
+{
+#ifdef _WIN32
+   HANDLE file = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+   LARGE_INTEGER file_size;
+   HANDLE mapping;
+   void *rval;
+
+   if( file == INVALID_HANDLE_VALUE)
+      return( NULL);
+   if( !GetFileSizeEx( file, &file_size) || (ULONGLONG)file_size.QuadPart > (size_t)-1)
+      {
+      CloseHandle( file);
+      return( NULL);
+      }
+   mapping = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL);
+   CloseHandle( file);        /* the mapping keeps the file open */
+   if( !mapping)
+      return( NULL);
+   rval = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0);
+   if( !rval)
+      {
+      CloseHandle( mapping);
+      return( NULL);
+      }
+   *map_size = (size_t)file_size.QuadPart;
+   *map_handle = mapping;
+   return( rval);
+#else
+   const int fd = open( filename, O_RDONLY);
+   struct stat file_stat;
+   void *rval;
+
+   if( fd < 0)
+      return( NULL);
+   if( fstat( fd, &file_stat) || file_stat.st_size <= 0)
+      {
+      close( fd);
+      return( NULL);
+      }
+   rval = mmap( NULL, (size_t)file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+   close( fd);                /* the mapping keeps the file open */
+   if( rval == MAP_FAILED)
+      return( NULL);
+   *map_size = (size_t)file_stat.st_size;
+   *map_handle = NULL;
+   return( rval);
+#endif
+}
+
+static void unmap_file( void *map_base, const size_t map_size, void *map_handle)
+{
+#ifdef _WIN32
+   UnmapViewOfFile( map_base);
+   CloseHandle( (HANDLE)map_handle);
+#else
+   (void)map_handle;
+   munmap( map_base, map_size);
+#endif
+}
+
+/****************************************************************************
+**    init_sub_ephem( filename)                                            **
+*****************************************************************************
+**                                                                         **
+**    does the work of jpl_init_ephemeris( ) for a sub-ephemeris written   **
+**    by make_sub_ephem( ).  The file is memory mapped,  or read whole     **
+**    into a cache-line aligned buffer if it can't be,  so the records are **
+**    always in core and no FILE is kept open.  The records are used in    **
+**    place:  there's no header to parse beyond a few fields,  and nothing **
+**    to swap.                                                             **
+****************************************************************************/
+
+static void *init_sub_ephem( const char *filename)
+{
+   struct jpl_sub_ephem_header hdr;
+   struct jpl_eph_data *rval = NULL;
+   size_t map_size = 0;
+   void *map_handle = NULL;
+   void *map_base = map_file( filename, &map_size, &map_handle);
+   char *resident = NULL;
+   const char *file_data = (const char *)map_base;
+   int i;
+
+   init_err_code = 0;
+   if( !map_base)            /* can't map it,  so read the whole file */
+      {
+      FILE *ifile = fopen( filename, "rb");
+      long file_size = 0L;
+
+      if( !ifile)
+         init_err_code = JPL_INIT_FILE_NOT_FOUND;
+      else if( fseek( ifile, 0L, SEEK_END) || (file_size = ftell( ifile)) <= 0L
+                      || fseek( ifile, 0L, SEEK_SET))
+         init_err_code = JPL_INIT_FSEEK_FAILED;
+      else if( (resident = (char *)malloc( (size_t)file_size
+                      + JPL_SUB_EPHEM_ALIGNMENT)) == NULL)
+         init_err_code = JPL_INIT_MEMORY_FAILURE;
+      else
+         {
+         char *aligned = (char *)( ((uintptr_t)resident + JPL_SUB_EPHEM_ALIGNMENT - 1)
+                               & ~(uintptr_t)( JPL_SUB_EPHEM_ALIGNMENT - 1));
+
+         map_size = (size_t)file_size;
+         if( fread( aligned, 1, map_size, ifile) != map_size)
+            init_err_code = JPL_INIT_FREAD_FAILED;
+         file_data = aligned;
+         }
+      if( ifile)
+         fclose( ifile);
+      }
+
+   if( !init_err_code)
+      {
+      if( map_size < sizeof( hdr))
+         init_err_code = JPL_INIT_FILE_CORRUPT;
+      else
+         {
+         memcpy( &hdr, file_data, sizeof( hdr));
+         if( hdr.byte_order != JPL_SUB_EPHEM_BYTE_ORDER || hdr.ncoeff <= 0
+                  || hdr.ncoeff % (JPL_SUB_EPHEM_ALIGNMENT / sizeof( double))
+                  || hdr.n_records <= 0 || hdr.records_offset < (int32_t)sizeof( hdr)
+                  || hdr.records_offset % JPL_SUB_EPHEM_ALIGNMENT
+                  || (size_t)hdr.records_offset + (size_t)hdr.n_records
+                           * (size_t)hdr.ncoeff * sizeof( double) > map_size)
+            init_err_code = JPL_INIT_FILE_CORRUPT;
+         for( i = 0; i < 13; i++)
+            if( hdr.ipt[i][1] && (hdr.ipt[i][0] < 3 || hdr.ipt[i][1] > JPL_MAX_COEFFS ||
+                     hdr.ipt[i][0] - 1 + hdr.ipt[i][1] * hdr.ipt[i][2] * ((i == 11) ? 2 : 3)
+                                 > hdr.ncoeff))
+               init_err_code = JPL_INIT_FILE_CORRUPT;
+         }
+      }
+
+   if( !init_err_code)
+      {
+      rval = (struct jpl_eph_data *)calloc( sizeof( struct jpl_eph_data), 1);
+      if( rval)
+         rval->filename = (char *)malloc( strlen( filename) + 1);
+      if( !rval || !rval->filename)
+         {
+         free( rval);
+         rval = NULL;
+         init_err_code = JPL_INIT_MEMORY_FAILURE;
+         }
+      }
+
+   if( init_err_code)
+      {
+      if( map_base)
+         unmap_file( map_base, map_size, map_handle);
+      free( resident);
+      return( NULL);
+      }
+
+   strcpy( rval->filename, filename);
+   rval->ephem_start = hdr.ephem_start;
+   rval->ephem_end = hdr.ephem_end;
+   rval->ephem_step = hdr.ephem_step;
+   rval->ncon = 0;
+   rval->au = hdr.au;
+   rval->emrat = hdr.emrat;
+   memcpy( rval->ipt, hdr.ipt, sizeof( rval->ipt));
+   rval->ephemeris_version = hdr.ephemeris_version;
+   rval->ncoeff = hdr.ncoeff;
+   rval->recsize = hdr.ncoeff * (int32_t)sizeof( double);
+   rval->kernel_size = hdr.ncoeff * 2;
+   rval->iinfo.np = 2;
+   rval->iinfo.nv = 3;
+   rval->iinfo.pc[0] = 1.0;
+   rval->iinfo.pc[1] = 0.0;
+   rval->iinfo.vc[1] = 1.0;
+   rval->curr_cache_loc = -1L;
+   rval->records = (const double *)( file_data + hdr.records_offset);
+   rval->n_records = hdr.n_records;
+   rval->map_base = map_base;
+   rval->map_size = map_size;
+   rval->map_handle = map_handle;
+   rval->resident = resident;
+   return( rval);
+}
+
+/****************************************************************************
+**    jpl_init_ephemeris_mapped( ephemeris_filename, nam, val)             **
+*****************************************************************************
+**                                                                         **
+**    same as jpl_init_ephemeris( ),  except that the data records are     **
+**    served straight from a memory mapping of the whole file instead of   **
+**    being read one at a time into the cache.  jpl_state( ) then never    **
+**    seeks,  reads or copies,  whichever record it needs.  If the file    **
+**    is in the opposite byte order,  the records are swapped once into    **
+**    a resident, cache-line aligned copy and the mapping is released.     **
+**    If the file can't be mapped,  the buffered reader is used instead.   **
+**    Sub-ephemerides are always mapped (or loaded) by jpl_init_ephemeris( ).**
+****************************************************************************/
+
+void * DLL_FUNC jpl_init_ephemeris_mapped( const char *ephemeris_filename,
+                          char nam[][6], double *val)
+{
+   struct jpl_eph_data *eph = (struct jpl_eph_data *)
+                     jpl_init_ephemeris( ephemeris_filename, nam, val);
+   size_t map_size;
+   void *map_handle, *map_base;
+   long n_records;
+
+   if( !eph || eph->records)     /* sub-ephemerides are always in core */
+      return( eph);
+   map_base = map_file( ephemeris_filename, &map_size, &map_handle);
+   if( !map_base)
+      return( eph);
+                  /* Skip two blocks to account for header: */
+   n_records = (long)( map_size / (size_t)eph->recsize) - 2L;
+   if( n_records <= 0)
+      {
+      unmap_file( map_base, map_size, map_handle);
+      return( eph);
+      }
+
+   if( !eph->swap_bytes)
+      {
+      eph->map_base = map_base;
+      eph->map_size = map_size;
+      eph->map_handle = map_handle;
+      eph->records = (const double *)( (const char *)map_base + 2L * eph->recsize);
+      eph->n_records = n_records;
+      }
+   else
+      {
+      const size_t n_bytes = (size_t)n_records * (size_t)eph->recsize;
+      char *resident = (char *)malloc( n_bytes + 64);
+
+      if( resident)
+         {
+         double *records = (double *)( ((uintptr_t)resident + 63) & ~(uintptr_t)63);
+
+         memcpy( records, (const char *)map_base + 2L * eph->recsize, n_bytes);
+         swap_64_bit_val( records, (long)( n_bytes / sizeof( double)));
+         eph->resident = resident;
+         eph->records = records;
+         eph->n_records = n_records;
+         }
+      unmap_file( map_base, map_size, map_handle);
+      }
+   return( eph);
+}
+
 /****************************************************************************
 **    jpl_close_ephemeris( ephem)                                          **
 *****************************************************************************
@@ -703,7 +1383,12 @@ void DLL_FUNC jpl_close_ephemeris( void *ephem)
 {
    struct jpl_eph_data *eph = (struct jpl_eph_data *)ephem;
 
-   fclose( eph->ifile);
+   if( eph->ifile)
+      fclose( eph->ifile);
+   if( eph->map_base)
+      unmap_file( eph->map_base, eph->map_size, eph->map_handle);
+   free( eph->resident);
+   free( eph->filename);
    free( ephem);
 }
 
@@ -729,4 +1414,154 @@ double DLL_FUNC jpl_get_constant( const int idx, void *ephem, char *constant_nam
       }
    return( rval);
 }
+
+/****************************************************************************
+**    make_sub_ephem_targets( ephem, sub_filename, start_jd, end_jd,       **
+**                            target_mask)                                 **
+*****************************************************************************
+**                                                                         **
+**    writes a sub-ephemeris covering start_jd to end_jd,  holding only    **
+**    the data needed for the targets in 'target_mask'.  Bit (ntarg - 1)   **
+**    selects target 'ntarg',  numbered as in jpl_pleph( ),  so that bits  **
+**    13 and 14 select nutations and librations.  The Sun is always kept,  **
+**    as every query needs it.  The records are copied whole from the      **
+**    source,  so the sub-ephemeris gives exactly the same results.        **
+**                                                                         **
+**    The file is written in the byte order of this machine,  with each    **
+**    record padded to a whole number of cache lines (see jpl_int.h).  It  **
+**    can be opened with jpl_init_ephemeris( ) or with                    **
+**    jpl_init_ephemeris_mapped( ),  which then use the records in place.  **
+**    Returns 0 on success,  JPL_EPH_INVALID_INDEX if the mask is empty or **
+**    invalid,  JPL_EPH_OUTSIDE_RANGE if the source doesn't overlap the    **
+**    time span,  or a read or write error.                                **
+****************************************************************************/
+
+int DLL_FUNC make_sub_ephem_targets( void *ephem, const char *sub_filename,
+                              const double start_jd, const double end_jd,
+                              const unsigned target_mask)
+{
+   const struct jpl_eph_data *eph = (const struct jpl_eph_data *)ephem;
+   const long n_source = (long)( (eph->ephem_end - eph->ephem_start) / eph->ephem_step + .5);
+   const int32_t per_line = (int32_t)( JPL_SUB_EPHEM_ALIGNMENT / sizeof( double));
+   struct jpl_sub_ephem_header hdr;
+   char padding[JPL_SUB_EPHEM_ALIGNMENT];
+   int keep[13], i, ntarg, rval = 0;
+   int32_t offset = 3;     /* after the record's start and end dates */
+   long first, last, nr;
+   double *record;
+   void *context;
+   FILE *ofile;
+
+   if( !target_mask || (target_mask >> 15))
+      return( JPL_EPH_INVALID_INDEX);
+   if( end_jd < start_jd || start_jd > eph->ephem_end || end_jd < eph->ephem_start)
+      return( JPL_EPH_OUTSIDE_RANGE);
+
+/*   find the file bodies to keep (numbered as in jpl_state( ),  with   */
+/*   nutations and librations as 11 and 12)                              */
+
+   for( i = 0; i < 13; i++)
+      keep[i] = 0;
+   keep[10] = 1;
+   for( ntarg = 1; ntarg <= 15; ntarg++)
+      if( (target_mask >> (ntarg - 1)) & 1)
+         {
+         if( ntarg == 3 || ntarg == 10)
+            keep[2] = keep[9] = 1;
+         else if( ntarg == 13)
+            keep[2] = 1;
+         else if( ntarg == 14 || ntarg == 15)
+            keep[ntarg - 3] = 1;
+         else if( ntarg != 12)
+            keep[ntarg - 1] = 1;
+         }
+
+   memset( &hdr, 0, sizeof( hdr));
+   memcpy( hdr.magic, JPL_SUB_EPHEM_MAGIC, 8);
+   hdr.byte_order = JPL_SUB_EPHEM_BYTE_ORDER;
+   hdr.ephemeris_version = eph->ephemeris_version;
+   for( i = 0; i < 13; i++)
+      if( keep[i] && eph->ipt[i][1] > 0)
+         {
+         hdr.ipt[i][0] = offset;
+         hdr.ipt[i][1] = eph->ipt[i][1];
+         hdr.ipt[i][2] = eph->ipt[i][2];
+         offset += eph->ipt[i][1] * eph->ipt[i][2] * ((i == 11) ? 2 : 3);
+         }
+   hdr.ncoeff = (offset - 1 + per_line - 1) / per_line * per_line;
+
+   first = (long)( (start_jd - eph->ephem_start) / eph->ephem_step);
+   last = (long)ceil( (end_jd - eph->ephem_start) / eph->ephem_step) - 1L;
+   if( first < 0L)
+      first = 0L;
+   if( last > n_source - 1L)
+      last = n_source - 1L;
+   if( last < first)
+      last = first;
+   hdr.ephem_start = eph->ephem_start + (double)first * eph->ephem_step;
+   hdr.ephem_end = eph->ephem_start + (double)( last + 1L) * eph->ephem_step;
+   hdr.ephem_step = eph->ephem_step;
+   hdr.au = eph->au;
+   hdr.emrat = eph->emrat;
+   hdr.n_records = (int32_t)( last - first + 1L);
+   hdr.records_offset = (int32_t)( (sizeof( hdr) + JPL_SUB_EPHEM_ALIGNMENT - 1)
+                               / JPL_SUB_EPHEM_ALIGNMENT * JPL_SUB_EPHEM_ALIGNMENT);
+
+   context = jpl_init_context( ephem);
+   record = (double *)calloc( (size_t)hdr.ncoeff, sizeof( double));
+   ofile = fopen( sub_filename, "wb");
+   if( !context || !record || !ofile)
+      rval = (context && record ? JPL_EPH_WRITE_ERROR : JPL_EPH_READ_ERROR);
+   else
+      {
+      const size_t n_padding = (size_t)hdr.records_offset - sizeof( hdr);
+
+      memset( padding, 0, sizeof( padding));
+      if( fwrite( &hdr, sizeof( hdr), 1, ofile) != 1 ||
+               fwrite( padding, 1, n_padding, ofile) != n_padding)
+         rval = JPL_EPH_WRITE_ERROR;
+      }
+
+   for( nr = first; !rval && nr <= last; nr++)
+      {
+      const double *buf;
+
+      rval = load_record( eph, (struct jpl_eph_context *)context, nr, &buf);
+      if( !rval)
+         {
+         record[0] = buf[0];
+         record[1] = buf[1];
+         for( i = 0; i < 13; i++)
+            if( hdr.ipt[i][1])
+               memcpy( record + hdr.ipt[i][0] - 1, buf + eph->ipt[i][0] - 1,
+                        (size_t)( hdr.ipt[i][1] * hdr.ipt[i][2] * ((i == 11) ? 2 : 3))
+                                      * sizeof( double));
+         if( fwrite( record, sizeof( double), (size_t)hdr.ncoeff, ofile)
+                                   != (size_t)hdr.ncoeff)
+            rval = JPL_EPH_WRITE_ERROR;
+         }
+      }
+
+   if( ofile && fclose( ofile) && !rval)
+      rval = JPL_EPH_WRITE_ERROR;
+   if( ofile && rval)
+      remove( sub_filename);
+   if( context)
+      jpl_close_context( context);
+   free( record);
+   return( rval);
+}
+
+/****************************************************************************
+**    make_sub_ephem( ephem, sub_filename, start_jd, end_jd)               **
+*****************************************************************************
+**                                                                         **
+**    same as make_sub_ephem_targets( ),  keeping everything on the file.  **
+****************************************************************************/
+
+int DLL_FUNC make_sub_ephem( void *ephem, const char *sub_filename,
+                              const double start_jd, const double end_jd)
+{
+   return( make_sub_ephem_targets( ephem, sub_filename, start_jd, end_jd, 0x7fff));
+}
 /*************************** THE END ***************************************/
@@ -46,15 +46,29 @@ extern "C" {
 
 void * DLL_FUNC jpl_init_ephemeris( const char *ephemeris_filename,
                                              char nam[][6], double *val);
+void * DLL_FUNC jpl_init_ephemeris_mapped( const char *ephemeris_filename,
+                                             char nam[][6], double *val);
 void DLL_FUNC jpl_close_ephemeris( void *ephem);
 int DLL_FUNC jpl_state( void *ephem, const double et, const int list[12],
                           double pv[][6], double nut[4], const int bary);
 int DLL_FUNC jpl_pleph( void *ephem, const double et, const int ntarg,
                       const int ncent, double rrd[], const int calc_velocity);
+void * DLL_FUNC jpl_init_context( const void *ephem);
+void DLL_FUNC jpl_close_context( void *context);
+int DLL_FUNC jpl_state_r( const void *ephem, void *context, const double et,
+                 const int list[12], double pv[][6], double nut[4], const int bary);
+int DLL_FUNC jpl_pleph_r( const void *ephem, void *context, const double et,
+                 const int ntarg, const int ncent, double rrd[], const int calc_velocity);
+int DLL_FUNC jpl_pleph_batch( const void *ephem, void *context, const double et[],
+                 const long n_epochs, const unsigned target_mask, const int ncent,
+                 double *const pv[][6], const int calc_velocity);
 double DLL_FUNC jpl_get_double( const void *ephem, const int value);
 long DLL_FUNC jpl_get_long( const void *ephem, const int value);
 int DLL_FUNC make_sub_ephem( void *ephem, const char *sub_filename,
                               const double start_jd, const double end_jd);
+int DLL_FUNC make_sub_ephem_targets( void *ephem, const char *sub_filename,
+                              const double start_jd, const double end_jd,
+                              const unsigned target_mask);
 double DLL_FUNC jpl_get_constant( const int idx, void *ephem, char *constant_name);
 
 #ifdef __cplusplus
@@ -84,6 +98,13 @@ double DLL_FUNC jpl_get_constant( const int idx, void *ephem, char *constant_nam
 #define JPL_EPH_NO_LIBRATIONS_IN_EPHEMERIS   (-4)
 #define JPL_EPH_INVALID_INDEX                (-5)
 #define JPL_EPH_FSEEK_ERROR                  (-6)
+#define JPL_EPH_BODY_NOT_IN_EPHEMERIS        (-7)
+
+         /* ...and by make_sub_ephem( ):  */
+#define JPL_EPH_WRITE_ERROR                  (-8)
+
+         /* ...and by jpl_pleph_batch( ):  */
+#define JPL_EPH_TOO_MANY_COEFFICIENTS        (-9)
 
 int DLL_FUNC jpl_init_error_code( void);
 
@@ -0,0 +1,87 @@
+/* sub_eph.cpp: writes a sub-ephemeris of a JPL ephemeris
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA.    */
+
+/*****************************************************************************
+**    sub_eph  de_file sub_file start_jd end_jd [targets]                  **
+******************************************************************************
+**                                                                          **
+**    Writes the part of 'de_file' covering start_jd to end_jd to          **
+**    'sub_file',  in the compact format of make_sub_ephem_targets( ).     **
+**    'targets' is a comma-separated list of targets,  numbered as in      **
+**    jpl_pleph( ) (e.g. '1,2,3,4,5' for Mercury through Jupiter);  by     **
+**    default everything is kept.  Build it with jpleph.cpp,  e.g.         **
+**                                                                          **
+**       g++ -O2 -o sub_eph sub_eph.cpp jpleph.cpp                          **
+**                                                                          **
+**    or with the sub_eph project of sln/msvc/igato.sln.                    **
+**                                                                          **
+*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "jpleph.h"
+
+int main( const int argc, const char **argv)
+{
+   unsigned target_mask = 0x7fff;
+   void *ephem;
+   int rval;
+
+   if( argc < 5)
+      {
+      printf( "usage: sub_eph de_file sub_file start_jd end_jd [targets]\n\n");
+      printf( "'targets' is a comma-separated list of jpl_pleph( ) targets:\n");
+      printf( "   1=Mercury, 2=Venus, 3=Earth, 4=Mars, 5=Jupiter, 6=Saturn,\n");
+      printf( "   7=Uranus, 8=Neptune, 9=Pluto, 10=Moon, 11=Sun, 13=EM barycenter,\n");
+      printf( "   14=nutations, 15=librations.  By default everything is kept.\n");
+      return( -1);
+      }
+
+   if( argc > 5)
+      {
+      const char *tptr = argv[5];
+
+      target_mask = 0;
+      while( *tptr)
+         {
+         char *endptr;
+         const long ntarg = strtol( tptr, &endptr, 10);
+
+         if( endptr == tptr || ntarg < 1 || ntarg > 15)
+            {
+            printf( "Invalid target list '%s'\n", argv[5]);
+            return( -2);
+            }
+         target_mask |= 1u << (ntarg - 1);
+         tptr = (*endptr == ',' ? endptr + 1 : endptr);
+         }
+      }
+
+   ephem = jpl_init_ephemeris( argv[1], NULL, NULL);
+   if( !ephem)
+      {
+      printf( "Couldn't open '%s': error %d\n", argv[1], jpl_init_error_code( ));
+      return( -3);
+      }
+
+   rval = make_sub_ephem_targets( ephem, argv[2], atof( argv[3]), atof( argv[4]),
+                                  target_mask);
+   if( rval)
+      printf( "Couldn't write '%s': error %d\n", argv[2], rval);
+   jpl_close_ephemeris( ephem);
+   return( rval);
+}
@@ -35,7 +35,8 @@
 namespace kep_toolbox {
 
     inline double m2e(const double& M, const double & eccentricity) {
-        double E = M + eccentricity * cos(M);
+        // Danby's starter: Newton-Raphson converges from here for any eccentricity in [0,1)
+        double E = M + 0.85 * eccentricity * (sin(M) >= 0 ? 1 : -1);
         newton_raphson(E,boost::bind(kepE,_1,M, eccentricity),boost::bind(d_kepE,_1, eccentricity),100,ASTRO_TOLERANCE);
         return (E);
     }
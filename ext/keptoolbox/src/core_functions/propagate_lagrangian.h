@@ -26,12 +26,11 @@
 #ifndef PROPAGATE_LAGRANGIAN_H
 #define PROPAGATE_LAGRANGIAN_H
 
-#include<boost/bind.hpp>
-#include<boost/math/tools/roots.hpp>
+#include<cmath>
 
 #include"../astro_constants.h"
-#include"../numerics/newton_raphson.h"
 #include"kepler_equations.h"
+#include"propagate_lagrangian_batch.h"
 
 
 
@@ -48,62 +47,148 @@ namespace kep_toolbox {
  * \param[in] t propagation time (can be negative)
  * \param[in] mu central body gravitational parameter
  *
- * NOTE: The solver used for the kepler equation is a derivative free solver from the boost libraries.
+ * NOTE: This is propagate_lagrangian_batch for a single state, Kepler's equation is solved in the universal anomaly.
  *
  * @author Dario Izzo (dario.izzo _AT_ googlemail.com)
  */
 template<class T>
 void propagate_lagrangian(T& r0, T& v0, const double &t, const double &mu)
+{
+    double rx = r0[0], ry = r0[1], rz = r0[2];
+    double vx = v0[0], vy = v0[1], vz = v0[2];
+    propagate_lagrangian_batch(1, &rx, &ry, &rz, &vx, &vy, &vz, &t, mu);
+    r0[0] = rx; r0[1] = ry; r0[2] = rz;
+    v0[0] = vx; v0[1] = vy; v0[2] = vz;
+}
+
+/// Lagrangian propagation with the state transition matrix
+/**
+ * This template function propagates the state as propagate_lagrangian and also returns the state transition matrix, i.e.
+ * the partial derivatives of the final position and velocity with respect to the initial ones. These are computed
+ * analytically, differentiating the Lagrange coefficients and, implicitly, Kepler's equation in the eccentric (or
+ * hyperbolic) anomaly difference with respect to the semi-major axis, the initial radius and sigma0, which are in turn
+ * functions of the initial state.
+ *
+ * \param[in,out] r0 initial position vector. On output contains the propagated position.
+ * \param[in,out] v0 initial velocity vector. On output contains the propagated velocity.
+ * \param[in] t propagation time (can be negative)
+ * \param[in] mu central body gravitational parameter
+ * \param[out] stm 6x6 state transition matrix, stm[i][j] being the derivative of (r,v)[i] with respect to (r0,v0)[j]
+ * (suggested template type is boost::array<boost::array<double,6>,6>)
+ *
+ * @see propagate_lagrangian
+ */
+template<class T, class M>
+void propagate_lagrangian_stm(T& r0, T& v0, const double &t, const double &mu, M& stm)
 {
     double R = sqrt(r0[0]*r0[0] + r0[1]*r0[1] + r0[2]*r0[2]);
     double V = sqrt(v0[0]*v0[0] + v0[1]*v0[1] + v0[2]*v0[2]);
     double energy = (V*V/2 - mu/R);
     double a = - mu / 2.0 / energy;
-    double sqrta;
-    double F,G,Ft,Gt;
+    double sqrta, sqrtmu = sqrt(mu);
+    double r,F,G,Ft,Gt;
+    // Partial derivatives with respect to a, R, sigma0 and the anomaly difference D: f_ of Kepler's equation,
+    // r_ of the final radius and F_, G_, Ft_, Gt_ of the Lagrange coefficients (at constant final radius for Ft and Gt)
+    double f_a, f_R, f_s, f_D, DM;
+    double r_a, r_R, r_s, r_D;
+    double F_a, F_R, F_D, G_a, G_R, G_s, G_D, Ft_a, Ft_D, Gt_a, Gt_D;
 
     double sigma0 = (r0[0]*v0[0] + r0[1]*v0[1] + r0[2]*v0[2]) / sqrt(mu);
 
-    if (a > 0){	//Solve Kepler's equation, elliptical case
+    //Kepler's equation is solved in the universal anomaly chi, which is the anomaly difference times sqrt(|a|)
+    double alpha = 1 / a, tau = sqrtmu * t, chi;
+    solve_universal_anomaly(1, &R, &sigma0, &alpha, &tau, &chi);
+
+    if (a > 0){	//Elliptical case
         sqrta = sqrt(a);
-        double DM = sqrt(mu / pow(a,3)) * t;
-        double DE = DM;
-
-        //Solve Kepler Equation for ellipses in DE (eccentric anomaly difference)
-        //newton_raphson(DE,boost::bind(kepDE,_1,DM,sigma0,sqrta,a,R),boost::bind(d_kepDE,_1,sigma0,sqrta,a,R),100,ASTRO_TOLERANCE);
-        std::pair<double, double> result;
-        boost::uintmax_t iter = ASTRO_MAX_ITER;
-        boost::math::tools::eps_tolerance<double> tol(64);
-        result = boost::math::tools::bracket_and_solve_root(boost::bind(kepDE,_1,DM,sigma0,sqrta,a,R),DE,2.0,true,tol,iter);
-        DE = (result.first + result.second) / 2;
-        double r = a + (R - a) * cos(DE) + sigma0 * sqrta * sin(DE);
+        DM = sqrt(mu / pow(a,3)) * t;
+        double DE = chi / sqrta;
+        double c = cos(DE), s = sin(DE);
+        r = a + (R - a) * c + sigma0 * sqrta * s;
 
         //Lagrange coefficients
-        F  = 1 - a / R * (1 - cos(DE));
-        G  = a * sigma0 / sqrt(mu) * (1 - cos(DE)) + R * sqrt(a / mu) * sin(DE);
-        Ft = -sqrt(mu * a) / (r * R) * sin(DE);
-        Gt = 1 - a / r * (1 - cos(DE));
+        F  = 1 - a / R * (1 - c);
+        G  = a * sigma0 / sqrt(mu) * (1 - c) + R * sqrt(a / mu) * s;
+        Ft = -sqrt(mu * a) / (r * R) * s;
+        Gt = 1 - a / r * (1 - c);
+
+        f_a = -0.5 * sigma0 * (1 - c) / (a * sqrta) - R * s / (a * a);
+        f_R = s / a;
+        f_s = (1 - c) / sqrta;
+        f_D = r / a;
+        r_a = 1 - c + 0.5 * sigma0 * s / sqrta;
+        r_R = c;
+        r_s = sqrta * s;
+        r_D = -(R - a) * s + sigma0 * sqrta * c;
+        F_a = -(1 - c) / R;
+        F_R = a * (1 - c) / (R * R);
+        F_D = -a * s / R;
+        G_a = (sigma0 * (1 - c) + 0.5 * R * s / sqrta) / sqrtmu;
+        G_R = sqrta * s / sqrtmu;
+        G_s = a * (1 - c) / sqrtmu;
+        G_D = (a * sigma0 * s + R * sqrta * c) / sqrtmu;
+        Ft_a = -sqrtmu * s / (2 * sqrta * r * R);
+        Ft_D = -sqrtmu * sqrta * c / (r * R);
+        Gt_a = -(1 - c) / r;
+        Gt_D = -a * s / r;
     }
-    else{	//Solve Kepler's equation, hyperbolic case
+    else{	//Hyperbolic case
         sqrta = sqrt(-a);
-        double DN = sqrt(-mu / pow(a,3)) * t;
-        double DH;
-        t > 0 ? DH = 1 : DH = -1; // TODO: find a better initial guess. I tried with 0 and D (both have numercial problems and result in exceptions)
-
-        //Solve Kepler Equation for hyperbolae in DH (hyperbolic anomaly difference)
-        //newton_raphson(DH,boost::bind(kepDH,_1,DN,sigma0,sqrta,a,R),boost::bind(d_kepDH,_1,sigma0,sqrta,a,R),100,ASTRO_TOLERANCE);
-        std::pair<double, double> result;
-        boost::uintmax_t iter = ASTRO_MAX_ITER;
-        boost::math::tools::eps_tolerance<double> tol(64);
-        result = boost::math::tools::bracket_and_solve_root(boost::bind(kepDH,_1,DN,sigma0,sqrta,a,R),DH,2.0,true,tol,iter);
-        DH = (result.first + result.second) / 2;
-        double r = a + (R - a) * cosh(DH) + sigma0 * sqrta * sinh(DH);
+        DM = sqrt(-mu / pow(a,3)) * t;
+        double DH = chi / sqrta;
+        double c = cosh(DH), s = sinh(DH);
+        r = a + (R - a) * c + sigma0 * sqrta * s;
 
         //Lagrange coefficients
-        F  = 1 - a / R * (1 - cosh(DH));
-        G  = a * sigma0 / sqrt(mu) * (1 - cosh(DH)) + R * sqrt(-a / mu) * sinh(DH);
-        Ft = -sqrt(-mu * a) / (r * R) * sinh(DH);
-        Gt = 1 - a / r * (1 - cosh(DH));
+        F  = 1 - a / R * (1 - c);
+        G  = a * sigma0 / sqrt(mu) * (1 - c) + R * sqrt(-a / mu) * s;
+        Ft = -sqrt(-mu * a) / (r * R) * s;
+        Gt = 1 - a / r * (1 - c);
+
+        f_a = 0.5 * sigma0 * (1 - c) / (a * sqrta) + R * s / (a * a);
+        f_R = -s / a;
+        f_s = (c - 1) / sqrta;
+        f_D = -r / a;
+        r_a = 1 - c - 0.5 * sigma0 * s / sqrta;
+        r_R = c;
+        r_s = sqrta * s;
+        r_D = (R - a) * s + sigma0 * sqrta * c;
+        F_a = -(1 - c) / R;
+        F_R = a * (1 - c) / (R * R);
+        F_D = a * s / R;
+        G_a = (sigma0 * (1 - c) - 0.5 * R * s / sqrta) / sqrtmu;
+        G_R = sqrta * s / sqrtmu;
+        G_s = a * (1 - c) / sqrtmu;
+        G_D = (-a * sigma0 * s + R * sqrta * c) / sqrtmu;
+        Ft_a = sqrtmu * s / (2 * sqrta * r * R);
+        Ft_D = -sqrtmu * sqrta * c / (r * R);
+        Gt_a = -(1 - c) / r;
+        Gt_D = a * s / r;
+    }
+
+    // The mean anomaly difference depends on a only, as DM/da = -1.5 DM / a
+    f_a += 1.5 * DM / a;
+    for (int k=0;k<6;k++){
+        // Derivatives of R, sigma0 and a with respect to the k-th component of (r0,v0)
+        double dR = (k < 3) ? r0[k] / R : 0;
+        double ds = ((k < 3) ? v0[k] : r0[k-3]) / sqrtmu;
+        double da = 2 * a * a / mu * ((k < 3) ? mu * r0[k] / (R * R * R) : v0[k-3]);
+        double dD = -(f_a * da + f_R * dR + f_s * ds) / f_D;
+        double dr = r_a * da + r_R * dR + r_s * ds + r_D * dD;
+        double dF = F_a * da + F_R * dR + F_D * dD;
+        double dG = G_a * da + G_R * dR + G_s * ds + G_D * dD;
+        double dFt = Ft_a * da - Ft / R * dR + Ft_D * dD - Ft / r * dr;
+        double dGt = Gt_a * da + Gt_D * dD + (1 - Gt) / r * dr;
+        for (int i=0;i<3;i++){
+            stm[i][k] = r0[i] * dF + v0[i] * dG;
+            stm[i+3][k] = r0[i] * dFt + v0[i] * dGt;
+        }
+    }
+    for (int i=0;i<3;i++){
+        stm[i][i] += F;
+        stm[i][i+3] += G;
+        stm[i+3][i] += Ft;
+        stm[i+3][i+3] += Gt;
     }
 
     double temp[3] = {r0[0],r0[1],r0[2]};
@@ -0,0 +1,183 @@
+/*****************************************************************************
+ *   Copyright (C) 2004-2012 The PyKEP development team,                     *
+ *   Advanced Concepts Team (ACT), European Space Agency (ESA)               *
+ *   http://keptoolbox.sourceforge.net/index.html                            *
+ *   http://keptoolbox.sourceforge.net/credits.html                          *
+ *                                                                           *
+ *   act@esa.int                                                             *
+ *                                                                           *
+ *   This program is free software; you can redistribute it and/or modify    *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   This program is distributed in the hope that it will be useful,         *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with this program; if not, write to the                           *
+ *   Free Software Foundation, Inc.,                                         *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.               *
+ *****************************************************************************/
+
+#ifndef PROPAGATE_LAGRANGIAN_BATCH_H
+#define PROPAGATE_LAGRANGIAN_BATCH_H
+
+#include<algorithm>
+#include<cmath>
+#include<cstddef>
+
+#include"../astro_constants.h"
+#include"../exceptions.h"
+#include"stumpff.h"
+
+namespace kep_toolbox {
+
+/// One Laguerre-Conway iteration on Kepler's equation in the universal anomaly
+/**
+ * Kepler's equation is written as \f$ \sqrt\mu t = \sigma_0 \chi^2 C(z) + (1 - \alpha R) \chi^3 S(z) + R \chi \f$, with
+ * \f$ z = \alpha \chi^2 \f$, and holds for elliptical, parabolic and hyperbolic orbits alike.
+ *
+ * \param[in] R initial radius
+ * \param[in] sigma0 initial r.v / sqrt(mu)
+ * \param[in] alpha reciprocal of the semi-major axis, 2 / R - v^2 / mu
+ * \param[in] tau sqrt(mu) t
+ * \param[in] chi current universal anomaly
+ *
+ * \return the updated universal anomaly
+ */
+inline double laguerre_step_universal(const double &R, const double &sigma0, const double &alpha, const double &tau, const double &chi)
+{
+    double C, S;
+    double chi2 = chi*chi;
+    double z = alpha*chi2;
+    stumpff_cs(z, C, S);
+    double b = 1 - alpha*R;
+    double F = sigma0*chi2*C + b*chi2*chi*S + R*chi - tau;
+    double dF = sigma0*chi*(1 - z*S) + b*chi2*C + R;
+    double ddF = sigma0*(1 - z*C) + b*chi*(1 - z*S);
+    double disc = std::sqrt(std::abs(16*dF*dF - 20*F*ddF));
+    double den = (dF < 0) ? dF - disc : dF + disc;
+    return (den == 0) ? chi : chi - 5*F/den;
+}
+
+/// Solves Kepler's equation in the universal anomaly for a batch of propagations
+/**
+ * All lanes take the same, fixed, number of Laguerre-Conway iterations, so that the loops have no data dependent
+ * exits. The method converges cubically from the initial guesses used, and only the lanes whose last correction was
+ * not negligible are iterated further, one at a time.
+ *
+ * \param[in] n number of propagations
+ * \param[in] R initial radii
+ * \param[in] sigma0 initial r.v / sqrt(mu)
+ * \param[in] alpha reciprocals of the semi-major axes
+ * \param[in] tau sqrt(mu) t
+ * \param[out] chi universal anomalies
+ *
+ * \throw value_error if a lane does not converge in ASTRO_MAX_ITER further iterations
+ *
+ * @see laguerre_step_universal
+ */
+inline void solve_universal_anomaly(const std::size_t &n, const double *R, const double *sigma0, const double *alpha, const double *tau, double *chi)
+{
+    const int n_iter = 4;
+    const double rtol = 1e-8;
+
+    //Initial guesses (Vallado)
+    for (std::size_t j = 0; j < n; ++j) {
+        double guess = tau[j] / R[j];
+        if (alpha[j] > 1e-12) {
+            guess = tau[j] * alpha[j];
+        } else if (alpha[j] < -1e-12) {
+            double sqrta = std::sqrt(-1 / alpha[j]);
+            double sign = (tau[j] < 0) ? -1 : 1;
+            double arg = -2 * alpha[j] * tau[j] / (sigma0[j] + sign * sqrta * (1 - R[j] * alpha[j]));
+            if (arg > 0) guess = sign * sqrta * std::log(arg);
+        }
+        chi[j] = guess;
+    }
+
+    //The same iterations for every lane
+    for (int it = 0; it < n_iter; ++it) {
+        for (std::size_t j = 0; j < n; ++j) {
+            chi[j] = laguerre_step_universal(R[j], sigma0[j], alpha[j], tau[j], chi[j]);
+        }
+    }
+
+    //Lanes still moving are finished on their own
+    for (std::size_t j = 0; j < n; ++j) {
+        double next = laguerre_step_universal(R[j], sigma0[j], alpha[j], tau[j], chi[j]);
+        int it = 0;
+        while (std::abs(next - chi[j]) > rtol * std::max(1., std::abs(chi[j]))) {
+            if (++it > ASTRO_MAX_ITER) throw_value_error("Maximum number of iteration reached");
+            chi[j] = next;
+            next = laguerre_step_universal(R[j], sigma0[j], alpha[j], tau[j], chi[j]);
+        }
+        chi[j] = next;
+    }
+}
+
+/// Lagrangian propagation of a batch of states
+/**
+ * This function propagates n initial states, each for its own time, assuming a central body and a keplerian motion.
+ * The states are stored by component (structure of arrays) and are processed in blocks of lanes: the universal anomalies
+ * of a block are found by solve_universal_anomaly and the states are then advanced with the Lagrange coefficients. All
+ * units systems can be used, as long as the input parameters are all expressed in the same system.
+ *
+ * \param[in] n number of states
+ * \param[in,out] rx,ry,rz initial position components. On output contain the propagated positions.
+ * \param[in,out] vx,vy,vz initial velocity components. On output contain the propagated velocities.
+ * \param[in] t propagation times (can be negative)
+ * \param[in] mu central body gravitational parameter
+ *
+ * @see propagate_lagrangian
+ */
+inline void propagate_lagrangian_batch(const std::size_t &n, double *rx, double *ry, double *rz, double *vx, double *vy, double *vz, const double *t, const double &mu)
+{
+    const std::size_t lanes = 64;
+    double R[lanes], sigma0[lanes], alpha[lanes], tau[lanes], chi[lanes];
+    const double sqrtmu = std::sqrt(mu);
+
+    for (std::size_t first = 0; first < n; first += lanes) {
+        const std::size_t m = std::min(lanes, n - first);
+        double *x = rx + first, *y = ry + first, *z = rz + first;
+        double *u = vx + first, *v = vy + first, *w = vz + first;
+
+        for (std::size_t j = 0; j < m; ++j) {
+            R[j] = std::sqrt(x[j]*x[j] + y[j]*y[j] + z[j]*z[j]);
+            alpha[j] = 2 / R[j] - (u[j]*u[j] + v[j]*v[j] + w[j]*w[j]) / mu;
+            sigma0[j] = (x[j]*u[j] + y[j]*v[j] + z[j]*w[j]) / sqrtmu;
+            tau[j] = sqrtmu * t[first + j];
+        }
+
+        solve_universal_anomaly(m, R, sigma0, alpha, tau, chi);
+
+        for (std::size_t j = 0; j < m; ++j) {
+            double C, S;
+            double chi2 = chi[j]*chi[j];
+            double zeta = alpha[j]*chi2;
+            stumpff_cs(zeta, C, S);
+            double r = sigma0[j]*chi[j]*(1 - zeta*S) + (1 - alpha[j]*R[j])*chi2*C + R[j];
+
+            //Lagrange coefficients
+            double F  = 1 - chi2*C / R[j];
+            double G  = (sigma0[j]*chi2*C + R[j]*chi[j]*(1 - zeta*S)) / sqrtmu;
+            double Ft = sqrtmu / (r*R[j]) * chi[j] * (zeta*S - 1);
+            double Gt = 1 - chi2*C / r;
+
+            double x0 = x[j], y0 = y[j], z0 = z[j];
+            x[j] = F*x0 + G*u[j];
+            y[j] = F*y0 + G*v[j];
+            z[j] = F*z0 + G*w[j];
+            u[j] = Ft*x0 + Gt*u[j];
+            v[j] = Ft*y0 + Gt*v[j];
+            w[j] = Ft*z0 + Gt*w[j];
+        }
+    }
+}
+
+} //Namespace
+
+#endif // PROPAGATE_LAGRANGIAN_BATCH_H
@@ -28,14 +28,39 @@
 
 #include<algorithm>
 #include<cmath>
+#include<vector>
 #include<boost/array.hpp>
 
 #include"../exceptions.h"
 
 namespace kep_toolbox {
 
-template<class T>
-double propagate_taylor_step(T& r0, T& v0, double &m0, const double &h, const int &order, const T &thrust, const double &mu, const double &veff, const double &xm, const double &eps_a, const double &eps_r, std::vector< boost::array<double,7> > &x, std::vector< boost::array<double,21> > &u){
+/// Memory for the Taylor coefficients of propagate_taylor
+/**
+ * The common polynomial orders, 10 to 25, keep their coefficients on the stack and only the other orders use it. A caller
+ * propagating many arcs at such orders can keep one workspace and pass it to every call, so that the coefficient
+ * arrays are allocated once rather than once per call. A workspace must not be shared between threads.
+ */
+struct taylor_workspace {
+	/// Makes room for the coefficients up to the given order and clears the accumulated ones
+	void reset(const int &order) {
+		if ((int)x.size() < order + 1) x.resize(order + 1);
+		if ((int)u.size() < order) u.resize(order);
+		for (int i=0;i<order;++i) u[i].assign(0);
+	}
+	std::vector< boost::array<double,7> > x;   // x[order][var]
+	std::vector< boost::array<double,21> > u;   // u[order][var]
+};
+
+/// One step of propagate_taylor, for coefficient containers X and U of any kind
+/**
+ * If fixed_order is positive it is used as the polynomial order, so that all the loop bounds are known at compile
+ * time, and the run-time order is ignored. The elements of u must be zero on entry.
+ */
+template<int fixed_order, class T, class X, class U>
+double propagate_taylor_step_impl(T& r0, T& v0, double &m0, const double &h, const int &runtime_order, const T &thrust, const double &mu, const double &veff, const double &xm, const double &eps_a, const double &eps_r, X &x, U &u){
+
+    const int order = (fixed_order > 0) ? fixed_order : runtime_order;
 
     //We initialize the initial conditions
     x[0][0] = r0[0];
@@ -59,9 +84,20 @@ double propagate_taylor_step(T& r0, T& v0, double &m0, const double &h, const in
         u[n][4] = x[n][4];  //vy
         u[n][5] = x[n][5];  //vz
         u[n][6] = x[n][6];  //m
-        for (int j=0;j<=n;j++) u[n][7] += u[j][0]*u[n-j][0];  //x^2
-        for (int j=0;j<=n;j++) u[n][8] += u[j][1]*u[n-j][1];  //y^2
-        for (int j=0;j<=n;j++) u[n][9] += u[j][2]*u[n-j][2];  //z^2
+        //x^2, y^2, z^2: the Cauchy product of a series with itself is symmetric, so only half of it is summed
+        for (int j=0;j<(n+1)/2;j++) {
+            u[n][7] += u[j][0]*u[n-j][0];
+            u[n][8] += u[j][1]*u[n-j][1];
+            u[n][9] += u[j][2]*u[n-j][2];
+        }
+        u[n][7] *= 2;
+        u[n][8] *= 2;
+        u[n][9] *= 2;
+        if (n%2 == 0) {
+            u[n][7] += u[n/2][0]*u[n/2][0];
+            u[n][8] += u[n/2][1]*u[n/2][1];
+            u[n][9] += u[n/2][2]*u[n/2][2];
+        }
         u[n][10] = u[n][7] + u[n][8];  //x^2+y^2
         u[n][11] = u[n][10] + u[n][9];  //r^2
 
@@ -74,9 +110,11 @@ double propagate_taylor_step(T& r0, T& v0, double &m0, const double &h, const in
 
         u[n][13] = -u[n][12] * mu; //-mu/r^3
 
-        for (int j=0;j<=n;j++) u[n][14] += u[j][0]*u[n-j][13]; //-mu x /r^3
-        for (int j=0;j<=n;j++) u[n][15] += u[j][1]*u[n-j][13]; //-mu y /r^3
-        for (int j=0;j<=n;j++) u[n][16] += u[j][2]*u[n-j][13]; //-mu z /r^3
+        for (int j=0;j<=n;j++) {
+            u[n][14] += u[j][0]*u[n-j][13]; //-mu x /r^3
+            u[n][15] += u[j][1]*u[n-j][13]; //-mu y /r^3
+            u[n][16] += u[j][2]*u[n-j][13]; //-mu z /r^3
+        }
 
         if (n==0){
             u[n][17] = 1 / u[0][6];
@@ -147,6 +185,74 @@ double propagate_taylor_step(T& r0, T& v0, double &m0, const double &h, const in
     return step;
 }
 
+template<class T>
+double propagate_taylor_step(T& r0, T& v0, double &m0, const double &h, const int &order, const T &thrust, const double &mu, const double &veff, const double &xm, const double &eps_a, const double &eps_r, std::vector< boost::array<double,7> > &x, std::vector< boost::array<double,21> > &u){
+    return propagate_taylor_step_impl<0>(r0,v0,m0,h,order,thrust,mu,veff,xm,eps_a,eps_r,x,u);
+}
+
+/// One step of propagate_taylor at a polynomial order known at compile time, with the coefficients on the stack
+template<int order, class T>
+double propagate_taylor_step_fixed(T& r0, T& v0, double &m0, const double &h, const T &thrust, const double &mu, const double &veff, const double &xm, const double &eps_a, const double &eps_r){
+    boost::array<boost::array<double,7>, order + 1> x;
+    boost::array<boost::array<double,21>, order> u;
+    for (int i=0;i<order;++i) u[i].assign(0);
+    return propagate_taylor_step_impl<order>(r0,v0,m0,h,order,thrust,mu,veff,xm,eps_a,eps_r,x,u);
+}
+
+/// One step of propagate_taylor, on the stack for the common orders and in the workspace otherwise
+template<class T>
+double propagate_taylor_step(T& r0, T& v0, double &m0, const double &h, const int &order, const T &thrust, const double &mu, const double &veff, const double &xm, const double &eps_a, const double &eps_r, taylor_workspace &ws){
+#define KEP_TOOL_TAYLOR_CASE(N) case N: return propagate_taylor_step_fixed<N>(r0,v0,m0,h,thrust,mu,veff,xm,eps_a,eps_r);
+    switch (order) {
+        KEP_TOOL_TAYLOR_CASE(10) KEP_TOOL_TAYLOR_CASE(11) KEP_TOOL_TAYLOR_CASE(12) KEP_TOOL_TAYLOR_CASE(13)
+        KEP_TOOL_TAYLOR_CASE(14) KEP_TOOL_TAYLOR_CASE(15) KEP_TOOL_TAYLOR_CASE(16) KEP_TOOL_TAYLOR_CASE(17)
+        KEP_TOOL_TAYLOR_CASE(18) KEP_TOOL_TAYLOR_CASE(19) KEP_TOOL_TAYLOR_CASE(20) KEP_TOOL_TAYLOR_CASE(21)
+        KEP_TOOL_TAYLOR_CASE(22) KEP_TOOL_TAYLOR_CASE(23) KEP_TOOL_TAYLOR_CASE(24) KEP_TOOL_TAYLOR_CASE(25)
+        default:
+            ws.reset(order);
+            return propagate_taylor_step_impl<0>(r0,v0,m0,h,order,thrust,mu,veff,xm,eps_a,eps_r,ws.x,ws.u);
+    }
+#undef KEP_TOOL_TAYLOR_CASE
+}
+
+/// Taylor series propagation of a constant thrust trajectory, with caller-owned scratch memory
+/**
+ * Same as the overload below, with the memory for the polynomial orders that are not kept on the stack taken from ws.
+ *
+ * \param[in,out] ws scratch memory, see taylor_workspace
+ */
+template<class T>
+void propagate_taylor(T& r0, T& v0, double &m0, const T& u, const double &t0, const double &mu, const double &veff, const int &log10tolerance, const int &log10rtolerance, const int &max_iter, const int &max_order, taylor_workspace &ws){
+
+    double step = t0;
+    double eps_a = pow(10.,log10tolerance);
+    double eps_r = pow(10.,log10rtolerance);
+    double eps_m,xm;
+    int j;
+    for (j=0; j< max_iter; ++j) {
+        //We follow the method described by Jorba in "A software package ...."
+        //1 - We determine eps_m from Eq. (7)
+        xm = std::max(std::abs(r0[0]),std::abs(r0[1]));
+        xm = std::max(xm,std::abs(r0[2]));
+        xm = std::max(xm,std::abs(v0[0]));
+        xm = std::max(xm,std::abs(v0[1]));
+        xm = std::max(xm,std::abs(v0[2]));
+        xm = std::max(xm,std::abs(m0));
+
+        //2 - We evaluate the polynomial order
+        (eps_r*xm < eps_a) ? eps_m = eps_a : eps_m = eps_r;
+        int order = (int) ( ceil(-0.5*log(eps_m) + 1) );
+        if (order > max_order) throw_value_error("Polynomial order is too high.....");
+
+        //3 - We take the step, the coefficients live on the stack or in the workspace
+        double h = propagate_taylor_step(r0,v0,m0,step,order,u,mu,veff,xm, eps_a, eps_r,ws);
+        if (std::abs(h)>=std::abs(step)) break; else {
+            step = step - h;
+        }
+    }
+    if (j>max_iter-1) throw_value_error("Maximum number of iteration reached");
+}
+
 /// Taylor series propagation of a constant thrust trajectory
 /**
  * This template function propagates an initial state for a time t assuming a central body and a keplerian
@@ -171,14 +277,151 @@ double propagate_taylor_step(T& r0, T& v0, double &m0, const double &h, const in
  */
 template<class T>
 void propagate_taylor(T& r0, T& v0, double &m0, const T& u, const double &t0, const double &mu = 1, const double &veff = 1, const int &log10tolerance=-10, const int &log10rtolerance=-10, const int &max_iter = 10000, const int &max_order = 3000){
+    taylor_workspace ws;
+    propagate_taylor(r0,v0,m0,u,t0,mu,veff,log10tolerance,log10rtolerance,max_iter,max_order,ws);
+}
 
-    boost::array<double,7> dumb;
-    boost::array<double,21> dumb2;
-    for (int i=0;i<7;++i) dumb[i]=0;
-    for (int i=0;i<21;++i) dumb2[i]=0;
+/// Memory for the Taylor coefficients of propagate_taylor_stm
+/**
+ * Besides the coefficients of the state, each coefficient has its 10 partial derivatives with respect to the initial
+ * state and the thrust. A workspace must not be shared between threads.
+ */
+struct taylor_stm_workspace {
+	/// Makes room for the coefficients up to the given order and clears the accumulated ones
+	void reset(const int &order) {
+		state.reset(order);
+		if ((int)dx.size() < order + 1) dx.resize(order + 1);
+		if ((int)du.size() < order) du.resize(order);
+	}
+	taylor_workspace state;
+	std::vector< boost::array<boost::array<double,10>,7> > dx;   // dx[order][var][partial]
+	std::vector< boost::array<boost::array<double,10>,21> > du;   // du[order][var][partial]
+};
 
-    std::vector< boost::array<double,7> > _x;   // x[order][var]
-    std::vector< boost::array<double,21> > _u;   // u[order][var]
+/// Variational part of one step of propagate_taylor_stm
+/**
+ * Given the Taylor coefficients u of a step as computed by propagate_taylor_step_impl, this function differentiates
+ * the same recurrences to obtain the coefficients of the partial derivatives and advances the state transition matrix
+ * by the step. The step size is not differentiated, so that the result is the derivative of the numerical solution
+ * for the sequence of steps taken.
+ */
+template<class S, class T, class U>
+void propagate_taylor_variational_step(S& stm, const double &step, const int &order, const T &thrust, const double &mu, const double &veff, const U &u, taylor_stm_workspace &ws){
+    const int np = 10;
+    std::vector< boost::array<boost::array<double,10>,7> > &dx = ws.dx;
+    std::vector< boost::array<boost::array<double,10>,21> > &du = ws.du;
+
+    for (int i=0;i<7;++i) for (int k=0;k<np;++k) dx[0][i][k] = stm[i][k];
+
+    double alpha = -1.5; //Exponent for r^2
+    double beta = -1.; //Exponent for m
+    double sqrtT = sqrt(thrust[0]*thrust[0] + thrust[1]*thrust[1] + thrust[2]*thrust[2]);
+    for (int n=0;n<order;++n) {
+        for (int i=0;i<7;++i) for (int k=0;k<np;++k) du[n][i][k] = dx[n][i][k];
+        //x^2, y^2, z^2
+        for (int i=7;i<21;++i) du[n][i].assign(0);
+        for (int j=0;j<=n;++j) {
+            for (int k=0;k<np;++k) {
+                du[n][7][k] += 2 * du[j][0][k]*u[n-j][0];
+                du[n][8][k] += 2 * du[j][1][k]*u[n-j][1];
+                du[n][9][k] += 2 * du[j][2][k]*u[n-j][2];
+            }
+        }
+        for (int k=0;k<np;++k) {
+            du[n][10][k] = du[n][7][k] + du[n][8][k];  //x^2+y^2
+            du[n][11][k] = du[n][10][k] + du[n][9][k];  //r^2
+        }
+        //r^-3
+        if (n==0) {
+            for (int k=0;k<np;++k) du[0][12][k] = alpha * u[0][12] / u[0][11] * du[0][11][k];
+        } else {
+            for (int j=0;j<n;++j) {
+                double c = alpha*n - j*(alpha+1);
+                for (int k=0;k<np;++k) du[n][12][k] += c * (du[n-j][11][k]*u[j][12] + u[n-j][11]*du[j][12][k]);
+            }
+            for (int k=0;k<np;++k) du[n][12][k] = (du[n][12][k] - n*du[0][11][k]*u[n][12]) / (n*u[0][11]);
+        }
+        for (int k=0;k<np;++k) du[n][13][k] = -du[n][12][k] * mu; //-mu/r^3
+        for (int j=0;j<=n;++j) {
+            for (int k=0;k<np;++k) {
+                du[n][14][k] += du[j][0][k]*u[n-j][13] + u[j][0]*du[n-j][13][k]; //-mu x /r^3
+                du[n][15][k] += du[j][1][k]*u[n-j][13] + u[j][1]*du[n-j][13][k]; //-mu y /r^3
+                du[n][16][k] += du[j][2][k]*u[n-j][13] + u[j][2]*du[n-j][13][k]; //-mu z /r^3
+            }
+        }
+        //1/m
+        if (n==0) {
+            for (int k=0;k<np;++k) du[0][17][k] = beta * u[0][17] / u[0][6] * du[0][6][k];
+        } else {
+            for (int j=0;j<n;++j) {
+                double c = beta*n - j*(beta+1);
+                for (int k=0;k<np;++k) du[n][17][k] += c * (du[n-j][6][k]*u[j][17] + u[n-j][6]*du[j][17][k]);
+            }
+            for (int k=0;k<np;++k) du[n][17][k] = (du[n][17][k] - n*du[0][6][k]*u[n][17]) / (n*u[0][6]);
+        }
+        for (int k=0;k<np;++k) {
+            du[n][18][k] = du[n][14][k] + du[n][17][k] * thrust[0];  // eq1
+            du[n][19][k] = du[n][15][k] + du[n][17][k] * thrust[1];  // eq2
+            du[n][20][k] = du[n][16][k] + du[n][17][k] * thrust[2];  // eq3
+        }
+        // the thrust is the parameter of the last three partials
+        du[n][18][7] += u[n][17];
+        du[n][19][8] += u[n][17];
+        du[n][20][9] += u[n][17];
+
+        for (int k=0;k<np;++k) {
+            dx[n+1][0][k] = 1./(n+1) * du[n][3][k];
+            dx[n+1][1][k] = 1./(n+1) * du[n][4][k];
+            dx[n+1][2][k] = 1./(n+1) * du[n][5][k];
+            dx[n+1][3][k] = 1./(n+1) * du[n][18][k];
+            dx[n+1][4][k] = 1./(n+1) * du[n][19][k];
+            dx[n+1][5][k] = 1./(n+1) * du[n][20][k];
+            dx[n+1][6][k] = 0;
+        }
+        if (n==0 && sqrtT > 0) {
+            for (int j=0;j<3;++j) dx[1][6][7+j] = - thrust[j] / sqrtT / veff;
+        }
+    }
+
+    //The sum of the series, as for the state
+    double steppow = step;
+    for(int j=1; j<=order;++j){
+        for (int i=0;i<6;++i) for (int k=0;k<np;++k) stm[i][k] += dx[j][i][k]*steppow;
+        steppow*=step;
+    }
+    for (int k=0;k<np;++k) stm[6][k] += dx[1][6][k] * step;
+}
+
+/// Taylor series propagation of a constant thrust trajectory with its state transition matrix
+/**
+ * This template function propagates the state as propagate_taylor and also integrates the variational equations, so
+ * that it returns the partial derivatives of the final state with respect to the initial state and the thrust. These
+ * are obtained by differentiating the recurrences of the Taylor coefficients, with the steps taken for the state.
+ *
+ * \param[in,out] r0 initial position vector. On output contains the propagated position.
+ * \param[in,out] v0 initial velocity vector. On output contains the propagated velocity.
+ * \param[in,out] m0 initial mass. On output contains the propagated mass.
+ * \param[in] u thrust vector (cartesian components)
+ * \param[in] t0 propagation time (can be negative)
+ * \param[in] mu central body gravitational parameter
+ * \param[in] veff the product Isp g0
+ * \param[in] log10tolerance logarithm of the desired absolute tolerance
+ * \param[in] log10rtolerance logarithm of the desired relative tolerance
+ * \param[out] stm 7x10 matrix, stm[i][j] being the derivative of (r,v,m)[i] with respect to (r0,v0,m0,u)[j]
+ * (suggested template type is boost::array<boost::array<double,10>,7>)
+ * \param[in,out] ws scratch memory, see taylor_stm_workspace
+ * \param[in] max_iter maximum number of iteration allowed
+ * \param[in] max_order maximum order for the polynomial expansion
+ *
+ * \throw value_error if max_iter is hit.....
+ * \throw value_error if max_order is exceeded.....
+ *
+ * @see propagate_taylor
+ */
+template<class T, class S>
+void propagate_taylor_stm(T& r0, T& v0, double &m0, const T& u, const double &t0, const double &mu, const double &veff, const int &log10tolerance, const int &log10rtolerance, S& stm, taylor_stm_workspace &ws, const int &max_iter = 10000, const int &max_order = 3000){
+
+    for (int i=0;i<7;++i) for (int k=0;k<10;++k) stm[i][k] = (i==k) ? 1 : 0;
 
     double step = t0;
     double eps_a = pow(10.,log10tolerance);
@@ -186,8 +429,6 @@ void propagate_taylor(T& r0, T& v0, double &m0, const T& u, const double &t0, co
     double eps_m,xm;
     int j;
     for (j=0; j< max_iter; ++j) {
-        //We follow the method described by Jorba in "A software package ...."
-        //1 - We determine eps_m from Eq. (7)
         xm = std::max(std::abs(r0[0]),std::abs(r0[1]));
         xm = std::max(xm,std::abs(r0[2]));
         xm = std::max(xm,std::abs(v0[0]));
@@ -195,15 +436,14 @@ void propagate_taylor(T& r0, T& v0, double &m0, const T& u, const double &t0, co
         xm = std::max(xm,std::abs(v0[2]));
         xm = std::max(xm,std::abs(m0));
 
-        //2 - We evaluate the polynomial order
         (eps_r*xm < eps_a) ? eps_m = eps_a : eps_m = eps_r;
         int order = (int) ( ceil(-0.5*log(eps_m) + 1) );
         if (order > max_order) throw_value_error("Polynomial order is too high.....");
 
-        //3 - We allocate or deallocate memory if necessary
-        _x.assign(order+1,dumb);
-        _u.assign(order,dumb2);
-        double h = propagate_taylor_step(r0,v0,m0,step,order,u,mu,veff,xm, eps_a, eps_r,_x,_u);
+        //The state step leaves its coefficients in the workspace, where the variational step differentiates them
+        ws.reset(order);
+        double h = propagate_taylor_step_impl<0>(r0,v0,m0,step,order,u,mu,veff,xm,eps_a,eps_r,ws.state.x,ws.state.u);
+        propagate_taylor_variational_step(stm,h,order,u,mu,veff,ws.state.u,ws);
         if (std::abs(h)>=std::abs(step)) break; else {
             step = step - h;
         }
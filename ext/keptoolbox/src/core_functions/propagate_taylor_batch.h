@@ -0,0 +1,303 @@
+/*****************************************************************************
+ *   Copyright (C) 2004-2012 The PyKEP development team,                     *
+ *   Advanced Concepts Team (ACT), European Space Agency (ESA)               *
+ *   http://keptoolbox.sourceforge.net/index.html                            *
+ *   http://keptoolbox.sourceforge.net/credits.html                          *
+ *                                                                           *
+ *   act@esa.int                                                             *
+ *                                                                           *
+ *   This program is free software; you can redistribute it and/or modify    *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   This program is distributed in the hope that it will be useful,         *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with this program; if not, write to the                           *
+ *   Free Software Foundation, Inc.,                                         *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.               *
+ *****************************************************************************/
+
+#ifndef PROPAGATE_TAYLOR_BATCH_H
+#define PROPAGATE_TAYLOR_BATCH_H
+
+#include<algorithm>
+#include<cmath>
+#include<cstddef>
+#include<vector>
+
+#include"../exceptions.h"
+
+namespace kep_toolbox {
+
+/// Memory for the Taylor coefficients of propagate_taylor_batch
+/**
+ * The coefficients are stored lane-major: for every order and variable the values of all the lanes of a block are
+ * contiguous, so that the Cauchy products run over the lanes in the innermost loop. A workspace must not be shared
+ * between threads.
+ */
+struct taylor_batch_workspace {
+	/// Makes room for the coefficients up to the given order of width lanes
+	void reset(const int &order, const std::size_t &width) {
+		if (x.size() < (order + 1) * 7 * width) x.resize((order + 1) * 7 * width);
+		if (u.size() < order * 21 * width) u.resize(order * 21 * width);
+		if (lane.size() < 7 * width) lane.resize(7 * width);
+	}
+	std::vector<double> x;   // x[(order*7 + var)*width + lane]
+	std::vector<double> u;   // u[(order*21 + var)*width + lane]
+	std::vector<double> lane;   // per lane thrust, |thrust|, xm, step and its powers
+	std::vector<std::size_t> active;   // the lanes of the block still propagating
+	std::vector<double> remaining;   // the time left to each lane of the block
+};
+
+/// Number of lanes whose sums the Cauchy products of propagate_taylor_batch_step keep in registers
+const std::size_t taylor_batch_chunk = 8;
+
+/// Cauchy product of two lane-major series over one chunk of lanes
+/**
+ * Returns in out[k] the sum over j in [j0, j1) of (c0 + c1 j) a_j[k] b_{n-j}[k], for the taylor_batch_chunk lanes
+ * starting at out, where the coefficients of order i of the two series are found at a + i stride and b + i stride.
+ */
+inline void taylor_batch_cauchy(double *out, const double *a, const double *b, const std::size_t &stride, const int &n, const int &j0, const int &j1, const double &c0, const double &c1){
+    double acc[taylor_batch_chunk];
+    for (std::size_t k=0;k<taylor_batch_chunk;++k) acc[k] = 0;
+    for (int j=j0;j<j1;++j) {
+        const double c = c0 + c1*j;
+        const double *aj = a + j*stride, *bj = b + (n-j)*stride;
+        for (std::size_t k=0;k<taylor_batch_chunk;++k) acc[k] += c*aj[k]*bj[k];
+    }
+    for (std::size_t k=0;k<taylor_batch_chunk;++k) out[k] = acc[k];
+}
+
+/// One step of propagate_taylor_batch for the w packed lanes of a workspace
+/**
+ * This is propagate_taylor_step_impl with every operation applied to w lanes at once. All lanes share the polynomial
+ * order and each takes its own step size. The width w must be a multiple of taylor_batch_chunk. On entry the rows
+ * x[0][0..6] hold the packed states and the lane rows the thrust components, xm and the time left, on exit the states
+ * are advanced and the lane row 5 holds the steps taken.
+ *
+ * @see propagate_taylor_step_impl
+ */
+inline void propagate_taylor_batch_step(const std::size_t &w, const int &order, const double &mu, const double &veff, const double &eps_a, const double &eps_r, taylor_batch_workspace &ws){
+
+    double *x = &ws.x[0];
+    double *u = &ws.u[0];
+    const double *tx = &ws.lane[0], *ty = &ws.lane[w], *tz = &ws.lane[2*w];
+    double *sqrtT = &ws.lane[3*w], *xm = &ws.lane[4*w], *step = &ws.lane[5*w], *steppow = &ws.lane[6*w];
+
+    const double alpha = -1.5; //Exponent for r^2
+    const double beta = -1.; //Exponent for m
+    for (std::size_t k=0;k<w;++k) sqrtT[k] = std::sqrt(tx[k]*tx[k] + ty[k]*ty[k] + tz[k]*tz[k]);
+
+    //We compute all needed taylor coefficients via automated differentiation
+    for (int n=0;n<order;++n) {
+        double *xn = x + n*7*w, *xn1 = x + (n+1)*7*w, *un = u + n*21*w;
+        for (int i=0;i<7;++i) std::copy(xn + i*w, xn + (i+1)*w, un + i*w);
+
+        //x^2, y^2, z^2, halved as in propagate_taylor
+        const std::size_t stride = 21*w;
+        for (int i=0;i<3;++i) {
+            double *sq = un + (7+i)*w;
+            const double *a = u + i*w;
+            for (std::size_t k0=0;k0<w;k0+=taylor_batch_chunk) taylor_batch_cauchy(sq+k0,a+k0,a+k0,stride,n,0,(n+1)/2,2,0);
+            if (n%2 == 0) {
+                const double *h = a + (n/2)*stride;
+                for (std::size_t k=0;k<w;++k) sq[k] += h[k]*h[k];
+            }
+        }
+        for (std::size_t k=0;k<w;++k) {
+            un[10*w+k] = un[7*w+k] + un[8*w+k];  //x^2+y^2
+            un[11*w+k] = un[10*w+k] + un[9*w+k];  //r^2
+        }
+
+        //r^-3
+        double *r3 = un + 12*w;
+        const double *r2 = u + 11*w;
+        if (n==0) {
+            for (std::size_t k=0;k<w;++k) r3[k] = std::sqrt(1./(r2[k]*r2[k]*r2[k]));
+        } else {
+            for (std::size_t k0=0;k0<w;k0+=taylor_batch_chunk) taylor_batch_cauchy(r3+k0,u+12*w+k0,r2+k0,stride,n,0,n,alpha*n,-(alpha+1));
+            for (std::size_t k=0;k<w;++k) r3[k] /= n*r2[k];
+        }
+        for (std::size_t k=0;k<w;++k) un[13*w+k] = -r3[k] * mu; //-mu/r^3
+
+        //-mu x /r^3, -mu y /r^3, -mu z /r^3
+        for (int i=0;i<3;++i) {
+            for (std::size_t k0=0;k0<w;k0+=taylor_batch_chunk) taylor_batch_cauchy(un+(14+i)*w+k0,u+i*w+k0,u+13*w+k0,stride,n,0,n+1,1,0);
+        }
+
+        //1/m
+        double *im = un + 17*w;
+        const double *m = u + 6*w;
+        if (n==0) {
+            for (std::size_t k=0;k<w;++k) im[k] = 1 / m[k];
+        } else {
+            for (std::size_t k0=0;k0<w;k0+=taylor_batch_chunk) taylor_batch_cauchy(im+k0,u+17*w+k0,m+k0,stride,n,0,n,beta*n,-(beta+1));
+            for (std::size_t k=0;k<w;++k) im[k] /= n*m[k];
+        }
+
+        const double inv = 1./(n+1);
+        for (std::size_t k=0;k<w;++k) {
+            un[18*w+k] = un[14*w+k] + im[k] * tx[k];  // eq1
+            un[19*w+k] = un[15*w+k] + im[k] * ty[k];  // eq2
+            un[20*w+k] = un[16*w+k] + im[k] * tz[k];  // eq3
+            xn1[k] = inv * un[3*w+k];
+            xn1[w+k] = inv * un[4*w+k];
+            xn1[2*w+k] = inv * un[5*w+k];
+            xn1[3*w+k] = inv * un[18*w+k];
+            xn1[4*w+k] = inv * un[19*w+k];
+            xn1[5*w+k] = inv * un[20*w+k];
+            xn1[6*w+k] = (n==0) ? - sqrtT[k] / veff : 0;
+        }
+    }
+
+    //Determining the optimal step size of each lane (see Jorba's method), step holds the time left on entry
+    const double *xo = x + order*7*w, *xo1 = x + (order-1)*7*w;
+    for (std::size_t k=0;k<w;++k) {
+        double xm_n = std::abs(xo[k]), xm_n1 = std::abs(xo1[k]);
+        for (int i=1;i<7;++i) {
+            xm_n = std::max(xm_n,std::abs(xo[i*w+k]));
+            xm_n1 = std::max(xm_n1,std::abs(xo1[i*w+k]));
+        }
+        double rho_m;
+        if (eps_r*xm[k] < eps_a) {
+            rho_m = std::min(pow((1/xm_n),1./order),pow((1/xm_n1),1./(order-1)));
+        } else {
+            rho_m = std::min(pow((xm[k]/xm_n),1./order),pow((xm[k]/xm_n1),1./(order-1)));
+        }
+        double h = step[k];
+        double s = rho_m/(M_E*M_E);
+        if (h<0) s = -s;
+        if (std::abs(s) > std::abs(h)) s = h;
+        step[k] = s;
+        steppow[k] = s;
+    }
+
+    //Horner's-Biscani method, the packed states are summed in place
+    for (int j=1;j<=order;++j) {
+        const double *xj = x + j*7*w;
+        for (int i=0;i<6;++i) {
+            double *s = x + i*w;
+            const double *c = xj + i*w;
+            for (std::size_t k=0;k<w;++k) s[k] += c[k]*steppow[k];
+        }
+        for (std::size_t k=0;k<w;++k) steppow[k] *= step[k];
+    }
+    for (std::size_t k=0;k<w;++k) x[6*w+k] += x[13*w+k] * step[k];
+}
+
+/// Taylor series propagation of a batch of constant thrust trajectories
+/**
+ * This function propagates n initial states, each with its own inertially constant thrust and for its own time, as
+ * propagate_taylor does for one. The states are stored by component (structure of arrays) and are processed in blocks
+ * of lanes that advance in lockstep: at each step the lanes of a block share the polynomial order, the highest one
+ * required by any of them, while each lane takes its own step size. A lane that has reached its final time is
+ * dropped from the block, so that the remaining steps are taken only by the lanes still propagating.
+ *
+ * \param[in] n number of states
+ * \param[in,out] rx,ry,rz initial position components. On output contain the propagated positions.
+ * \param[in,out] vx,vy,vz initial velocity components. On output contain the propagated velocities.
+ * \param[in,out] m initial masses. On output contain the propagated masses.
+ * \param[in] ux,uy,uz thrust components
+ * \param[in] t propagation times (can be negative)
+ * \param[in] mu central body gravitational parameter
+ * \param[in] veff the product Isp g0
+ * \param[in] log10tolerance logarithm of the desired absolute tolerance
+ * \param[in] log10rtolerance logarithm of the desired relative tolerance
+ * \param[in,out] ws scratch memory, see taylor_batch_workspace
+ * \param[in] max_iter maximum number of iteration allowed to each lane
+ * \param[in] max_order maximum order for the polynomial expansion
+ *
+ * \throw value_error if max_iter is hit.....
+ * \throw value_error if max_order is exceeded.....
+ *
+ * @see propagate_taylor
+ */
+inline void propagate_taylor_batch(const std::size_t &n, double *rx, double *ry, double *rz, double *vx, double *vy, double *vz, double *m, const double *ux, const double *uy, const double *uz, const double *t, const double &mu, const double &veff, const int &log10tolerance, const int &log10rtolerance, taylor_batch_workspace &ws, const int &max_iter = 10000, const int &max_order = 3000){
+
+    const std::size_t lanes = 64;
+    double *state[7] = {rx, ry, rz, vx, vy, vz, m};
+    const double *thrust[3] = {ux, uy, uz};
+    double eps_a = pow(10.,log10tolerance);
+    double eps_r = pow(10.,log10rtolerance);
+
+    for (std::size_t first = 0; first < n; first += lanes) {
+        const std::size_t last = std::min(n, first + lanes);
+
+        //The lanes with nothing to do are left as they are
+        ws.active.clear();
+        ws.remaining.clear();
+        for (std::size_t i = first; i < last; ++i) {
+            if (t[i] != 0) {
+                ws.active.push_back(i);
+                ws.remaining.push_back(t[i]);
+            }
+        }
+
+        for (int it = 0; !ws.active.empty(); ++it) {
+            if (it == max_iter) throw_value_error("Maximum number of iteration reached");
+            const std::size_t na = ws.active.size();
+
+            //1 - We determine eps_m from Eq. (7) and the polynomial order for each lane, the block takes the highest
+            int order = 0;
+            for (std::size_t k = 0; k < na; ++k) {
+                const std::size_t i = ws.active[k];
+                double xm = std::abs(state[0][i]);
+                for (int j = 1; j < 7; ++j) xm = std::max(xm,std::abs(state[j][i]));
+                double eps_m = (eps_r*xm < eps_a) ? eps_a : eps_r;
+                order = std::max(order, (int) ( ceil(-0.5*log(eps_m) + 1) ));
+            }
+            if (order > max_order) throw_value_error("Polynomial order is too high.....");
+
+            //2 - The states of the active lanes are packed in the workspace, padded to whole chunks with the last one
+            const std::size_t w = (na + taylor_batch_chunk - 1) / taylor_batch_chunk * taylor_batch_chunk;
+            ws.reset(order, w);
+            for (std::size_t k = 0; k < w; ++k) {
+                const std::size_t i = ws.active[std::min(k, na - 1)];
+                double xm = 0;
+                for (int j = 0; j < 7; ++j) {
+                    ws.x[j*w+k] = state[j][i];
+                    xm = std::max(xm,std::abs(state[j][i]));
+                }
+                for (int j = 0; j < 3; ++j) ws.lane[j*w+k] = thrust[j][i];
+                ws.lane[4*w+k] = xm;
+                ws.lane[5*w+k] = ws.remaining[std::min(k, na - 1)];
+            }
+
+            //3 - We take the step
+            propagate_taylor_batch_step(w, order, mu, veff, eps_a, eps_r, ws);
+
+            //4 - The states are unpacked and the lanes that have arrived are dropped
+            std::size_t kept = 0;
+            for (std::size_t k = 0; k < na; ++k) {
+                const std::size_t i = ws.active[k];
+                for (int j = 0; j < 7; ++j) state[j][i] = ws.x[j*w+k];
+                const double h = ws.lane[5*w+k];
+                if (std::abs(h) < std::abs(ws.remaining[k])) {
+                    ws.active[kept] = i;
+                    ws.remaining[kept] = ws.remaining[k] - h;
+                    ++kept;
+                }
+            }
+            ws.active.resize(kept);
+            ws.remaining.resize(kept);
+        }
+    }
+}
+
+/// Taylor series propagation of a batch of constant thrust trajectories
+/**
+ * Same as the overload above, with its own scratch memory.
+ */
+inline void propagate_taylor_batch(const std::size_t &n, double *rx, double *ry, double *rz, double *vx, double *vy, double *vz, double *m, const double *ux, const double *uy, const double *uz, const double *t, const double &mu = 1, const double &veff = 1, const int &log10tolerance = -10, const int &log10rtolerance = -10, const int &max_iter = 10000, const int &max_order = 3000){
+    taylor_batch_workspace ws;
+    propagate_taylor_batch(n,rx,ry,rz,vx,vy,vz,m,ux,uy,uz,t,mu,veff,log10tolerance,log10rtolerance,ws,max_iter,max_order);
+}
+
+} //Namespace
+
+#endif // PROPAGATE_TAYLOR_BATCH_H
@@ -34,8 +34,27 @@
 
 namespace kep_toolbox {
 
-template<class T>
-double propagate_taylor_s_step(T& r0, T& v0, double &m0, double &t0 , const double &sf, const int &order, const T &thrust, const double &mu, const double &sundmann_alpha, const double &sundmann_c, const double &veff, const double &xm, const double &eps_a, const double &eps_r, std::vector< boost::array<double,8> > &x, std::vector< boost::array<double,25> > &u){
+/// As taylor_workspace, for propagate_taylor_s
+struct taylor_s_workspace {
+	/// Makes room for the coefficients up to the given order and clears the accumulated ones
+	void reset(const int &order) {
+		if ((int)x.size() < order + 1) x.resize(order + 1);
+		if ((int)u.size() < order) u.resize(order);
+		for (int i=0;i<order;++i) u[i].assign(0);
+	}
+	std::vector< boost::array<double,8> > x;   // x[order][var]
+	std::vector< boost::array<double,25> > u;   // u[order][var]
+};
+
+/// One step of propagate_taylor_s, for coefficient containers X and U of any kind
+/**
+ * If fixed_order is positive it is used as the polynomial order, so that all the loop bounds are known at compile
+ * time, and the run-time order is ignored. The elements of u must be zero on entry.
+ */
+template<int fixed_order, class T, class X, class U>
+double propagate_taylor_s_step_impl(T& r0, T& v0, double &m0, double &t0 , const double &sf, const int &runtime_order, const T &thrust, const double &mu, const double &sundmann_alpha, const double &sundmann_c, const double &veff, const double &xm, const double &eps_a, const double &eps_r, X &x, U &u){
+
+    const int order = (fixed_order > 0) ? fixed_order : runtime_order;
 
     double sqrtT = sqrt(thrust[0]*thrust[0] + thrust[1]*thrust[1] + thrust[2]*thrust[2]);
 
@@ -63,9 +82,20 @@ double propagate_taylor_s_step(T& r0, T& v0, double &m0, double &t0 , const doub
         u[n][6] = x[n][6];  	//m
         u[n][7] = x[n][7];  	//time
 
-        for (int j=0;j<=n;j++) u[n][8]  += u[j][0]*u[n-j][0];  	//x^2
-        for (int j=0;j<=n;j++) u[n][9]  += u[j][1]*u[n-j][1];  	//y^2
-        for (int j=0;j<=n;j++) u[n][10] += u[j][2]*u[n-j][2]; 	//z^2
+        //x^2, y^2, z^2: the Cauchy product of a series with itself is symmetric, so only half of it is summed
+        for (int j=0;j<(n+1)/2;j++) {
+            u[n][8]  += u[j][0]*u[n-j][0];
+            u[n][9]  += u[j][1]*u[n-j][1];
+            u[n][10] += u[j][2]*u[n-j][2];
+        }
+        u[n][8]  *= 2;
+        u[n][9]  *= 2;
+        u[n][10] *= 2;
+        if (n%2 == 0) {
+            u[n][8]  += u[n/2][0]*u[n/2][0];
+            u[n][9]  += u[n/2][1]*u[n/2][1];
+            u[n][10] += u[n/2][2]*u[n/2][2];
+        }
         u[n][11] = u[n][8] + u[n][9] + u[n][10];  		//r^2
 
 
@@ -83,9 +113,11 @@ double propagate_taylor_s_step(T& r0, T& v0, double &m0, double &t0 , const doub
             u[n][13] = u[n][13] / n / u[0][11];
         } //1 / r^(3-alpha)
 
-        for (int j=0;j<=n;j++) u[n][14] += u[j][13]*u[n-j][0];	// 1 / r^(3-alpha) x
-        for (int j=0;j<=n;j++) u[n][15] += u[j][13]*u[n-j][1];	// 1 / r^(3-alpha) y
-        for (int j=0;j<=n;j++) u[n][16] += u[j][13]*u[n-j][2];	// 1 / r^(3-alpha) z
+        for (int j=0;j<=n;j++) {
+            u[n][14] += u[j][13]*u[n-j][0];	// 1 / r^(3-alpha) x
+            u[n][15] += u[j][13]*u[n-j][1];	// 1 / r^(3-alpha) y
+            u[n][16] += u[j][13]*u[n-j][2];	// 1 / r^(3-alpha) z
+        }
 
         if (n==0){
             u[n][17] = u[n][12] / u[n][6];
@@ -94,9 +126,11 @@ double propagate_taylor_s_step(T& r0, T& v0, double &m0, double &t0 , const doub
             u[n][17] = 1.0 / u[0][6] * (u[n][12] - u[n][17]);
         } // r^alpha/m
 
-        for (int j=0;j<=n;j++) u[n][18] += u[j][3]*u[n-j][12];				// eq1
-        for (int j=0;j<=n;j++) u[n][19] += u[j][4]*u[n-j][12];				// eq2
-        for (int j=0;j<=n;j++) u[n][20] += u[j][5]*u[n-j][12];				// eq3
+        for (int j=0;j<=n;j++) {
+            u[n][18] += u[j][3]*u[n-j][12];				// eq1
+            u[n][19] += u[j][4]*u[n-j][12];				// eq2
+            u[n][20] += u[j][5]*u[n-j][12];				// eq3
+        }
         u[n][21] = - mu * u[n][14] + u[n][17] * thrust[0];  				// eq4
         u[n][22] = - mu * u[n][15] + u[n][17] * thrust[1];  				// eq5
         u[n][23] = - mu * u[n][16] + u[n][17] * thrust[2];  				// eq6
@@ -163,43 +197,44 @@ double propagate_taylor_s_step(T& r0, T& v0, double &m0, double &t0 , const doub
     return step;
 }
 
-/// Taylor series propagation of a constant thrust arc using the Generalized Sundmann Transformation
+template<class T>
+double propagate_taylor_s_step(T& r0, T& v0, double &m0, double &t0 , const double &sf, const int &order, const T &thrust, const double &mu, const double &sundmann_alpha, const double &sundmann_c, const double &veff, const double &xm, const double &eps_a, const double &eps_r, std::vector< boost::array<double,8> > &x, std::vector< boost::array<double,25> > &u){
+    return propagate_taylor_s_step_impl<0>(r0,v0,m0,t0,sf,order,thrust,mu,sundmann_alpha,sundmann_c,veff,xm,eps_a,eps_r,x,u);
+}
+
+/// One step of propagate_taylor_s at a polynomial order known at compile time, with the coefficients on the stack
+template<int order, class T>
+double propagate_taylor_s_step_fixed(T& r0, T& v0, double &m0, double &t0 , const double &sf, const T &thrust, const double &mu, const double &sundmann_alpha, const double &sundmann_c, const double &veff, const double &xm, const double &eps_a, const double &eps_r){
+    boost::array<boost::array<double,8>, order + 1> x;
+    boost::array<boost::array<double,25>, order> u;
+    for (int i=0;i<order;++i) u[i].assign(0);
+    return propagate_taylor_s_step_impl<order>(r0,v0,m0,t0,sf,order,thrust,mu,sundmann_alpha,sundmann_c,veff,xm,eps_a,eps_r,x,u);
+}
+
+/// One step of propagate_taylor_s, on the stack for the common orders and in the workspace otherwise
+template<class T>
+double propagate_taylor_s_step(T& r0, T& v0, double &m0, double &t0 , const double &sf, const int &order, const T &thrust, const double &mu, const double &sundmann_alpha, const double &sundmann_c, const double &veff, const double &xm, const double &eps_a, const double &eps_r, taylor_s_workspace &ws){
+#define KEP_TOOL_TAYLOR_S_CASE(N) case N: return propagate_taylor_s_step_fixed<N>(r0,v0,m0,t0,sf,thrust,mu,sundmann_alpha,sundmann_c,veff,xm,eps_a,eps_r);
+    switch (order) {
+        KEP_TOOL_TAYLOR_S_CASE(10) KEP_TOOL_TAYLOR_S_CASE(11) KEP_TOOL_TAYLOR_S_CASE(12) KEP_TOOL_TAYLOR_S_CASE(13)
+        KEP_TOOL_TAYLOR_S_CASE(14) KEP_TOOL_TAYLOR_S_CASE(15) KEP_TOOL_TAYLOR_S_CASE(16) KEP_TOOL_TAYLOR_S_CASE(17)
+        KEP_TOOL_TAYLOR_S_CASE(18) KEP_TOOL_TAYLOR_S_CASE(19) KEP_TOOL_TAYLOR_S_CASE(20) KEP_TOOL_TAYLOR_S_CASE(21)
+        KEP_TOOL_TAYLOR_S_CASE(22) KEP_TOOL_TAYLOR_S_CASE(23) KEP_TOOL_TAYLOR_S_CASE(24) KEP_TOOL_TAYLOR_S_CASE(25)
+        default:
+            ws.reset(order);
+            return propagate_taylor_s_step_impl<0>(r0,v0,m0,t0,sf,order,thrust,mu,sundmann_alpha,sundmann_c,veff,xm,eps_a,eps_r,ws.x,ws.u);
+    }
+#undef KEP_TOOL_TAYLOR_S_CASE
+}
+
+/// Taylor series propagation of a constant thrust arc using the Generalized Sundmann Transformation, with caller-owned scratch memory
 /**
- * This template function propagates an initial state using the generalized Sundmann-Transformation. The independent variable thus is not
- * time, but \f$ ds = c r^\alpha dt \f$
+ * Same as the overload below, with the memory for the polynomial orders that are not kept on the stack taken from ws.
  *
- * \param[in,out]	r0 initial position vector. On output contains the propagated position. (r0[1],r0[2],r0[3] need to be preallocated, suggested template type is boost::array<double>,3))
- * \param[in,out]	v0 initial velocity vector. On output contains the propagated velocity. (v0[1],v0[2],v0[3] need to be preallocated, suggested template type is boost::array<double>,3))
- * \param[in,out]	m0 initial mass. On output contains the propagated value
- * \param[in,out]	t0 initial time. on output contains the propagated time
- * \param[in]		u  thrust vector
- * \param[in,out]	sf propagation pesudo-time (can be negative). If the maximum number of iterations is reached, the pseudo-time is returned where the state is calculated for the last time
- * \param[in]		mu central body gravitational parameter
- * \param[in]		veff the product g0*Isp characteristic of the engine
- * \param[in]		c constant in the generalized Sundmann transform defaults to 1.0
- * \param[in]		alpha exponent in the generalized Sundmann transform (defaults to 1.5)
- * \param[in]		log10tolerance logarithm of the desired absolute tolerance
- * \param[in]		log10rtolerance logarithm of the desired relative tolerance
- * \param[in]		max_iter maximum number of iteration allowed
- * \param[in]		max_order maximum order for the polynomial expansion
- *
- * \throw value_error if max_iter is hit.....
- * \throw value_error if max_order is exceeded.....
- *
- * NOTE: Equations of motions are written and propagated in cartesian coordinates
- *
- * @author Dario Izzo (dario.izzo _AT_ googlemail.com)
+ * \param[in,out] ws scratch memory, see taylor_s_workspace
  */
 template<class T>
-void propagate_taylor_s(T& r0, T& v0, double &m0, double &t0, const T& thrust, const double &sf, const double &mu = 1, const double &veff = 1, const double &c = 1.0, const double &alpha = 1.5, const int &log10tolerance=-10, const int &log10rtolerance=-10, const int &max_iter = 10000, const int &max_order = 3000){
-
-    boost::array<double,8> dumb;
-    boost::array<double,25> dumb2;
-    for (int i=0;i<8;++i) dumb[i]=0;
-    for (int i=0;i<25;++i) dumb2[i]=0;
-
-    std::vector< boost::array<double,8> > _x;   // x[order][var]
-    std::vector< boost::array<double,25> > _u;   // u[order][var]
+void propagate_taylor_s(T& r0, T& v0, double &m0, double &t0, const T& thrust, const double &sf, const double &mu, const double &veff, const double &c, const double &alpha, const int &log10tolerance, const int &log10rtolerance, const int &max_iter, const int &max_order, taylor_s_workspace &ws){
 
     double step = sf;
     double eps_a = pow(10.,log10tolerance);
@@ -222,10 +257,8 @@ void propagate_taylor_s(T& r0, T& v0, double &m0, double &t0, const T& thrust, c
         int order = (int) ( ceil(-0.5*log(eps_m) + 1) );
         if (order > max_order) throw_value_error("Polynomial order is too high.....");
 
-        //3 - We allocate or deallocate memory if necessary
-        _x.assign(order+1,dumb);
-        _u.assign(order,dumb2);
-        double h = propagate_taylor_s_step(r0,v0,m0,t0,step,order,thrust,mu,alpha,c,veff,xm, eps_a, eps_r,_x,_u);
+        //3 - We take the step, the coefficients live on the stack or in the workspace
+        double h = propagate_taylor_s_step(r0,v0,m0,t0,step,order,thrust,mu,alpha,c,veff,xm, eps_a, eps_r,ws);
         if (std::abs(h)>=std::abs(step)) break; else {
             step = step - h;
         }
@@ -233,6 +266,39 @@ void propagate_taylor_s(T& r0, T& v0, double &m0, double &t0, const T& thrust, c
     if (j>max_iter-1) throw_value_error("Maximum number of iteration reached in Taylor integration (sundmann)");
 }
 
+/// Taylor series propagation of a constant thrust arc using the Generalized Sundmann Transformation
+/**
+ * This template function propagates an initial state using the generalized Sundmann-Transformation. The independent variable thus is not
+ * time, but \f$ ds = c r^\alpha dt \f$
+ *
+ * \param[in,out]	r0 initial position vector. On output contains the propagated position. (r0[1],r0[2],r0[3] need to be preallocated, suggested template type is boost::array<double>,3))
+ * \param[in,out]	v0 initial velocity vector. On output contains the propagated velocity. (v0[1],v0[2],v0[3] need to be preallocated, suggested template type is boost::array<double>,3))
+ * \param[in,out]	m0 initial mass. On output contains the propagated value
+ * \param[in,out]	t0 initial time. on output contains the propagated time
+ * \param[in]		u  thrust vector
+ * \param[in,out]	sf propagation pesudo-time (can be negative). If the maximum number of iterations is reached, the pseudo-time is returned where the state is calculated for the last time
+ * \param[in]		mu central body gravitational parameter
+ * \param[in]		veff the product g0*Isp characteristic of the engine
+ * \param[in]		c constant in the generalized Sundmann transform defaults to 1.0
+ * \param[in]		alpha exponent in the generalized Sundmann transform (defaults to 1.5)
+ * \param[in]		log10tolerance logarithm of the desired absolute tolerance
+ * \param[in]		log10rtolerance logarithm of the desired relative tolerance
+ * \param[in]		max_iter maximum number of iteration allowed
+ * \param[in]		max_order maximum order for the polynomial expansion
+ *
+ * \throw value_error if max_iter is hit.....
+ * \throw value_error if max_order is exceeded.....
+ *
+ * NOTE: Equations of motions are written and propagated in cartesian coordinates
+ *
+ * @author Dario Izzo (dario.izzo _AT_ googlemail.com)
+ */
+template<class T>
+void propagate_taylor_s(T& r0, T& v0, double &m0, double &t0, const T& thrust, const double &sf, const double &mu = 1, const double &veff = 1, const double &c = 1.0, const double &alpha = 1.5, const int &log10tolerance=-10, const int &log10rtolerance=-10, const int &max_iter = 10000, const int &max_order = 3000){
+    taylor_s_workspace ws;
+    propagate_taylor_s(r0,v0,m0,t0,thrust,sf,mu,veff,c,alpha,log10tolerance,log10rtolerance,max_iter,max_order,ws);
+}
+
 } //Namespace kep_toolbox
 
 #endif // PROPAGATE_TAYLOR_S_H
@@ -62,6 +62,34 @@ inline double stumpff_c(const double x) {
 
 }
 
+/// Both Stumpff functions, C(x) and S(x), at once
+/**
+ * The square root and the trigonometric (or hyperbolic) functions are evaluated once for both. Close to x = 0, where the
+ * closed forms lose accuracy to cancellation, the series expansions are used instead.
+ */
+inline void stumpff_cs(const double x, double &c, double &s) {
+    if (std::abs(x) < 0.1)
+    {
+        c = 1./2 - x*(1./24 - x*(1./720 - x*(1./40320 - x*(1./3628800 - x/479001600.))));
+        s = 1./6 - x*(1./120 - x*(1./5040 - x*(1./362880 - x*(1./39916800 - x/6227020800.))));
+    }
+    else if (x > 0)
+    {
+        // 1 - cos is written as 2 sin^2 of the half angle, which does not cancel near x = 4 n^2 pi^2
+        double sx = std::sqrt(x);
+        double sh = std::sin(sx/2), ch = std::cos(sx/2);
+        c = 2*sh*sh/x;
+        s = (sx - 2*sh*ch)/(x*sx);
+    }
+    else
+    {
+        double sx = std::sqrt(-x);
+        double sh = std::sinh(sx/2), ch = std::cosh(sx/2);
+        c = 2*sh*sh/(-x);
+        s = (2*sh*ch - sx)/(-x*sx);
+    }
+}
+
 }
 
 #endif //STUMPFF_H
@@ -0,0 +1,134 @@
+/*****************************************************************************
+ *   Copyright (C) 2004-2012 The PyKEP development team,                     *
+ *   Advanced Concepts Team (ACT), European Space Agency (ESA)               *
+ *   http://keptoolbox.sourceforge.net/index.html                            *
+ *   http://keptoolbox.sourceforge.net/credits.html                          *
+ *                                                                           *
+ *   act@esa.int                                                             *
+ *                                                                           *
+ *   This program is free software; you can redistribute it and/or modify    *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   This program is distributed in the hope that it will be useful,         *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with this program; if not, write to the                           *
+ *   Free Software Foundation, Inc.,                                         *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.               *
+ *****************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+
+#include "kepler_table.h"
+#include "exceptions.h"
+#include "core_functions/convert_anomalies.h"
+
+namespace kep_toolbox {
+
+/// Constructor
+/** It tabulates E(M) for the given eccentricity.
+ *
+ * \param[in] e eccentricity, in [0,1)
+ * \param[in] accuracy maximum error allowed on the eccentric anomaly (radians)
+ * \param[in] max_size maximum number of table intervals
+ */
+kepler_table::kepler_table(const double &e, const double &accuracy, const std::size_t &max_size) :
+                m_e(e), m_accuracy(accuracy), m_h(0)
+{
+    if (e < 0 || e >= 1) {
+        throw_value_error("The eccentricity needs to be in [0,1)");
+    }
+    if (accuracy <= 0) {
+        throw_value_error("The accuracy needs to be strictly positive");
+    }
+
+    for (std::size_t n = 16; n <= max_size; n *= 2) {
+        build(n);
+        // The interpolation error peaks half way between the nodes
+        double err_max = 0;
+        for (std::size_t k = 0; k < n; ++k) {
+            double u = (k + 0.5) * m_h;
+            double M = M_PI * u * u * u;
+            err_max = std::max(err_max, std::fabs(m2e(M) - kep_toolbox::m2e(M, m_e)));
+        }
+        if (err_max <= m_accuracy) {
+            return;
+        }
+    }
+    throw_value_error("The requested accuracy cannot be reached within the maximum table size");
+}
+
+/// Tabulates E(M) and dE/du on n intervals uniform in u = (M/pi)^(1/3)
+void kepler_table::build(const std::size_t &n)
+{
+    m_h = 1.0 / n;
+    m_E.resize(n + 1);
+    m_dE.resize(n + 1);
+    for (std::size_t k = 0; k <= n; ++k) {
+        double u = k * m_h;
+        m_E[k] = kep_toolbox::m2e(M_PI * u * u * u, m_e);
+        m_dE[k] = 3 * M_PI * u * u / (1 - m_e * cos(m_E[k]));
+    }
+}
+
+/// Cubic Hermite interpolation of the table for M in [0, pi]
+double kepler_table::interpolate(const double &M) const
+{
+    double u = pow(M / M_PI, 1.0 / 3.0) / m_h;
+    std::size_t k = std::min(static_cast<std::size_t>(u), m_E.size() - 2);
+    double t = u - k;
+    double s = 1 - t;
+    return (s * s * ((1 + 2 * t) * m_E[k] + t * m_h * m_dE[k]) + t * t * ((3 - 2 * t) * m_E[k + 1] - s * m_h * m_dE[k + 1]));
+}
+
+/// Eccentric anomaly
+/** Returns the eccentric anomaly for any mean anomaly, on the same branch as M.
+ *
+ * \param[in] M mean anomaly (radians)
+ * \return the eccentric anomaly (radians)
+ */
+double kepler_table::m2e(const double &M) const
+{
+    // Reduce to [0, pi] using E(2 pi - M) = 2 pi - E(M)
+    double offset = 2 * M_PI * floor(M / (2 * M_PI));
+    double reduced = M - offset;
+    bool mirror = reduced > M_PI;
+    if (mirror) {
+        reduced = 2 * M_PI - reduced;
+    }
+
+    double E = interpolate(reduced);
+    E = offset + (mirror ? 2 * M_PI - E : E);
+
+    // The correction uses the unreduced M, as the reduction error is amplified by dE/dM close to pericentre
+    double f2 = m_e * sin(E);
+    double f1 = 1 - m_e * cos(E);
+    double f0 = E - f2 - M;
+    return (E - f0 / (f1 - 0.5 * f0 * f2 / f1));
+}
+
+/// Getter for the eccentricity
+const double& kepler_table::get_e() const
+{
+    return m_e;
+}
+
+/// Getter for the accuracy requested on construction
+const double& kepler_table::get_accuracy() const
+{
+    return m_accuracy;
+}
+
+/// Getter for the number of table intervals
+std::size_t kepler_table::get_size() const
+{
+    return m_E.size() - 1;
+}
+
+} //namespaces
@@ -0,0 +1,68 @@
+/*****************************************************************************
+ *   Copyright (C) 2004-2012 The PyKEP development team,                     *
+ *   Advanced Concepts Team (ACT), European Space Agency (ESA)               *
+ *   http://keptoolbox.sourceforge.net/index.html                            *
+ *   http://keptoolbox.sourceforge.net/credits.html                          *
+ *                                                                           *
+ *   act@esa.int                                                             *
+ *                                                                           *
+ *   This program is free software; you can redistribute it and/or modify    *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   This program is distributed in the hope that it will be useful,         *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with this program; if not, write to the                           *
+ *   Free Software Foundation, Inc.,                                         *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.               *
+ *****************************************************************************/
+
+#ifndef KEPLERIAN_TOOLBOX_KEPLER_TABLE_H
+#define KEPLERIAN_TOOLBOX_KEPLER_TABLE_H
+
+#include <cstddef>
+#include <vector>
+
+#include "config.h"
+
+namespace kep_toolbox {
+
+/// Tabulated solution of Kepler's equation for a fixed eccentricity
+/**
+ * This class answers repeated m2e queries for a body whose eccentricity does not change, as when a catalog
+ * of asteroids is propagated over many epochs. On construction E(M) is tabulated on [0, pi] together with
+ * its derivative, so that a query is a table lookup, a cubic Hermite interpolation and a single Halley
+ * correction, with no iteration. The nodes are uniform in u = (M/pi)^(1/3), which follows the cube root
+ * behaviour of E(M) close to pericentre when the eccentricity approaches one. The number of nodes is
+ * doubled until the corrected solution matches the iterative reference to the requested accuracy.
+ *
+ * @see kep_toolbox::m2e
+ */
+
+class __KEP_TOOL_VISIBLE kepler_table
+{
+public:
+    kepler_table(const double &e, const double &accuracy = 1e-13, const std::size_t &max_size = 65536);
+    double m2e(const double &M) const;
+    const double& get_e() const;
+    const double& get_accuracy() const;
+    std::size_t get_size() const;
+private:
+    void build(const std::size_t &n);
+    double interpolate(const double &M) const;
+
+    double m_e;
+    double m_accuracy;
+    double m_h;
+    std::vector<double> m_E;
+    std::vector<double> m_dE;
+};
+
+} //namespaces
+
+#endif // KEPLERIAN_TOOLBOX_KEPLER_TABLE_H
@@ -32,6 +32,8 @@
 #include"asteroid_gtoc2.h"
 #include"asteroid_gtoc5.h"
 #include"lambert_problem.h"
+#include"kepler_table.h"
+#include"thread_pool.h"
 #include"core_functions/array3D_operations.h"
 #include"core_functions/convert_anomalies.h"
 #include"core_functions/convert_dates.h"
@@ -46,7 +48,9 @@
 #include"core_functions/fb_prop.h"
 #include"core_functions/propagate_lagrangian.h"
 #include"core_functions/propagate_lagrangian_u.h"
+#include"core_functions/propagate_lagrangian_batch.h"
 #include"core_functions/propagate_taylor.h"
+#include"core_functions/propagate_taylor_batch.h"
 #include"core_functions/propagate_taylor_s.h"
 #include"core_functions/propagate_taylor_jorba.h"
 #include"lambert_problem.h"
@@ -90,6 +90,22 @@ public:
 		}
 	}
 
+	/**
+	 * Calculates the state mismatches at the mid-point of each leg on a thread_pool. The legs are evaluated
+	 * concurrently and, within each leg, so are the forward and the backward propagations. Every leg writes
+	 * its own seven values and is computed as in the serial method, so the mismatches are bit-identical to it.
+	 */
+	template<typename it_type>
+			void evaluate_all_mismatch_con(it_type begin, it_type end, thread_pool &pool) const {
+		assert(end - begin == 7*legs.size());
+		(void) end;
+		std::vector<thread_pool::task_type> tasks(legs.size());
+		for (size_t i=0; i<legs.size();i++){
+			tasks[i] = leg_mismatch_task<it_type>(legs[i], begin + 7*i, pool);
+		}
+		pool.run(tasks);
+	}
+
 
 	/** @name Flight-plan setters*/
 	//@{
@@ -182,6 +198,19 @@ public:
 
 	//@}
 private:
+	// Task evaluating the mismatch of one leg, as run by evaluate_all_mismatch_con on a thread_pool
+	template<typename it_type>
+	struct leg_mismatch_task
+	{
+		leg_mismatch_task(const leg &l, it_type begin, thread_pool &pool) : m_leg(&l), m_begin(begin), m_pool(&pool) {}
+		void operator()() const {
+			m_leg->get_mismatch_con(m_begin, m_begin + 7, *m_pool);
+		}
+		const leg *m_leg;
+		it_type m_begin;
+		thread_pool *m_pool;
+	};
+
 	std::vector<leg> legs;
 	std::vector<planet_ptr> planets;
 
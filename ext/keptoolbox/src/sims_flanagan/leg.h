@@ -25,14 +25,19 @@
 #ifndef LEG_H
 #define LEG_H
 
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
 #include <boost/utility.hpp>
 #include <boost/type_traits/is_same.hpp>
+#include <algorithm>
+#include <functional>
 #include <iterator>
 #include <vector>
 #include "spacecraft.h"
 #include "../core_functions/array3D_operations.h"
 #include "../core_functions/propagate_lagrangian.h"
 #include "../core_functions/propagate_taylor.h"
+#include "../thread_pool.h"
 #include "sc_state.h"
 #include "../epoch.h"
 #include "throttle.h"
@@ -380,22 +385,203 @@ public:
 
 	template<typename it_type>
 	void get_mismatch_con(it_type begin, it_type end) const
+	{
+		assert(end - begin == 7);
+		(void)end;
+		half_leg fwd, back;
+		propagate_fwd(fwd);
+		propagate_back(back);
+		join_halves(begin, fwd, back);
+	}
+
+	/// Evaluate the state mismatch, propagating the two halves concurrently
+	/**
+	* This method overloads the same method using iterators but runs the forward and the backward propagations
+	* as two tasks of a thread_pool. The two halves share no state and are joined as in the serial method, so that
+	* the mismatch is bit-identical to the one it returns.
+	*
+	* @param[in] begin iterator pointing to the beginning of the memory where the mismatches will be stored
+	* @param[in] begin iterator pointing to the end of the memory where the mismatches will be stored
+	* @param[in] pool thread_pool running the two propagations
+	*/
+	template<typename it_type>
+	void get_mismatch_con(it_type begin, it_type end, thread_pool &pool) const
+	{
+		assert(end - begin == 7);
+		(void)end;
+		half_leg fwd, back;
+		std::vector<thread_pool::task_type> tasks(2);
+		tasks[0] = boost::bind(&leg::propagate_fwd, this, boost::ref(fwd));
+		tasks[1] = boost::bind(&leg::propagate_back, this, boost::ref(back));
+		pool.run(tasks);
+		join_halves(begin, fwd, back);
+	}
+
+	/// Number of variables of the mismatch Jacobian
+	/**
+	* The variables are, in order, the initial state x_i \f$ (\mathbf r, \mathbf v, m) \f$, the throttles
+	* \f$ (x_1,y_1,z_1,x_2,y_2,z_2,...,x_n,y_n,z_n) \f$ and the final state x_f, i.e. \f$ 3n + 14 \f$ variables.
+	*
+	* @return the number of columns of the Jacobian computed by get_mismatch_con_jacobian
+	*/
+	size_t get_jacobian_n_var() const { return 14 + 3 * throttles.size(); }
+
+	/// Evaluate the state mismatch and its Jacobian
+	/**
+	* This method computes the mismatch as get_mismatch_con together with its partial derivatives with respect to the
+	* variables listed in get_jacobian_n_var. The state transition matrices of the half propagations are chained analytically:
+	* those of propagate_lagrangian_stm and of the impulses for chemical legs, those of the variational equations of
+	* propagate_taylor_stm for high fidelity legs. The epochs of the leg and of its throttles are kept fixed. A single call
+	* replaces the \f$ 3n + 14 \f$ evaluations of a finite difference gradient.
+	*
+	* @param[in] begin iterator pointing to the beginning of the memory where the mismatches will be stored
+	* @param[in] begin iterator pointing to the end of the memory where the mismatches will be stored
+	* @param[out] jac_begin iterator pointing to the beginning of the memory where the 7 x get_jacobian_n_var() Jacobian will be stored, row by row
+	* @param[out] jac_end iterator pointing to the end of the memory where the Jacobian will be stored
+	*
+	* @throws value_error if the Jacobian iterators distance is not 7 * get_jacobian_n_var()
+	*/
+	template<typename it_type, typename jac_it_type>
+	void get_mismatch_con_jacobian(it_type begin, it_type end, jac_it_type jac_begin, jac_it_type jac_end) const
+	{
+		assert(end - begin == 7);
+		(void)end;
+		const size_t n_var = get_jacobian_n_var();
+		if ((size_t)(jac_end - jac_begin) != 7 * n_var) {
+			throw_value_error("Iterators distance is incompatible with the Jacobian size");
+		}
+		half_leg fwd, back;
+		fwd.jac.resize(7 * n_var);
+		back.jac.resize(7 * n_var);
+		propagate_fwd(fwd);
+		propagate_back(back);
+		join_halves(begin, fwd, back);
+		std::transform(fwd.jac.begin(), fwd.jac.end(), back.jac.begin(), jac_begin, std::minus<double>());
+	}
+
+protected:
+	// State reached by one of the two half propagations, t being its epoch in seconds. If jac is not empty it
+	// receives the 7 x get_jacobian_n_var() Jacobian of the state, row by row.
+	struct half_leg
+	{
+		array3D r;
+		array3D v;
+		double m;
+		double t;
+		std::vector<double> jac;
+		std::vector<double> jac_tmp;
+	};
+
+	// Sets the Jacobian of a half leg to that of the boundary state starting at column first
+	void init_jacobian(half_leg &h, const size_t &first) const
+	{
+		const size_t n_var = get_jacobian_n_var();
+		std::fill(h.jac.begin(), h.jac.end(), 0.);
+		for (size_t i = 0; i < 7; ++i) {
+			h.jac[i * n_var + first + i] = 1;
+		}
+	}
+
+	// Chains the Jacobian of a half leg through a keplerian propagation, which leaves the mass unchanged
+	template<typename stm_type>
+	void chain_kepler_jacobian(half_leg &h, const stm_type &stm) const
+	{
+		const size_t n_var = get_jacobian_n_var();
+		h.jac_tmp.assign(h.jac.begin(), h.jac.begin() + 6 * n_var);
+		for (size_t i = 0; i < 6; ++i) {
+			for (size_t c = 0; c < n_var; ++c) {
+				double tmp = 0;
+				for (size_t k = 0; k < 6; ++k) tmp += stm[i][k] * h.jac_tmp[k * n_var + c];
+				h.jac[i * n_var + c] = tmp;
+			}
+		}
+	}
+
+	// Chains the Jacobian of a half leg through a thrust arc of segment seg, stm being the derivatives of the final
+	// state with respect to the initial state and the thrust vector, the latter max_thrust times the throttle
+	template<typename stm_type>
+	void chain_thrust_jacobian(half_leg &h, const stm_type &stm, const size_t &seg, const double &max_thrust) const
+	{
+		const size_t n_var = get_jacobian_n_var();
+		h.jac_tmp = h.jac;
+		for (size_t i = 0; i < 7; ++i) {
+			for (size_t c = 0; c < n_var; ++c) {
+				double tmp = 0;
+				for (size_t k = 0; k < 7; ++k) tmp += stm[i][k] * h.jac_tmp[k * n_var + c];
+				h.jac[i * n_var + c] = tmp;
+			}
+			for (size_t j = 0; j < 3; ++j) {
+				h.jac[i * n_var + 7 + 3 * seg + j] += stm[i][7 + j] * max_thrust;
+			}
+		}
+	}
+
+	// Chains the Jacobian of a half leg through the impulse dv = sign * g * throttle of segment seg, with g = T dt / m
+	// depending on the mass m before the impulse, after which the mass is multiplied by e = exp(-sign |dv| / c)
+	void chain_impulse_jacobian(half_leg &h, const array3D &dv, const size_t &seg, const double &sign, const double &g,
+				    const double &m, const double &e, const double &c) const
+	{
+		const size_t n_var = get_jacobian_n_var();
+		const size_t col = 7 + 3 * seg;
+		double *jac_m = &h.jac[6 * n_var];
+		double norm_dv = norm(dv);
+		for (size_t j = 0; j < 3; ++j) {
+			double *jac_v = &h.jac[(3 + j) * n_var];
+			for (size_t k = 0; k < n_var; ++k) jac_v[k] -= dv[j] / m * jac_m[k];
+			jac_v[col + j] += sign * g;
+		}
+		double dm_dm = e * (1 + sign * norm_dv / c);
+		for (size_t k = 0; k < n_var; ++k) jac_m[k] *= dm_dm;
+		if (norm_dv > 0) {
+			for (size_t j = 0; j < 3; ++j) jac_m[col + j] -= m * e * g / c * dv[j] / norm_dv;
+		}
+	}
+
+	void propagate_fwd(half_leg &fwd) const
 	{
 		if (m_hf) {
-			get_mismatch_con_low_thrust(begin, end);
+			propagate_fwd_low_thrust(fwd);
 		} else {
-			get_mismatch_con_chemical(begin, end);
+			propagate_fwd_chemical(fwd);
+		}
+	}
+
+	void propagate_back(half_leg &back) const
+	{
+		if (m_hf) {
+			propagate_back_low_thrust(back);
+		} else {
+			propagate_back_chemical(back);
 		}
 	}
 
-protected:
 	template<typename it_type>
-	void get_mismatch_con_chemical(it_type begin, it_type end) const
+	void join_halves(it_type begin, half_leg &fwd, const half_leg &back) const
+	{
+		if (!m_hf) {
+			// finally, we propagate from current_time_fwd to current_time_back with a keplerian motion
+			if (fwd.jac.empty()) {
+				propagate_lagrangian(fwd.r, fwd.v, back.t - fwd.t, m_mu);
+			} else {
+				boost::array<boost::array<double,6>,6> stm;
+				propagate_lagrangian_stm(fwd.r, fwd.v, back.t - fwd.t, m_mu, stm);
+				chain_kepler_jacobian(fwd, stm);
+			}
+		}
+
+		//Return the mismatch
+		diff(fwd.r,fwd.r,back.r);
+		diff(fwd.v,fwd.v,back.v);
+
+		std::copy(fwd.r.begin(), fwd.r.end(), begin);
+		std::copy(fwd.v.begin(), fwd.v.end(), begin + 3);
+		begin[6] = fwd.m - back.m;
+	}
+
+	void propagate_fwd_chemical(half_leg &fwd) const
 	{
-		assert(end - begin == 7);
-		(void)end;
 		size_t n_seg = throttles.size();
-		const int n_seg_fwd = (n_seg + 1) / 2, n_seg_back = n_seg / 2;
+		const int n_seg_fwd = (n_seg + 1) / 2;
 
 		//Aux variables
 		double max_thrust = m_sc.get_thrust();
@@ -404,18 +590,30 @@ protected:
 		array3D dv;
 
 		//Initial state
-		array3D rfwd = x_i.get_position();
-		array3D vfwd = x_i.get_velocity();
-		double mfwd = x_i.get_mass();
+		array3D &rfwd = fwd.r;
+		array3D &vfwd = fwd.v;
+		double &mfwd = fwd.m;
+		rfwd = x_i.get_position();
+		vfwd = x_i.get_velocity();
+		mfwd = x_i.get_mass();
+		const bool with_jac = !fwd.jac.empty();
+		boost::array<boost::array<double,6>,6> stm;
+		if (with_jac) init_jacobian(fwd, 0);
 
 		//Forward Propagation
-		double current_time_fwd = t_i.mjd2000() * ASTRO_DAY2SEC;
+		double &current_time_fwd = fwd.t;
+		current_time_fwd = t_i.mjd2000() * ASTRO_DAY2SEC;
 		for (int i = 0; i < n_seg_fwd; i++) {
 			double thrust_duration = (throttles[i].get_end().mjd2000() -
 						  throttles[i].get_start().mjd2000()) * ASTRO_DAY2SEC;
 			double manouver_time = (throttles[i].get_start().mjd2000() +
 						throttles[i].get_end().mjd2000()) / 2. * ASTRO_DAY2SEC;
-			propagate_lagrangian(rfwd, vfwd, manouver_time - current_time_fwd, m_mu);
+			if (with_jac) {
+				propagate_lagrangian_stm(rfwd, vfwd, manouver_time - current_time_fwd, m_mu, stm);
+				chain_kepler_jacobian(fwd, stm);
+			} else {
+				propagate_lagrangian(rfwd, vfwd, manouver_time - current_time_fwd, m_mu);
+			}
 			current_time_fwd = manouver_time;
 
 			for (int j=0;j<3;j++){
@@ -424,25 +622,54 @@ protected:
 
 			norm_dv = norm(dv);
 			sum(vfwd,vfwd,dv);
-			mfwd *= exp( -norm_dv/isp/ASTRO_G0 );
+			double mass_ratio = exp( -norm_dv/isp/ASTRO_G0 );
+			if (with_jac) chain_impulse_jacobian(fwd, dv, i, 1., max_thrust / mfwd * thrust_duration, mfwd, mass_ratio, isp*ASTRO_G0);
+			mfwd *= mass_ratio;
 			//Temporary solution to the creation of NaNs when mass gets too small (i.e. 0)
-			if (mfwd < 1) mfwd=1;
+			if (mfwd < 1) {
+				mfwd=1;
+				if (with_jac) std::fill(fwd.jac.begin() + 6 * get_jacobian_n_var(), fwd.jac.end(), 0.);
+			}
 		}
+	}
+
+	void propagate_back_chemical(half_leg &back) const
+	{
+		size_t n_seg = throttles.size();
+		const int n_seg_back = n_seg / 2;
+
+		//Aux variables
+		double max_thrust = m_sc.get_thrust();
+		double isp = m_sc.get_isp();
+		double norm_dv;
+		array3D dv;
 
 		//Final state
-		array3D rback = x_f.get_position();
-		array3D vback = x_f.get_velocity();
-		double mback = x_f.get_mass();
+		array3D &rback = back.r;
+		array3D &vback = back.v;
+		double &mback = back.m;
+		rback = x_f.get_position();
+		vback = x_f.get_velocity();
+		mback = x_f.get_mass();
+		const bool with_jac = !back.jac.empty();
+		boost::array<boost::array<double,6>,6> stm;
+		if (with_jac) init_jacobian(back, 7 + 3 * n_seg);
 
 		//Backward Propagation
-		double current_time_back = t_f.mjd2000() * ASTRO_DAY2SEC;
+		double &current_time_back = back.t;
+		current_time_back = t_f.mjd2000() * ASTRO_DAY2SEC;
 		for (int i = 0; i < n_seg_back; i++) {
 			double thrust_duration = (throttles[throttles.size() - i - 1].get_end().mjd2000() -
 						  throttles[throttles.size() - i - 1].get_start().mjd2000()) * ASTRO_DAY2SEC;
 			double manouver_time = (throttles[throttles.size() - i - 1].get_start().mjd2000() +
 						throttles[throttles.size() - i - 1].get_end().mjd2000()) / 2. * ASTRO_DAY2SEC;
 			// manouver_time - current_time_back is negative, so this should propagate backwards
-			propagate_lagrangian(rback, vback, manouver_time - current_time_back, m_mu);
+			if (with_jac) {
+				propagate_lagrangian_stm(rback, vback, manouver_time - current_time_back, m_mu, stm);
+				chain_kepler_jacobian(back, stm);
+			} else {
+				propagate_lagrangian(rback, vback, manouver_time - current_time_back, m_mu);
+			}
 			current_time_back = manouver_time;
 
 			for (int j=0;j<3;j++){
@@ -450,29 +677,16 @@ protected:
 			}
 			norm_dv = norm(dv);
 			sum(vback,vback,dv);
-			mback *= exp( norm_dv/isp/ASTRO_G0 );
+			double mass_ratio = exp( norm_dv/isp/ASTRO_G0 );
+			if (with_jac) chain_impulse_jacobian(back, dv, n_seg - i - 1, -1., max_thrust / mback * thrust_duration, mback, mass_ratio, isp*ASTRO_G0);
+			mback *= mass_ratio;
 		}
-
-		// finally, we propagate from current_time_fwd to current_time_back with a keplerian motion
-		propagate_lagrangian(rfwd, vfwd, current_time_back - current_time_fwd, m_mu);
-
-		//Return the mismatch
-		diff(rfwd,rfwd,rback);
-		diff(vfwd,vfwd,vback);
-
-		std::copy(rfwd.begin(), rfwd.end(), begin);
-		std::copy(vfwd.begin(), vfwd.end(), begin + 3);
-		begin[6] = mfwd - mback;
 	}
 
-
-	template<typename it_type>
-	void get_mismatch_con_low_thrust(it_type begin, it_type end) const
+	void propagate_fwd_low_thrust(half_leg &fwd) const
 	{
-		assert(end - begin == 7);
-		(void)end;
 		size_t n_seg = throttles.size();
-		const int n_seg_fwd = (n_seg + 1) / 2, n_seg_back = n_seg / 2;
+		const int n_seg_fwd = (n_seg + 1) / 2;
 
 		//Aux variables
 		double max_thrust = m_sc.get_thrust();
@@ -480,9 +694,17 @@ protected:
 		array3D thrust;
 
 		//Initial state
-		array3D rfwd = x_i.get_position();
-		array3D vfwd = x_i.get_velocity();
-		double mfwd = x_i.get_mass();
+		array3D &rfwd = fwd.r;
+		array3D &vfwd = fwd.v;
+		double &mfwd = fwd.m;
+		rfwd = x_i.get_position();
+		vfwd = x_i.get_velocity();
+		mfwd = x_i.get_mass();
+		fwd.t = t_i.mjd2000() * ASTRO_DAY2SEC;
+		const bool with_jac = !fwd.jac.empty();
+		boost::array<boost::array<double,10>,7> stm;
+		taylor_stm_workspace ws;
+		if (with_jac) init_jacobian(fwd, 0);
 
 		//Forward Propagation
 		for (int i = 0; i < n_seg_fwd; i++) {
@@ -492,13 +714,38 @@ protected:
 			for (int j=0;j<3;j++){
 				thrust[j] = max_thrust * throttles[i].get_value()[j];
 			}
-			propagate_taylor(rfwd,vfwd,mfwd,thrust,thrust_duration,m_mu,veff,m_tol,m_tol);
+			if (with_jac) {
+				propagate_taylor_stm(rfwd,vfwd,mfwd,thrust,thrust_duration,m_mu,veff,m_tol,m_tol,stm,ws);
+				chain_thrust_jacobian(fwd, stm, i, max_thrust);
+			} else {
+				propagate_taylor(rfwd,vfwd,mfwd,thrust,thrust_duration,m_mu,veff,m_tol,m_tol);
+			}
+			fwd.t += thrust_duration;
 		}
+	}
+
+	void propagate_back_low_thrust(half_leg &back) const
+	{
+		size_t n_seg = throttles.size();
+		const int n_seg_back = n_seg / 2;
+
+		//Aux variables
+		double max_thrust = m_sc.get_thrust();
+		double veff = m_sc.get_isp()*ASTRO_G0;
+		array3D thrust;
 
 		//Final state
-		array3D rback = x_f.get_position();
-		array3D vback = x_f.get_velocity();
-		double mback = x_f.get_mass();
+		array3D &rback = back.r;
+		array3D &vback = back.v;
+		double &mback = back.m;
+		rback = x_f.get_position();
+		vback = x_f.get_velocity();
+		mback = x_f.get_mass();
+		back.t = t_f.mjd2000() * ASTRO_DAY2SEC;
+		const bool with_jac = !back.jac.empty();
+		boost::array<boost::array<double,10>,7> stm;
+		taylor_stm_workspace ws;
+		if (with_jac) init_jacobian(back, 7 + 3 * n_seg);
 
 		//Backward Propagation
 		for (int i = 0; i < n_seg_back; i++) {
@@ -507,16 +754,14 @@ protected:
 			for (int j=0;j<3;j++){
 				thrust[j] = max_thrust * throttles[throttles.size() - i - 1].get_value()[j];
 			}
-			propagate_taylor(rback,vback,mback,thrust,-thrust_duration,m_mu,veff,m_tol,m_tol);
+			if (with_jac) {
+				propagate_taylor_stm(rback,vback,mback,thrust,-thrust_duration,m_mu,veff,m_tol,m_tol,stm,ws);
+				chain_thrust_jacobian(back, stm, n_seg - i - 1, max_thrust);
+			} else {
+				propagate_taylor(rback,vback,mback,thrust,-thrust_duration,m_mu,veff,m_tol,m_tol);
+			}
+			back.t -= thrust_duration;
 		}
-
-		//Return the mismatch
-		diff(rfwd,rfwd,rback);
-		diff(vfwd,vfwd,vback);
-
-		std::copy(rfwd.begin(), rfwd.end(), begin);
-		std::copy(vfwd.begin(), vfwd.end(), begin + 3);
-		begin[6] = mfwd - mback;
 	}
 
 
@@ -0,0 +1,157 @@
+/*****************************************************************************
+ *   Copyright (C) 2004-2012 The PyKEP development team,                     *
+ *   Advanced Concepts Team (ACT), European Space Agency (ESA)               *
+ *   http://keptoolbox.sourceforge.net/index.html                            *
+ *   http://keptoolbox.sourceforge.net/credits.html                          *
+ *                                                                           *
+ *   act@esa.int                                                             *
+ *                                                                           *
+ *   This program is free software; you can redistribute it and/or modify    *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   This program is distributed in the hope that it will be useful,         *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with this program; if not, write to the                           *
+ *   Free Software Foundation, Inc.,                                         *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.               *
+ *****************************************************************************/
+
+#include <algorithm>
+#include <exception>
+#include <boost/bind.hpp>
+
+#include "thread_pool.h"
+#include "exceptions.h"
+
+namespace kep_toolbox {
+
+/// Constructor
+/** It starts the worker threads.
+ *
+ * \param[in] n_threads number of threads working on a batch, counting the one calling run(). With 0 or 1 the
+ * tasks are executed serially by the caller.
+ */
+thread_pool::thread_pool(const unsigned int &n_threads) : m_size(std::max(n_threads, 1u)), m_stop(false)
+{
+    for (unsigned int i = 1; i < m_size; ++i) {
+        m_threads.create_thread(boost::bind(&thread_pool::worker, this));
+    }
+}
+
+/// Destructor
+/** It stops and joins the worker threads. No batch may be running.
+ */
+thread_pool::~thread_pool()
+{
+    {
+        boost::lock_guard<boost::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_work.notify_all();
+    m_threads.join_all();
+}
+
+/// Runs a batch of tasks
+/** It returns when every task has been executed. If some tasks throw the others still run, and the error of
+ * the first failed task, in the order of the vector, is then thrown as a value error, as a serial loop over the
+ * tasks would have reported it.
+ *
+ * \param[in] tasks the tasks to execute, in any order and possibly concurrently
+ */
+void thread_pool::run(std::vector<task_type> &tasks)
+{
+    batch b;
+    b.tasks = &tasks;
+    b.next = 0;
+    b.done = 0;
+    b.failed = tasks.size();
+
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    if (tasks.size() > 1 && m_size > 1) {
+        m_queue.push_back(&b);
+        m_work.notify_all();
+    }
+
+    // The caller takes tasks from its own batch until none is left ...
+    while (b.next < tasks.size()) {
+        std::size_t i = b.next++;
+        if (b.next == tasks.size()) {
+            std::deque<batch *>::iterator it = std::find(m_queue.begin(), m_queue.end(), &b);
+            if (it != m_queue.end()) {
+                m_queue.erase(it);
+            }
+        }
+        lock.unlock();
+        execute(b, i);
+        lock.lock();
+    }
+    // ... and then waits for those the workers are still executing
+    while (b.done < tasks.size()) {
+        m_done.wait(lock);
+    }
+    lock.unlock();
+
+    if (b.failed < tasks.size()) {
+        throw_value_error(b.message);
+    }
+}
+
+/// Number of threads working on a batch, counting the caller
+unsigned int thread_pool::get_size() const
+{
+    return m_size;
+}
+
+void thread_pool::worker()
+{
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    while (true) {
+        while (!m_stop && m_queue.empty()) {
+            m_work.wait(lock);
+        }
+        if (m_stop) {
+            return;
+        }
+        batch &b = *m_queue.front();
+        std::size_t i = b.next++;
+        if (b.next == b.tasks->size()) {
+            m_queue.pop_front();
+        }
+        lock.unlock();
+        execute(b, i);
+        lock.lock();
+    }
+}
+
+// Executes the i-th task of a batch and records its completion. It is called without holding the lock.
+void thread_pool::execute(batch &b, const std::size_t &i)
+{
+    std::string message;
+    bool failed = false;
+    try {
+        (*b.tasks)[i]();
+    } catch (const std::exception &e) {
+        message = e.what();
+        failed = true;
+    } catch (...) {
+        message = "Unknown exception thrown by a thread_pool task";
+        failed = true;
+    }
+
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    if (failed && i < b.failed) {
+        b.failed = i;
+        b.message = message;
+    }
+    if (++b.done == b.tasks->size()) {
+        m_done.notify_all();
+    }
+}
+
+} //namespaces
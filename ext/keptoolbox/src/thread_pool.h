@@ -0,0 +1,87 @@
+/*****************************************************************************
+ *   Copyright (C) 2004-2012 The PyKEP development team,                     *
+ *   Advanced Concepts Team (ACT), European Space Agency (ESA)               *
+ *   http://keptoolbox.sourceforge.net/index.html                            *
+ *   http://keptoolbox.sourceforge.net/credits.html                          *
+ *                                                                           *
+ *   act@esa.int                                                             *
+ *                                                                           *
+ *   This program is free software; you can redistribute it and/or modify    *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   This program is distributed in the hope that it will be useful,         *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with this program; if not, write to the                           *
+ *   Free Software Foundation, Inc.,                                         *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.               *
+ *****************************************************************************/
+
+#ifndef KEPLERIAN_TOOLBOX_THREAD_POOL_H
+#define KEPLERIAN_TOOLBOX_THREAD_POOL_H
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+#include <boost/utility.hpp>
+
+#include "config.h"
+
+namespace kep_toolbox {
+
+/// Fixed set of worker threads running batches of independent tasks
+/**
+ * The workers are started once, on construction, and are reused by every call to run(), so that the cost of
+ * a parallel evaluation is a few lock and wake-up operations rather than the creation of threads. The thread
+ * calling run() works on its own batch too, and a task may itself call run() on the same pool: the caller
+ * then executes its sub-tasks while the workers are busy, so nested batches cannot deadlock.
+ *
+ * The tasks of a batch must not depend on each other and should write to disjoint memory. Each task is then
+ * executed exactly once, with the same inputs as in a serial loop, so the results do not depend on the
+ * number of threads or on the scheduling.
+ *
+ * @see kep_toolbox::sims_flanagan::fb_traj::evaluate_all_mismatch_con
+ */
+
+class __KEP_TOOL_VISIBLE thread_pool : boost::noncopyable
+{
+public:
+    typedef boost::function<void ()> task_type;
+
+    explicit thread_pool(const unsigned int &n_threads = boost::thread::hardware_concurrency());
+    ~thread_pool();
+    void run(std::vector<task_type> &tasks);
+    unsigned int get_size() const;
+private:
+    struct batch
+    {
+        std::vector<task_type> *tasks;
+        std::size_t next;
+        std::size_t done;
+        std::size_t failed;
+        std::string message;
+    };
+
+    void worker();
+    void execute(batch &b, const std::size_t &i);
+
+    boost::mutex m_mutex;
+    boost::condition_variable m_work;
+    boost::condition_variable m_done;
+    std::deque<batch *> m_queue;
+    boost::thread_group m_threads;
+    unsigned int m_size;
+    bool m_stop;
+};
+
+} //namespaces
+
+#endif // KEPLERIAN_TOOLBOX_THREAD_POOL_H
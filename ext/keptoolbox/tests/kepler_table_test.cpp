@@ -0,0 +1,68 @@
+/*****************************************************************************
+ *   Copyright (C) 2004-2012 The PyKEP development team,                     *
+ *   Advanced Concepts Team (ACT), European Space Agency (ESA)               *
+ *   http://keptoolbox.sourceforge.net/index.html                            *
+ *   http://keptoolbox.sourceforge.net/credits.html                          *
+ *                                                                           *
+ *   act@esa.int                                                             *
+ *                                                                           *
+ *   This program is free software; you can redistribute it and/or modify    *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   This program is distributed in the hope that it will be useful,         *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with this program; if not, write to the                           *
+ *   Free Software Foundation, Inc.,                                         *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.               *
+ *****************************************************************************/
+
+#include <iostream>
+#include <iomanip>
+#include <boost/random.hpp>
+
+#include "../src/keplerian_toolbox.h"
+
+using namespace std;
+using namespace kep_toolbox;
+int main() {
+	// Preamble
+	boost::mt19937 rng;
+	boost::uniform_real<> dist(-50,50);
+	boost::variate_generator<boost::mt19937&, boost::uniform_real<> > drng(rng, dist);
+	double err_max=0,err=0,acc=0;
+	int count=0;
+
+	// Experiment Settings
+	const double eccentricities[] = {0, 0.01, 0.1, 0.3, 0.5, 0.7, 0.9, 0.99, 0.999, 0.999999};
+	const double accuracy = 1e-12;
+	unsigned int Ntrials = 20000;
+
+	// Start Experiment
+	for (unsigned int i = 0; i < sizeof(eccentricities) / sizeof(double); ++i) {
+		//1 - build the table for this eccentricity
+		kepler_table table(eccentricities[i], accuracy);
+		std::cout << "e = " << eccentricities[i] << ", table size: " << table.get_size() << std::endl;
+		//2 - compare against the iterative solution at random mean anomalies
+		for (unsigned int j = 0; j < Ntrials; ++j) {
+			double M = drng();
+			err = fabs(table.m2e(M) - m2e(M, eccentricities[i]));
+			err_max = std::max(err_max,err);
+			acc += err;
+			count ++;
+		}
+	}
+	std::cout << "Max error: " << err_max << std::endl;
+	std::cout << "Average Error: " << acc / count << std::endl;
+	std::cout << "Number of Queries Made: " << count << std::endl;
+	if (err_max < accuracy) {
+		return 0;
+	} else {
+		return 1;
+	}
+}
@@ -0,0 +1,124 @@
+/*****************************************************************************
+ *   Copyright (C) 2004-2012 The PyKEP development team,                     *
+ *   Advanced Concepts Team (ACT), European Space Agency (ESA)               *
+ *   http://keptoolbox.sourceforge.net/index.html                            *
+ *   http://keptoolbox.sourceforge.net/credits.html                          *
+ *                                                                           *
+ *   act@esa.int                                                             *
+ *                                                                           *
+ *   This program is free software; you can redistribute it and/or modify    *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   This program is distributed in the hope that it will be useful,         *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with this program; if not, write to the                           *
+ *   Free Software Foundation, Inc.,                                         *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.               *
+ *****************************************************************************/
+
+#include <iostream>
+#include <vector>
+#include <boost/random.hpp>
+
+#include "../src/keplerian_toolbox.h"
+
+using namespace std;
+using namespace kep_toolbox;
+using namespace kep_toolbox::sims_flanagan;
+
+// Sets the leg from the variables of its Jacobian: x_i, the throttles and x_f
+void set_variables(leg& l, const std::vector<double>& z, const int& n_seg) {
+	array3D r0 = {{z[0], z[1], z[2]}}, v0 = {{z[3], z[4], z[5]}};
+	array3D r1 = {{z[7 + 3*n_seg], z[8 + 3*n_seg], z[9 + 3*n_seg]}}, v1 = {{z[10 + 3*n_seg], z[11 + 3*n_seg], z[12 + 3*n_seg]}};
+	l.set_leg(epoch(1000), sc_state(r0, v0, z[6]), z.begin() + 7, z.begin() + 7 + 3*n_seg, epoch(1250), sc_state(r1, v1, z[13 + 3*n_seg]), ASTRO_MU_SUN);
+}
+
+// Largest difference between the analytic and the central difference Jacobian, each derivative being scaled
+// by the typical sizes of the mismatch and of the variable
+double jacobian_error(leg& l, std::vector<double> z, const int& n_seg) {
+	const double scales[7] = {ASTRO_AU, ASTRO_AU, ASTRO_AU, 30000, 30000, 30000, 1000};
+	const size_t n_var = z.size();
+	std::vector<double> scale(n_var, 1.);
+	for (int i = 0; i < 7; ++i) {
+		scale[i] = scales[i];
+		scale[7 + 3*n_seg + i] = scales[i];
+	}
+
+	array7D mismatch, plus, minus;
+	std::vector<double> jac(7 * n_var);
+	set_variables(l, z, n_seg);
+	l.get_mismatch_con_jacobian(mismatch.begin(), mismatch.end(), jac.begin(), jac.end());
+
+	double err_max = 0;
+	for (size_t k = 0; k < n_var; ++k) {
+		double h = 1e-6 * scale[k];
+		double zk = z[k];
+		z[k] = zk + h;
+		set_variables(l, z, n_seg);
+		l.get_mismatch_con(plus.begin(), plus.end());
+		z[k] = zk - h;
+		set_variables(l, z, n_seg);
+		l.get_mismatch_con(minus.begin(), minus.end());
+		z[k] = zk;
+		for (int i = 0; i < 7; ++i) {
+			double fd = (plus[i] - minus[i]) / (2 * h);
+			err_max = std::max(err_max, std::abs(fd - jac[i * n_var + k]) * scale[k] / scales[i]);
+		}
+	}
+	return err_max;
+}
+
+int main() {
+	// Preamble
+	boost::mt19937 rng;
+	boost::uniform_real<> dist1(-1,1);
+	boost::variate_generator<boost::mt19937&, boost::uniform_real<> > drng(rng, dist1);
+	double err_max=0,err=0;
+	int count=0;
+
+	// Experiment Settings
+	unsigned int Ntrials = 20;
+	const int n_seg = 5;
+
+	// Start Experiment
+	for (unsigned int i = 0; i<Ntrials; ++i){
+		//1 - a random Earth-like to Mars-like leg
+		std::vector<double> z(14 + 3*n_seg);
+		z[0] = ASTRO_AU * (1 + 0.1*drng()); z[1] = ASTRO_AU * 0.1*drng(); z[2] = ASTRO_AU * 0.01*drng();
+		z[3] = 1000*drng(); z[4] = 29784.7 + 1000*drng(); z[5] = 100*drng();
+		z[6] = 1500;
+		for (int j = 0; j < 3*n_seg; ++j) z[7 + j] = drng() * 0.5;
+		z[7 + 3*n_seg] = ASTRO_AU * 0.1*drng(); z[8 + 3*n_seg] = ASTRO_AU * (1.52 + 0.1*drng()); z[9 + 3*n_seg] = ASTRO_AU * 0.01*drng();
+		z[10 + 3*n_seg] = -24130.0 + 1000*drng(); z[11 + 3*n_seg] = 1000*drng(); z[12 + 3*n_seg] = 100*drng();
+		z[13 + 3*n_seg] = 1300;
+
+		leg l;
+		l.set_spacecraft(spacecraft(1500, 0.3, 3000));
+
+		//2 - chemical (impulsive) model
+		l.set_high_fidelity(false);
+		err = jacobian_error(l, z, n_seg);
+		err_max = std::max(err_max,err);
+
+		//3 - high fidelity model, every other trial only
+		if (i % 2 == 0) {
+			l.set_high_fidelity(true);
+			err = jacobian_error(l, z, n_seg);
+			err_max = std::max(err_max,err);
+		}
+		count ++;
+	}
+	std::cout << "Max scaled difference: " << err_max << std::endl;
+	std::cout << "Number of Comparisons Made: " << count << std::endl;
+	if (err_max < 1e-6) {
+		return 0;
+	} else {
+		return 1;
+	}
+}
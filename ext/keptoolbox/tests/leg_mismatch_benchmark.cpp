@@ -0,0 +1,148 @@
+/*****************************************************************************
+ *   Copyright (C) 2004-2012 The PyKEP development team,                     *
+ *   Advanced Concepts Team (ACT), European Space Agency (ESA)               *
+ *   http://keptoolbox.sourceforge.net/index.html                            *
+ *   http://keptoolbox.sourceforge.net/credits.html                          *
+ *                                                                           *
+ *   act@esa.int                                                             *
+ *                                                                           *
+ *   This program is free software; you can redistribute it and/or modify    *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   This program is distributed in the hope that it will be useful,         *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with this program; if not, write to the                           *
+ *   Free Software Foundation, Inc.,                                         *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.               *
+ *****************************************************************************/
+
+// Times the high-fidelity (Taylor propagated) mismatch evaluation of sims_flanagan legs, which is what
+// fb_traj::evaluate_all_mismatch_con spends its time on when the legs are high fidelity.
+
+#include <iostream>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/random.hpp>
+
+#include "../src/keplerian_toolbox.h"
+
+using namespace std;
+using namespace kep_toolbox;
+using namespace kep_toolbox::sims_flanagan;
+int main() {
+	// Preamble
+	boost::mt19937 rng;
+	boost::uniform_real<> dist1(-1,1);
+	boost::variate_generator<boost::mt19937&, boost::uniform_real<> > drng(rng, dist1);
+
+	// Experiment Settings
+	const unsigned int Nlegs = 20;
+	const unsigned int Nsegments = 20;
+	const unsigned int Nevaluations = 500;
+
+	// A set of Earth-like to Mars-like low-thrust legs with random throttles
+	spacecraft sc(1500, 0.3, 3000);
+	std::vector<leg> legs(Nlegs);
+	for (unsigned int i = 0; i<Nlegs; ++i){
+		array3D r0 = {{ASTRO_AU, 0, 0}}, v0 = {{0, 29784.7, 0}};
+		array3D r1 = {{0, 1.52 * ASTRO_AU, 0}}, v1 = {{-24130.0, 0, 0}};
+		std::vector<double> throttles(3 * Nsegments);
+		for (unsigned int j = 0; j < throttles.size(); ++j) throttles[j] = drng() * 0.5;
+		legs[i].set_spacecraft(sc);
+		legs[i].set_leg(epoch(1000), sc_state(r0, v0, 1500), throttles.begin(), throttles.end(), epoch(1250 + i), sc_state(r1, v1, 1300), ASTRO_MU_SUN);
+		legs[i].set_high_fidelity(true);
+	}
+
+	// Start Experiment
+	array7D mismatch;
+	double check = 0;
+	boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+	for (unsigned int n = 0; n < Nevaluations; ++n){
+		for (unsigned int i = 0; i<Nlegs; ++i){
+			legs[i].get_mismatch_con(mismatch.begin(), mismatch.end());
+			check += mismatch[0];
+		}
+	}
+	boost::posix_time::time_duration elapsed = boost::posix_time::microsec_clock::local_time() - start;
+	std::cout << "Time per leg mismatch: " << elapsed.total_microseconds() / double(Nevaluations * Nlegs) << " us" << std::endl;
+	std::cout << "Checksum: " << check << std::endl;
+
+	// The same legs evaluated concurrently on a thread pool, each leg also running its two halves concurrently
+	thread_pool pool;
+	std::vector<double> mismatches(7 * Nlegs);
+	std::vector<thread_pool::task_type> tasks(Nlegs);
+	for (unsigned int i = 0; i<Nlegs; ++i){
+		tasks[i] = boost::bind(&leg::get_mismatch_con<std::vector<double>::iterator>, &legs[i],
+				       mismatches.begin() + 7 * i, mismatches.begin() + 7 * (i + 1), boost::ref(pool));
+	}
+	check = 0;
+	start = boost::posix_time::microsec_clock::local_time();
+	for (unsigned int n = 0; n < Nevaluations; ++n){
+		pool.run(tasks);
+		for (unsigned int i = 0; i<Nlegs; ++i){
+			check += mismatches[7 * i];
+		}
+	}
+	elapsed = boost::posix_time::microsec_clock::local_time() - start;
+	std::cout << "Time per leg mismatch on " << pool.get_size() << " threads: " << elapsed.total_microseconds() / double(Nevaluations * Nlegs) << " us" << std::endl;
+	std::cout << "Checksum: " << check << std::endl;
+
+	// The mismatch together with its analytic Jacobian, to compare with 2 (3 Nsegments + 14) evaluations of central differences
+	std::vector<double> jacobian(7 * legs[0].get_jacobian_n_var());
+	check = 0;
+	start = boost::posix_time::microsec_clock::local_time();
+	for (unsigned int n = 0; n < Nevaluations / 10; ++n){
+		for (unsigned int i = 0; i<Nlegs; ++i){
+			legs[i].get_mismatch_con_jacobian(mismatch.begin(), mismatch.end(), jacobian.begin(), jacobian.end());
+			check += jacobian[0];
+		}
+	}
+	elapsed = boost::posix_time::microsec_clock::local_time() - start;
+	std::cout << "Time per leg mismatch Jacobian: " << elapsed.total_microseconds() / double(Nevaluations / 10 * Nlegs) << " us" << std::endl;
+	std::cout << "Checksum: " << check << std::endl;
+
+	// The first thrust arc of a population of legs with random throttles, one at a time and as a batch
+	const unsigned int Npopulation = 20 * Nlegs;
+	const double tof = 250. / Nsegments * ASTRO_DAY2SEC, veff = sc.get_isp() * ASTRO_G0;
+	std::vector<double> rx(Npopulation, ASTRO_AU), ry(Npopulation, 0), rz(Npopulation, 0);
+	std::vector<double> vx(Npopulation, 0), vy(Npopulation, 29784.7), vz(Npopulation, 0), m(Npopulation, 1500);
+	std::vector<double> ux(Npopulation), uy(Npopulation), uz(Npopulation), t(Npopulation, tof);
+	for (unsigned int i = 0; i<Npopulation; ++i){
+		ux[i] = drng() * 0.5 * sc.get_thrust(); uy[i] = drng() * 0.5 * sc.get_thrust(); uz[i] = drng() * 0.5 * sc.get_thrust();
+	}
+	check = 0;
+	start = boost::posix_time::microsec_clock::local_time();
+	for (unsigned int n = 0; n < Nevaluations / 10; ++n){
+		for (unsigned int i = 0; i<Npopulation; ++i){
+			array3D r = {{rx[i], ry[i], rz[i]}}, v = {{vx[i], vy[i], vz[i]}}, u = {{ux[i], uy[i], uz[i]}};
+			double mass = m[i];
+			propagate_taylor(r, v, mass, u, tof, ASTRO_MU_SUN, veff, -10, -10);
+			check += r[0];
+		}
+	}
+	elapsed = boost::posix_time::microsec_clock::local_time() - start;
+	std::cout << "Time per thrust arc: " << elapsed.total_microseconds() / double(Nevaluations / 10 * Npopulation) << " us" << std::endl;
+	std::cout << "Checksum: " << check << std::endl;
+
+	taylor_batch_workspace ws;
+	check = 0;
+	start = boost::posix_time::microsec_clock::local_time();
+	for (unsigned int n = 0; n < Nevaluations / 10; ++n){
+		std::vector<double> x(rx), y(ry), z(rz), u(vx), v(vy), w(vz), mass(m);
+		propagate_taylor_batch(Npopulation, &x[0], &y[0], &z[0], &u[0], &v[0], &w[0], &mass[0], &ux[0], &uy[0], &uz[0], &t[0], ASTRO_MU_SUN, veff, -10, -10, ws);
+		for (unsigned int i = 0; i<Npopulation; ++i){
+			check += x[i];
+		}
+	}
+	elapsed = boost::posix_time::microsec_clock::local_time() - start;
+	std::cout << "Time per thrust arc in a batch: " << elapsed.total_microseconds() / double(Nevaluations / 10 * Npopulation) << " us" << std::endl;
+	std::cout << "Checksum: " << check << std::endl;
+	return 0;
+}
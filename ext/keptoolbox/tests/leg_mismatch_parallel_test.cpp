@@ -0,0 +1,117 @@
+/*****************************************************************************
+ *   Copyright (C) 2004-2012 The PyKEP development team,                     *
+ *   Advanced Concepts Team (ACT), European Space Agency (ESA)               *
+ *   http://keptoolbox.sourceforge.net/index.html                            *
+ *   http://keptoolbox.sourceforge.net/credits.html                          *
+ *                                                                           *
+ *   act@esa.int                                                             *
+ *                                                                           *
+ *   This program is free software; you can redistribute it and/or modify    *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   This program is distributed in the hope that it will be useful,         *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with this program; if not, write to the                           *
+ *   Free Software Foundation, Inc.,                                         *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.               *
+ *****************************************************************************/
+
+#include <iostream>
+#include <vector>
+#include <boost/random.hpp>
+
+#include "../src/keplerian_toolbox.h"
+#include "../src/sims_flanagan/codings.h"
+
+using namespace std;
+using namespace kep_toolbox;
+using namespace kep_toolbox::sims_flanagan;
+
+// Counts the mismatch values that are not bit-identical
+int count_differences(const std::vector<double>& a, const std::vector<double>& b) {
+	int retval = 0;
+	for (size_t i = 0; i < a.size(); ++i) {
+		if (!(a[i] == b[i])) ++retval;
+	}
+	return retval;
+}
+
+int main() {
+	// Preamble
+	boost::mt19937 rng;
+	boost::uniform_real<> dist1(-1,1);
+	boost::variate_generator<boost::mt19937&, boost::uniform_real<> > drng(rng, dist1);
+	int differences = 0;
+	int count = 0;
+
+	// Experiment Settings
+	unsigned int Ntrials = 50;
+	const int n_seg = 10;
+	thread_pool pool(4);
+	thread_pool serial_pool(1);
+
+	//1 - a chemical multiple fly-by trajectory, legs and half legs evaluated concurrently
+	std::vector<planet_ptr> sequence;
+	sequence.push_back(planet_ss("earth").clone());
+	sequence.push_back(planet_ss("venus").clone());
+	sequence.push_back(planet_ss("earth").clone());
+	sequence.push_back(planet_ss("mars").clone());
+	sequence.push_back(planet_ss("jupiter").clone());
+	const int n_legs = sequence.size() - 1;
+	fb_traj traj(sequence, n_seg, 2000, 0.5, 3000);
+	base_format coding(n_legs, n_seg, 2000);
+
+	std::vector<double> x(coding.size());
+	std::vector<double> serial(7 * n_legs), parallel(7 * n_legs);
+	for (unsigned int i = 0; i<Ntrials; ++i){
+		int k = 0;
+		x[k++] = 1000 + drng() * 100;
+		for (int leg_n = 0; leg_n < n_legs; ++leg_n) {
+			for (int j = 0; j < 3; ++j) x[k++] = drng() * 3;
+			for (int j = 0; j < 3 * n_seg; ++j) x[k++] = drng() * 0.5;
+			for (int j = 0; j < 3; ++j) x[k++] = drng() * 3;
+			x[k] = x[k - 3 * n_seg - 7] + 300 + drng() * 100;
+			++k;
+		}
+		traj.init_from_full_vector(x.begin(), x.end(), coding);
+
+		traj.evaluate_all_mismatch_con(serial.begin(), serial.end());
+		traj.evaluate_all_mismatch_con(parallel.begin(), parallel.end(), pool);
+		differences += count_differences(serial, parallel);
+		traj.evaluate_all_mismatch_con(parallel.begin(), parallel.end(), serial_pool);
+		differences += count_differences(serial, parallel);
+		count ++;
+	}
+
+	//2 - high fidelity legs, whose halves are propagated with Taylor integration
+	spacecraft sc(1500, 0.3, 3000);
+	std::vector<leg> legs(6);
+	for (unsigned int i = 0; i<legs.size(); ++i){
+		array3D r0 = {{ASTRO_AU, 0, 0}}, v0 = {{0, 29784.7, 0}};
+		array3D r1 = {{0, 1.52 * ASTRO_AU, 0}}, v1 = {{-24130.0, 0, 0}};
+		std::vector<double> throttles(3 * (n_seg + i));
+		for (unsigned int j = 0; j < throttles.size(); ++j) throttles[j] = drng() * 0.5;
+		legs[i].set_spacecraft(sc);
+		legs[i].set_leg(epoch(1000), sc_state(r0, v0, 1500), throttles.begin(), throttles.end(), epoch(1250 + 10 * i), sc_state(r1, v1, 1300), ASTRO_MU_SUN);
+		legs[i].set_high_fidelity(true);
+
+		legs[i].get_mismatch_con(serial.begin(), serial.begin() + 7);
+		legs[i].get_mismatch_con(parallel.begin(), parallel.begin() + 7, pool);
+		differences += count_differences(serial, parallel);
+		count ++;
+	}
+
+	std::cout << "Number of values differing: " << differences << std::endl;
+	std::cout << "Number of Comparisons Made: " << count << std::endl;
+	if (differences == 0) {
+		return 0;
+	} else {
+		return 1;
+	}
+}
@@ -0,0 +1,86 @@
+/*****************************************************************************
+ *   Copyright (C) 2004-2012 The PyKEP development team,                     *
+ *   Advanced Concepts Team (ACT), European Space Agency (ESA)               *
+ *   http://keptoolbox.sourceforge.net/index.html                            *
+ *   http://keptoolbox.sourceforge.net/credits.html                          *
+ *                                                                           *
+ *   act@esa.int                                                             *
+ *                                                                           *
+ *   This program is free software; you can redistribute it and/or modify    *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   This program is distributed in the hope that it will be useful,         *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with this program; if not, write to the                           *
+ *   Free Software Foundation, Inc.,                                         *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.               *
+ *****************************************************************************/
+
+#include <iostream>
+#include <vector>
+#include <boost/random.hpp>
+
+#include "../src/keplerian_toolbox.h"
+
+using namespace std;
+using namespace kep_toolbox;
+int main() {
+	// Preamble
+	boost::mt19937 rng;
+	boost::uniform_real<> dist1(-2,2);
+	boost::variate_generator<boost::mt19937&, boost::uniform_real<> > drng(rng, dist1);
+	double err_max=0,err=0;
+
+	// Experiment Settings, more states than the lanes of a block and not a multiple of them
+	const unsigned int N = 50001;
+
+	//1 - generate random propagation set-ups
+	std::vector<double> rx(N),ry(N),rz(N),vx(N),vy(N),vz(N),t(N),minus_t(N);
+	for (unsigned int i = 0; i<N; ++i){
+		rx[i] = drng() * 2; ry[i] = drng() * 2; rz[i] = drng() * 2;
+		vx[i] = drng() * 2; vy[i] = drng() * 2; vz[i] = drng() * 2;
+		t[i] = drng() * 20;
+		minus_t[i] = -t[i];
+	}
+	std::vector<double> x(rx),y(ry),z(rz),u(vx),v(vy),w(vz);
+
+	//2 - every lane must keep the energy and the angular momentum of its initial state
+	propagate_lagrangian_batch(N,&x[0],&y[0],&z[0],&u[0],&v[0],&w[0],&t[0],1.0);
+	for (unsigned int i = 0; i<N; ++i){
+		array3D r0 = {{rx[i],ry[i],rz[i]}}, v0 = {{vx[i],vy[i],vz[i]}};
+		array3D r1 = {{x[i],y[i],z[i]}}, v1 = {{u[i],v[i],w[i]}};
+		double energy0 = 0.5 * dot(v0,v0) - 1.0 / norm(r0);
+		double energy1 = 0.5 * dot(v1,v1) - 1.0 / norm(r1);
+		array3D h0,h1;
+		cross(h0,r0,v0);
+		cross(h1,r1,v1);
+		diff(h1,h1,h0);
+		err = std::max(fabs(energy1 - energy0) / std::max(1.,fabs(energy0)), norm(h1) / std::max(1.,norm(h0)));
+		err_max = std::max(err_max,err);
+	}
+
+	//3 - propagate back to the initial state
+	propagate_lagrangian_batch(N,&x[0],&y[0],&z[0],&u[0],&v[0],&w[0],&minus_t[0],1.0);
+	for (unsigned int i = 0; i<N; ++i){
+		array3D r0 = {{rx[i],ry[i],rz[i]}}, r1 = {{x[i],y[i],z[i]}};
+		array3D v0 = {{vx[i],vy[i],vz[i]}}, v1 = {{u[i],v[i],w[i]}};
+		diff(r1,r1,r0);
+		diff(v1,v1,v0);
+		err = std::max(norm(r1) / std::max(1.,norm(r0)), norm(v1) / std::max(1.,norm(v0)));
+		err_max = std::max(err_max,err);
+	}
+
+	std::cout << "Max error: " << err_max << std::endl;
+	std::cout << "Number of Propagations Made: " << 2 * N << std::endl;
+	if (err_max < 1e-7) {
+		return 0;
+	} else {
+		return 1;
+	}
+}
@@ -0,0 +1,122 @@
+/*****************************************************************************
+ *   Copyright (C) 2004-2012 The PyKEP development team,                     *
+ *   Advanced Concepts Team (ACT), European Space Agency (ESA)               *
+ *   http://keptoolbox.sourceforge.net/index.html                            *
+ *   http://keptoolbox.sourceforge.net/credits.html                          *
+ *                                                                           *
+ *   act@esa.int                                                             *
+ *                                                                           *
+ *   This program is free software; you can redistribute it and/or modify    *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   This program is distributed in the hope that it will be useful,         *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with this program; if not, write to the                           *
+ *   Free Software Foundation, Inc.,                                         *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.               *
+ *****************************************************************************/
+
+#include <iostream>
+#include <vector>
+#include <boost/random.hpp>
+
+#include "../src/keplerian_toolbox.h"
+
+using namespace std;
+using namespace kep_toolbox;
+
+// Propagates the lanes of a batch in reverse order and returns the largest relative difference from the
+// result of the forward batch (x,y,z,u,v,w,mass)
+static double reversed_batch_difference(const std::vector<double> *in, const std::vector<double> *out, const std::vector<double> &t, int tol, int rtol, taylor_batch_workspace &ws) {
+	const unsigned int N = t.size();
+	std::vector<double> s[11];
+	for (unsigned int j = 0; j<10; ++j) s[j].assign(in[j].rbegin(),in[j].rend());
+	s[10].assign(t.rbegin(),t.rend());
+	propagate_taylor_batch(N,&s[0][0],&s[1][0],&s[2][0],&s[3][0],&s[4][0],&s[5][0],&s[6][0],&s[7][0],&s[8][0],&s[9][0],&s[10][0],1.0,1.0,tol,rtol,ws);
+	double d = 0;
+	for (unsigned int i = 0; i<N; ++i) {
+		for (unsigned int j = 0; j<7; ++j) {
+			const double a = out[j][i], b = s[j][N-1-i];
+			d = std::max(d,std::abs(a-b) / std::max(1.,std::abs(a)));
+		}
+	}
+	return d;
+}
+
+int main() {
+	boost::mt19937 rng;
+	boost::uniform_real<> dist1(-1,1);
+	boost::variate_generator<boost::mt19937&, boost::uniform_real<> > drng(rng, dist1);
+
+	// 1001 lanes fill 15 blocks of 64 and leave a partial one, every 37th lane has t == 0 and must be dropped from its
+	// block before the first step
+	const unsigned int N = 1001;
+	// With log10tolerance == log10rtolerance every lane asks for the same polynomial order. With {-8, -12} the lanes
+	// whose largest component is below 1e4 ask for the order of an absolute 1e-8 and the heavier ones, every 5th,
+	// for that of a relative 1e-12, so a block takes the highest order among the lanes it still holds
+	const int tolerances[][2] = {{-10, -10}, {-6, -6}, {-8, -12}};
+
+	std::vector<double> in[10];
+	std::vector<double> t(N);
+	for (unsigned int j = 0; j<10; ++j) in[j].resize(N);
+	for (unsigned int i = 0; i<N; ++i){
+		for (unsigned int j = 0; j<6; ++j) in[j][i] = drng() * 2;
+		in[6][i] = (drng()+1)*500 + ((i % 5 == 0) ? 20000 : 1000);
+		for (unsigned int j = 7; j<10; ++j) in[j][i] = drng() * 1;
+		t[i] = (i % 37 == 0) ? 0 : drng() * 20;
+	}
+
+	double err_scalar = 0, err_mixed = 0, err_order = 0;
+	unsigned int moved = 0;
+	taylor_batch_workspace ws;
+	for (unsigned int k = 0; k<3; ++k){
+		const int tol = tolerances[k][0], rtol = tolerances[k][1];
+		std::vector<double> out[7];
+		for (unsigned int j = 0; j<7; ++j) out[j] = in[j];
+		propagate_taylor_batch(N,&out[0][0],&out[1][0],&out[2][0],&out[3][0],&out[4][0],&out[5][0],&out[6][0],&in[7][0],&in[8][0],&in[9][0],&t[0],1.0,1.0,tol,rtol,ws);
+
+		for (unsigned int i = 0; i<N; ++i){
+			// the lanes with t == 0 never enter a block, so they must come back untouched
+			if (t[i] == 0) {
+				for (unsigned int j = 0; j<7; ++j) moved += (out[j][i] != in[j][i]);
+				continue;
+			}
+			// the others must agree with propagate_taylor, also when their block was shrinking around them. With a
+			// single order they use the order of the scalar propagation, with mixed tolerances a lane may have been
+			// propagated at a higher order than it asked for and only the truncation error of the scalar one is left
+			array3D r0 = {{in[0][i],in[1][i],in[2][i]}}, v0 = {{in[3][i],in[4][i],in[5][i]}}, thrust = {{in[7][i],in[8][i],in[9][i]}};
+			double m0 = in[6][i];
+			propagate_taylor(r0,v0,m0,thrust,t[i],1.0,1.0,tol,rtol);
+			array3D r1 = {{out[0][i],out[1][i],out[2][i]}}, v1 = {{out[3][i],out[4][i],out[5][i]}};
+			diff(r1,r1,r0);
+			diff(v1,v1,v0);
+			double err = std::max(norm(r1) / std::max(1.,norm(r0)), norm(v1) / std::max(1.,norm(v0)));
+			err = std::max(err,std::abs(out[6][i]-m0) / m0);
+			if (tol == rtol) {
+				err_scalar = std::max(err_scalar,err);
+			} else {
+				err_mixed = std::max(err_mixed,err);
+			}
+		}
+
+		// reversing the lanes regroups them in different blocks: with a single order this must not change a bit,
+		// with mixed tolerances the order of a block may change and the lanes only agree to within the tolerance
+		const double d = reversed_batch_difference(in,out,t,tol,rtol,ws);
+		if (tol == rtol) {
+			moved += (d != 0);
+		} else {
+			err_order = std::max(err_order,d);
+		}
+	}
+
+	std::cout << "Largest deviation from propagate_taylor: " << err_scalar << " (single order), " << err_mixed << " (mixed orders)" << std::endl;
+	std::cout << "Largest deviation after reversing the lanes: " << err_order << std::endl;
+	std::cout << "Values that should have been bit-identical but were not: " << moved << std::endl;
+	return (err_scalar < 1e-8 && err_mixed < 1e-6 && err_order < 1e-6 && moved == 0) ? 0 : 1;
+}
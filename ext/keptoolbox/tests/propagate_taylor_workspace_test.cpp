@@ -0,0 +1,109 @@
+/*****************************************************************************
+ *   Copyright (C) 2004-2012 The PyKEP development team,                     *
+ *   Advanced Concepts Team (ACT), European Space Agency (ESA)               *
+ *   http://keptoolbox.sourceforge.net/index.html                            *
+ *   http://keptoolbox.sourceforge.net/credits.html                          *
+ *                                                                           *
+ *   act@esa.int                                                             *
+ *                                                                           *
+ *   This program is free software; you can redistribute it and/or modify    *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   This program is distributed in the hope that it will be useful,         *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with this program; if not, write to the                           *
+ *   Free Software Foundation, Inc.,                                         *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.               *
+ *****************************************************************************/
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <boost/random.hpp>
+
+#include "../src/keplerian_toolbox.h"
+
+using namespace std;
+using namespace kep_toolbox;
+int main() {
+	// Preamble
+	array3D r0,v0,r1,v1,r2,v2,u;
+	double tof,m0,m1,m2,t1,t2;
+	boost::mt19937 rng;
+	boost::uniform_real<> dist1(-1,1);
+	boost::variate_generator<boost::mt19937&, boost::uniform_real<> > drng(rng, dist1);
+	double err_max=0,err=0;
+	int count=0;
+
+	// Experiment Settings
+	unsigned int Ntrials = 500;
+	// Polynomial orders 8, 13, 24 and 29, i.e. below, inside and above the ones kept on the stack
+	const int tolerances[] = {-6, -10, -20, -24};
+
+	// One workspace reused by every propagation
+	taylor_workspace ws;
+	taylor_s_workspace ws_s;
+
+	// Start Experiment
+	for (unsigned int i = 0; i<Ntrials; ++i){
+		//1 - generate a random propagation set-up
+		r0[0] = drng() * 2; r0[1] = drng() * 2; r0[2] = drng() * 2;
+		v0[0] = drng() * 2; v0[1] = drng() * 2; v0[2] = drng() * 2;
+		m0 = (drng()+1)*500 + 1000;
+		u[0] = drng() * 1;
+		u[1] = drng() * 1;
+		u[2] = drng() * 1;
+		tof = drng() * 20;
+		int tol = tolerances[i % 4];
+
+		//2 - the caller-owned workspace must not change the result
+		r1 = r0; v1 = v0; m1 = m0;
+		r2 = r0; v2 = v0; m2 = m0;
+		propagate_taylor(r1,v1,m1,u,tof,1.0,1.0,tol,tol);
+		propagate_taylor(r2,v2,m2,u,tof,1.0,1.0,tol,tol,10000,3000,ws);
+		diff(r1,r1,r2);
+		diff(v1,v1,v2);
+		err = std::max(norm(r1),norm(v1));
+		err = std::max(err,std::abs(m1-m2));
+		err_max = std::max(err_max,err);
+
+		r1 = r0; v1 = v0; m1 = m0; t1 = 0;
+		r2 = r0; v2 = v0; m2 = m0; t2 = 0;
+		propagate_taylor_s(r1,v1,m1,t1,u,tof/20,1.1,1.0,1.0,1.0,tol,tol);
+		propagate_taylor_s(r2,v2,m2,t2,u,tof/20,1.1,1.0,1.0,1.0,tol,tol,10000,3000,ws_s);
+		diff(r1,r1,r2);
+		diff(v1,v1,v2);
+		err = std::max(norm(r1),norm(v1));
+		err = std::max(err,std::abs(m1-m2));
+		err = std::max(err,std::abs(t1-t2));
+		err_max = std::max(err_max,err);
+
+		//3 - a step at a fixed order must match the same step with heap allocated coefficients
+		std::vector< boost::array<double,7> > x(14);
+		std::vector< boost::array<double,21> > uu(13);
+		for (int j=0;j<13;++j) uu[j].assign(0);
+		r1 = r0; v1 = v0; m1 = m0;
+		r2 = r0; v2 = v0; m2 = m0;
+		double xm = std::max(std::max(norm(r0),norm(v0)),m0);
+		double h1 = propagate_taylor_step(r1,v1,m1,tof,13,u,1.0,1.0,xm,1e-10,1e-10,x,uu);
+		double h2 = propagate_taylor_step_fixed<13>(r2,v2,m2,tof,u,1.0,1.0,xm,1e-10,1e-10);
+		diff(r1,r1,r2);
+		diff(v1,v1,v2);
+		err = std::max(norm(r1),norm(v1));
+		err = std::max(err,std::abs(h1-h2));
+		err_max = std::max(err_max,err);
+		count ++;
+	}
+	std::cout << "Max difference: " << err_max << std::endl;
+	std::cout << "Number of Comparisons Made: " << count << std::endl;
+	if (err_max < 1e-12) {
+		return 0;
+	} else {
+		return 1;
+	}
+}
@@ -1,5 +1,6 @@
 #include "Arcs.h"
 #include "Lambert.h"
+#include "Orbit.h"
 
 void Arc::CompareToPreviousArc(const Arc& previousArc, Vector3* deltaVelocity)
 {
@@ -23,11 +24,11 @@ void LambertArc::SetInitialConditions(const Vector3& initialCondition1, const Ve
 void LambertArc::Evaluate(double timeOfFlight)
 {
     assert(timeOfFlight > 0.0);
-    LambertManager::Evaluate(_initialStateVector.position, _initialStateVector.velocity,
+    LambertManager::Evaluate(_initialStateVector.position, _finalStateVector.position,
                              timeOfFlight,
                              _orbitDirection,
                              _maxRevolutions,
-                             &_finalStateVector.position, &_finalStateVector.velocity);
+                             &_initialStateVector.velocity, &_finalStateVector.velocity);
 }
 
 CoastArc::CoastArc(PropagateType propagateType)
@@ -48,9 +49,13 @@ void CoastArc::Evaluate(double timeOfFlight)
     switch (_propagateType)
     {
     case PROPAGATE_COES:
-        break;
-
     case PROPAGATE_RV:
+        {
+            // Canonical units, so mu = 1.
+            Orbit orbit(_initialStateVector, 1.0);
+            orbit.Propagate(timeOfFlight, _propagateType);
+            _finalStateVector = orbit.GetStateVector();
+        }
         break;
 
     case PROPAGATE_JPL_EPHEMERIS:
@@ -136,7 +136,8 @@ enum LambertType
     LAMBERT_EXP_SINUSOID,
     LAMBERT_BATTIN,
     LAMBERT_UNIVERSAL_VAR,
-    LAMBERT_UNIVERSAL_VAR_GPU,
+    LAMBERT_UNIVERSAL_VAR_BULK,
+    LAMBERT_IZZO,
     LAMBERT_COUNT
 };
 
@@ -182,7 +183,93 @@ struct OrbitalElements
                 trueAnomaly   == rhs.trueAnomaly   &&
                 timePerigee   == rhs.timePerigee);
     }
-    
+
+};
+
+/// Structure-of-arrays storage for a set of 3D vectors.
+/// Each component is stored contiguously so batched kernels can stream
+/// through the x, y and z columns independently.
+struct Vector3Array
+{
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> z;
+
+    inline void Resize(size_t count)
+    {
+        x.resize(count);
+        y.resize(count);
+        z.resize(count);
+    }
+
+    inline size_t Size() const
+    {
+        return x.size();
+    }
+
+    inline void Set(size_t index, const Vector3& vector)
+    {
+        x[index] = vector.x;
+        y[index] = vector.y;
+        z[index] = vector.z;
+    }
+
+    inline void Get(size_t index, Vector3* vector) const
+    {
+        vector->set(x[index], y[index], z[index]);
+    }
+};
+
+/// Structure-of-arrays storage for a set of orbital elements.
+/// Each element is stored contiguously so batched conversions can stream
+/// through them independently.
+struct OrbitalElementsArray
+{
+    std::vector<double> semimajorAxis;
+    std::vector<double> eccentricity;
+    std::vector<double> argPerigee;
+    std::vector<double> inclination;
+    std::vector<double> raan;
+    std::vector<double> trueAnomaly;
+    std::vector<double> timePerigee;
+
+    inline void Resize(size_t count)
+    {
+        semimajorAxis.resize(count);
+        eccentricity.resize(count);
+        argPerigee.resize(count);
+        inclination.resize(count);
+        raan.resize(count);
+        trueAnomaly.resize(count);
+        timePerigee.resize(count);
+    }
+
+    inline size_t Size() const
+    {
+        return semimajorAxis.size();
+    }
+
+    inline void Set(size_t index, const OrbitalElements& orbitalElements)
+    {
+        semimajorAxis[index] = orbitalElements.semimajorAxis;
+        eccentricity[index] = orbitalElements.eccentricity;
+        argPerigee[index] = orbitalElements.argPerigee;
+        inclination[index] = orbitalElements.inclination;
+        raan[index] = orbitalElements.raan;
+        trueAnomaly[index] = orbitalElements.trueAnomaly;
+        timePerigee[index] = orbitalElements.timePerigee;
+    }
+
+    inline void Get(size_t index, OrbitalElements* orbitalElements) const
+    {
+        orbitalElements->semimajorAxis = semimajorAxis[index];
+        orbitalElements->eccentricity = eccentricity[index];
+        orbitalElements->argPerigee = argPerigee[index];
+        orbitalElements->inclination = inclination[index];
+        orbitalElements->raan = raan[index];
+        orbitalElements->trueAnomaly = trueAnomaly[index];
+        orbitalElements->timePerigee = timePerigee[index];
+    }
 };
 
 // Math
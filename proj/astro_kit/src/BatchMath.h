@@ -0,0 +1,244 @@
+/*****************************************************************************
+ *   IGATO - Interplanetary Gravity Assist Trajectory Optimizer              *
+ *   Copyright (C) 2012 Jason Bryan (Jmbryan10@gmail.com)                    *
+ *                                                                           *
+ *   IGATO is free software; you can redistribute it and/or modify           *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   IGATO is distributed in the hope that it will be useful,                *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with IGATO; if not, see http://www.gnu.org/licenses/              *
+ *****************************************************************************/
+
+#pragma once
+#include "Base.h"
+
+#include <float.h>
+#include <stdint.h>
+#include <string.h>
+
+// Branch-free elementary functions for the inner loops of the batch kernels.
+//
+// The C library functions are out-of-line calls with data dependent branches,
+// so a loop over the lanes of a batch that calls them stays scalar. The
+// functions below are inline, select their result instead of branching and
+// use only arithmetic, comparisons and integer bit operations on the IEEE
+// representation, which the compiler keeps in vector registers. They follow
+// the Cephes library (S. L. Moshier, "Methods and Programs for Mathematical
+// Functions", 1989) and are accurate to a few units in the last place over the
+// documented domains. Arguments outside a domain give an unspecified finite,
+// infinite or NaN result without trapping, so every lane of a loop may be
+// evaluated and the unused results discarded.
+
+/// Marks a batch kernel to be compiled for AVX-512, AVX2 and the baseline
+/// instruction set, with the best one picked at load time. Only GCC on x86-64
+/// Linux provides the dispatch; elsewhere the kernel is compiled once for the
+/// instruction set selected by the build (e.g. /arch:AVX2).
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__)
+#define BATCH_KERNEL __attribute__((target_clones("avx512f", "avx2", "default"), optimize("tree-vectorize", "no-trapping-math")))
+#else
+#define BATCH_KERNEL
+#endif
+
+/// Marks the array parameters of a batch kernel as not overlapping, so that
+/// the compiler needs no run-time checks before vectorizing the loop.
+#define BATCH_RESTRICT __restrict
+
+/// Functions called from a batch kernel are inlined into each of its clones.
+#if defined(_MSC_VER)
+#define BATCH_INLINE __forceinline
+#elif defined(__GNUC__)
+#define BATCH_INLINE inline __attribute__((always_inline))
+#else
+#define BATCH_INLINE inline
+#endif
+
+BATCH_INLINE uint64_t BatchBits(double x)
+{
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits;
+}
+
+BATCH_INLINE double BatchFromBits(uint64_t bits)
+{
+    double x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+/// Square root, for x >= 0. GCC keeps a branch to the library around sqrt()
+/// to set errno unless built with -fno-math-errno, so the root is found there
+/// from the reciprocal root estimate of the IEEE representation and Newton
+/// steps, to within an ulp.
+BATCH_INLINE double BatchSqrt(double x)
+{
+#if defined(__GNUC__) && !defined(__NO_MATH_ERRNO__)
+    double y = BatchFromBits(0x5fe6eb50c7b537a9ULL - (BatchBits(x) >> 1));
+    y = y * (1.5 - 0.5 * x * y * y);
+    y = y * (1.5 - 0.5 * x * y * y);
+    y = y * (1.5 - 0.5 * x * y * y);
+    y = y * (1.5 - 0.5 * x * y * y);
+    const double root = x * y;
+    return root + 0.5 * y * (x - root * root);
+#else
+    return sqrt(x);
+#endif
+}
+
+/// Exponential, for -708 <= x <= 708.
+BATCH_INLINE double BatchExp(double x)
+{
+    const double ROUND = 6755399441055744.0; // 1.5 * 2^52
+    const double C1 = 6.93145751953125e-1;
+    const double C2 = 1.42860682030941723212e-6;
+
+    // x = k ln2 + r with |r| <= ln2 / 2, k is left in the low mantissa bits
+    const double kr = x * MATH_LOG2E + ROUND;
+    const double k = kr - ROUND;
+    const double r = (x - k * C1) - k * C2;
+
+    // Pade approximation of e^r
+    const double rr = r * r;
+    const double p = r * ((1.26177193074810590878e-4 * rr + 3.02994407707441961300e-2) * rr + 9.99999999999999999910e-1);
+    const double q = ((3.00198505138664455042e-6 * rr + 2.52448340349684104192e-3) * rr + 2.27265548208155028766e-1) * rr + 2.00000000000000000009e0;
+    const double er = 1.0 + 2.0 * p / (q - p);
+
+    // 2^k built directly in the exponent field
+    const double scale = BatchFromBits((BatchBits(kr) - BatchBits(ROUND) + 1023) << 52);
+    return er * scale;
+}
+
+/// Natural logarithm, for positive normal x.
+BATCH_INLINE double BatchLog(double x)
+{
+    const double C1 = 0.693359375;
+    const double C2 = -2.121944400546905827679e-4;
+    const double SQRT2 = 1.41421356237309504880;
+    const double BIAS = 4503599627370496.0 + 1023.0; // 2^52 + exponent bias
+
+    // x = m 2^e with sqrt(1/2) <= m < sqrt(2)
+    const uint64_t bits = BatchBits(x);
+    const double m1 = BatchFromBits((bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL);
+    const double e1 = BatchFromBits((bits >> 52) | 0x4330000000000000ULL) - BIAS;
+    const bool high = (m1 > SQRT2);
+    const double m = high ? 0.5 * m1 : m1;
+    const double e = high ? e1 + 1.0 : e1;
+
+    // log(1 + f) = f - f^2 / 2 + f^3 P(f) / Q(f)
+    const double f = m - 1.0;
+    const double ff = f * f;
+    const double p = ((((1.01875663804580931796e-4 * f + 4.97494994976747001425e-1) * f + 4.70579119878881725854e0) * f
+                        + 1.44989225341610930846e1) * f + 1.79368678507819816313e1) * f + 7.70838733755885391666e0;
+    const double q = ((((f + 1.12873587189167450590e1) * f + 4.52279145837532221105e1) * f + 8.29875266912776603211e1) * f
+                        + 7.11544750618563894466e1) * f + 2.31251620126765340583e1;
+    const double y = f * ff * p / q + e * C2 - 0.5 * ff;
+    return (f + y) + e * C1;
+}
+
+/// Arc tangent, for all finite x and +-infinity.
+BATCH_INLINE double BatchAtan(double x)
+{
+    const double T3P8 = 2.41421356237309504880; // tan(3 pi / 8)
+    const double MOREBITS = 6.123233995736765886130e-17; // pi / 2 - MATH_PI_OVER_2
+
+    // Reduce to |t| <= 0.66 with atan(t0) = y0 + atan(t)
+    const double t0 = fabs(x);
+    const bool large = (t0 > T3P8);
+    const bool medium = (t0 > 0.66);
+    const double tLarge = -1.0 / t0;
+    const double tMedium = (t0 - 1.0) / (t0 + 1.0);
+    const double t = large ? tLarge : (medium ? tMedium : t0);
+    const double y0 = large ? MATH_PI_OVER_2 + MOREBITS : (medium ? MATH_PI_OVER_4 + 0.5 * MOREBITS : 0.0);
+
+    const double z = t * t;
+    const double p = (((-8.750608600031904122785e-1 * z - 1.615753718733365076637e1) * z - 7.500855792314704667340e1) * z
+                       - 1.228866684490136173410e2) * z - 6.485021904942025371773e1;
+    const double q = ((((z + 2.485846490142306297962e1) * z + 1.650270098316988542046e2) * z + 4.328810604912902668951e2) * z
+                       + 4.853903996359136964868e2) * z + 1.945506571482613964425e2;
+    const double y = y0 + (t + t * z * p / q);
+    return (x < 0.0) ? -y : y;
+}
+
+/// Arc tangent of y / x in (-pi, pi], for (x, y) != (0, 0).
+BATCH_INLINE double BatchAtan2(double y, double x)
+{
+    const double z = BatchAtan(y / x);
+    const double shift = (y < 0.0) ? -MATH_PI : MATH_PI;
+    return (x < 0.0) ? z + shift : z;
+}
+
+/// Arc cosine in [0, pi], for -1 <= x <= 1. Arguments just outside the
+/// domain from rounding are clamped to it.
+BATCH_INLINE double BatchAcos(double x)
+{
+    const double c = (x > 1.0) ? 1.0 : ((x < -1.0) ? -1.0 : x);
+    return BatchAtan2(BatchSqrt((1.0 - c) * (1.0 + c)), c);
+}
+
+/// Sine and cosine, for |x| < 2^30.
+BATCH_INLINE void BatchSinCos(double x, double* sinx, double* cosx)
+{
+    const double FOUR_OVER_PI = 1.27323954473516268615;
+    const double DP1 = 7.85398125648498535156e-1; // pi / 4 in three parts
+    const double DP2 = 3.77489470793079817668e-8;
+    const double DP3 = 2.69515142907905952645e-15;
+
+    // Octant j of |x|, rounded up to even, and the reduced argument z
+    const double ax = fabs(x);
+    int j = (int)(ax * FOUR_OVER_PI);
+    j += (j & 1);
+    const double y = (double)j;
+    const double z = ((ax - y * DP1) - y * DP2) - y * DP3;
+
+    const double zz = z * z;
+    const double s = z + z * zz * (((((1.58962301576546568060e-10 * zz - 2.50507477628578072866e-8) * zz
+                       + 2.75573136213857245213e-6) * zz - 1.98412698295895385996e-4) * zz
+                       + 8.33333333332211858878e-3) * zz - 1.66666666666666307295e-1);
+    const double c = 1.0 - 0.5 * zz + zz * zz * (((((-1.13585365213876817300e-11 * zz + 2.08757008419747316778e-9) * zz
+                       - 2.75573141792967388112e-7) * zz + 2.48015872888517045348e-5) * zz
+                       - 1.38888888888730564116e-3) * zz + 4.16666666666665929218e-2);
+
+    // Quadrant (j / 2) mod 4 swaps the polynomials and sets the signs
+    const int quadrant = (j >> 1) & 3;
+    const bool swap = (quadrant & 1) != 0;
+    const double sinAbs = swap ? c : s;
+    const double cosAbs = swap ? s : c;
+    *sinx = ((quadrant >= 2) != (x < 0.0)) ? -sinAbs : sinAbs;
+    *cosx = (quadrant == 1 || quadrant == 2) ? -cosAbs : cosAbs;
+}
+
+/// Hyperbolic sine and cosine, for |x| <= 708. The sine is summed from its
+/// series below |x| = 1/4, where e^x - e^-x would cancel.
+BATCH_INLINE void BatchSinhCosh(double x, double* sinhx, double* coshx)
+{
+    const double ex = BatchExp(fabs(x));
+    const double sinhAbs = 0.5 * (ex - 1.0 / ex);
+    const double xx = x * x;
+    const double sinhSeries = x + x * xx * (1.0/6.0 + xx * (1.0/120.0 + xx * (1.0/5040.0 + xx * (1.0/362880.0
+                              + xx * (1.0/39916800.0 + xx * (1.0/6227020800.0))))));
+    *sinhx = (fabs(x) < 0.25) ? sinhSeries : ((x < 0.0) ? -sinhAbs : sinhAbs);
+    *coshx = 0.5 * (ex + 1.0 / ex);
+}
+
+/// Nearest integer to x, for |x| < 2^51, with ties rounded to even.
+BATCH_INLINE double BatchRound(double x)
+{
+    const double ROUND = 6755399441055744.0; // 1.5 * 2^52
+    return (x + ROUND) - ROUND;
+}
+
+/// Cube root, for x >= 0.
+BATCH_INLINE double BatchCbrt(double x)
+{
+    const bool normal = (x >= DBL_MIN);
+    const double root = BatchExp(BatchLog(normal ? x : 1.0) * (1.0/3.0));
+    // One Newton step removes the error of exp(log(x) / 3)
+    return normal ? root - (root - x / (root * root)) * (1.0/3.0) : 0.0;
+}
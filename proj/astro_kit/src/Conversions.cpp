@@ -19,6 +19,7 @@
 #include "Conversions.h"
 #include "Transformation.h"
 #include "Base.h"
+#include "BatchMath.h"
 
 void CalculateCanonicalUnits(double radius, double mu, double* DU, double* TU, double* VU)
 {
@@ -43,17 +44,17 @@ void ConvertStateVector2OrbitalElements(const StateVector& stateVector, OrbitalE
     double posDotVel = Pos.dot(Vel);
 
     // Specific angular momentum
-    static Vector3 SpecificAngularMomentum;
+    Vector3 SpecificAngularMomentum;
     Vector3::cross(Pos, Vel, &SpecificAngularMomentum);
     double specificAngularMomentum = SpecificAngularMomentum.length();
 
     // Node vector
-    static Vector3 NodeVector;
+    Vector3 NodeVector;
     Vector3::cross(MATH_UNIT_VEC_K, SpecificAngularMomentum, &NodeVector); 
     double nodeVector = NodeVector.length();
 
     // Eccentricity
-    static Vector3 Eccentricity;
+    Vector3 Eccentricity;
     Eccentricity = (SQR(vel) - 1.0/pos)*Pos - posDotVel*Vel;
     double eccentricity = Eccentricity.length();
 
@@ -162,7 +163,7 @@ void ConvertOrbitalElements2StateVector(const OrbitalElements& orbitalElements,
     double sinTrueAnomaly = sin(trueAnomaly);
 
     // Build state vectors in perifocal reference frame
-    static Vector3 Pos, Vel;
+    Vector3 Pos, Vel;
     Pos.x = semiParameter*cosTrueAnomaly / (1.0 + eccentricity*cosTrueAnomaly);
     Pos.y = semiParameter*sinTrueAnomaly / (1.0 + eccentricity*cosTrueAnomaly);
     Pos.z = 0.0;
@@ -173,4 +174,163 @@ void ConvertOrbitalElements2StateVector(const OrbitalElements& orbitalElements,
     // Transform state vectors from perifocal reference frame to inertial.
     TransformPerifocal2Inertial(Pos, inclination, raan, argPerigee, &stateVector->position);
     TransformPerifocal2Inertial(Vel, inclination, raan, argPerigee, &stateVector->velocity);
-}
\ No newline at end of file
+}
+
+void ConvertStateVectors2OrbitalElements(const Vector3Array& positions, const Vector3Array& velocities, OrbitalElementsArray* orbitalElements)
+{
+    assert(positions.Size() == velocities.Size());
+    orbitalElements->Resize(positions.Size());
+    ConvertStateVectors2OrbitalElements(positions, velocities, 0, positions.Size(), orbitalElements);
+}
+
+// The loop of ConvertStateVectors2OrbitalElements(). The arrays are passed as
+// restrict parameters, checking twelve arrays for overlap at run time takes
+// more tests than the vectorizer will make.
+static void BATCH_KERNEL StateVectors2OrbitalElementsKernel(size_t begin, size_t end,
+    const double* BATCH_RESTRICT rx, const double* BATCH_RESTRICT ry, const double* BATCH_RESTRICT rz,
+    const double* BATCH_RESTRICT vx, const double* BATCH_RESTRICT vy, const double* BATCH_RESTRICT vz,
+    double* BATCH_RESTRICT outSemimajorAxis, double* BATCH_RESTRICT outEccentricity, double* BATCH_RESTRICT outArgPerigee,
+    double* BATCH_RESTRICT outInclination, double* BATCH_RESTRICT outRaan, double* BATCH_RESTRICT outTrueAnomaly)
+{
+    for (size_t i = begin; i < end; ++i)
+    {
+        // Position and velocity vectors, magnitudes, and dot product.
+        double pos = BatchSqrt(rx[i]*rx[i] + ry[i]*ry[i] + rz[i]*rz[i]);
+        double vel = BatchSqrt(vx[i]*vx[i] + vy[i]*vy[i] + vz[i]*vz[i]);
+        double posDotVel = rx[i]*vx[i] + ry[i]*vy[i] + rz[i]*vz[i];
+
+        // Specific angular momentum
+        double hx = ry[i]*vz[i] - rz[i]*vy[i];
+        double hy = rz[i]*vx[i] - rx[i]*vz[i];
+        double hz = rx[i]*vy[i] - ry[i]*vx[i];
+        double specificAngularMomentum = BatchSqrt(hx*hx + hy*hy + hz*hz);
+
+        // Node vector (K x h)
+        double nx = -hy;
+        double ny = hx;
+        double nodeVector = BatchSqrt(nx*nx + ny*ny);
+
+        // Eccentricity
+        double factor = vel*vel - 1.0/pos;
+        double ex = factor*rx[i] - posDotVel*vx[i];
+        double ey = factor*ry[i] - posDotVel*vy[i];
+        double ez = factor*rz[i] - posDotVel*vz[i];
+        double eccentricity = BatchSqrt(ex*ex + ey*ey + ez*ez);
+
+        // Semimajor axis
+        double specificMechEnergy = 0.5*vel*vel - 1.0/pos;
+        double semimajorAxis = (eccentricity != ASTRO_ECC_PARABOLIC) ? -0.5 / specificMechEnergy : MATH_INFINITY;
+
+        // Inclination
+        double inclination = (specificAngularMomentum > 0.0) ? BatchAcos(hz / specificAngularMomentum) : 0.0;
+
+        // Right ascension of the ascending node
+        double raan = BatchAcos(nx / nodeVector);
+        raan = (ny < 0) ? MATH_2_PI - raan : raan;
+        raan = (nodeVector > 0.0) ? raan : 0.0;
+
+        // Argument of perigee. Every candidate is evaluated and the one the scalar routine would pick is kept.
+        bool circular = (eccentricity == ASTRO_ECC_CIRCULAR);
+        bool equatorial = (inclination == ASTRO_INCL_EQUATORIAL);
+        double inclinedArgPerigee = BatchAcos((nx*ex + ny*ey) / nodeVector / eccentricity);
+        inclinedArgPerigee = (ez < 0.0) ? MATH_2_PI - inclinedArgPerigee : inclinedArgPerigee;
+        double equatorialArgPerigee = BatchAcos(ex / eccentricity);
+        double argPerigee = circular ? 0.0 : (equatorial ? equatorialArgPerigee : inclinedArgPerigee);
+
+        // True anomaly, argument of latitude or true longitude
+        double anomalyFromPerigee = BatchAcos((ex*rx[i] + ey*ry[i] + ez*rz[i]) / eccentricity / pos);
+        anomalyFromPerigee = (posDotVel < 0.0) ? MATH_2_PI - anomalyFromPerigee : anomalyFromPerigee;
+        double argLatitude = BatchAcos((nx*rx[i] + ny*ry[i]) / nodeVector / pos);
+        argLatitude = (nx*vx[i] + ny*vy[i] > 0.0) ? MATH_2_PI - argLatitude : argLatitude;
+        double trueLongitude = BatchAcos(rx[i] / pos);
+        trueLongitude = (vx[i] > 0.0) ? MATH_2_PI - trueLongitude : trueLongitude;
+        double trueAnomaly = !circular ? anomalyFromPerigee : (!equatorial ? argLatitude : trueLongitude);
+
+        // Pack up the calculated orbital elements
+        outSemimajorAxis[i] = semimajorAxis;
+        outEccentricity[i] = eccentricity;
+        outArgPerigee[i] = argPerigee;
+        outInclination[i] = inclination;
+        outRaan[i] = raan;
+        outTrueAnomaly[i] = trueAnomaly;
+    }
+}
+
+void ConvertStateVectors2OrbitalElements(const Vector3Array& positions, const Vector3Array& velocities, size_t begin, size_t end, OrbitalElementsArray* orbitalElements)
+{
+    assert(end <= positions.Size() && end <= velocities.Size() && end <= orbitalElements->Size());
+    if (begin >= end)
+    {
+        return;
+    }
+
+    StateVectors2OrbitalElementsKernel(begin, end,
+        &positions.x[0], &positions.y[0], &positions.z[0], &velocities.x[0], &velocities.y[0], &velocities.z[0],
+        &orbitalElements->semimajorAxis[0], &orbitalElements->eccentricity[0], &orbitalElements->argPerigee[0],
+        &orbitalElements->inclination[0], &orbitalElements->raan[0], &orbitalElements->trueAnomaly[0]);
+}
+
+void ConvertOrbitalElements2StateVectors(const OrbitalElementsArray& orbitalElements, Vector3Array* positions, Vector3Array* velocities)
+{
+    positions->Resize(orbitalElements.Size());
+    velocities->Resize(orbitalElements.Size());
+    ConvertOrbitalElements2StateVectors(orbitalElements, 0, orbitalElements.Size(), positions, velocities);
+}
+
+// The loop of ConvertOrbitalElements2StateVectors(), with restrict arrays as above.
+static void BATCH_KERNEL OrbitalElements2StateVectorsKernel(size_t begin, size_t end,
+    const double* BATCH_RESTRICT inSemimajorAxis, const double* BATCH_RESTRICT inEccentricity, const double* BATCH_RESTRICT inArgPerigee,
+    const double* BATCH_RESTRICT inInclination, const double* BATCH_RESTRICT inRaan, const double* BATCH_RESTRICT inTrueAnomaly,
+    double* BATCH_RESTRICT rx, double* BATCH_RESTRICT ry, double* BATCH_RESTRICT rz,
+    double* BATCH_RESTRICT vx, double* BATCH_RESTRICT vy, double* BATCH_RESTRICT vz)
+{
+    for (size_t i = begin; i < end; ++i)
+    {
+        double eccentricity = inEccentricity[i];
+
+        // Calculate the semiparameter
+        double semiParameter = inSemimajorAxis[i]*(1.0 - eccentricity*eccentricity);
+
+        // Precalculate common trig functions.
+        double cosTrueAnomaly, sinTrueAnomaly, cosRAAN, sinRAAN, cosOmega, sinOmega, cosIncl, sinIncl;
+        BatchSinCos(inTrueAnomaly[i], &sinTrueAnomaly, &cosTrueAnomaly);
+        BatchSinCos(inRaan[i], &sinRAAN, &cosRAAN);
+        BatchSinCos(inArgPerigee[i], &sinOmega, &cosOmega);
+        BatchSinCos(inInclination[i], &sinIncl, &cosIncl);
+
+        // Build state vectors in perifocal reference frame
+        double px = semiParameter*cosTrueAnomaly / (1.0 + eccentricity*cosTrueAnomaly);
+        double py = semiParameter*sinTrueAnomaly / (1.0 + eccentricity*cosTrueAnomaly);
+        double qx = -BatchSqrt(1.0/semiParameter)*sinTrueAnomaly;
+        double qy = BatchSqrt(1.0/semiParameter)*(eccentricity + cosTrueAnomaly);
+
+        // Rotate from the perifocal reference frame to inertial, as TransformPerifocal2Inertial() does.
+        double m11 =  (cosRAAN * cosOmega) - (sinRAAN * sinOmega * cosIncl);
+        double m12 = -(cosRAAN * sinOmega) - (sinRAAN * cosIncl * cosOmega);
+        double m21 =  (sinRAAN * cosOmega) + (cosRAAN * cosIncl * sinOmega);
+        double m22 = -(sinRAAN * sinOmega) + (cosRAAN * cosIncl * cosOmega);
+        double m31 =  (sinIncl * sinOmega);
+        double m32 =  (sinIncl * cosOmega);
+
+        rx[i] = m11*px + m12*py;
+        ry[i] = m21*px + m22*py;
+        rz[i] = m31*px + m32*py;
+        vx[i] = m11*qx + m12*qy;
+        vy[i] = m21*qx + m22*qy;
+        vz[i] = m31*qx + m32*qy;
+    }
+}
+
+void ConvertOrbitalElements2StateVectors(const OrbitalElementsArray& orbitalElements, size_t begin, size_t end, Vector3Array* positions, Vector3Array* velocities)
+{
+    assert(end <= orbitalElements.Size() && end <= positions->Size() && end <= velocities->Size());
+    if (begin >= end)
+    {
+        return;
+    }
+
+    OrbitalElements2StateVectorsKernel(begin, end,
+        &orbitalElements.semimajorAxis[0], &orbitalElements.eccentricity[0], &orbitalElements.argPerigee[0],
+        &orbitalElements.inclination[0], &orbitalElements.raan[0], &orbitalElements.trueAnomaly[0],
+        &positions->x[0], &positions->y[0], &positions->z[0], &velocities->x[0], &velocities->y[0], &velocities->z[0]);
+}
@@ -29,22 +29,29 @@ Ephemeris* EphemerisManager::_ephemeris = NULL;
 void EphemerisManager::SetEphemerisType(EphemerisType ephemerisType)
 {
     Cleanup();
+    _ephemeris = CreateEphemeris(ephemerisType);
+}
 
+Ephemeris* EphemerisManager::CreateEphemeris(EphemerisType ephemerisType)
+{
     switch (ephemerisType)
     {
     case EPHEMERIS_ANALYTICAL:
-        _ephemeris = new AnalyticalEphemeris();
-        break;
+        return new AnalyticalEphemeris();
 
     case EPHEMERIS_JPL:
-        _ephemeris = new JplEphemeris();
-        break;
+        return new JplEphemeris();
 
     default:
         throw "Invalid ephemeris source type";
     }
 }
 
+const Ephemeris* EphemerisManager::GetEphemeris()
+{
+    return _ephemeris;
+}
+
 void EphemerisManager::GetOrbitAtEpoch(int objectId, double epoch, OrbitalElements* orbitalElements, StateVector* stateVector)
 {
     if (_ephemeris != NULL)
@@ -57,6 +64,17 @@ void EphemerisManager::GetOrbitAtEpoch(int objectId, double epoch, OrbitalElemen
     }
 }
 
+void EphemerisManager::FitEphemeris(double startEpoch, double endEpoch, double tolerance)
+{
+    if (_ephemeris == NULL)
+    {
+        throw "Ephemeris source type has not been initialized yet";
+    }
+    // The current ephemeris stays in place if the fit throws
+    Ephemeris* fitted = new ChebyshevEphemeris(_ephemeris, startEpoch, endEpoch, tolerance, true);
+    _ephemeris = fitted;
+}
+
 void EphemerisManager::Cleanup()
 {
     if (_ephemeris != NULL)
@@ -66,7 +84,7 @@ void EphemerisManager::Cleanup()
     }
 }
 
-void AnalyticalEphemeris::GetOrbitAtEpoch(int objectId, double epoch, OrbitalElements* orbitalElements, StateVector* stateVector)
+void AnalyticalEphemeris::GetOrbitAtEpoch(int objectId, double epoch, OrbitalElements* orbitalElements, StateVector* stateVector) const
 {
     assert(objectId >= 0 && objectId < 10);
     assert(epoch > 0);
@@ -79,199 +97,709 @@ void AnalyticalEphemeris::GetOrbitAtEpoch(int objectId, double epoch, OrbitalEle
     }
 
     // We must compute the orbital elements. If we don't want them,
-    // then we use a dummy variable.
-    if (orbitalElements != NULL)
+    // then we use a local variable so that concurrent queries do not share it.
+    OrbitalElements coes;
+    if (orbitalElements == NULL)
     {
-        Calculate(objectId, epoch, orbitalElements);
-        
-    }
-    else
-    {
-        Calculate(objectId, epoch, &_dummyCoes);
+        orbitalElements = &coes;
     }
+    Calculate(objectId, epoch, orbitalElements);
 
-    if (orbitalElements != NULL && stateVector != NULL) // orbitalElements and state vector are outputs
+    if (stateVector != NULL)
     {
-        ConvertOrbitalElements2StateVector(*orbitalElements, stateVector); 
+        ConvertOrbitalElements2StateVector(*orbitalElements, stateVector);
     }
-    else if (stateVector != NULL) // only state vector is output
-    {
-        ConvertOrbitalElements2StateVector(_dummyCoes, stateVector);
+}
+
+// Polynomial coefficients of the analytical elements of each planet, in increasing powers of T:
+// semimajor axis (AU), eccentricity, inclination, right ascension of the ascending node, argument
+// of perigee and mean anomaly (degrees).
+// Reference: ESA, PaGMO - Planet_Ephemerides_Analytical function
+static const int ANALYTICAL_NUMBER_ELEMENTS = 6;
+static const int ANALYTICAL_NUMBER_POWERS   = 6;
+static const double ANALYTICAL_ELEMENTS[PLANET_COUNT][ANALYTICAL_NUMBER_ELEMENTS][ANALYTICAL_NUMBER_POWERS] =
+{
+    {   // Mercury
+        {0.38709860},
+        {0.205614210, 0.000020460, -0.000000030},
+        {7.002880555555555560, 1.86083333333333333e-3, -1.83333333333333333e-5},
+        {4.71459444444444444e+1, 1.185208333333333330, 1.73888888888888889e-4},
+        {2.87537527777777778e+1, 3.70280555555555556e-1, 1.20833333333333333e-4},
+        {1.02279380555555556e2, 1.49472515288888889e+5, 6.38888888888888889e-6}
+    },
+    {   // Venus
+        {0.72333160},
+        {0.006820690, -0.000047740, 0.0000000910},
+        {3.393630555555555560, 1.00583333333333333e-3, -9.72222222222222222e-7},
+        {7.57796472222222222e+1, 8.9985e-1, 4.1e-4},
+        {5.43841861111111111e+1, 5.08186111111111111e-1, -1.38638888888888889e-3},
+        {2.12603219444444444e2, 5.8517803875e+4, 1.28605555555555556e-3}
+    },
+    {   // Earth
+        {1.000000230},
+        {0.016751040, -0.000041800, -0.0000001260},
+        {0.00},
+        {0.00},
+        {1.01220833333333333e+2, 1.7191750, 4.52777777777777778e-4, 3.33333333333333333e-6},
+        {3.58475844444444444e2, 3.599904975e+4, -1.50277777777777778e-4, -3.33333333333333333e-6}
+    },
+    {   // Mars
+        {1.5236883990},
+        {0.093312900, 0.0000920640, -0.0000000770},
+        {1.850333333333333330, -6.75e-4, 1.26111111111111111e-5},
+        {4.87864416666666667e+1, 7.70991666666666667e-1, -1.38888888888888889e-6, -5.33333333333333333e-6},
+        {2.85431761111111111e+2, 1.069766666666666670, 1.3125e-4, 4.13888888888888889e-6},
+        {3.19529425e2, 1.91398585e+4, 1.80805555555555556e-4, 1.19444444444444444e-6}
+    },
+    {   // Jupiter
+        {5.2025610},
+        {0.048334750, 0.000164180, -0.00000046760, -0.00000000170},
+        {1.308736111111111110, -5.69611111111111111e-3, 3.88888888888888889e-6},
+        {9.94433861111111111e+1, 1.010530, 3.52222222222222222e-4, -8.51111111111111111e-6},
+        {2.73277541666666667e+2, 5.99431666666666667e-1, 7.0405e-4, 5.07777777777777778e-6},
+        {2.25328327777777778e2, 3.03469202388888889e+3, -7.21588888888888889e-4, 1.78444444444444444e-6}
+    },
+    {   // Saturn
+        {9.5547470},
+        {0.055892320, -0.00034550, -0.0000007280, 0.000000000740},
+        {2.492519444444444440, -3.91888888888888889e-3, -1.54888888888888889e-5, 4.44444444444444444e-8},
+        {1.12790388888888889e+2, 8.73195138888888889e-1, -1.52180555555555556e-4, -5.30555555555555556e-6},
+        {3.38307772222222222e+2, 1.085220694444444440, 9.78541666666666667e-4, 9.91666666666666667e-6},
+        {1.75466216666666667e2, 1.22155146777777778e+3, -5.01819444444444444e-4, -5.19444444444444444e-6}
+    },
+    {   // Uranus
+        {19.218140},
+        {0.04634440, -0.000026580, 0.0000000770},
+        {7.72463888888888889e-1, 6.25277777777777778e-4, 3.95e-5},
+        {7.34770972222222222e+1, 4.98667777777777778e-1, 1.31166666666666667e-3},
+        {9.80715527777777778e+1, 9.85765e-1, -1.07447222222222222e-3, -6.05555555555555556e-7},
+        {7.26488194444444444e1, 4.28379113055555556e+2, 7.88444444444444444e-5, 1.11111111111111111e-9}
+    },
+    {   // Neptune
+        {30.109570},
+        {0.008997040, 0.0000063300, -0.0000000020},
+        {1.779241666666666670, -9.54361111111111111e-3, -9.11111111111111111e-6},
+        {1.30681358333333333e+2, 1.0989350, 2.49866666666666667e-4, -4.71777777777777778e-6},
+        {2.76045966666666667e+2, 3.25639444444444444e-1, 1.4095e-4, 4.11333333333333333e-6},
+        {3.77306694444444444e1, 2.18461339722222222e+2, -7.03333333333333333e-5}
+    },
+    {   // Pluto
+        // Fifth order polynomial least square fit generated by Dario Izzo (ESA ACT). JPL405
+        // ephemerides (Charon-Pluto barycenter) have been used to produce the coefficients.
+        // This approximation should not be used outside the range 2000-2100.
+        {39.34041961252520, 4.33305138120726, -22.93749932403733, 48.76336720791873, -45.52494862462379, 15.55134951783384},
+        {0.24617365396517, 0.09198001742190, -0.57262288991447, 1.39163022881098, -1.46948451587683, 0.56164158721620},
+        {17.16690003784702, -0.49770248790479, 2.73751901890829, -6.26973695197547, 6.36276927397430, -2.37006911673031},
+        {110.222019291707, 1.551579150048, -9.701771291171, 25.730756810615, -30.140401383522, 12.796598193159},
+        {113.368933916592, 9.436835192183, -35.762300003726, 48.966118351549, -19.384576636609, -3.362714022614},
+        {15.17008631634665, 137.023166578486, 28.362805871736, -29.677368415909, -3.585159909117, 13.406844652829}
     }
-    else if (orbitalElements != NULL) // only orbitalElements is output
+};
+
+// T is in Julian centuries since J2000, plus this offset (i.e. since 1900 for all but Pluto).
+static const double ANALYTICAL_TIME_OFFSET[PLANET_COUNT] = {1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 0.0};
+
+// The same coefficients stored planet-fastest, so that GetAllPlanetsAtEpoch() can work on every planet at once.
+struct AnalyticalElementTable
+{
+    double coefficients[ANALYTICAL_NUMBER_ELEMENTS][ANALYTICAL_NUMBER_POWERS][PLANET_COUNT];
+};
+
+static AnalyticalElementTable CreateAnalyticalElementTable()
+{
+    AnalyticalElementTable table;
+    for (int element = 0; element < ANALYTICAL_NUMBER_ELEMENTS; ++element)
     {
-        // do nothing
+        for (int power = 0; power < ANALYTICAL_NUMBER_POWERS; ++power)
+        {
+            for (int planetId = 0; planetId < PLANET_COUNT; ++planetId)
+            {
+                table.coefficients[element][power][planetId] = ANALYTICAL_ELEMENTS[planetId][element][power];
+            }
+        }
     }
+    return table;
 }
 
-void AnalyticalEphemeris::Calculate(int planetId, double epoch, OrbitalElements* orbitalElements)
+static const AnalyticalElementTable ANALYTICAL_ELEMENT_TABLE = CreateAnalyticalElementTable();
+
+void AnalyticalEphemeris::Calculate(int planetId, double epoch, OrbitalElements* orbitalElements) const
 {
     assert(orbitalElements != NULL);
-    // Reference: ESA, PaGMO - Planet_Ephemerides_Analytical function
-
-    double mjd2000 = epoch - 2451545;
-    double T = (mjd2000 + 36525.00) / 36525.00;
-
-    double semimajorAxis, eccentricity, inclination, RA, w, XM, M, E;
-    switch (planetId)
-    {
-    case PLANET_MERCURY:
-        semimajorAxis=(0.38709860);
-        eccentricity=(0.205614210 + 0.000020460*T - 0.000000030*T*T);
-        inclination=(7.002880555555555560 + 1.86083333333333333e-3*T - 1.83333333333333333e-5*T*T);
-        RA=(4.71459444444444444e+1 + 1.185208333333333330*T + 1.73888888888888889e-4*T*T);
-        w=(2.87537527777777778e+1 + 3.70280555555555556e-1*T +1.20833333333333333e-4*T*T);
-        XM   = 1.49472515288888889e+5 + 6.38888888888888889e-6*T;
-        M=(1.02279380555555556e2 + XM*T);
-        break;
-
-    case PLANET_VENUS:
-        semimajorAxis=(0.72333160);
-        eccentricity=(0.006820690 - 0.000047740*T + 0.0000000910*T*T);
-        inclination=(3.393630555555555560 + 1.00583333333333333e-3*T - 9.72222222222222222e-7*T*T);
-        RA=(7.57796472222222222e+1 + 8.9985e-1*T + 4.1e-4*T*T);
-        w=(5.43841861111111111e+1 + 5.08186111111111111e-1*T -1.38638888888888889e-3*T*T);
-        XM =5.8517803875e+4 + 1.28605555555555556e-3*T;
-        M=(2.12603219444444444e2 + XM*T);
-        break;
-
-    case PLANET_EARTH:
-        semimajorAxis=(1.000000230);
-        eccentricity=(0.016751040 - 0.000041800*T - 0.0000001260*T*T);
-        inclination=(0.00);
-        RA=(0.00);
-        w=(1.01220833333333333e+2 + 1.7191750*T + 4.52777777777777778e-4*T*T + 3.33333333333333333e-6*T*T*T);
-        XM   = 3.599904975e+4 - 1.50277777777777778e-4*T - 3.33333333333333333e-6*T*T;
-        M=(3.58475844444444444e2 + XM*T);
-        break;
-
-    case PLANET_MARS:
-        semimajorAxis=(1.5236883990);
-        eccentricity=(0.093312900 + 0.0000920640*T - 0.0000000770*T*T);
-        inclination=(1.850333333333333330 - 6.75e-4*T + 1.26111111111111111e-5*T*T);
-        RA=(4.87864416666666667e+1 + 7.70991666666666667e-1*T - 1.38888888888888889e-6*T*T - 5.33333333333333333e-6*T*T*T);
-        w=(2.85431761111111111e+2 + 1.069766666666666670*T +  1.3125e-4*T*T + 4.13888888888888889e-6*T*T*T);
-        XM   = 1.91398585e+4 + 1.80805555555555556e-4*T + 1.19444444444444444e-6*T*T;
-        M=(3.19529425e2 + XM*T);
-        break;
-
-    case PLANET_JUPITER:
-        semimajorAxis=(5.2025610);
-        eccentricity=(0.048334750 + 0.000164180*T  - 0.00000046760*T*T -0.00000000170*T*T*T);
-        inclination=(1.308736111111111110 - 5.69611111111111111e-3*T +  3.88888888888888889e-6*T*T);
-        RA=(9.94433861111111111e+1 + 1.010530*T + 3.52222222222222222e-4*T*T - 8.51111111111111111e-6*T*T*T);
-        w=(2.73277541666666667e+2 + 5.99431666666666667e-1*T + 7.0405e-4*T*T + 5.07777777777777778e-6*T*T*T);
-        XM   = 3.03469202388888889e+3 - 7.21588888888888889e-4*T + 1.78444444444444444e-6*T*T;
-        M=(2.25328327777777778e2 + XM*T);
-        break;
-
-    case PLANET_SATURN:
-        semimajorAxis=(9.5547470);
-        eccentricity=(0.055892320 - 0.00034550*T - 0.0000007280*T*T + 0.000000000740*T*T*T);
-        inclination=(2.492519444444444440 - 3.91888888888888889e-3*T - 1.54888888888888889e-5*T*T + 4.44444444444444444e-8*T*T*T);
-        RA=(1.12790388888888889e+2 + 8.73195138888888889e-1*T -1.52180555555555556e-4*T*T - 5.30555555555555556e-6*T*T*T);
-        w=(3.38307772222222222e+2 + 1.085220694444444440*T + 9.78541666666666667e-4*T*T + 9.91666666666666667e-6*T*T*T);
-        XM   = 1.22155146777777778e+3 - 5.01819444444444444e-4*T - 5.19444444444444444e-6*T*T;
-        M=(1.75466216666666667e2 + XM*T);
-        break;
-
-    case PLANET_URANUS:
-        semimajorAxis=(19.218140);
-        eccentricity=(0.04634440 - 0.000026580*T + 0.0000000770*T*T);
-        inclination=(7.72463888888888889e-1 + 6.25277777777777778e-4*T + 3.95e-5*T*T);
-        RA=(7.34770972222222222e+1 + 4.98667777777777778e-1*T + 1.31166666666666667e-3*T*T);
-        w=(9.80715527777777778e+1 + 9.85765e-1*T - 1.07447222222222222e-3*T*T - 6.05555555555555556e-7*T*T*T);
-        XM   = 4.28379113055555556e+2 + 7.88444444444444444e-5*T + 1.11111111111111111e-9*T*T;
-        M=(7.26488194444444444e1 + XM*T);
-        break;
-
-    case PLANET_NEPTUNE:
-        semimajorAxis=(30.109570);
-        eccentricity=(0.008997040 + 0.0000063300*T - 0.0000000020*T*T);
-        inclination=(1.779241666666666670 - 9.54361111111111111e-3*T - 9.11111111111111111e-6*T*T);
-        RA=(1.30681358333333333e+2 + 1.0989350*T + 2.49866666666666667e-4*T*T - 4.71777777777777778e-6*T*T*T);
-        w=(2.76045966666666667e+2 + 3.25639444444444444e-1*T + 1.4095e-4*T*T + 4.11333333333333333e-6*T*T*T);
-        XM   = 2.18461339722222222e+2 - 7.03333333333333333e-5*T;
-        M=(3.77306694444444444e1 + XM*T);
-        break;
-
-    case PLANET_PLUTO:
-        //Fifth order polynomial least square fit generated by Dario Izzo
-        //(ESA ACT). JPL405 ephemerides (Charon-Pluto barycenter) have been used to produce the coefficients.
-        //This approximation should not be used outside the range 2000-2100;
-        T =mjd2000/36525.00;
-        semimajorAxis=(39.34041961252520 + 4.33305138120726*T - 22.93749932403733*T*T + 48.76336720791873*T*T*T - 45.52494862462379*T*T*T*T + 15.55134951783384*T*T*T*T*T);
-        eccentricity=(0.24617365396517 + 0.09198001742190*T - 0.57262288991447*T*T + 1.39163022881098*T*T*T - 1.46948451587683*T*T*T*T + 0.56164158721620*T*T*T*T*T);
-        inclination=(17.16690003784702 - 0.49770248790479*T + 2.73751901890829*T*T - 6.26973695197547*T*T*T + 6.36276927397430*T*T*T*T - 2.37006911673031*T*T*T*T*T);
-        RA=(110.222019291707 + 1.551579150048*T - 9.701771291171*T*T + 25.730756810615*T*T*T - 30.140401383522*T*T*T*T + 12.796598193159 * T*T*T*T*T);
-        w=(113.368933916592 + 9.436835192183*T - 35.762300003726*T*T + 48.966118351549*T*T*T - 19.384576636609*T*T*T*T - 3.362714022614 * T*T*T*T*T);
-        M=(15.17008631634665 + 137.023166578486*T + 28.362805871736*T*T - 29.677368415909*T*T*T - 3.585159909117*T*T*T*T + 13.406844652829 * T*T*T*T*T);
-        break;
-    }
-
-    orbitalElements->semimajorAxis = semimajorAxis; // units are AU (already in DU)
-    orbitalElements->eccentricity = eccentricity;
-       
+    assert(planetId >= 0 && planetId < PLANET_COUNT);
+
+    const double T = (epoch - 2451545) / 36525.00 + ANALYTICAL_TIME_OFFSET[planetId];
+
+    // Evaluate the element polynomials with Horner's rule.
+    double elements[ANALYTICAL_NUMBER_ELEMENTS];
+    for (int element = 0; element < ANALYTICAL_NUMBER_ELEMENTS; ++element)
+    {
+        const double* coefficients = ANALYTICAL_ELEMENTS[planetId][element];
+        double value = coefficients[ANALYTICAL_NUMBER_POWERS - 1];
+        for (int power = ANALYTICAL_NUMBER_POWERS - 2; power >= 0; --power)
+        {
+            value = value * T + coefficients[power];
+        }
+        elements[element] = value;
+    }
+
+    orbitalElements->semimajorAxis = elements[0]; // units are AU (already in DU)
+    orbitalElements->eccentricity = elements[1];
+
     // conversion of DEG into RAD
-    orbitalElements->inclination = inclination * MATH_DEG_TO_RAD;
-    orbitalElements->raan = RA   * MATH_DEG_TO_RAD;
-    orbitalElements->argPerigee = w    * MATH_DEG_TO_RAD;
-    M *= MATH_DEG_TO_RAD;
+    orbitalElements->inclination = elements[2] * MATH_DEG_TO_RAD;
+    orbitalElements->raan = elements[3] * MATH_DEG_TO_RAD;
+    orbitalElements->argPerigee = elements[4] * MATH_DEG_TO_RAD;
+    double M = elements[5] * MATH_DEG_TO_RAD;
     M = fmod(M, 2.0 * MATH_PI);
 
     // Conversion from Mean Anomaly to Eccentric Anomaly via Kepler's equation
-    E = SolveKeplersEquationE(orbitalElements->eccentricity, M);
+    double E = SolveKeplersEquationE(orbitalElements->eccentricity, M);
 
     // Convert Eccentric Anomaly to True Anomaly
     //orbitalElements.TA  = 2 * atan(sqrt((double) (1 + orbitalElements.e) / (1 - orbitalElements.e)) * tan((double) E / 2));
     orbitalElements->trueAnomaly = E;
 }
 
+void AnalyticalEphemeris::GetAllPlanetsAtEpoch(double epoch, OrbitalElements* orbitalElements, StateVector* stateVectors) const
+{
+    assert(epoch > 0);
+
+    // Nothing to do, get out and report the error.
+    if (orbitalElements == NULL && stateVectors == NULL)
+    {
+        // log error
+        return;
+    }
+
+    // Every step below works on all the planets at once. The element polynomials are loops the compiler
+    // vectorizes, Kepler's equations and the state vectors come from the batch kernels.
+    const double mjd2000 = epoch - 2451545;
+    double T[PLANET_COUNT];
+    for (int p = 0; p < PLANET_COUNT; ++p)
+    {
+        T[p] = mjd2000 / 36525.00 + ANALYTICAL_TIME_OFFSET[p];
+    }
+
+    // Element polynomials
+    double elements[ANALYTICAL_NUMBER_ELEMENTS][PLANET_COUNT];
+    for (int element = 0; element < ANALYTICAL_NUMBER_ELEMENTS; ++element)
+    {
+        const double (*coefficients)[PLANET_COUNT] = ANALYTICAL_ELEMENT_TABLE.coefficients[element];
+        double* value = elements[element];
+        for (int p = 0; p < PLANET_COUNT; ++p)
+        {
+            value[p] = coefficients[ANALYTICAL_NUMBER_POWERS - 1][p];
+        }
+        for (int power = ANALYTICAL_NUMBER_POWERS - 2; power >= 0; --power)
+        {
+            for (int p = 0; p < PLANET_COUNT; ++p)
+            {
+                value[p] = value[p] * T[p] + coefficients[power][p];
+            }
+        }
+    }
+
+    const double* semimajorAxis = elements[0];
+    const double* eccentricity = elements[1];
+    double inclination[PLANET_COUNT], raan[PLANET_COUNT], argPerigee[PLANET_COUNT], M[PLANET_COUNT];
+    for (int p = 0; p < PLANET_COUNT; ++p)
+    {
+        inclination[p] = elements[2][p] * MATH_DEG_TO_RAD;
+        raan[p] = elements[3][p] * MATH_DEG_TO_RAD;
+        argPerigee[p] = elements[4][p] * MATH_DEG_TO_RAD;
+        M[p] = fmod(elements[5][p] * MATH_DEG_TO_RAD, 2.0 * MATH_PI);
+    }
+
+    // All the Kepler's equations at once. As in Calculate(), the eccentric anomaly is used as the true anomaly.
+    double E[PLANET_COUNT];
+    SolveKeplersEquationE(PLANET_COUNT, eccentricity, M, E);
+
+    if (orbitalElements != NULL)
+    {
+        for (int p = 0; p < PLANET_COUNT; ++p)
+        {
+            orbitalElements[p].semimajorAxis = semimajorAxis[p];
+            orbitalElements[p].eccentricity = eccentricity[p];
+            orbitalElements[p].inclination = inclination[p];
+            orbitalElements[p].raan = raan[p];
+            orbitalElements[p].argPerigee = argPerigee[p];
+            orbitalElements[p].trueAnomaly = E[p];
+        }
+    }
+
+    if (stateVectors != NULL)
+    {
+        OrbitalElementsArray elementsArray;
+        elementsArray.Resize(PLANET_COUNT);
+        for (int p = 0; p < PLANET_COUNT; ++p)
+        {
+            elementsArray.semimajorAxis[p] = semimajorAxis[p];
+            elementsArray.eccentricity[p] = eccentricity[p];
+            elementsArray.inclination[p] = inclination[p];
+            elementsArray.raan[p] = raan[p];
+            elementsArray.argPerigee[p] = argPerigee[p];
+            elementsArray.trueAnomaly[p] = E[p];
+        }
+
+        Vector3Array positions, velocities;
+        ConvertOrbitalElements2StateVectors(elementsArray, &positions, &velocities);
+        for (int p = 0; p < PLANET_COUNT; ++p)
+        {
+            positions.Get(p, &stateVectors[p].position);
+            velocities.Get(p, &stateVectors[p].velocity);
+        }
+    }
+}
+
+// JPL states are barycentric, referred to the ICRF (i.e. the J2000 equator) and in AU and AU/day.
+// They are converted to heliocentric states referred to the J2000 ecliptic in canonical units, the
+// frame and units of the analytical ephemeris.
+static const int    JPL_CENTER_SUN        = 11;
+static const double JPL_COS_OBLIQUITY     = 0.917482062069181825744; // cos(23.4392911111 deg)
+static const double JPL_SIN_OBLIQUITY     = 0.397777155931913701597; // sin(23.4392911111 deg)
+
+// Conversion from AU/day to canonical velocity units, i.e. the time unit in days
+static double CalculateJplVelocityFactor()
+{
+    double DU, TU, VU;
+    CalculateCanonicalUnits(ASTRO_AU_TO_KM, ASTRO_MU_SUN, &DU, &TU, &VU);
+    return 1.0 / (TU * MATH_DAY_TO_SEC);
+}
+
+static const double JPL_VELOCITY_FACTOR = CalculateJplVelocityFactor();
+
+static void ConvertJplVector(double x, double y, double z, double factor, Vector3* vector)
+{
+    vector->x = factor * x;
+    vector->y = factor * (JPL_COS_OBLIQUITY * y + JPL_SIN_OBLIQUITY * z);
+    vector->z = factor * (JPL_COS_OBLIQUITY * z - JPL_SIN_OBLIQUITY * y);
+}
+
+static void ConvertJplVectors(double factor, Vector3Array* vectors)
+{
+    const size_t count = vectors->Size();
+    for (size_t i = 0; i < count; ++i)
+    {
+        const double y = vectors->y[i];
+        const double z = vectors->z[i];
+        vectors->x[i] = factor * vectors->x[i];
+        vectors->y[i] = factor * (JPL_COS_OBLIQUITY * y + JPL_SIN_OBLIQUITY * z);
+        vectors->z[i] = factor * (JPL_COS_OBLIQUITY * z - JPL_SIN_OBLIQUITY * y);
+    }
+}
+
+static const char* GetJplErrorMessage(int errorCode)
+{
+    switch (errorCode)
+    {
+    case JPL_EPH_OUTSIDE_RANGE:
+        return "JPL ephemeris query epoch is outside the range of the file";
+    case JPL_EPH_READ_ERROR:
+    case JPL_EPH_FSEEK_ERROR:
+        return "Failed to read JPL ephemeris file";
+    case JPL_EPH_INVALID_INDEX:
+        return "Invalid JPL ephemeris object";
+    case JPL_EPH_BODY_NOT_IN_EPHEMERIS:
+        return "JPL ephemeris object is not in the sub-ephemeris file";
+    case JPL_EPH_TOO_MANY_COEFFICIENTS:
+        return "JPL ephemeris file has more Chebyshev coefficients than the batch reader supports";
+    default:
+        return "JPL ephemeris query failed";
+    }
+}
+
+JplEphemeris::JplEphemeris()
+    : _ephemerisData(NULL)
+{
+    for (int i = 0; i < JPL_NUMBER_CONTEXT_SLOTS; ++i)
+    {
+        _contexts[i].store(NULL);
+    }
+}
+
+JplEphemeris::~JplEphemeris()
+{
+    CloseContexts();
+    jpl_eph_data* ephemerisData = _ephemerisData.load();
+    if (ephemerisData != NULL)
+    {
+        jpl_close_ephemeris(ephemerisData);
+    }
+}
+
 void JplEphemeris::SetEphemerisFile(const std::string& filepath)
 {
+    std::lock_guard<std::mutex> lock(_loadMutex);
+
+    CloseContexts();
+    jpl_eph_data* ephemerisData = _ephemerisData.exchange(NULL);
+    if (ephemerisData != NULL)
+    {
+        jpl_close_ephemeris(ephemerisData);
+    }
     _ephemerisFile = filepath;
-    _ephemerisState = STATE_DIRTY;
 }
 
-void JplEphemeris::GetOrbitAtEpoch(int objectId, double epoch, OrbitalElements* orbitalElements, StateVector* stateVector)
+jpl_eph_data* JplEphemeris::GetEphemerisData() const
 {
+    jpl_eph_data* ephemerisData = _ephemerisData.load(std::memory_order_acquire);
+    if (ephemerisData != NULL)
+    {
+        return ephemerisData;
+    }
+
+    // First query, open the file unless another thread got here first.
+    std::lock_guard<std::mutex> lock(_loadMutex);
+    ephemerisData = _ephemerisData.load(std::memory_order_relaxed);
+    if (ephemerisData == NULL)
+    {
+        if (_ephemerisFile.empty())
+        {
+            throw JplEphemerisFileError("JPL ephemeris file has not been set", JPL_INIT_NOT_CALLED);
+        }
+
+        // The file is memory mapped so queries never touch the disk.
+        void* result = jpl_init_ephemeris_mapped(_ephemerisFile.c_str(), NULL, NULL);
+        if (result == NULL)
+        {
+            throw JplEphemerisFileError("Failed to initialize JPL ephemeris file " + _ephemerisFile, jpl_init_error_code());
+        }
+        ephemerisData = reinterpret_cast<jpl_eph_data*>(result);
+        _ephemerisData.store(ephemerisData, std::memory_order_release);
+    }
+    return ephemerisData;
 }
 
-void JplEphemeris::QueryDatabase(int planetId, double epoch, StateVector* stateVector)
+void JplEphemeris::GetOrbitAtEpoch(int objectId, double epoch, OrbitalElements* orbitalElements, StateVector* stateVector) const
 {
-    // Make sure the current jpl ephemeris file has already been initialized
-    if (_ephemerisState == STATE_DIRTY)
+    assert(objectId >= 0 && objectId < PLANET_COUNT);
+
+    // Nothing to do, get out and report the error.
+    if (orbitalElements == NULL && stateVector == NULL)
+    {
+        // log error
+        return;
+    }
+
+    // We must compute the state vectors. If we don't want them,
+    // then we use a local variable so that concurrent queries do not share it.
+    StateVector state;
+    if (stateVector == NULL)
     {
-        if (_ephemerisData != NULL)
+        stateVector = &state;
+    }
+    QueryDatabase(objectId, epoch, stateVector);
+
+    if (orbitalElements != NULL)
+    {
+        ConvertStateVector2OrbitalElements(*stateVector, orbitalElements);
+    }
+}
+
+void JplEphemeris::QueryDatabase(int planetId, double epoch, StateVector* stateVector) const
+{
+    jpl_eph_data* ephemerisData = GetEphemerisData();
+
+    // Query the ephemeris database
+    double rv[6];
+    void* context = AcquireContext();
+    int result = jpl_pleph_r(ephemerisData, context, epoch, planetId + 1, JPL_CENTER_SUN, rv, 1);
+    ReleaseContext(context);
+
+    if (result != 0)
+    {
+        throw JplEphemerisQueryError(GetJplErrorMessage(result), result);
+    }
+
+    ConvertJplVector(rv[0], rv[1], rv[2], 1.0, &stateVector->position);
+    ConvertJplVector(rv[3], rv[4], rv[5], JPL_VELOCITY_FACTOR, &stateVector->velocity);
+}
+
+void JplEphemeris::GetStateVectorsAtEpochs(const int* objectIds, size_t numberObjects, const double* epochs, size_t numberEpochs,
+                                           Vector3Array* positions, Vector3Array* velocities) const
+{
+    assert(positions != NULL && velocities != NULL);
+
+    jpl_eph_data* ephemerisData = GetEphemerisData();
+
+    positions->Resize(numberObjects * numberEpochs);
+    velocities->Resize(numberObjects * numberEpochs);
+    if (numberObjects == 0 || numberEpochs == 0)
+    {
+        return;
+    }
+
+    // Point the JPL reader directly at the output columns
+    double* pv[13][6] = {};
+    unsigned int targetMask = 0;
+    for (size_t i = 0; i < numberObjects; ++i)
+    {
+        assert(objectIds[i] >= 0 && objectIds[i] < PLANET_COUNT);
+        const int target = objectIds[i] + 1;
+        assert((targetMask & (1u << (target - 1))) == 0);
+        targetMask |= 1u << (target - 1);
+
+        const size_t offset = i * numberEpochs;
+        pv[target - 1][0] = &positions->x[offset];
+        pv[target - 1][1] = &positions->y[offset];
+        pv[target - 1][2] = &positions->z[offset];
+        pv[target - 1][3] = &velocities->x[offset];
+        pv[target - 1][4] = &velocities->y[offset];
+        pv[target - 1][5] = &velocities->z[offset];
+    }
+
+    void* context = AcquireContext();
+    int result = jpl_pleph_batch(ephemerisData, context, epochs, static_cast<long>(numberEpochs), targetMask, JPL_CENTER_SUN, pv, 1);
+    ReleaseContext(context);
+
+    if (result != 0)
+    {
+        throw JplEphemerisQueryError(GetJplErrorMessage(result), result);
+    }
+
+    ConvertJplVectors(1.0, positions);
+    ConvertJplVectors(JPL_VELOCITY_FACTOR, velocities);
+}
+
+// Each slot holds a free context or NULL. A context is taken by swapping NULL into its slot, so
+// two threads can never take the same one and there is no ABA problem as with a linked free list.
+void* JplEphemeris::AcquireContext() const
+{
+    for (int i = 0; i < JPL_NUMBER_CONTEXT_SLOTS; ++i)
+    {
+        if (_contexts[i].load(std::memory_order_relaxed) != NULL)
         {
-            delete _ephemerisData;
-            _ephemerisData = NULL;
+            void* context = _contexts[i].exchange(NULL, std::memory_order_acquire);
+            if (context != NULL)
+            {
+                return context;
+            }
         }
+    }
+
+    void* context = jpl_init_context(GetEphemerisData());
+    if (context == NULL)
+    {
+        throw JplEphemerisError("Failed to create JPL ephemeris query context", JPL_INIT_MEMORY_FAILURE);
+    }
+    return context;
+}
+
+void JplEphemeris::ReleaseContext(void* context) const
+{
+    for (int i = 0; i < JPL_NUMBER_CONTEXT_SLOTS; ++i)
+    {
+        void* empty = NULL;
+        if (_contexts[i].load(std::memory_order_relaxed) == NULL &&
+            _contexts[i].compare_exchange_strong(empty, context, std::memory_order_release))
+        {
+            return;
+        }
+    }
 
-        // Initialize the jpl ephemeris file
-        void* result = jpl_init_ephemeris(_ephemerisFile.c_str(), NULL, NULL);
+    // More threads than slots, this context is not kept.
+    jpl_close_context(context);
+}
 
-        if (result != NULL)
+void JplEphemeris::CloseContexts()
+{
+    for (int i = 0; i < JPL_NUMBER_CONTEXT_SLOTS; ++i)
+    {
+        void* context = _contexts[i].exchange(NULL);
+        if (context != NULL)
         {
-            _ephemerisData = reinterpret_cast<jpl_eph_data*>(result);
-            assert(_ephemerisData != NULL);
-            _ephemerisState = STATE_CLEAN;
+            jpl_close_context(context);
         }
-        else
+    }
+}
+
+// Chebyshev fits use this many coefficients per component and segment, and segments are
+// not made shorter than the minimum length (days) when looking for the tolerance.
+static const int    CHEBYSHEV_NUMBER_COEFFICIENTS  = 12;
+static const double CHEBYSHEV_MIN_SEGMENT_LENGTH   = 1.0;
+
+// Evaluates the six fitted components of one segment at x in [-1, 1] with Clenshaw's recurrence.
+static void EvaluateChebyshevSegment(const double* coefficients, double x, StateVector* stateVector)
+{
+    const int n = CHEBYSHEV_NUMBER_COEFFICIENTS;
+    const double twoX = 2.0 * x;
+
+    double b1[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    double b2[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    for (int j = n - 1; j >= 1; --j)
+    {
+        for (int component = 0; component < 6; ++component)
         {
-            throw "Failed to initialize JPL ephemeris file";
+            const double b0 = twoX * b1[component] - b2[component] + coefficients[component * n + j];
+            b2[component] = b1[component];
+            b1[component] = b0;
         }
     }
+    double result[6];
+    for (int component = 0; component < 6; ++component)
+    {
+        result[component] = x * b1[component] - b2[component] + coefficients[component * n];
+    }
 
-    // Query the ephemeris database
-    double rv[6];
-    jpl_pleph(_ephemerisData, epoch, planetId + 1, 12, rv, 1);
-    stateVector->position.x = rv[0];
-    stateVector->position.y = rv[1];
-    stateVector->position.z = rv[2];
+    stateVector->position.set(result[0], result[1], result[2]);
+    stateVector->velocity.set(result[3], result[4], result[5]);
+}
 
-    stateVector->velocity.x = rv[3];
-    stateVector->velocity.y = rv[4];
-    stateVector->velocity.z = rv[5];
+ChebyshevEphemeris::ChebyshevEphemeris(const Ephemeris* source, double startEpoch, double endEpoch, double tolerance, bool takeOwnership)
+    : _source(source),
+      _ownsSource(takeOwnership),
+      _startEpoch(startEpoch),
+      _endEpoch(endEpoch),
+      _tolerance(tolerance),
+      _fits(PLANET_COUNT)
+{
+    assert(source != NULL);
+    if (!(endEpoch > startEpoch) || !(tolerance > 0.0))
+    {
+        throw "Invalid Chebyshev ephemeris window or tolerance";
+    }
+
+    for (int objectId = 0; objectId < PLANET_COUNT; ++objectId)
+    {
+        FitObject(objectId, &_fits[objectId]);
+    }
+}
+
+ChebyshevEphemeris::~ChebyshevEphemeris()
+{
+    if (_ownsSource)
+    {
+        delete _source;
+    }
 }
 
+void ChebyshevEphemeris::GetOrbitAtEpoch(int objectId, double epoch, OrbitalElements* orbitalElements, StateVector* stateVector) const
+{
+    assert(objectId >= 0 && objectId < PLANET_COUNT);
+
+    // Outside the window, ask the source.
+    if (epoch < _startEpoch || epoch > _endEpoch)
+    {
+        _source->GetOrbitAtEpoch(objectId, epoch, orbitalElements, stateVector);
+        return;
+    }
+
+    // Nothing to do, get out and report the error.
+    if (orbitalElements == NULL && stateVector == NULL)
+    {
+        // log error
+        return;
+    }
+
+    StateVector state;
+    if (stateVector == NULL)
+    {
+        stateVector = &state;
+    }
+    Interpolate(_fits[objectId], epoch, stateVector);
+
+    if (orbitalElements != NULL)
+    {
+        ConvertStateVector2OrbitalElements(*stateVector, orbitalElements);
+    }
+}
+
+void ChebyshevEphemeris::GetFitError(int objectId, double* positionError, double* velocityError) const
+{
+    assert(objectId >= 0 && objectId < PLANET_COUNT);
+    *positionError = _fits[objectId].positionError;
+    *velocityError = _fits[objectId].velocityError;
+}
+
+size_t ChebyshevEphemeris::GetNumberSegments(int objectId) const
+{
+    assert(objectId >= 0 && objectId < PLANET_COUNT);
+    return _fits[objectId].numberSegments;
+}
+
+void ChebyshevEphemeris::FitObject(int objectId, Fit* fit) const
+{
+    // Double the number of segments until the fit is good enough.
+    const double windowLength = _endEpoch - _startEpoch;
+    size_t numberSegments = 1;
+    FitSegments(objectId, numberSegments, fit);
+    while ((fit->positionError > _tolerance || fit->velocityError > _tolerance) &&
+           windowLength / (2 * numberSegments) >= CHEBYSHEV_MIN_SEGMENT_LENGTH)
+    {
+        numberSegments *= 2;
+        FitSegments(objectId, numberSegments, fit);
+    }
+}
+
+void ChebyshevEphemeris::FitSegments(int objectId, size_t numberSegments, Fit* fit) const
+{
+    const int n = CHEBYSHEV_NUMBER_COEFFICIENTS;
+    const size_t segmentSize = 6 * n;
+
+    fit->segmentLength = (_endEpoch - _startEpoch) / numberSegments;
+    fit->numberSegments = numberSegments;
+    fit->coefficients.assign(numberSegments * segmentSize, 0.0);
+    fit->positionError = 0.0;
+    fit->velocityError = 0.0;
+
+    StateVector state;
+    double values[6][CHEBYSHEV_NUMBER_COEFFICIENTS];
+    for (size_t segment = 0; segment < numberSegments; ++segment)
+    {
+        const double segmentStart = _startEpoch + segment * fit->segmentLength;
+        double* coefficients = &fit->coefficients[segment * segmentSize];
+
+        // Sample the source at the Chebyshev nodes of the segment, and find the
+        // coefficients of the interpolating polynomials with a cosine transform.
+        for (int k = 0; k < n; ++k)
+        {
+            const double x = cos(MATH_PI * (k + 0.5) / n);
+            _source->GetOrbitAtEpoch(objectId, segmentStart + 0.5 * (x + 1.0) * fit->segmentLength, NULL, &state);
+            values[0][k] = state.position.x;
+            values[1][k] = state.position.y;
+            values[2][k] = state.position.z;
+            values[3][k] = state.velocity.x;
+            values[4][k] = state.velocity.y;
+            values[5][k] = state.velocity.z;
+        }
+        for (int component = 0; component < 6; ++component)
+        {
+            for (int j = 0; j < n; ++j)
+            {
+                double sum = 0.0;
+                for (int k = 0; k < n; ++k)
+                {
+                    sum += values[component][k] * cos(MATH_PI * j * (k + 0.5) / n);
+                }
+                coefficients[component * n + j] = (j == 0 ? 1.0 : 2.0) * sum / n;
+            }
+        }
+
+        // Measure the error between the nodes and at the ends of the segment.
+        StateVector fitted;
+        const int numberChecks = 2 * n + 1;
+        for (int m = 0; m < numberChecks; ++m)
+        {
+            const double x = 2.0 * m / (numberChecks - 1) - 1.0;
+            _source->GetOrbitAtEpoch(objectId, segmentStart + 0.5 * (x + 1.0) * fit->segmentLength, NULL, &state);
+            EvaluateChebyshevSegment(coefficients, x, &fitted);
+            fit->positionError = std::max(fit->positionError, (fitted.position - state.position).length());
+            fit->velocityError = std::max(fit->velocityError, (fitted.velocity - state.velocity).length());
+        }
+    }
+}
+
+void ChebyshevEphemeris::Interpolate(const Fit& fit, double epoch, StateVector* stateVector) const
+{
+    // Find the segment and the time within it, scaled to [-1, 1].
+    const double location = (epoch - _startEpoch) / fit.segmentLength;
+    size_t segment = static_cast<size_t>(location);
+    if (segment >= fit.numberSegments)
+    {
+        segment = fit.numberSegments - 1;
+    }
+    const double x = 2.0 * (location - segment) - 1.0;
+
+    EvaluateChebyshevSegment(&fit.coefficients[segment * 6 * CHEBYSHEV_NUMBER_COEFFICIENTS], x, stateVector);
+}
@@ -19,6 +19,10 @@
 #pragma once
 #include "Base.h"
 
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+
 // Forward declarations
 class Ephemeris;
 struct jpl_eph_data;
@@ -27,6 +31,9 @@ struct jpl_eph_data;
 /** This class is responsible for retrieving ephemeris data for a specified orbital object at a desired epoch.
     The ephemeris may either be interpolated via analytical methods or queried from an established database
     such as the JPL ephemeris.
+
+    Ephemeris queries are const and may be made from any number of threads at once, as long as
+    SetEphemerisType() and Cleanup() are not called concurrently with them.
  */
 class EphemerisManager
 {
@@ -35,6 +42,16 @@ public:
     /// Set the type of ephemeris to use.
     static void SetEphemerisType(EphemerisType ephemerisType);
 
+    /// Creates a new ephemeris of the given type, owned by the caller.
+    /**
+     Useful for threads or optimizers that want an ephemeris independent of the manager, e.g. a JPL
+     ephemeris with its own data file.
+     */
+    static Ephemeris* CreateEphemeris(EphemerisType ephemerisType);
+
+    /// Returns the current ephemeris, or NULL if no type has been set.
+    static const Ephemeris* GetEphemeris();
+
     /// Get orbital elements and state vectors.
     /**
      This routine retrieves the orbit (orbital elements and state vectors) for a specified orbital object
@@ -48,6 +65,19 @@ public:
      */
     static void GetOrbitAtEpoch(int objectId, double epoch, OrbitalElements* orbitalElements, StateVector* stateVector);
 
+    /// Replace the current ephemeris by a Chebyshev fit of it.
+    /**
+     This routine precomputes a ChebyshevEphemeris of the current ephemeris over a window, so that later
+     queries inside the window are a short polynomial evaluation. Queries outside the window still go to the
+     current ephemeris. Throws an exception if no ephemeris type has been set, or if the window or tolerance
+     is invalid, in which case the current ephemeris is kept.
+
+     @param startEpoch : The start of the window
+     @param endEpoch : The end of the window
+     @param tolerance : The largest error allowed in the positions (DU) and velocities (VU)
+     */
+    static void FitEphemeris(double startEpoch, double endEpoch, double tolerance);
+
     /// Static destructor.
     /**
      This routine releases any allocated memory for the current ephemeris class.
@@ -64,20 +94,33 @@ private:
 };
 
 /// Abstract base class for all ephemeris classes.
+/** Queries must not modify the ephemeris, so that one instance can be shared between threads. All
+    scratch data lives on the stack of the call.
+ */
 class Ephemeris
 {
 public:
-    virtual void GetOrbitAtEpoch(int objectId, double epoch, OrbitalElements* orbitalElements, StateVector* stateVector) = 0;
+    virtual ~Ephemeris() {}
 
-protected:
-    OrbitalElements _dummyCoes;
-    StateVector _dummyStateVector;
+    virtual void GetOrbitAtEpoch(int objectId, double epoch, OrbitalElements* orbitalElements, StateVector* stateVector) const = 0;
 };
 
 class AnalyticalEphemeris : public Ephemeris
 {
 public:
-    virtual void GetOrbitAtEpoch(int objectId, double epoch, OrbitalElements* orbitalElements, StateVector* stateVector);
+    virtual void GetOrbitAtEpoch(int objectId, double epoch, OrbitalElements* orbitalElements, StateVector* stateVector) const;
+
+    /// Get the orbital elements and state vectors of all the planets at once.
+    /**
+     This routine gives the same results as GetOrbitAtEpoch() for every planet, but computes all of them
+     together: the element polynomials, Kepler's equation and the conversion to state vectors are each one
+     pass over a table of all the planets, rather than one call per planet.
+
+     @param epoch : The time at which to recieve data at
+     @param [out] orbitalElements : The computed orbital elements, PLANET_COUNT of them indexed by planet, or NULL.
+     @param [out] stateVectors : The computed state vectors, PLANET_COUNT of them indexed by planet, or NULL.
+     */
+    void GetAllPlanetsAtEpoch(double epoch, OrbitalElements* orbitalElements, StateVector* stateVectors) const;
 
 protected:
     /// Calculate the analytical ephemeris
@@ -88,37 +131,216 @@ protected:
      @param epoch : The time at which to recieve data at
      @param [out] orbitalElements : The computed orbital elements.
      */
-    virtual void Calculate(int objectId, double epoch, OrbitalElements* orbitalElements);
+    virtual void Calculate(int objectId, double epoch, OrbitalElements* orbitalElements) const;
+};
+
+/// Base class for errors reported by the JPL ephemeris reader.
+/** The error code is the value returned by the reader, one of the JPL_INIT_* codes for a
+    JplEphemerisFileError or one of the JPL_EPH_* codes for a JplEphemerisQueryError (see jpleph.h).
+ */
+class JplEphemerisError : public std::runtime_error
+{
+public:
+    JplEphemerisError(const std::string& message, int errorCode)
+        : std::runtime_error(message), _errorCode(errorCode) {}
+
+    int GetErrorCode() const {return _errorCode;}
+
+private:
+    int _errorCode;
+};
+
+/// The JPL ephemeris file could not be opened or read.
+class JplEphemerisFileError : public JplEphemerisError
+{
+public:
+    JplEphemerisFileError(const std::string& message, int errorCode)
+        : JplEphemerisError(message, errorCode) {}
 };
 
+/// A JPL ephemeris query failed, e.g. the epoch is outside the range of the file.
+class JplEphemerisQueryError : public JplEphemerisError
+{
+public:
+    JplEphemerisQueryError(const std::string& message, int errorCode)
+        : JplEphemerisError(message, errorCode) {}
+};
+
+/// Number of free JPL query contexts a JplEphemeris keeps for reuse. Queries running on more
+/// threads than this at once create and close contexts of their own.
+const int JPL_NUMBER_CONTEXT_SLOTS = 16;
+
+/// Ephemeris queried from a JPL ephemeris database file (e.g DE405, DE423, etc..).
+/** States are returned in the same frame and units as the AnalyticalEphemeris, so the two can be swapped
+    freely: heliocentric, referred to the J2000 ecliptic, in canonical units (AU and AU/TU with the
+    gravitational parameter of the Sun).
+
+    The file is opened by the first query rather than by SetEphemerisFile(), so an ephemeris may be
+    created cheaply and shared between threads before anyone has queried it. Errors are reported by
+    throwing a JplEphemerisFileError or JplEphemerisQueryError.
+ */
 class JplEphemeris : public Ephemeris
 {
 public:
+    JplEphemeris();
+    virtual ~JplEphemeris();
+
     /// Set the JPL ephemeris data file
     /**
-     This routine sets the current JPL ephemeris data file which will be used for all future ephemeries queries.
+     This routine sets the JPL ephemeris data file which will be used for all future ephemeries queries.
+     Any previously opened file is closed. The new file is opened by the first query, which throws a
+     JplEphemerisFileError if it cannot be read. It must not be called concurrently with queries.
+
+     Either a full DE file or a sub-ephemeris written by make_sub_ephem_targets() (see the sub_eph tool)
+     may be used. A sub-ephemeris only covers the time window and planets it was made for, and is used in
+     place without any byte swapping or copying, so it loads faster and keeps less memory resident.
 
      @param filename : The absolute path to the file
      */
     virtual void SetEphemerisFile(const std::string& filepath);
 
-    virtual void GetOrbitAtEpoch(int objectId, double epoch, OrbitalElements* orbitalElements, StateVector* stateVector);
+    /// Get orbital elements and state vectors.
+    /**
+     This routine queries the JPL ephemeris for a specified planet at a desired epoch. The orbital
+     elements are only computed if requested, from the state vectors.
+
+     @param objectId : The planet identifier
+     @param epoch : The time at which to recieve data at (Julian date)
+     @param [out] orbitalElements : The computed orbital elements, may be NULL.
+     @param [out] stateVector : The computed state vectors, may be NULL.
+     */
+    virtual void GetOrbitAtEpoch(int objectId, double epoch, OrbitalElements* orbitalElements, StateVector* stateVector) const;
+
+    /// Query the JPL ephemeris database for several objects at many epochs.
+    /**
+     This routine evaluates the states of several orbital objects at many epochs in a single pass over
+     the ephemeris file. Each JPL record is read once for all the epochs falling in it, and each
+     object's Chebyshev series is evaluated for a block of epochs at a time, so epochs should be sorted.
+     Units and frame are the same as GetOrbitAtEpoch().
+
+     Results are stored object-major: entry (i * numberEpochs + j) of positions and velocities holds
+     object objectIds[i] at epochs[j].
+
+     @param objectIds : The orbital object identifiers, each listed at most once
+     @param numberObjects : The number of orbital objects
+     @param epochs : The times at which to recieve data at
+     @param numberEpochs : The number of epochs
+     @param [out] positions : The computed positions, resized to numberObjects * numberEpochs
+     @param [out] velocities : The computed velocities, resized to numberObjects * numberEpochs
+     */
+    void GetStateVectorsAtEpochs(const int* objectIds, size_t numberObjects, const double* epochs, size_t numberEpochs,
+                                 Vector3Array* positions, Vector3Array* velocities) const;
 
 protected:
     /// Query the JPL ephemeris database.
     /**
      This routine queries a JPL ephemeris database file (e.g DE405, DE423, etc..) for data for a specified
-     orbital object at a desired epoch.
+     orbital object at a desired epoch. Each query borrows a JPL query context holding the reader's scratch
+     data from a set of atomic slots, so once the file is open concurrent queries never take a lock.
+     The state is converted to the frame and units described above.
 
      @param objectId : The orbital object identifier
      @param epoch : The time at which to recieve data at
      @param [out] stateVector : The computed state vectors.
      */
-    virtual void QueryDatabase(int objectId, double epoch, StateVector* stateVector);
+    virtual void QueryDatabase(int objectId, double epoch, StateVector* stateVector) const;
+
+    /// Returns the ephemeris data, opening the file on the first call.
+    /**
+     Once the file is open this is a single atomic load, so it is cheap enough to call on every query.
+     Concurrent first calls open the file only once.
+     */
+    jpl_eph_data* GetEphemerisData() const;
+
+    /// Takes a free JPL query context, creating a new one if there is none.
+    /** Throws a JplEphemerisError if a new context cannot be allocated. */
+    void* AcquireContext() const;
+
+    /// Returns a JPL query context taken with AcquireContext(), closing it if every slot is taken.
+    void ReleaseContext(void* context) const;
+
+    /// Closes all free JPL query contexts.
+    void CloseContexts();
+
+private:
+    /// Prevent copying, the ephemeris data is owned by the instance.
+    JplEphemeris(const JplEphemeris&);
+    JplEphemeris& operator=(const JplEphemeris&);
 
 protected:
     std::string _ephemerisFile;
-    jpl_eph_data* _ephemerisData;
-    State _ephemerisState;
+    mutable std::atomic<jpl_eph_data*> _ephemerisData; // NULL until the first query
+    mutable std::mutex _loadMutex;
+    mutable std::atomic<void*> _contexts[JPL_NUMBER_CONTEXT_SLOTS]; // free query contexts, NULL if empty
 };
 
+/// Ephemeris interpolated from piecewise Chebyshev fits of another ephemeris.
+/** The state vectors of each planet are fitted over a fixed window by Chebyshev polynomials on equal
+    segments. The number of segments is doubled until the fit matches the source ephemeris to the
+    requested tolerance, as measured at points between the fitting nodes. Queries inside the window then
+    cost a short polynomial evaluation instead of a full evaluation of the source, while queries outside
+    the window are passed on to the source.
+
+    Orbital elements, if requested, are computed from the interpolated state vectors.
+ */
+class ChebyshevEphemeris : public Ephemeris
+{
+public:
+    /// Fit the source ephemeris.
+    /**
+     @param source : The ephemeris to fit. It must outlive this one unless ownership is taken.
+     @param startEpoch : The start of the window
+     @param endEpoch : The end of the window
+     @param tolerance : The largest error allowed in the positions (DU) and velocities (VU)
+     @param takeOwnership : Whether the source is deleted with this ephemeris. If the constructor throws,
+                            the source is left to the caller.
+     */
+    ChebyshevEphemeris(const Ephemeris* source, double startEpoch, double endEpoch, double tolerance, bool takeOwnership = false);
+    virtual ~ChebyshevEphemeris();
+
+    virtual void GetOrbitAtEpoch(int objectId, double epoch, OrbitalElements* orbitalElements, StateVector* stateVector) const;
+
+    /// Returns the largest errors of the fit of a planet.
+    /**
+     The errors are measured against the source ephemeris at points between the fitting nodes. They may
+     exceed the tolerance if it could not be reached with segments of the minimum length.
+
+     @param objectId : The planet identifier
+     @param [out] positionError : The largest position error (DU)
+     @param [out] velocityError : The largest velocity error (VU)
+     */
+    void GetFitError(int objectId, double* positionError, double* velocityError) const;
+
+    /// Returns the number of segments used to fit a planet.
+    size_t GetNumberSegments(int objectId) const;
+
+    double GetStartEpoch() const {return _startEpoch;}
+    double GetEndEpoch() const {return _endEpoch;}
+
+private:
+    /// The fit of one planet.
+    struct Fit
+    {
+        double segmentLength;
+        size_t numberSegments;
+        std::vector<double> coefficients; // [segment][component][coefficient]
+        double positionError;
+        double velocityError;
+    };
+
+    void FitObject(int objectId, Fit* fit) const;
+    void FitSegments(int objectId, size_t numberSegments, Fit* fit) const;
+    void Interpolate(const Fit& fit, double epoch, StateVector* stateVector) const;
+
+    /// Prevent copying, the source may be owned by the instance.
+    ChebyshevEphemeris(const ChebyshevEphemeris&);
+    ChebyshevEphemeris& operator=(const ChebyshevEphemeris&);
+
+private:
+    const Ephemeris* _source;
+    bool _ownsSource;
+    double _startEpoch;
+    double _endEpoch;
+    double _tolerance;
+    std::vector<Fit> _fits; // one per planet
+};
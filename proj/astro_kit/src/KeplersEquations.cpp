@@ -18,6 +18,7 @@
 
 #include "KeplersEquations.h"
 #include "Base.h"
+#include "BatchMath.h"
 
 double SolveKeplersEquationE(double eccentricity, double M)
 {
@@ -100,4 +101,113 @@ double SolveKeplersEquationH(double eccentricity, double M)
     }
 
     return H;
-}
\ No newline at end of file
+}
+
+void BATCH_KERNEL SolveKeplersEquationE(size_t count, const double* eccentricity, const double* M, double* E)
+{
+    const double PI_SQUARED = MATH_PI * MATH_PI;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        assert(eccentricity[i] >= 0.0 && eccentricity[i] < 1.0);
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const double e = eccentricity[i];
+
+        // Reduce to [-pi, pi] and solve for |M|; the solution is odd in M.
+        const double offset = MATH_2_PI * BatchRound(0.5 * MATH_1_OVER_PI * M[i]);
+        const double reduced = M[i] - offset;
+        const double sign = (reduced >= 0.0) ? 1.0 : -1.0;
+        const double m = fabs(reduced);
+
+        // Markley's starter (eqs. 20 - 21), w = (|r| + sqrt(q^3 + r^2))^(2/3) > 0
+        const double alpha = (3.0*PI_SQUARED + 1.6*MATH_PI*(MATH_PI - m)/(1.0 + e)) / (PI_SQUARED - 6.0);
+        const double d = 3.0*(1.0 - e) + alpha*e;
+        const double q = 2.0*alpha*d*(1.0 - e) - m*m;
+        const double r = 3.0*alpha*d*(d - 1.0 + e)*m + m*m*m;
+        const double w = BatchExp(BatchLog(fabs(r) + BatchSqrt(q*q*q + r*r)) * (2.0/3.0));
+        const double E1 = (2.0*r*w/(w*w + w*q + q*q) + m) / d;
+
+        // Fifth order correction (eqs. 26 - 29)
+        double sinE1, cosE1;
+        BatchSinCos(E1, &sinE1, &cosE1);
+        const double f2 = e*sinE1;
+        const double f3 = e*cosE1;
+        const double f0 = E1 - f2 - m;
+        const double f1 = 1.0 - f3;
+        const double d3 = -f0 / (f1 - 0.5*f0*f2/f1);
+        const double d4 = -f0 / (f1 + 0.5*d3*f2 + d3*d3*f3/6.0);
+        const double d5 = -f0 / (f1 + 0.5*d4*f2 + d4*d4*f3/6.0 - d4*d4*d4*f2/24.0);
+
+        E[i] = offset + sign*(E1 + d5);
+    }
+}
+
+void BATCH_KERNEL SolveKeplersEquationH(size_t count, const double* eccentricity, const double* M, double* H)
+{
+    const int NUMBER_ITERATIONS = 3; // Halley steps needed from the starter below.
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        assert(eccentricity[i] >= 1.0);
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const double e = eccentricity[i];
+
+        // Solve for |M|; the solution is odd in M.
+        const double sign = (M[i] >= 0.0) ? 1.0 : -1.0;
+        const double m = fabs(M[i]);
+
+        // Cardano root of (e - 1) H + e H^3 / 6 = m
+        const double p = 6.0*(e - 1.0)/e;
+        const double halfQ = 3.0*m/e;
+        const double root = BatchSqrt(halfQ*halfQ + p*p*p/27.0);
+        const double a = BatchCbrt(root + halfQ);
+        const double b = BatchCbrt(root - halfQ);
+        const double ab = a*a + a*b + b*b;
+        const double cubic = 2.0*halfQ / ((ab > DBL_MIN) ? ab : DBL_MIN); // a - b without the cancellation
+
+        const double asymptote = BatchLog(2.0*m/e + 1.8);
+        double x = (cubic < asymptote) ? cubic : asymptote;
+        for (int j = 0; j < NUMBER_ITERATIONS; ++j)
+        {
+            double sinhx, coshx;
+            BatchSinhCosh(x, &sinhx, &coshx);
+            const double f2 = e*sinhx;
+            const double f1Raw = e*coshx - 1.0;
+            const double f1 = (f1Raw > DBL_MIN) ? f1Raw : DBL_MIN; // only zero for e = 1, M = 0
+            const double f0 = f2 - x - m;
+            x -= f0 / (f1 - 0.5*f0*f2/f1);
+        }
+
+        H[i] = sign*x;
+    }
+}
+
+void CalculateStumpffFunctions(double psi, double* c2, double* c3)
+{
+    if (psi > 0.1)
+    {
+        // 1 - cos is written as 2 sin^2 to stay accurate near psi = 4 n^2 pi^2.
+        double sqrtPsi = sqrt(psi);
+        *c2 = 2.0 * SQR(sin(0.5 * sqrtPsi)) / psi;
+        *c3 = (sqrtPsi - sin(sqrtPsi)) / (sqrtPsi * psi);
+    }
+    else if (psi < -0.1)
+    {
+        double sqrtPsi = sqrt(-psi);
+        *c2 = -2.0 * SQR(sinh(0.5 * sqrtPsi)) / psi;
+        *c3 = (sinh(sqrtPsi) - sqrtPsi) / (-sqrtPsi * psi);
+    }
+    else
+    {
+        // Series expansion avoids the cancellation of the closed forms near
+        // psi = 0. Six terms are accurate to machine precision for |psi| <= 0.1.
+        *c2 = (1.0/2.0)*(1.0 - psi/12.0*(1.0 - psi/30.0*(1.0 - psi/56.0*(1.0 - psi/90.0*(1.0 - psi/132.0)))));
+        *c3 = (1.0/6.0)*(1.0 - psi/20.0*(1.0 - psi/42.0*(1.0 - psi/72.0*(1.0 - psi/110.0*(1.0 - psi/156.0)))));
+    }
+}
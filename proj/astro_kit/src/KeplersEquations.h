@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <cstddef>
+
 /// Solves Keplers Equation for elliptical orbits.
 /**
  This routine computes the eccentric anomaly of an elliptical orbit using the eccentricity and mean anomaly.
@@ -44,4 +46,47 @@ double SolveKeplersEquationE(double eccentricity, double M);
  @param M : The mean anomaly (radians).
  @returns : The hyperbolic anomaly (radians).
 */
-double SolveKeplersEquationH(double eccentricity, double M);
\ No newline at end of file
+double SolveKeplersEquationH(double eccentricity, double M);
+
+/// Solves Keplers Equation for arrays of elliptical orbits.
+/**
+ This routine computes the eccentric anomaly of each (eccentricity, mean anomaly) pair. Each mean anomaly
+ is reduced to [-pi, pi] and started from Markley's cubic approximation, which is then refined by a single
+ fifth order correction. Every element takes the same fixed path through the loop, with no iteration limit
+ and no branching on convergence, and the elementary functions are the branch-free ones of BatchMath.h, so
+ the loop is vectorized. The result is accurate to machine precision for all 0 <= e < 1.
+
+ Reference: Kepler Equation Solver, F. Landis Markley, Celestial Mechanics and Dynamical Astronomy 63, 1995.
+
+ @param count : The number of elements in each array.
+ @param eccentricity : The eccentricities.
+ @param M : The mean anomalies (radians).
+ @param E : Returns the eccentric anomalies (radians).
+*/
+void SolveKeplersEquationE(size_t count, const double* eccentricity, const double* M, double* E);
+
+/// Solves Keplers Equation for arrays of hyperbolic orbits.
+/**
+ This routine computes the hyperbolic anomaly of each (eccentricity, mean anomaly) pair. Each element is
+ started from the smaller of the root of the cubic truncation of Kepler's Equation and the logarithmic
+ asymptote, both of which bound the solution from above, and then refined by a fixed number of Halley
+ iterations. As with the elliptical version there is no branching on convergence and the loop is vectorized.
+
+ Reference: Fundamentals of Celestial Mechanics 2nd Edition, J.M.A. Danby, Section 6.6.
+
+ @param count : The number of elements in each array.
+ @param eccentricity : The eccentricities.
+ @param M : The mean anomalies (radians).
+ @param H : Returns the hyperbolic anomalies (radians).
+*/
+void SolveKeplersEquationH(size_t count, const double* eccentricity, const double* M, double* H);
+
+/// Computes the Stumpff functions c2 and c3 used by the universal variable formulation.
+/**
+ Reference: Fundamentals of Astrodynamics and Applications 3rd Edition, David Vallado, Algorithm 1.
+
+ @param psi : The universal variable psi (radians squared).
+ @param c2 : Returns the c2 function of psi.
+ @param c3 : Returns the c3 function of psi.
+*/
+void CalculateStumpffFunctions(double psi, double* c2, double* c3);
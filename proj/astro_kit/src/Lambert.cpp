@@ -17,52 +17,205 @@
  *****************************************************************************/
 
 #include "Lambert.h"
+#include "LambertCache.h"
+#include "ThreadPool.h"
+#include "KeplersEquations.h"
+#include "BatchMath.h"
 
 // Static field initialization
 Lambert* LambertManager::_lambertSolver = NULL;
+LambertCache* LambertManager::_lambertCache = NULL;
+
+void LambertBatch::Resize(size_t count)
+{
+    initialPosition.Resize(count);
+    finalPosition.Resize(count);
+    timeOfFlight.resize(count);
+    orbitDirection.resize(count, ORBIT_DIR_PROGRADE);
+    numberRevolutions.resize(count, 0);
+    initialVelocity.Resize(count);
+    finalVelocity.Resize(count);
+}
+
+size_t LambertBatch::Size() const
+{
+    return timeOfFlight.size();
+}
+
+void LambertBatch::SetProblem(size_t index,
+                              const Vector3& initialPosition,
+                              const Vector3& finalPosition,
+                              double timeOfFlight,
+                              OrbitDirection orbitDirection,
+                              int numberRevolutions)
+{
+    this->initialPosition.Set(index, initialPosition);
+    this->finalPosition.Set(index, finalPosition);
+    this->timeOfFlight[index] = timeOfFlight;
+    this->orbitDirection[index] = orbitDirection;
+    this->numberRevolutions[index] = numberRevolutions;
+}
+
+void LambertBatch::GetSolution(size_t index, Vector3* initialVelocity, Vector3* finalVelocity) const
+{
+    this->initialVelocity.Get(index, initialVelocity);
+    this->finalVelocity.Get(index, finalVelocity);
+}
 
 void LambertManager::SetLambertType(LambertType lambertType)
 {
+    size_t cacheCapacity = (_lambertCache != NULL) ? _lambertCache->GetCapacity() : 0;
+
     Cleanup();
 
+    _lambertSolver = CreateLambertSolver(lambertType);
+    if (cacheCapacity > 0)
+    {
+        EnableCache(cacheCapacity);
+    }
+}
+
+Lambert* LambertManager::CreateLambertSolver(LambertType lambertType)
+{
     switch (lambertType)
     {
     case LAMBERT_EXP_SINUSOID:
-        _lambertSolver = new ExpSinusoidLambert();
-        break;
+        return new ExpSinusoidLambert();
 
     case LAMBERT_BATTIN:
-        _lambertSolver = new BattinsLambert();
-        break;
+        return new BattinsLambert();
 
     case LAMBERT_UNIVERSAL_VAR:
-        _lambertSolver = new UniversalVarLambert();
-        break;
+        return new UniversalVarLambert();
+
+    case LAMBERT_UNIVERSAL_VAR_BULK:
+        return new UniversalVarBulkLambert();
 
-    case LAMBERT_UNIVERSAL_VAR_GPU:
-        _lambertSolver = new UniversalVarGpuLambert();
-        break;
+    case LAMBERT_IZZO:
+        return new IzzoLambert();
 
     default:
         throw "Invalid Lambert algorithm type";
     }
 }
 
-void LambertManager::Evaluate(const Vector3& initialPosition,
+bool LambertManager::Evaluate(const Vector3& initialPosition,
                               const Vector3& finalPosition,
                               double timeOfFlight,
                               OrbitDirection orbitDirection,
                               int numberRevolutions,
                               Vector3* initialVelocity,
-                              Vector3* finalVelocity)
+                              Vector3* finalVelocity,
+                              LambertInfo* info)
 {
-    if (_lambertSolver != NULL)
+    // The convergence status is needed even if the caller has no use for
+    // the rest of the diagnostics.
+    LambertInfo localInfo;
+    if (info == NULL)
+    {
+        info = &localInfo;
+    }
+    info->converged = false;
+
+    if (_lambertCache != NULL)
+    {
+        _lambertCache->Evaluate(initialPosition, finalPosition,
+                                timeOfFlight,
+                                orbitDirection,
+                                numberRevolutions,
+                                initialVelocity, finalVelocity,
+                                info);
+    }
+    else if (_lambertSolver != NULL)
     {
         _lambertSolver->Evaluate(initialPosition, finalPosition,
                                 timeOfFlight,
                                 orbitDirection,
                                 numberRevolutions,
-                                initialVelocity, finalVelocity);
+                                initialVelocity, finalVelocity,
+                                info);
+    }
+    else
+    {
+        throw "Lambert algorithm has not been specified yet";
+    }
+    return info->converged;
+}
+
+void LambertManager::EnableCache(size_t capacity)
+{
+    if (_lambertSolver != NULL)
+    {
+        DisableCache();
+        _lambertCache = new LambertCache(_lambertSolver, capacity);
+    }
+    else
+    {
+        throw "Lambert algorithm has not been specified yet";
+    }
+}
+
+void LambertManager::DisableCache()
+{
+    if (_lambertCache != NULL)
+    {
+        delete _lambertCache;
+        _lambertCache = NULL;
+    }
+}
+
+const LambertCache* LambertManager::GetCache()
+{
+    return _lambertCache;
+}
+
+void LambertManager::EvaluateBatch(LambertBatch* batch)
+{
+    if (_lambertSolver != NULL)
+    {
+        const size_t count = batch->Size();
+        batch->initialVelocity.Resize(count);
+        batch->finalVelocity.Resize(count);
+
+        _lambertSolver->EvaluateBatch(batch, 0, count);
+    }
+    else
+    {
+        throw "Lambert algorithm has not been specified yet";
+    }
+}
+
+void LambertManager::EvaluateSweep(LambertBatch* batch, size_t numberRows, size_t numberColumns, LambertSweepMode mode, std::vector<LambertInfo>* infos)
+{
+    if (_lambertSolver != NULL)
+    {
+        _lambertSolver->EvaluateSweep(batch, numberRows, numberColumns, mode, infos);
+    }
+    else
+    {
+        throw "Lambert algorithm has not been specified yet";
+    }
+}
+
+void LambertManager::EvaluateParallel(LambertBatch* batch, ThreadPool* threadPool)
+{
+    if (_lambertSolver != NULL)
+    {
+        const size_t count = batch->Size();
+        batch->initialVelocity.Resize(count);
+        batch->finalVelocity.Resize(count);
+
+        // A few chunks per worker balances problems that need more
+        // iterations, chunks are kept a multiple of the batch width.
+        size_t numberChunks = 4 * threadPool->GetNumberThreads();
+        size_t grainSize = (count + numberChunks - 1) / numberChunks;
+        grainSize = LAMBERT_BATCH_WIDTH * Max<size_t>(1, (grainSize + LAMBERT_BATCH_WIDTH - 1) / LAMBERT_BATCH_WIDTH);
+
+        const Lambert* solver = _lambertSolver;
+        threadPool->ParallelFor(count, grainSize, [=](size_t begin, size_t end)
+        {
+            solver->EvaluateBatch(batch, begin, end);
+        });
     }
     else
     {
@@ -72,6 +225,8 @@ void LambertManager::Evaluate(const Vector3& initialPosition,
 
 void LambertManager::Cleanup()
 {
+    DisableCache();
+
     if (_lambertSolver != NULL)
     {
         delete _lambertSolver;
@@ -79,13 +234,168 @@ void LambertManager::Cleanup()
     }
 }
 
+void Lambert::EvaluateBatch(LambertBatch* batch, size_t begin, size_t end) const
+{
+    Vector3 initialPosition, finalPosition, initialVelocity, finalVelocity;
+    for (size_t i = begin; i < end; ++i)
+    {
+        batch->initialPosition.Get(i, &initialPosition);
+        batch->finalPosition.Get(i, &finalPosition);
+
+        Evaluate(initialPosition, finalPosition,
+                 batch->timeOfFlight[i],
+                 batch->orbitDirection[i],
+                 batch->numberRevolutions[i],
+                 &initialVelocity, &finalVelocity);
+
+        batch->initialVelocity.Set(i, initialVelocity);
+        batch->finalVelocity.Set(i, finalVelocity);
+    }
+}
+
+void Lambert::EvaluateSweep(LambertBatch* batch, size_t numberRows, size_t numberColumns, LambertSweepMode mode, std::vector<LambertInfo>* infos) const
+{
+    const size_t count = batch->Size();
+    assert(numberRows * numberColumns == count);
+    assert(mode == LAMBERT_SWEEP_WARM_START || mode == LAMBERT_SWEEP_BATCH);
+    assert(mode == LAMBERT_SWEEP_WARM_START || infos == NULL);
+    batch->initialVelocity.Resize(count);
+    batch->finalVelocity.Resize(count);
+
+    if (mode == LAMBERT_SWEEP_BATCH)
+    {
+        EvaluateBatch(batch, 0, count);
+        return;
+    }
+
+    if (infos != NULL)
+    {
+        infos->resize(count);
+    }
+
+    Vector3 initialPosition, finalPosition, initialVelocity, finalVelocity;
+    LambertInfo info;
+
+    // Solution variable of the last two cells along the current row
+    double x0 = 0.0, x1 = 0.0;
+    int numberPrevious = 0;
+
+    for (size_t row = 0; row < numberRows; ++row)
+    {
+        for (size_t step = 0; step < numberColumns; ++step)
+        {
+            size_t column = (row % 2 == 0) ? step : numberColumns - 1 - step;
+            size_t i = row * numberColumns + column;
+
+            // The previous cell is the neighbour along the row, or the one
+            // above at the start of a row. A guess is only useful from a
+            // converged neighbour of the same kind.
+            size_t previous = (step > 0) ? ((row % 2 == 0) ? i - 1 : i + 1) : i - numberColumns;
+            if (numberPrevious > 0 &&
+                (batch->orbitDirection[previous] != batch->orbitDirection[i] ||
+                 batch->numberRevolutions[previous] != batch->numberRevolutions[i]))
+            {
+                numberPrevious = 0;
+            }
+
+            batch->initialPosition.Get(i, &initialPosition);
+            batch->finalPosition.Get(i, &finalPosition);
+
+            if (numberPrevious > 0)
+            {
+                // Along a row, extrapolate linearly from the last two cells
+                double initialGuess = (numberPrevious > 1 && step > 1) ? 2.0 * x1 - x0 : x1;
+                EvaluateWarmStart(initialPosition, finalPosition,
+                                  batch->timeOfFlight[i],
+                                  batch->orbitDirection[i],
+                                  batch->numberRevolutions[i],
+                                  initialGuess,
+                                  &initialVelocity, &finalVelocity,
+                                  &info);
+            }
+            else
+            {
+                Evaluate(initialPosition, finalPosition,
+                         batch->timeOfFlight[i],
+                         batch->orbitDirection[i],
+                         batch->numberRevolutions[i],
+                         &initialVelocity, &finalVelocity,
+                         &info);
+            }
+
+            batch->initialVelocity.Set(i, initialVelocity);
+            batch->finalVelocity.Set(i, finalVelocity);
+            if (infos != NULL)
+            {
+                (*infos)[i] = info;
+            }
+
+            if (info.converged)
+            {
+                x0 = x1;
+                x1 = info.x;
+                numberPrevious = Min(numberPrevious + 1, 2);
+            }
+            else
+            {
+                numberPrevious = 0;
+            }
+        }
+    }
+}
+
+void Lambert::EvaluateWarmStart(const Vector3& initialPosition,
+                                const Vector3& finalPosition,
+                                double timeOfFlight,
+                                OrbitDirection orbitDirection,
+                                int numberRevolutions,
+                                double /*initialGuess*/,
+                                Vector3* initialVelocity,
+                                Vector3* finalVelocity,
+                                LambertInfo* info) const
+{
+    Evaluate(initialPosition, finalPosition,
+             timeOfFlight,
+             orbitDirection,
+             numberRevolutions,
+             initialVelocity, finalVelocity,
+             info);
+}
+
 void ExpSinusoidLambert::Evaluate(const Vector3& initialPosition,
                                   const Vector3& finalPosition,
                                   double timeOfFlight,
                                   OrbitDirection orbitDirection,
                                   int numberRevolutions,
                                   Vector3* initialVelocity,
-                                  Vector3* finalVelocity)
+                                  Vector3* finalVelocity,
+                                  LambertInfo* info) const
+{
+    Solve(initialPosition, finalPosition, timeOfFlight, orbitDirection, numberRevolutions, NULL, initialVelocity, finalVelocity, info);
+}
+
+void ExpSinusoidLambert::EvaluateWarmStart(const Vector3& initialPosition,
+                                           const Vector3& finalPosition,
+                                           double timeOfFlight,
+                                           OrbitDirection orbitDirection,
+                                           int numberRevolutions,
+                                           double initialGuess,
+                                           Vector3* initialVelocity,
+                                           Vector3* finalVelocity,
+                                           LambertInfo* info) const
+{
+    Solve(initialPosition, finalPosition, timeOfFlight, orbitDirection, numberRevolutions, &initialGuess, initialVelocity, finalVelocity, info);
+}
+
+void ExpSinusoidLambert::Solve(const Vector3& initialPosition,
+                               const Vector3& finalPosition,
+                               double timeOfFlight,
+                               OrbitDirection orbitDirection,
+                               int numberRevolutions,
+                               const double* initialGuess,
+                               Vector3* initialVelocity,
+                               Vector3* finalVelocity,
+                               LambertInfo* info) const
 {
     assert(timeOfFlight > 0.0);
     assert(orbitDirection == ORBIT_DIR_PROGRADE || orbitDirection == ORBIT_DIR_RETROGRADE);
@@ -97,7 +407,7 @@ void ExpSinusoidLambert::Evaluate(const Vector3& initialPosition,
     T = R / V;
 
      // Non-dimensionalize the position vectors
-    static Vector3 R1, R2;
+    Vector3 R1, R2;
     R1 = initialPosition;
     R2 = finalPosition;
     R1 *= 1.0 / R;
@@ -109,7 +419,7 @@ void ExpSinusoidLambert::Evaluate(const Vector3& initialPosition,
     double tof = timeOfFlight / T;
 
     // Cross product of initial and final position.
-    static Vector3 CrossR1R2;
+    Vector3 CrossR1R2;
     Vector3::cross(R1, R2, &CrossR1R2);
     double crossR1R2 = CrossR1R2.length();
 
@@ -149,6 +459,32 @@ void ExpSinusoidLambert::Evaluate(const Vector3& initialPosition,
     y1 = log(y1) - logt;
     y2 = log(y2) - logt;
 
+    // Warm start: secant from the guess and a point next to it, in the
+    // transformed variables of the iteration below.
+    const double maxX = (numberRevolutions == 0) ? MATH_INFINITY : 1.0;
+    if (initialGuess != NULL && *initialGuess > -1.0 && *initialGuess < maxX)
+    {
+        input1 = *initialGuess;
+        input2 = (input1 + 1.0e-4 < maxX) ? input1 + 1.0e-4 : input1 - 1.0e-4;
+        CalculateTimeOfFlight(input1, s, c, longway, numberRevolutions, &y1);
+        CalculateTimeOfFlight(input2, s, c, longway, numberRevolutions, &y2);
+
+        if (numberRevolutions == 0)
+        {
+            x1 = log(1.0 + input1);
+            x2 = log(1.0 + input2);
+            y1 = log(y1) - logt;
+            y2 = log(y2) - logt;
+        }
+        else
+        {
+            x1 = tan(MATH_PI_OVER_2 * input1);
+            x2 = tan(MATH_PI_OVER_2 * input2);
+            y1 = y1 - tof;
+            y2 = y2 - tof;
+        }
+    }
+
     // Newton-Raphson iteration
     double error = 1.0;
     int iteration = 0;
@@ -179,10 +515,17 @@ void ExpSinusoidLambert::Evaluate(const Vector3& initialPosition,
         x1 = x2;    x2 = xnew;
         y1 = y2;    y2 = ynew;
 
-        error = abs(x1 - xnew);
+        error = fabs(x1 - xnew);
         iteration++;
     }
 
+    if (info != NULL)
+    {
+        info->iterations = iteration;
+        info->converged = (error <= MATH_TOLERANCE);
+        info->x = x;
+    }
+
     double a = aMin / (1.0 - x*x);
 
     double alpha, beta, sinpsi, sinhpsi, eta, eta2;
@@ -203,12 +546,12 @@ void ExpSinusoidLambert::Evaluate(const Vector3& initialPosition,
         eta     = sqrt(eta2);
     }
 
-    static Vector3 Ih, R2u;
+    Vector3 Ih, R2u;
     Ih = (longway / crossR1R2) * CrossR1R2; 
     R2u = R2;
     R2u.normalize();
 
-    static Vector3 CrossIhR1, CrossIhR2u;
+    Vector3 CrossIhR1, CrossIhR2u;
     Vector3::cross(Ih, R1, &CrossIhR1);
     Vector3::cross(Ih, R2u, &CrossIhR2u);
 
@@ -227,7 +570,7 @@ void ExpSinusoidLambert::Evaluate(const Vector3& initialPosition,
     *finalVelocity =   V * ((vr2 * R2u) + (vt2 * CrossIhR2u));
 }
 
-void ExpSinusoidLambert::CalculateTimeOfFlight(double x, double s, double c, int longway, double N, double* tof)
+void ExpSinusoidLambert::CalculateTimeOfFlight(double x, double s, double c, int longway, double N, double* tof) const
 {
     double a = 0.5*s / (1.0 - x*x);
     
@@ -246,61 +589,1407 @@ void ExpSinusoidLambert::CalculateTimeOfFlight(double x, double s, double c, int
     }
 }
 
-void BattinsLambert::Evaluate(const Vector3& initialPosition,
-                              const Vector3& finalPosition,
-                              double timeOfFlightDays,
-                              OrbitDirection orbitDirection,
-                              int numberRevolutions,
-                              Vector3* initialVelocity,
-                              Vector3* finalVelocity)
+// Time of flight of the exponential sinusoid in terms of x, written without
+// branches for the batch kernel. With E = 1 - x^2, w = sqrt(|E|) and
+// z = sqrt((s - c) / s) w, the angles of CalculateTimeOfFlight() combine into
+// the argument of (x + i w) (r - i longway z), r = sqrt(1 - z^2), for the
+// ellipse and into log((x + w) (r - longway z)), r = sqrt(1 + z^2), for the
+// hyperbola. Both are evaluated and the one matching the sign of E is kept,
+// so every lane runs the same instructions.
+static BATCH_INLINE double ExpSinusoidTimeOfFlight(double x, double s, double q, double longway, double N)
 {
+    const double E = 1.0 - x*x;
+    const bool ellipse = (E > 0.0);
+    const double sigma = ellipse ? 1.0 : -1.0;
+    const double w = BatchSqrt(fabs(E));
+    const double z = q * w;
+    const double r = BatchSqrt(fabs(1.0 - sigma*z*z));
+
+    // acos(x) - longway asin(z), in (-pi/2, 3pi/2)
+    double phi = BatchAtan2(w*r - longway*x*z, x*r + longway*w*z);
+    phi = (phi < -MATH_PI_OVER_2) ? phi + MATH_2_PI : phi;
+
+    // acosh(x) - longway asinh(z), with r - z written as 1 / (r + z)
+    const double rz = r + z;
+    const double logFactor = (longway > 0.0) ? 1.0 / rz : rz;
+    const double L = BatchLog((x + w) * logFactor);
+
+    const double a = 0.5*s / fabs(E);
+    const double angles = ellipse ? 2.0*phi + MATH_2_PI*N : -2.0*L;
+    return a*BatchSqrt(a) * (angles - sigma*(2.0*x*w - 2.0*longway*z*r));
 }
 
-void UniversalVarLambert::Evaluate(const Vector3& initialPosition,
-                                   const Vector3& finalPosition,
-                                   double timeOfFlightDays,
-                                   OrbitDirection orbitDirection,
-                                   int numberRevolutions,
-                                   Vector3* initialVelocity,
-                                   Vector3* finalVelocity)
+// Secant iteration state of the lanes of ExpSinusoidLambert::EvaluateBatch().
+// iteration starts at -2, the first two steps evaluate the starting points.
+struct ExpSinusoidLanes
 {
-    // Convert time of flight from days to seconds.
-    double tofSeconds = timeOfFlightDays * MATH_DAY_TO_SEC;
+    double s[LAMBERT_BATCH_WIDTH], q[LAMBERT_BATCH_WIDTH], longway[LAMBERT_BATCH_WIDTH];
+    double N[LAMBERT_BATCH_WIDTH], tof[LAMBERT_BATCH_WIDTH], logt[LAMBERT_BATCH_WIDTH];
+    double x1[LAMBERT_BATCH_WIDTH], x2[LAMBERT_BATCH_WIDTH];
+    double y1[LAMBERT_BATCH_WIDTH], y2[LAMBERT_BATCH_WIDTH];
+    double x[LAMBERT_BATCH_WIDTH], iteration[LAMBERT_BATCH_WIDTH];
+};
 
-     // Position vectors and magnitudes.
-    const Vector3& Ri = initialPosition;
-    const Vector3& Rf = finalPosition;
-    double r1 = Ri.length();
-    double r2 = Rf.length();
+static const double EXP_SINUSOID_INPUT1 = -0.5233;
+static const double EXP_SINUSOID_INPUT2 =  0.5233;
 
-    // Cross product of initial and final position.
-    static Vector3 C;
-    Vector3::cross(Ri, Rf, &C);
+// One secant step of every lane, the loop body of ExpSinusoidLambert::Solve().
+static void BATCH_KERNEL ExpSinusoidSecantStep(ExpSinusoidLanes* lanes)
+{
+    const double x1Start = log(1.0 + EXP_SINUSOID_INPUT1);
+    const double x2Start = log(1.0 + EXP_SINUSOID_INPUT2);
+
+    for (size_t i = 0; i < LAMBERT_BATCH_WIDTH; ++i)
+    {
+        const bool start1 = (lanes->iteration[i] == -2.0);
+        const bool start2 = (lanes->iteration[i] == -1.0);
+        const bool singleRev = (lanes->N[i] == 0.0);
+
+        const double secant = (lanes->x1[i]*lanes->y2[i] - lanes->y1[i]*lanes->x2[i]) / (lanes->y2[i] - lanes->y1[i]);
+        const double xnew = start1 ? x1Start : (start2 ? x2Start : secant);
+        const double xMapped = singleRev ? BatchExp(xnew) - 1.0 : 2.0 * MATH_1_OVER_PI * BatchAtan(xnew);
+        const double x = start1 ? EXP_SINUSOID_INPUT1 : (start2 ? EXP_SINUSOID_INPUT2 : xMapped);
+
+        const double t = ExpSinusoidTimeOfFlight(x, lanes->s[i], lanes->q[i], lanes->longway[i], lanes->N[i]);
+        const double yLog = BatchLog(t) - lanes->logt[i];
+        const double yIterate = singleRev ? yLog : t - lanes->tof[i];
+        const double ynew = (lanes->iteration[i] < 0.0) ? yLog : yIterate;
+
+        lanes->x[i] = x;
+        lanes->x1[i] = lanes->x2[i];  lanes->x2[i] = xnew;
+        lanes->y1[i] = lanes->y2[i];  lanes->y2[i] = ynew;
+        lanes->iteration[i] += 1.0;
+    }
+}
+
+// Problem geometry kept by a lane for the velocities once x has converged.
+// The half angle functions of the true anomaly come from the dot and cross
+// products directly, so that neither this nor the velocities need any of the
+// trigonometric functions of Solve().
+struct ExpSinusoidGeometry
+{
+    double R1[3], R2[3], C[3];
+    double V, r2, crossR1R2, sinHalfTheta, cosHalfTheta;
+};
+
+// Normalizes problem i of the batch as at the start of Solve() and loads it
+// into a lane.
+static void LoadExpSinusoidLane(const LambertBatch& batch, size_t i, size_t lane, ExpSinusoidLanes* lanes, ExpSinusoidGeometry* g)
+{
+    assert(batch.timeOfFlight[i] > 0.0);
+    assert(batch.orbitDirection[i] == ORBIT_DIR_PROGRADE || batch.orbitDirection[i] == ORBIT_DIR_RETROGRADE);
+
+    const double r1x = batch.initialPosition.x[i], r1y = batch.initialPosition.y[i], r1z = batch.initialPosition.z[i];
+    const double R = sqrt(r1x*r1x + r1y*r1y + r1z*r1z);
+    const double invR = 1.0 / R;
+    g->V = sqrt(invR);
+
+    g->R1[0] = r1x * invR;  g->R2[0] = batch.finalPosition.x[i] * invR;
+    g->R1[1] = r1y * invR;  g->R2[1] = batch.finalPosition.y[i] * invR;
+    g->R1[2] = r1z * invR;  g->R2[2] = batch.finalPosition.z[i] * invR;
+    g->r2 = sqrt(g->R2[0]*g->R2[0] + g->R2[1]*g->R2[1] + g->R2[2]*g->R2[2]);
+
+    g->C[0] = g->R1[1]*g->R2[2] - g->R1[2]*g->R2[1];
+    g->C[1] = g->R1[2]*g->R2[0] - g->R1[0]*g->R2[2];
+    g->C[2] = g->R1[0]*g->R2[1] - g->R1[1]*g->R2[0];
+    g->crossR1R2 = sqrt(g->C[0]*g->C[0] + g->C[1]*g->C[1] + g->C[2]*g->C[2]);
+
+    // Half of the transfer angle theta in [0, pi], then of 2 pi - theta
+    // when the direction of travel takes the long way round.
+    const double cosTheta = Clamp((g->R1[0]*g->R2[0] + g->R1[1]*g->R2[1] + g->R1[2]*g->R2[2]) / g->r2, -1.0, 1.0);
+    const double sinTheta = g->crossR1R2 / g->r2;
+    double cosHalf = sqrt(0.5 * (1.0 + cosTheta));
+    double sinHalf = sqrt(0.5 * (1.0 - cosTheta));
+    if (cosTheta >= 0.0)
+    {
+        sinHalf = 0.5 * sinTheta / cosHalf;
+    }
+    else
+    {
+        cosHalf = 0.5 * sinTheta / sinHalf;
+    }
+
+    const bool flip = (batch.orbitDirection[i] == ORBIT_DIR_PROGRADE) ? (g->C[2] <= 0.0) : (g->C[2] >= 0.0);
+    const double longway = (flip && cosTheta > -1.0) ? -1.0 : 1.0;
+    g->sinHalfTheta = sinHalf;
+    g->cosHalfTheta = longway * cosHalf;
+
+    const double c = sqrt(1.0 + g->r2*g->r2 - 2.0*g->r2*cosTheta);
+    const double s = 0.5*(1.0 + g->r2 + c);
+
+    lanes->s[lane]       = s;
+    lanes->q[lane]       = sqrt(Max(s - c, 0.0) / s);
+    lanes->longway[lane] = longway;
+    lanes->N[lane]       = batch.numberRevolutions[i];
+    lanes->tof[lane]     = batch.timeOfFlight[i] * g->V * invR;
+    lanes->logt[lane]    = BatchLog(lanes->tof[lane]);
+    lanes->iteration[lane] = -2.0;
+}
+
+// Velocities of problem i from the converged x of its lane, as at the end of
+// Solve(). sin(psi) and sinh(psi) are the imaginary part of the unit complex
+// number and half the difference of the exponential that give the angles in
+// ExpSinusoidTimeOfFlight().
+static void StoreExpSinusoidVelocities(const ExpSinusoidLanes& lanes, size_t lane, const ExpSinusoidGeometry& g, size_t i, LambertBatch* batch)
+{
+    const double x = lanes.x[lane];
+    const double s = lanes.s[lane];
+    const double longway = lanes.longway[lane];
+    const double aMin = 0.5*s;
+    const double lambda = sqrt(g.r2)*g.cosHalfTheta/s;
+
+    const double E = 1.0 - x*x;
+    const double a = aMin / E;
+    const double w = sqrt(fabs(E));
+    const double z = lanes.q[lane] * w;
+
+    double eta2;
+    if (E > 0.0) // ellipse
+    {
+        double sinpsi = w*sqrt(1.0 - z*z) - longway*x*z;
+        eta2 = 2.0 * a * sinpsi * sinpsi / s;
+    }
+    else // hyperbolic
+    {
+        double r = sqrt(1.0 + z*z);
+        double expPsi = (x + w) * ((longway > 0.0) ? 1.0 / (r + z) : r + z);
+        double sinhpsi = 0.5 * (expPsi - 1.0 / expPsi);
+        eta2 = -2.0 * a * sinhpsi * sinhpsi / s;
+    }
+    double eta = sqrt(eta2);
+
+    // Unit angular momentum and unit arrival position
+    double k = longway / g.crossR1R2;
+    double Ihx = k * g.C[0], Ihy = k * g.C[1], Ihz = k * g.C[2];
+    double invr2 = 1.0 / g.r2;
+    double R2ux = g.R2[0] * invr2, R2uy = g.R2[1] * invr2, R2uz = g.R2[2] * invr2;
+
+    // Radial and tangential departure and arrival velocity
+    double vr1 = (1.0 / eta / sqrt(aMin)) * ((2.0 * lambda * aMin) - lambda - (x * eta));
+    double vt1 = sqrt((g.r2 / aMin / eta2) * (g.sinHalfTheta * g.sinHalfTheta));
+    double vt2 = vt1 * invr2;
+    double vr2 = (vt1 - vt2) * g.cosHalfTheta / g.sinHalfTheta - vr1;
+
+    batch->initialVelocity.x[i] = g.V * (vr1 * g.R1[0] + vt1 * (Ihy*g.R1[2] - Ihz*g.R1[1]));
+    batch->initialVelocity.y[i] = g.V * (vr1 * g.R1[1] + vt1 * (Ihz*g.R1[0] - Ihx*g.R1[2]));
+    batch->initialVelocity.z[i] = g.V * (vr1 * g.R1[2] + vt1 * (Ihx*g.R1[1] - Ihy*g.R1[0]));
+    batch->finalVelocity.x[i]   = g.V * (vr2 * R2ux + vt2 * (Ihy*R2uz - Ihz*R2uy));
+    batch->finalVelocity.y[i]   = g.V * (vr2 * R2uy + vt2 * (Ihz*R2ux - Ihx*R2uz));
+    batch->finalVelocity.z[i]   = g.V * (vr2 * R2uz + vt2 * (Ihx*R2uy - Ihy*R2ux));
+}
+
+// Same algorithm as Solve(). A secant step costs the same for one lane as for
+// all of them, so rather than solving a block of problems in lockstep until
+// the slowest lane converges, each lane is retired as soon as its problem
+// converges and refilled with the next problem of the range. Lanes left idle
+// at the end of the range iterate a fixed well-conditioned problem.
+void ExpSinusoidLambert::EvaluateBatch(LambertBatch* batch, size_t begin, size_t end) const
+{
+    const size_t W = LAMBERT_BATCH_WIDTH;
+
+    ExpSinusoidLanes lanes;
+    ExpSinusoidGeometry geometry[W];
+    size_t problem[W];
+    size_t next = begin;
+    size_t numberActive = 0;
+
+    for (size_t lane = 0; lane < W; ++lane)
+    {
+        lanes.s[lane] = 1.0;  lanes.q[lane] = 0.5;  lanes.longway[lane] = 1.0;
+        lanes.N[lane] = 0.0;  lanes.tof[lane] = 1.0;  lanes.logt[lane] = 0.0;
+        lanes.iteration[lane] = -2.0;
 
-    // True anomaly
-    double trueAnomaly = acos(Ri.dot(Rf) / r1 / r2);
+        problem[lane] = end;
+        if (next < end)
+        {
+            problem[lane] = next++;
+            LoadExpSinusoidLane(*batch, problem[lane], lane, &lanes, &geometry[lane]);
+            numberActive++;
+        }
+    }
+
+    while (numberActive > 0)
+    {
+        ExpSinusoidSecantStep(&lanes);
+
+        for (size_t lane = 0; lane < W; ++lane)
+        {
+            if (problem[lane] == end)
+            {
+                lanes.iteration[lane] = -2.0;
+                continue;
+            }
+
+            // iteration counts the secant steps once both starting points are in
+            const double iteration = lanes.iteration[lane];
+            if (iteration < 1.0 || (fabs(lanes.x1[lane] - lanes.x2[lane]) > MATH_TOLERANCE && iteration < 60.0))
+            {
+                continue;
+            }
+
+            StoreExpSinusoidVelocities(lanes, lane, geometry[lane], problem[lane], batch);
+
+            if (next < end)
+            {
+                problem[lane] = next++;
+                LoadExpSinusoidLane(*batch, problem[lane], lane, &lanes, &geometry[lane]);
+            }
+            else
+            {
+                problem[lane] = end;
+                lanes.iteration[lane] = -2.0;
+                numberActive--;
+            }
+        }
+    }
+}
+
+// Iteration limit and relative time of flight tolerance of the iterative
+// solvers below.
+static const int LAMBERT_MAX_ITERATIONS = 60;
+static const double LAMBERT_TOLERANCE = 1.0e-12;
+
+/// Geometry of a Lambert problem in the Lancaster-Battin formulation.
+/// Reference: Izzo, "Revisiting Lambert's problem", CMDA 121 (2015).
+struct LagrangeGeometry
+{
+    double r1, r2;          /// Position magnitudes
+    double c, s;            /// Chord and semiperimeter
+    double transferAngle;   /// Transfer angle in the direction of motion (radians)
+    double lambda;          /// Geometry parameter, negative for transfers longer than pi
+    double T;               /// Non-dimensional time of flight
+    Vector3 ir1, ir2;       /// Radial unit vectors
+    Vector3 it1, it2;       /// Tangential unit vectors in the direction of motion
+};
+
+static void CalculateLagrangeGeometry(const Vector3& initialPosition,
+                                      const Vector3& finalPosition,
+                                      double timeOfFlight,
+                                      OrbitDirection orbitDirection,
+                                      LagrangeGeometry* geometry)
+{
+    double r1 = initialPosition.length();
+    double r2 = finalPosition.length();
+
+    Vector3 C;
+    Vector3::cross(initialPosition, finalPosition, &C);
+
+    double cosTheta = Clamp(initialPosition.dot(finalPosition) / (r1 * r2), -1.0, 1.0);
+    double theta = acos(cosTheta);
 
     // Direction of travel
     if (orbitDirection == ORBIT_DIR_PROGRADE && C.z <= 0.0)
     {
-        trueAnomaly = MATH_2_PI - trueAnomaly;
+        theta = MATH_2_PI - theta;
     }
     else if (orbitDirection == ORBIT_DIR_RETROGRADE && C.z >= 0.0)
     {
-        trueAnomaly = MATH_2_PI - trueAnomaly;
+        theta = MATH_2_PI - theta;
     }
+    bool longway = (theta > MATH_PI);
 
-    double A = sin(trueAnomaly) * sqrt(r1 * r2 / (1.0 - cos(trueAnomaly)));
-    
-    double z = -1.0;
+    // Unit angular momentum of the transfer
+    Vector3 ih = C;
+    ih.normalize();
+    if (longway)
+    {
+        ih *= -1.0;
+    }
+
+    geometry->r1 = r1;
+    geometry->r2 = r2;
+    geometry->c = sqrt(r1*r1 + r2*r2 - 2.0*r1*r2*cosTheta);
+    geometry->s = 0.5 * (r1 + r2 + geometry->c);
+    geometry->transferAngle = theta;
+    geometry->lambda = sqrt(Max(0.0, 1.0 - geometry->c / geometry->s));
+    if (longway)
+    {
+        geometry->lambda = -geometry->lambda;
+    }
+    geometry->T = sqrt(2.0 / (geometry->s * geometry->s * geometry->s)) * timeOfFlight;
+
+    geometry->ir1 = initialPosition;
+    geometry->ir1 *= 1.0 / r1;
+    geometry->ir2 = finalPosition;
+    geometry->ir2 *= 1.0 / r2;
+    Vector3::cross(ih, geometry->ir1, &geometry->it1);
+    Vector3::cross(ih, geometry->ir2, &geometry->it2);
 }
 
-void UniversalVarGpuLambert::Evaluate(const Vector3& initialPosition,
-                                      const Vector3& finalPosition,
-                                      double timeOfFlightDays,
-                                      OrbitDirection orbitDirection,
-                                      int numberRevolutions,
-                                      Vector3* initialVelocity,
-                                      Vector3* finalVelocity)
+/// Gauss hypergeometric function 2F1(3, 1, 5/2, z) used by Battin's series.
+static double HypergeometricF(double z, double tolerance)
+{
+    double Sj = 1.0;
+    double Cj = 1.0;
+    double error = 1.0;
+    for (int j = 0; error > tolerance && j < 1000; ++j)
+    {
+        Cj = Cj * (3.0 + j) * (1.0 + j) / (2.5 + j) * z / (j + 1.0);
+        Sj += Cj;
+        error = fabs(Cj);
+    }
+    return Sj;
+}
+
+/// Non-dimensional time of flight as a function of the Lancaster-Battin
+/// variable x. Uses Lagrange's equation away from x = 1, Battin's series
+/// very close to it and Lancaster's form elsewhere.
+static double LagrangeTimeOfFlight(double x, double lambda, int N)
+{
+    const double battin = 0.01;
+    const double lagrange = 0.2;
+    double dist = fabs(x - 1.0);
+
+    if (dist < lagrange && dist > battin)
+    {
+        double a = 1.0 / (1.0 - x*x);
+        if (a > 0.0) // ellipse
+        {
+            double alpha = 2.0 * acos(x);
+            double beta = 2.0 * asin(sqrt(lambda*lambda / a));
+            if (lambda < 0.0)
+            {
+                beta = -beta;
+            }
+            return 0.5 * a * sqrt(a) * ((alpha - sin(alpha)) - (beta - sin(beta)) + MATH_2_PI * N);
+        }
+        else // hyperbola
+        {
+            double alpha = 2.0 * acosh(x);
+            double beta = 2.0 * asinh(sqrt(-lambda*lambda / a));
+            if (lambda < 0.0)
+            {
+                beta = -beta;
+            }
+            return -0.5 * a * sqrt(-a) * ((beta - sinh(beta)) - (alpha - sinh(alpha)));
+        }
+    }
+
+    double E = x*x - 1.0;
+    double rho = fabs(E);
+    double z = sqrt(1.0 + lambda*lambda*E);
+
+    if (dist < battin)
+    {
+        double eta = z - lambda*x;
+        double S1 = 0.5 * (1.0 - lambda - x*eta);
+        double Q = 4.0 / 3.0 * HypergeometricF(S1, 1.0e-11);
+        return 0.5 * (eta*eta*eta*Q + 4.0*lambda*eta) + N * MATH_PI / pow(rho, 1.5);
+    }
+
+    double y = sqrt(rho);
+    double g = x*z - lambda*E;
+    double d;
+    if (E < 0.0)
+    {
+        d = N * MATH_PI + acos(Clamp(g, -1.0, 1.0));
+    }
+    else
+    {
+        double f = y * (z - lambda*x);
+        d = log(f + g);
+    }
+    return (x - lambda*z - d/y) / E;
+}
+
+/// First three derivatives of LagrangeTimeOfFlight() with respect to x.
+static void LagrangeTimeOfFlightDerivatives(double x, double T, double lambda, double* dT, double* ddT, double* dddT)
+{
+    double l2 = lambda*lambda;
+    double l3 = l2*lambda;
+    double umx2 = 1.0 - x*x;
+    double y = sqrt(1.0 - l2*umx2);
+    double y2 = y*y;
+    double y3 = y2*y;
+
+    *dT = (3.0*T*x - 2.0 + 2.0*l3*x/y) / umx2;
+    *ddT = (3.0*T + 5.0*x*(*dT) + 2.0*(1.0 - l2)*l3/y3) / umx2;
+    *dddT = (7.0*x*(*ddT) + 8.0*(*dT) - 6.0*(1.0 - l2)*l2*l3*x/y3/y2) / umx2;
+}
+
+/// Terminal velocities of the transfer defined by the Lancaster-Battin variable x.
+static void CalculateLagrangeVelocities(const LagrangeGeometry& geometry, double x, Vector3* initialVelocity, Vector3* finalVelocity)
 {
-}
\ No newline at end of file
+    double lambda = geometry.lambda;
+    double gamma = sqrt(0.5 * geometry.s);
+    double rho = (geometry.r1 - geometry.r2) / geometry.c;
+    double sigma = sqrt(Max(0.0, 1.0 - rho*rho));
+    double y = sqrt(1.0 - lambda*lambda + lambda*lambda*x*x);
+
+    double vr1 =  gamma * ((lambda*y - x) - rho*(lambda*y + x)) / geometry.r1;
+    double vr2 = -gamma * ((lambda*y - x) + rho*(lambda*y + x)) / geometry.r2;
+    double vt = gamma * sigma * (y + lambda*x);
+
+    *initialVelocity = (vr1 * geometry.ir1) + ((vt / geometry.r1) * geometry.it1);
+    *finalVelocity   = (vr2 * geometry.ir2) + ((vt / geometry.r2) * geometry.it2);
+}
+
+/// Minimum non-dimensional time of flight of an N revolution transfer and
+/// the x at which it occurs, found as the root of dT/dx with Halley
+/// iterations from the minimum energy point.
+static void FindMinimumTimeOfFlight(double lambda, int N, double* xMin, double* TMin, int* iterations)
+{
+    double dT, ddT, dddT;
+
+    *xMin = 0.0;
+    *TMin = LagrangeTimeOfFlight(*xMin, lambda, N);
+    for (int i = 0; i < 12; ++i)
+    {
+        (*iterations)++;
+        LagrangeTimeOfFlightDerivatives(*xMin, *TMin, lambda, &dT, &ddT, &dddT);
+        double step = dT * ddT / (ddT*ddT - 0.5*dT*dddT);
+        *xMin -= step;
+        *TMin = LagrangeTimeOfFlight(*xMin, lambda, N);
+        if (fabs(step) < 1.0e-13)
+        {
+            break;
+        }
+    }
+}
+
+/// Solves Lagrange's equation for the non-dimensional time of flight targetT
+/// with safeguarded Halley iterations from xi, on a bracket [lower, upper] over
+/// which the time of flight of an N revolution transfer decreases
+/// monotonically. Returns false if the iteration limit is reached first.
+static bool SolveLagrangeBracketed(double lambda, int N, double targetT, double lower, double upper, double xi, double* x, int* iterations)
+{
+    double dT, ddT, dddT;
+    xi = Clamp(xi, lower, upper);
+
+    for (int i = 0; i < LAMBERT_MAX_ITERATIONS; ++i)
+    {
+        (*iterations)++;
+        double T = LagrangeTimeOfFlight(xi, lambda, N);
+        double delta = T - targetT;
+        if (fabs(delta) <= LAMBERT_TOLERANCE * targetT)
+        {
+            *x = xi;
+            return true;
+        }
+
+        if (delta > 0.0)
+        {
+            lower = xi;
+        }
+        else
+        {
+            upper = xi;
+        }
+
+        LagrangeTimeOfFlightDerivatives(xi, T, lambda, &dT, &ddT, &dddT);
+        double xnew = xi - delta * dT / (dT*dT - 0.5*delta*ddT);
+        xi = (xnew > lower && xnew < upper) ? xnew : 0.5 * (lower + upper);
+    }
+
+    *x = xi;
+    return false;
+}
+
+/// Solves Lagrange's equation on the left branch of an N revolution transfer
+/// with safeguarded Halley iterations, starting from the initial guess if
+/// one is given. Returns false if the time of flight is below the minimum
+/// for N revolutions.
+static bool SolveLagrangeMultiRev(const LagrangeGeometry& geometry, int N, const double* initialGuess, double* x, int* iterations)
+{
+    const double lambda = geometry.lambda;
+
+    double xMin, TMin;
+    FindMinimumTimeOfFlight(lambda, N, &xMin, &TMin, iterations);
+
+    if (TMin > geometry.T)
+    {
+        return false;
+    }
+
+    // Left branch: T decreases monotonically from infinity at x = -1 to TMin.
+    double tmp = pow((N*MATH_PI + MATH_PI) / (8.0*geometry.T), 2.0/3.0);
+    double xi = (initialGuess != NULL) ? *initialGuess : (tmp - 1.0) / (tmp + 1.0);
+
+    return SolveLagrangeBracketed(lambda, N, geometry.T, -1.0, xMin, xi, x, iterations);
+}
+
+/// Battin's shape function xi(x) evaluated with its continued fraction.
+static double BattinXi(double x)
+{
+    double sqrt1x = sqrt(1.0 + x);
+    double eta = x / SQR(sqrt1x + 1.0);
+
+    double tail = 0.0;
+    for (int n = 30; n >= 4; --n)
+    {
+        double cn = (double)(n*n) / (4.0*n*n - 1.0);
+        tail = cn * eta / (1.0 + tail);
+    }
+    double denominator = 5.0 + eta + (9.0/7.0) * eta / (1.0 + tail);
+
+    return 8.0 * (sqrt1x + 1.0) / (3.0 + 1.0 / denominator);
+}
+
+/// Battin's K(u) function evaluated with its continued fraction.
+static double BattinK(double u)
+{
+    double tail = 0.0;
+    for (int k = 30; k >= 1; --k)
+    {
+        double gamma;
+        if (k == 1)
+        {
+            gamma = 4.0 / 27.0;
+        }
+        else if (k % 2 == 0)
+        {
+            int n = k / 2;
+            gamma = 2.0 * (3*n + 1) * (6*n - 1) / (9.0 * (4*n - 1) * (4*n + 1));
+        }
+        else
+        {
+            int n = (k - 1) / 2;
+            gamma = 2.0 * (3*n + 2) * (6*n + 1) / (9.0 * (4*n + 1) * (4*n + 3));
+        }
+        tail = gamma * u / (1.0 + tail);
+    }
+
+    return (1.0 / 3.0) / (1.0 + tail);
+}
+
+void BattinsLambert::Evaluate(const Vector3& initialPosition,
+                              const Vector3& finalPosition,
+                              double timeOfFlight,
+                              OrbitDirection orbitDirection,
+                              int numberRevolutions,
+                              Vector3* initialVelocity,
+                              Vector3* finalVelocity,
+                              LambertInfo* info) const
+{
+    Solve(initialPosition, finalPosition, timeOfFlight, orbitDirection, numberRevolutions, NULL, initialVelocity, finalVelocity, info);
+}
+
+void BattinsLambert::EvaluateWarmStart(const Vector3& initialPosition,
+                                       const Vector3& finalPosition,
+                                       double timeOfFlight,
+                                       OrbitDirection orbitDirection,
+                                       int numberRevolutions,
+                                       double initialGuess,
+                                       Vector3* initialVelocity,
+                                       Vector3* finalVelocity,
+                                       LambertInfo* info) const
+{
+    Solve(initialPosition, finalPosition, timeOfFlight, orbitDirection, numberRevolutions, &initialGuess, initialVelocity, finalVelocity, info);
+}
+
+void BattinsLambert::Solve(const Vector3& initialPosition,
+                           const Vector3& finalPosition,
+                           double timeOfFlight,
+                           OrbitDirection orbitDirection,
+                           int numberRevolutions,
+                           const double* initialGuess,
+                           Vector3* initialVelocity,
+                           Vector3* finalVelocity,
+                           LambertInfo* info) const
+{
+    assert(timeOfFlight > 0.0);
+    assert(orbitDirection == ORBIT_DIR_PROGRADE || orbitDirection == ORBIT_DIR_RETROGRADE);
+    assert(numberRevolutions >= 0);
+
+    LagrangeGeometry geometry;
+    CalculateLagrangeGeometry(initialPosition, finalPosition, timeOfFlight, orbitDirection, &geometry);
+
+    int iterations = 0;
+    bool converged = false;
+    double xL = 0.0; // Lancaster-Battin variable of the solution
+    double x = 0.0;  // Battin's variable of the solution
+
+    if (numberRevolutions > 0)
+    {
+        converged = SolveLagrangeMultiRev(geometry, numberRevolutions, initialGuess, &xL, &iterations);
+    }
+    else
+    {
+        const double r1 = geometry.r1;
+        const double r2 = geometry.r2;
+        const double theta = geometry.transferAngle;
+
+        double ratio = r2 / r1;
+        double epsilon = (r2 - r1) / r1;
+        double tan2w = 0.25 * epsilon * epsilon / (sqrt(ratio) + ratio * (2.0 + sqrt(ratio)));
+        double cosQuarter2 = SQR(cos(0.25 * theta));
+        double sinQuarter2 = SQR(sin(0.25 * theta));
+        double rop = sqrt(r1 * r2) * (cosQuarter2 + tan2w);
+
+        double l;
+        if (theta < MATH_PI)
+        {
+            l = (sinQuarter2 + tan2w) / (sinQuarter2 + tan2w + cos(0.5 * theta));
+        }
+        else
+        {
+            l = (cosQuarter2 + tan2w - cos(0.5 * theta)) / (cosQuarter2 + tan2w);
+        }
+
+        double m = timeOfFlight * timeOfFlight / (8.0 * rop * rop * rop);
+
+        // Successive substitution on Battin's x and y variables
+        x = (initialGuess != NULL && *initialGuess > -1.0) ? *initialGuess : l;
+        double y = 1.0;
+        while (iterations < LAMBERT_MAX_ITERATIONS)
+        {
+            iterations++;
+            double xi = BattinXi(x);
+            double denominator = (1.0 + 2.0*x + l) * (4.0*x + xi*(3.0 + x));
+            double h1 = SQR(l + x) * (1.0 + 3.0*x + xi) / denominator;
+            double h2 = m * (x - l + xi) / denominator;
+
+            double B = 27.0 * h2 / (4.0 * (1.0 + h1) * (1.0 + h1) * (1.0 + h1));
+            double U = B / (2.0 * (sqrt(1.0 + B) + 1.0));
+            double K = BattinK(U);
+            y = (1.0 + h1) / 3.0 * (2.0 + sqrt(1.0 + B) / (1.0 + 2.0*U*K*K));
+
+            double xnew = sqrt(SQR(0.5 * (1.0 - l)) + m / (y*y)) - 0.5 * (1.0 + l);
+            double error = fabs(xnew - x);
+            x = xnew;
+            if (error < 1.0e-13 * Max(1.0, x))
+            {
+                converged = true;
+                break;
+            }
+        }
+
+        // Semimajor axis of the transfer, mapped onto the Lancaster-Battin
+        // variable. Its sign follows from the minimum energy time of flight.
+        double a = timeOfFlight * timeOfFlight / (16.0 * rop * rop * x * y * y);
+        double aMin = 0.5 * geometry.s;
+        xL = sqrt(Max(0.0, 1.0 - aMin / a));
+        if (a > 0.0 && geometry.T > LagrangeTimeOfFlight(0.0, geometry.lambda, 0))
+        {
+            xL = -xL;
+        }
+
+        if (converged)
+        {
+            // The mapping loses precision near the minimum energy transfer,
+            // restore it with Newton steps on Lagrange's equation.
+            for (int i = 0; i < 2; ++i)
+            {
+                double T = LagrangeTimeOfFlight(xL, geometry.lambda, 0);
+                double dT, ddT, dddT;
+                LagrangeTimeOfFlightDerivatives(xL, T, geometry.lambda, &dT, &ddT, &dddT);
+                xL -= (T - geometry.T) / dT;
+            }
+        }
+        else
+        {
+            // The substitution stalls on some long way transfers close to a
+            // full revolution. Fall back to Lagrange's equation, bracketed
+            // between x = -1, where the time of flight is infinite, and a
+            // point found by doubling where it is below the target.
+            double upper = Max(xL, 0.0) + 1.0;
+            double lower = -1.0;
+            while (LagrangeTimeOfFlight(upper, geometry.lambda, 0) > geometry.T)
+            {
+                iterations++;
+                lower = upper;
+                upper *= 2.0;
+            }
+            converged = SolveLagrangeBracketed(geometry.lambda, 0, geometry.T, lower, upper, xL, &xL, &iterations);
+        }
+    }
+
+    CalculateLagrangeVelocities(geometry, xL, initialVelocity, finalVelocity);
+
+    if (info != NULL)
+    {
+        info->iterations = iterations;
+        info->converged = converged;
+        info->x = (numberRevolutions > 0) ? xL : x;
+    }
+}
+
+// Width of the universal variable bracket, relative to psi, below which it
+// is considered closed.
+static const double UNIVERSAL_BRACKET_TOLERANCE = 4.0 * std::numeric_limits<double>::epsilon();
+
+/// Universal variable time of flight and its derivative with respect to psi
+/// (Curtis eqs. 5.40 and 5.43, mu = 1). Returns false if y(psi) is negative,
+/// i.e. psi lies below the physically meaningful range.
+static bool UniversalTimeOfFlight(double psi, double r1, double r2, double A, double* y, double* t, double* dtdpsi)
+{
+    double c2, c3;
+    CalculateStumpffFunctions(psi, &c2, &c3);
+
+    *y = r1 + r2 + A * (psi*c3 - 1.0) / sqrt(c2);
+    if (*y < 0.0)
+    {
+        return false;
+    }
+
+    double sqrtY = sqrt(*y);
+    double chi = sqrt(*y / c2);
+    double chi3 = chi*chi*chi;
+    *t = chi3*c3 + A*sqrtY;
+
+    if (fabs(psi) > 1.0e-6)
+    {
+        *dtdpsi = chi3 * ((c2 - 1.5*c3/c2) / (2.0*psi) + 0.75*c3*c3/c2) +
+                  0.125 * A * (3.0*c3*sqrtY/c2 + A*sqrt(c2 / *y));
+    }
+    else
+    {
+        *dtdpsi = sqrt(2.0) / 40.0 * (*y)*sqrtY + 0.125 * A * (sqrtY + A*sqrt(0.5 / *y));
+    }
+    return true;
+}
+
+/// Position magnitudes and the coefficient A of the universal variable
+/// formulation (Curtis eq. 5.35), sin(theta) sqrt(r1 r2 / (1 - cos(theta))).
+/// It is evaluated as sqrt(r1 r2 (1 + cos(theta))), negative for the long
+/// way round, with 1 + cos(theta) taken from the sine of the cross product
+/// where the cosine is close to -1.
+static double UniversalVariableA(const Vector3& initialPosition,
+                                 const Vector3& finalPosition,
+                                 OrbitDirection orbitDirection,
+                                 double* r1, double* r2)
+{
+    *r1 = initialPosition.length();
+    *r2 = finalPosition.length();
+
+    Vector3 C;
+    Vector3::cross(initialPosition, finalPosition, &C);
+    bool longway = (orbitDirection == ORBIT_DIR_PROGRADE) ? (C.z <= 0.0) : (C.z >= 0.0);
+
+    double r1r2 = *r1 * *r2;
+    double cosTheta = Clamp(initialPosition.dot(finalPosition) / r1r2, -1.0, 1.0);
+    double rootOnePlusCos;
+    if (cosTheta >= 0.0)
+    {
+        rootOnePlusCos = sqrt(1.0 + cosTheta);
+    }
+    else
+    {
+        rootOnePlusCos = C.length() / r1r2 / sqrt(1.0 - cosTheta);
+    }
+
+    double A = sqrt(r1r2) * rootOnePlusCos;
+    return longway ? -A : A;
+}
+
+/// Brackets the universal variable solution on [lower, upper], on which the
+/// time of flight increases with psi, and picks the first Newton iterate.
+/// For multi-revolution transfers the minimum time of flight is located
+/// first with safeguarded Newton iterations on dt/dpsi, the second derivative
+/// taken by a forward difference. If the time of flight is below that
+/// minimum no solution exists and the iteration count is set to the limit.
+static void BracketUniversalVariable(double r1, double r2, double A,
+                                     double timeOfFlight,
+                                     int numberRevolutions,
+                                     double* lower, double* upper, double* psi,
+                                     double* y, int* iterations)
+{
+    double t, dtdpsi;
+
+    if (numberRevolutions == 0)
+    {
+        // Time of flight grows monotonically from the hyperbolic limit up to
+        // the one revolution singularity at 4 pi^2.
+        *lower = -4.0 * MATH_PI * MATH_PI;
+        *upper =  4.0 * MATH_PI * MATH_PI;
+        while (*iterations < LAMBERT_MAX_ITERATIONS &&
+               UniversalTimeOfFlight(*lower, r1, r2, A, y, &t, &dtdpsi) && t > timeOfFlight)
+        {
+            (*iterations)++;
+            *upper = *lower;
+            *lower *= 2.0;
+        }
+        *psi = (*lower < 0.0 && *upper > 0.0) ? 0.0 : 0.5 * (*lower + *upper);
+    }
+    else
+    {
+        // Time of flight is infinite at both ends of the interval.
+        *lower = SQR(MATH_2_PI * numberRevolutions);
+        *upper = SQR(MATH_2_PI * (numberRevolutions + 1));
+
+        double a = *lower, b = *upper;
+        double h = 1.0e-7 * (*upper - *lower);
+        double psiMin = 0.5 * (a + b);
+        while (*iterations < LAMBERT_MAX_ITERATIONS)
+        {
+            (*iterations)++;
+            double d1, d2;
+            UniversalTimeOfFlight(psiMin, r1, r2, A, y, &t, &d1);
+            UniversalTimeOfFlight(psiMin + h, r1, r2, A, y, &t, &d2);
+
+            if (d1 < 0.0)
+            {
+                a = psiMin;
+            }
+            else
+            {
+                b = psiMin;
+            }
+
+            double second = (d2 - d1) / h;
+            double psiNew = psiMin - d1 / second;
+            psiNew = (second > 0.0 && psiNew > a && psiNew < b) ? psiNew : 0.5 * (a + b);
+            double step = fabs(psiNew - psiMin);
+            psiMin = psiNew;
+            if (step < 1.0e-10 * (*upper - *lower))
+            {
+                break;
+            }
+        }
+
+        // Left branch of the transfer lies above the minimum in psi.
+        UniversalTimeOfFlight(psiMin, r1, r2, A, y, &t, &dtdpsi);
+        *lower = psiMin;
+        *psi = 0.5 * (psiMin + *upper);
+        if (t > timeOfFlight)
+        {
+            *iterations = LAMBERT_MAX_ITERATIONS;
+        }
+    }
+}
+
+void UniversalVarLambert::Evaluate(const Vector3& initialPosition,
+                                   const Vector3& finalPosition,
+                                   double timeOfFlight,
+                                   OrbitDirection orbitDirection,
+                                   int numberRevolutions,
+                                   Vector3* initialVelocity,
+                                   Vector3* finalVelocity,
+                                   LambertInfo* info) const
+{
+    Solve(initialPosition, finalPosition, timeOfFlight, orbitDirection, numberRevolutions, NULL, initialVelocity, finalVelocity, info);
+}
+
+void UniversalVarLambert::EvaluateWarmStart(const Vector3& initialPosition,
+                                            const Vector3& finalPosition,
+                                            double timeOfFlight,
+                                            OrbitDirection orbitDirection,
+                                            int numberRevolutions,
+                                            double initialGuess,
+                                            Vector3* initialVelocity,
+                                            Vector3* finalVelocity,
+                                            LambertInfo* info) const
+{
+    Solve(initialPosition, finalPosition, timeOfFlight, orbitDirection, numberRevolutions, &initialGuess, initialVelocity, finalVelocity, info);
+}
+
+void UniversalVarLambert::Solve(const Vector3& initialPosition,
+                                const Vector3& finalPosition,
+                                double timeOfFlight,
+                                OrbitDirection orbitDirection,
+                                int numberRevolutions,
+                                const double* initialGuess,
+                                Vector3* initialVelocity,
+                                Vector3* finalVelocity,
+                                LambertInfo* info) const
+{
+    assert(timeOfFlight > 0.0);
+    assert(orbitDirection == ORBIT_DIR_PROGRADE || orbitDirection == ORBIT_DIR_RETROGRADE);
+    assert(numberRevolutions >= 0);
+
+    double r1, r2;
+    const double A = UniversalVariableA(initialPosition, finalPosition, orbitDirection, &r1, &r2);
+
+    int iterations = 0;
+    bool converged = false;
+    double y = 0.0, t, dtdpsi;
+    double lower, upper, psi;
+    BracketUniversalVariable(r1, r2, A, timeOfFlight, numberRevolutions, &lower, &upper, &psi, &y, &iterations);
+    if (initialGuess != NULL && *initialGuess > lower && *initialGuess < upper)
+    {
+        psi = *initialGuess;
+    }
+
+    // Safeguarded Newton iteration, time of flight increases with psi on [lower, upper].
+    while (iterations < LAMBERT_MAX_ITERATIONS)
+    {
+        iterations++;
+        if (!UniversalTimeOfFlight(psi, r1, r2, A, &y, &t, &dtdpsi))
+        {
+            lower = psi;
+            psi = 0.5 * (lower + upper);
+            continue;
+        }
+
+        double F = t - timeOfFlight;
+        if (fabs(F) <= LAMBERT_TOLERANCE * timeOfFlight)
+        {
+            converged = true;
+            break;
+        }
+
+        if (F < 0.0)
+        {
+            lower = psi;
+        }
+        else
+        {
+            upper = psi;
+        }
+
+        // Close to the revolution singularities the time of flight loses
+        // digits to cancellation in y(psi) and |F| can level off above the
+        // tolerance. Accept psi once the bracket has closed around it.
+        if (upper - lower <= UNIVERSAL_BRACKET_TOLERANCE * Max(1.0, fabs(psi)))
+        {
+            converged = true;
+            break;
+        }
+
+        double psiNew = psi - F / dtdpsi;
+        psi = (dtdpsi > 0.0 && psiNew > lower && psiNew < upper) ? psiNew : 0.5 * (lower + upper);
+    }
+
+    // Lagrange coefficients
+    double f = 1.0 - y / r1;
+    double g = A * sqrt(y);
+    double gdot = 1.0 - y / r2;
+
+    *initialVelocity = (1.0 / g) * (finalPosition - f * initialPosition);
+    *finalVelocity = (1.0 / g) * (gdot * finalPosition - initialPosition);
+
+    if (info != NULL)
+    {
+        info->iterations = iterations;
+        info->converged = converged;
+        info->x = psi;
+    }
+}
+
+// CalculateStumpffFunctions() for the batch kernels. The elliptic and
+// hyperbolic closed forms and the series near zero are all evaluated and the
+// one for the sign of psi kept, with sin(sqrt(psi)) and sinh(sqrt(-psi))
+// formed from the functions of the half angle.
+static BATCH_INLINE void BatchStumpffFunctions(double psi, double* c2, double* c3)
+{
+    const double s = BatchSqrt(fabs(psi));
+    double sinHalf, cosHalf;
+    BatchSinCos(0.5*s, &sinHalf, &cosHalf);
+    const double expHalf = BatchExp(0.5*s);
+    const double sinhHalf = 0.5*(expHalf - 1.0/expHalf);
+    const double coshHalf = 0.5*(expHalf + 1.0/expHalf);
+
+    const double c2Ellipse = 2.0*sinHalf*sinHalf / psi;
+    const double c3Ellipse = (s - 2.0*sinHalf*cosHalf) / (s*psi);
+    const double c2Hyperbola = -2.0*sinhHalf*sinhHalf / psi;
+    const double c3Hyperbola = (2.0*sinhHalf*coshHalf - s) / (-s*psi);
+    const double c2Series = (1.0/2.0)*(1.0 - psi/12.0*(1.0 - psi/30.0*(1.0 - psi/56.0*(1.0 - psi/90.0*(1.0 - psi/132.0)))));
+    const double c3Series = (1.0/6.0)*(1.0 - psi/20.0*(1.0 - psi/42.0*(1.0 - psi/72.0*(1.0 - psi/110.0*(1.0 - psi/156.0)))));
+
+    *c2 = (psi > 0.1) ? c2Ellipse : ((psi < -0.1) ? c2Hyperbola : c2Series);
+    *c3 = (psi > 0.1) ? c3Ellipse : ((psi < -0.1) ? c3Hyperbola : c3Series);
+}
+
+// Iteration state of the lanes of UniversalVarBulkLambert::EvaluateBatch().
+// A lane with bracketing set is still extending the lower end of the bracket
+// of a single revolution problem, see BracketUniversalVariable().
+struct UniversalVarLanes
+{
+    double r1[LAMBERT_BATCH_WIDTH], r2[LAMBERT_BATCH_WIDTH], A[LAMBERT_BATCH_WIDTH], tof[LAMBERT_BATCH_WIDTH];
+    double lower[LAMBERT_BATCH_WIDTH], upper[LAMBERT_BATCH_WIDTH], psi[LAMBERT_BATCH_WIDTH], y[LAMBERT_BATCH_WIDTH];
+    double iteration[LAMBERT_BATCH_WIDTH], bracketing[LAMBERT_BATCH_WIDTH], done[LAMBERT_BATCH_WIDTH];
+};
+
+// One step of every lane: a doubling of the bracket or an iteration of the
+// safeguarded Newton loop of UniversalVarLambert::Solve(), with
+// UniversalTimeOfFlight() evaluated without branches.
+static void BATCH_KERNEL UniversalVarNewtonStep(UniversalVarLanes* lanes)
+{
+    for (size_t i = 0; i < LAMBERT_BATCH_WIDTH; ++i)
+    {
+        const double psi = lanes->psi[i];
+        const double r1 = lanes->r1[i], r2 = lanes->r2[i], A = lanes->A[i];
+        const double tof = lanes->tof[i];
+        double lower = lanes->lower[i], upper = lanes->upper[i];
+
+        double c2, c3;
+        BatchStumpffFunctions(psi, &c2, &c3);
+        // The roots of y / c2, c2 / y and 1 / (2 y) are formed from those of
+        // c2 and y. Where y(psi) < 0 their arguments would be negative or
+        // infinite, for which the first estimate of BatchSqrt() is subnormal
+        // and costs a microcode assist on every such lane.
+        const double sqrtC2 = BatchSqrt(c2);
+        const double y = r1 + r2 + A * (psi*c3 - 1.0) / sqrtC2;
+        const double yValid = (y >= 0.0) ? y : 0.0;
+        const double sqrtY = BatchSqrt(yValid);
+        const double chi = sqrtY / sqrtC2;
+        const double chi3 = chi*chi*chi;
+        const double t = chi3*c3 + A*sqrtY;
+        const double dtdpsiClosed = chi3 * ((c2 - 1.5*c3/c2) / (2.0*psi) + 0.75*c3*c3/c2) +
+                                    0.125 * A * (3.0*c3*sqrtY/c2 + A*sqrtC2/sqrtY);
+        const double dtdpsiSeries = sqrt(2.0) / 40.0 * yValid*sqrtY + 0.125 * A * (sqrtY + A/(sqrt(2.0)*sqrtY));
+        const double dtdpsi = (fabs(psi) > 1.0e-6) ? dtdpsiClosed : dtdpsiSeries;
+
+        // The flags are doubles combined with selects, which the vectorizer
+        // turns into masks where it would branch on && and ||.
+        // Bracketing: psi is the lower end, moved down while the time of
+        // flight there is too long (t is zero if y(psi) < 0).
+        const double bracketing = lanes->bracketing[i];
+        const double extend = (t > tof) ? bracketing : 0.0;
+        const double lowerExtended = (extend != 0.0) ? 2.0*lower : lower;
+        const double upperExtended = (extend != 0.0) ? lower : upper;
+        const double psiStart = (lowerExtended*upperExtended < 0.0) ? 0.0 : 0.5*(lowerExtended + upperExtended);
+
+        // Newton: below the valid range psi is treated as too short a transfer
+        const double F = (y >= 0.0) ? t - tof : -1.0;
+        const double lowerNewton = (F < 0.0) ? psi : lower;
+        const double upperNewton = (F < 0.0) ? upper : psi;
+        const double psiScale = (fabs(psi) > 1.0) ? fabs(psi) : 1.0;
+        const double closed = (upperNewton - lowerNewton <= UNIVERSAL_BRACKET_TOLERANCE * psiScale) ? 1.0 : 0.0;
+        const double finished = (fabs(F) <= LAMBERT_TOLERANCE * tof) ? 1.0 : ((y >= 0.0) ? closed : 0.0);
+        const double bisection = 0.5*(lowerNewton + upperNewton);
+        const double psiNewton = (y >= 0.0) ? ((dtdpsi > 0.0) ? psi - F / dtdpsi : bisection) : bisection;
+        const double psiNext = (psiNewton > lowerNewton) ? ((psiNewton < upperNewton) ? psiNewton : bisection) : bisection;
+
+        lanes->lower[i] = (bracketing != 0.0) ? lowerExtended : ((finished != 0.0) ? lower : lowerNewton);
+        lanes->upper[i] = (bracketing != 0.0) ? upperExtended : ((finished != 0.0) ? upper : upperNewton);
+        lanes->psi[i] = (bracketing != 0.0) ? ((extend != 0.0) ? lowerExtended : psiStart) : ((finished != 0.0) ? psi : psiNext);
+        lanes->y[i] = y;
+        lanes->iteration[i] += (bracketing != 0.0) ? extend : 1.0;
+        lanes->bracketing[i] = extend;
+        lanes->done[i] = (bracketing != 0.0) ? 0.0 : finished;
+    }
+}
+
+// Sets up problem i of the batch as at the start of UniversalVarLambert::Solve()
+// and loads it into a lane. Multi-revolution problems are bracketed here, the
+// bracket of a single revolution problem is extended by the lane itself.
+static void LoadUniversalVarLane(const LambertBatch& batch, size_t i, size_t lane, UniversalVarLanes* lanes)
+{
+    assert(batch.timeOfFlight[i] > 0.0);
+    assert(batch.orbitDirection[i] == ORBIT_DIR_PROGRADE || batch.orbitDirection[i] == ORBIT_DIR_RETROGRADE);
+    assert(batch.numberRevolutions[i] >= 0);
+
+    Vector3 initialPosition, finalPosition;
+    batch.initialPosition.Get(i, &initialPosition);
+    batch.finalPosition.Get(i, &finalPosition);
+
+    double r1, r2;
+    const double A = UniversalVariableA(initialPosition, finalPosition, batch.orbitDirection[i], &r1, &r2);
+
+    lanes->r1[lane] = r1;
+    lanes->r2[lane] = r2;
+    lanes->A[lane] = A;
+    lanes->tof[lane] = batch.timeOfFlight[i];
+    lanes->y[lane] = 0.0;
+    lanes->done[lane] = 0.0;
+
+    if (batch.numberRevolutions[i] == 0)
+    {
+        lanes->lower[lane] = -4.0 * MATH_PI * MATH_PI;
+        lanes->upper[lane] =  4.0 * MATH_PI * MATH_PI;
+        lanes->psi[lane] = lanes->lower[lane];
+        lanes->iteration[lane] = 0.0;
+        lanes->bracketing[lane] = 1.0;
+    }
+    else
+    {
+        int iterations = 0;
+        BracketUniversalVariable(r1, r2, A, batch.timeOfFlight[i], batch.numberRevolutions[i],
+                                 &lanes->lower[lane], &lanes->upper[lane], &lanes->psi[lane],
+                                 &lanes->y[lane], &iterations);
+        lanes->iteration[lane] = iterations;
+        lanes->bracketing[lane] = 0.0;
+    }
+}
+
+// Velocities of problem i from the Lagrange coefficients of its lane, as at
+// the end of UniversalVarLambert::Solve().
+static void StoreUniversalVarVelocities(const UniversalVarLanes& lanes, size_t lane, size_t i, LambertBatch* batch)
+{
+    const double y = lanes.y[lane];
+    const double f = 1.0 - y / lanes.r1[lane];
+    const double invg = 1.0 / (lanes.A[lane] * sqrt(y));
+    const double gdot = 1.0 - y / lanes.r2[lane];
+
+    const double r1x = batch->initialPosition.x[i], r1y = batch->initialPosition.y[i], r1z = batch->initialPosition.z[i];
+    const double r2x = batch->finalPosition.x[i], r2y = batch->finalPosition.y[i], r2z = batch->finalPosition.z[i];
+
+    batch->initialVelocity.x[i] = invg * (r2x - f * r1x);
+    batch->initialVelocity.y[i] = invg * (r2y - f * r1y);
+    batch->initialVelocity.z[i] = invg * (r2z - f * r1z);
+    batch->finalVelocity.x[i] = invg * (gdot * r2x - r1x);
+    batch->finalVelocity.y[i] = invg * (gdot * r2y - r1y);
+    batch->finalVelocity.z[i] = invg * (gdot * r2z - r1z);
+}
+
+// Same algorithm as UniversalVarLambert::Solve(), with the lanes retired as
+// soon as their problem converges and refilled with the next problem of the
+// range, as in ExpSinusoidLambert::EvaluateBatch(). Lanes left idle at the
+// end of the range iterate a fixed well-conditioned problem.
+void UniversalVarBulkLambert::EvaluateBatch(LambertBatch* batch, size_t begin, size_t end) const
+{
+    const size_t W = LAMBERT_BATCH_WIDTH;
+
+    UniversalVarLanes lanes;
+    size_t problem[W];
+    size_t next = begin;
+    size_t numberActive = 0;
+
+    for (size_t lane = 0; lane < W; ++lane)
+    {
+        problem[lane] = end;
+        lanes.r1[lane] = 1.0;  lanes.r2[lane] = 1.0;  lanes.A[lane] = 1.0;  lanes.tof[lane] = 1.0;
+        lanes.lower[lane] = -4.0 * MATH_PI * MATH_PI;  lanes.upper[lane] = 4.0 * MATH_PI * MATH_PI;
+        lanes.psi[lane] = 0.0;  lanes.y[lane] = 1.0;
+        lanes.iteration[lane] = 0.0;  lanes.bracketing[lane] = 0.0;  lanes.done[lane] = 0.0;
+    }
+
+    for (;;)
+    {
+        // Refill the free lanes. Problems without a solution leave the
+        // bracketing with the iteration limit reached and are stored at once.
+        for (size_t lane = 0; lane < W; ++lane)
+        {
+            while (problem[lane] == end && next < end)
+            {
+                LoadUniversalVarLane(*batch, next, lane, &lanes);
+                if (lanes.iteration[lane] < LAMBERT_MAX_ITERATIONS)
+                {
+                    problem[lane] = next;
+                    numberActive++;
+                }
+                else
+                {
+                    StoreUniversalVarVelocities(lanes, lane, next, batch);
+                }
+                next++;
+            }
+        }
+
+        if (numberActive == 0)
+        {
+            break;
+        }
+
+        UniversalVarNewtonStep(&lanes);
+
+        for (size_t lane = 0; lane < W; ++lane)
+        {
+            if (problem[lane] == end)
+            {
+                lanes.psi[lane] = 0.0;
+                lanes.iteration[lane] = 0.0;
+                lanes.bracketing[lane] = 0.0;
+                continue;
+            }
+
+            if (lanes.done[lane] != 0.0 || lanes.iteration[lane] >= LAMBERT_MAX_ITERATIONS)
+            {
+                StoreUniversalVarVelocities(lanes, lane, problem[lane], batch);
+                problem[lane] = end;
+                numberActive--;
+            }
+        }
+    }
+}
+
+// Iteration limit of the Householder solver. Izzo's initial guesses put x
+// within the cubic convergence region, so two or three iterations suffice
+// and the bound is only reached on failure. The tolerances apply to the last
+// step in x; with cubic convergence the remaining error is of the order of
+// its cube. The multi-revolution time of flight curve is flatter near the
+// solution, so its tolerance is tighter (Izzo's choice of values).
+static const int IZZO_MAX_ITERATIONS = 15;
+static const double IZZO_TOLERANCE = 1.0e-5;
+static const double IZZO_TOLERANCE_MULTI_REV = 1.0e-8;
+
+/// Householder (third order) iterations on Lagrange's equation from the
+/// initial guess in x. Returns false if the step did not fall below the
+/// tolerance within the iteration limit.
+static bool SolveLagrangeHouseholder(double lambda, double T, int N, double* x, int* iterations)
+{
+    const double tolerance = (N == 0) ? IZZO_TOLERANCE : IZZO_TOLERANCE_MULTI_REV;
+    double dT, ddT, dddT;
+    for (int i = 0; i < IZZO_MAX_ITERATIONS; ++i)
+    {
+        (*iterations)++;
+        double tof = LagrangeTimeOfFlight(*x, lambda, N);
+        LagrangeTimeOfFlightDerivatives(*x, tof, lambda, &dT, &ddT, &dddT);
+
+        double delta = tof - T;
+        double dT2 = dT*dT;
+        double xnew = *x - delta * (dT2 - 0.5*delta*ddT) / (dT * (dT2 - delta*ddT) + dddT*delta*delta / 6.0);
+        double step = fabs(xnew - *x);
+        *x = xnew;
+        if (step < tolerance)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Izzo's initial guess for the single revolution transfer.
+static double IzzoInitialGuess(double lambda, double T)
+{
+    double l2 = lambda*lambda;
+    double T00 = acos(lambda) + lambda * sqrt(1.0 - l2);
+    double T1 = 2.0 / 3.0 * (1.0 - l2*lambda);
+
+    if (T >= T00)
+    {
+        return -(T - T00) / (T - T00 + 4.0);
+    }
+    else if (T <= T1)
+    {
+        return T1 * (T1 - T) / (0.4 * (1.0 - l2*l2*lambda) * T) + 1.0;
+    }
+    return pow(T / T00, log(2.0) / log(T1 / T00)) - 1.0;
+}
+
+/// Izzo's initial guess for the left (left = true) or right branch of an N
+/// revolution transfer.
+static double IzzoInitialGuess(double T, int N, bool left)
+{
+    double tmp = left ? pow((N*MATH_PI + MATH_PI) / (8.0*T), 2.0/3.0)
+                      : pow((8.0*T) / (N*MATH_PI), 2.0/3.0);
+    return (tmp - 1.0) / (tmp + 1.0);
+}
+
+/// Largest number of revolutions for which a solution exists.
+static int CalculateMaximumRevolutions(double lambda, double T, int* iterations)
+{
+    int Nmax = (int)floor(T / MATH_PI);
+    double T00 = acos(lambda) + lambda * sqrt(1.0 - lambda*lambda);
+
+    // Below T00 + Nmax pi the Nmax solutions only exist above the minimum
+    if (Nmax > 0 && T < T00 + Nmax * MATH_PI)
+    {
+        double xMin, TMin;
+        FindMinimumTimeOfFlight(lambda, Nmax, &xMin, &TMin, iterations);
+        if (TMin > T)
+        {
+            Nmax--;
+        }
+    }
+    return Nmax;
+}
+
+void IzzoLambert::Evaluate(const Vector3& initialPosition,
+                           const Vector3& finalPosition,
+                           double timeOfFlight,
+                           OrbitDirection orbitDirection,
+                           int numberRevolutions,
+                           Vector3* initialVelocity,
+                           Vector3* finalVelocity,
+                           LambertInfo* info) const
+{
+    Solve(initialPosition, finalPosition, timeOfFlight, orbitDirection, numberRevolutions, NULL, initialVelocity, finalVelocity, info);
+}
+
+void IzzoLambert::EvaluateWarmStart(const Vector3& initialPosition,
+                                    const Vector3& finalPosition,
+                                    double timeOfFlight,
+                                    OrbitDirection orbitDirection,
+                                    int numberRevolutions,
+                                    double initialGuess,
+                                    Vector3* initialVelocity,
+                                    Vector3* finalVelocity,
+                                    LambertInfo* info) const
+{
+    Solve(initialPosition, finalPosition, timeOfFlight, orbitDirection, numberRevolutions, &initialGuess, initialVelocity, finalVelocity, info);
+}
+
+void IzzoLambert::Solve(const Vector3& initialPosition,
+                        const Vector3& finalPosition,
+                        double timeOfFlight,
+                        OrbitDirection orbitDirection,
+                        int numberRevolutions,
+                        const double* initialGuess,
+                        Vector3* initialVelocity,
+                        Vector3* finalVelocity,
+                        LambertInfo* info) const
+{
+    assert(timeOfFlight > 0.0);
+    assert(orbitDirection == ORBIT_DIR_PROGRADE || orbitDirection == ORBIT_DIR_RETROGRADE);
+    assert(numberRevolutions >= 0);
+
+    LagrangeGeometry geometry;
+    CalculateLagrangeGeometry(initialPosition, finalPosition, timeOfFlight, orbitDirection, &geometry);
+
+    int iterations = 0;
+    bool converged = false;
+    double x = 0.0;
+
+    if (initialGuess != NULL && *initialGuess > -1.0)
+    {
+        x = *initialGuess;
+        converged = SolveLagrangeHouseholder(geometry.lambda, geometry.T, numberRevolutions, &x, &iterations);
+
+        // A multi-revolution warm start may land on the right branch, where
+        // the time of flight increases with x.
+        if (converged && numberRevolutions > 0)
+        {
+            double dT, ddT, dddT;
+            LagrangeTimeOfFlightDerivatives(x, geometry.T, geometry.lambda, &dT, &ddT, &dddT);
+            converged = (dT < 0.0);
+        }
+    }
+
+    // Cold start from Izzo's initial guess
+    if (!converged &&
+        (numberRevolutions == 0 || CalculateMaximumRevolutions(geometry.lambda, geometry.T, &iterations) >= numberRevolutions))
+    {
+        x = (numberRevolutions == 0) ? IzzoInitialGuess(geometry.lambda, geometry.T)
+                                     : IzzoInitialGuess(geometry.T, numberRevolutions, true);
+        converged = SolveLagrangeHouseholder(geometry.lambda, geometry.T, numberRevolutions, &x, &iterations);
+    }
+
+    CalculateLagrangeVelocities(geometry, x, initialVelocity, finalVelocity);
+
+    if (info != NULL)
+    {
+        info->iterations = iterations;
+        info->converged = converged;
+        info->x = x;
+    }
+}
+
+int IzzoLambert::EvaluateAll(const Vector3& initialPosition,
+                             const Vector3& finalPosition,
+                             double timeOfFlight,
+                             OrbitDirection orbitDirection,
+                             std::vector<Vector3>* initialVelocities,
+                             std::vector<Vector3>* finalVelocities,
+                             std::vector<LambertInfo>* infos) const
+{
+    assert(timeOfFlight > 0.0);
+    assert(orbitDirection == ORBIT_DIR_PROGRADE || orbitDirection == ORBIT_DIR_RETROGRADE);
+
+    LagrangeGeometry geometry;
+    CalculateLagrangeGeometry(initialPosition, finalPosition, timeOfFlight, orbitDirection, &geometry);
+
+    int iterations = 0;
+    int Nmax = CalculateMaximumRevolutions(geometry.lambda, geometry.T, &iterations);
+
+    const size_t numberSolutions = 2 * Nmax + 1;
+    initialVelocities->resize(numberSolutions);
+    finalVelocities->resize(numberSolutions);
+    if (infos != NULL)
+    {
+        infos->resize(numberSolutions);
+    }
+
+    for (size_t i = 0; i < numberSolutions; ++i)
+    {
+        // Solution 0 is the single revolution transfer, followed by the
+        // left and right branch of each multi-revolution transfer.
+        int N = (int)(i + 1) / 2;
+        double x = (N == 0) ? IzzoInitialGuess(geometry.lambda, geometry.T)
+                            : IzzoInitialGuess(geometry.T, N, (i % 2) == 1);
+
+        bool converged = SolveLagrangeHouseholder(geometry.lambda, geometry.T, N, &x, &iterations);
+        CalculateLagrangeVelocities(geometry, x, &(*initialVelocities)[i], &(*finalVelocities)[i]);
+
+        if (infos != NULL)
+        {
+            (*infos)[i].iterations = iterations;
+            (*infos)[i].converged = converged;
+            (*infos)[i].x = x;
+        }
+        iterations = 0;
+    }
+
+    return Nmax;
+}
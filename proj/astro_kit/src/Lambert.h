@@ -19,21 +19,107 @@
 #pragma once
 #include "Base.h"
 
-// Forward declaration
+// Forward declarations
+class ThreadPool;
+class LambertCache;
+
+/// Number of problems the batched kernels iterate together. Eight doubles
+/// fill two AVX2 registers or one AVX-512 register per variable.
+const size_t LAMBERT_BATCH_WIDTH = 8;
+
 class Lambert;
 
+/// How Lambert::EvaluateSweep() solves a grid of problems.
+enum LambertSweepMode
+{
+    LAMBERT_SWEEP_INVALID_MODE = -1,
+    LAMBERT_SWEEP_WARM_START,   /// Serpentine order, every cell warm started from its neighbour
+    LAMBERT_SWEEP_BATCH,        /// Every cell solved cold with EvaluateBatch()
+    LAMBERT_SWEEP_COUNT
+};
+
+/// Diagnostics reported by a single Lambert solve.
+struct LambertInfo
+{
+    int iterations;  /// Number of iterations performed by the solver
+    bool converged;  /// False if no solution was found within the iteration limit
+    double x;        /// Iteration variable of the solution, specific to the solver type
+};
+
+/// Structure-of-arrays set of Lambert problems and their solutions.
+/// Used to evaluate many problems (e.g. a porkchop grid) in a single call.
+struct LambertBatch
+{
+    // Inputs
+    Vector3Array initialPosition;
+    Vector3Array finalPosition;
+    std::vector<double> timeOfFlight;
+    std::vector<OrbitDirection> orbitDirection;
+    std::vector<int> numberRevolutions;
+
+    // Outputs
+    Vector3Array initialVelocity;
+    Vector3Array finalVelocity;
+
+    void Resize(size_t count);
+    size_t Size() const;
+
+    void SetProblem(size_t index,
+                    const Vector3& initialPosition,
+                    const Vector3& finalPosition,
+                    double timeOfFlight,
+                    OrbitDirection orbitDirection,
+                    int numberRevolutions);
+
+    void GetSolution(size_t index, Vector3* initialVelocity, Vector3* finalVelocity) const;
+};
+
+/// Owns the active Lambert solver and, optionally, a cache in front of it.
+/// Solvers hold no mutable state and the cache is thread-safe, so
+/// Evaluate(), EvaluateBatch() and EvaluateParallel() may be called from any
+/// number of threads at once, as long as SetLambertType(), EnableCache(),
+/// DisableCache() and Cleanup() are not called concurrently with them.
 class LambertManager
 {
 public:
     static void SetLambertType(LambertType lambertType);
 
-    static void Evaluate(const Vector3& initialPosition,
+    /// Creates a new solver of the given type, owned by the caller.
+    /// Useful for threads that want a solver independent of the manager.
+    static Lambert* CreateLambertSolver(LambertType lambertType);
+
+    /// Solves a single problem with the active solver, or the cache if one
+    /// is enabled. Returns false if the solver did not converge, in which
+    /// case the velocities are those of its last iterate.
+    static bool Evaluate(const Vector3& initialPosition,
                          const Vector3& finalPosition,
                          double timeOfFlight,
                          OrbitDirection orbitDirection,
                          int numberRevolutions,
                          Vector3* initialVelocity,
-                         Vector3* finalVelocity);
+                         Vector3* finalVelocity,
+                         LambertInfo* info = NULL);
+
+    /// Routes Evaluate() through a LambertCache of the given capacity. The
+    /// cache is kept, emptied, when the Lambert type changes. Batched
+    /// evaluation bypasses the cache.
+    static void EnableCache(size_t capacity);
+    static void DisableCache();
+
+    /// Returns the active cache, or NULL if caching is disabled.
+    static const LambertCache* GetCache();
+
+    /// Solves every problem in the batch and fills its velocity outputs.
+    static void EvaluateBatch(LambertBatch* batch);
+
+    /// Solves a grid of problems with warm starts, see Lambert::EvaluateSweep().
+    static void EvaluateSweep(LambertBatch* batch, size_t numberRows, size_t numberColumns,
+                              LambertSweepMode mode = LAMBERT_SWEEP_WARM_START,
+                              std::vector<LambertInfo>* infos = NULL);
+
+    /// Solves every problem in the batch, spreading blocks of problems
+    /// across the workers of the thread pool.
+    static void EvaluateParallel(LambertBatch* batch, ThreadPool* threadPool);
     
     static void Cleanup();
 
@@ -43,19 +129,67 @@ private:
 
 private:
     static Lambert* _lambertSolver;
+    static LambertCache* _lambertCache;
 };
 
 /// Abstract base class for all Lambert solver algorithms.
+/// Implementations must be reentrant: all scratch data lives on the stack
+/// of the call, so one instance can be shared between threads.
+/// All solvers work in canonical units (mu = 1). For multi-revolution
+/// transfers two solutions exist; solvers return the left branch, i.e. the
+/// solution with the Lancaster-Battin variable x below the minimum time of
+/// flight point.
 class Lambert
 {
 public:
+    virtual ~Lambert() {}
+
     virtual void Evaluate(const Vector3& initialPosition,
                           const Vector3& finalPosition,
                           double timeOfFlight,
                           OrbitDirection orbitDirection,
                           int numberRevolutions,
                           Vector3* initialVelocity,
-                          Vector3* finalVelocity) = 0;
+                          Vector3* finalVelocity,
+                          LambertInfo* info = NULL) const = 0;
+
+    /// Solves the problems [begin, end) of the batch. The velocity outputs
+    /// must already be sized. The default implementation loops over
+    /// Evaluate(), algorithms with a batched kernel override it.
+    virtual void EvaluateBatch(LambertBatch* batch, size_t begin, size_t end) const;
+
+    /// Solves a numberRows by numberColumns grid of problems stored row by
+    /// row in the batch, e.g. departure epochs by times of flight, and fills
+    /// its velocity outputs. Cells are visited in serpentine order, left to
+    /// right on even rows and right to left on odd rows, so every cell is
+    /// warm started from the neighbour solved just before it. A sweep along
+    /// one dimension is a grid with a single row. With LAMBERT_SWEEP_BATCH
+    /// the grid is instead solved cold with EvaluateBatch(), which is faster
+    /// for solvers with a batched kernel (see HasBatchKernel()) and reports
+    /// no infos.
+    void EvaluateSweep(LambertBatch* batch, size_t numberRows, size_t numberColumns,
+                       LambertSweepMode mode = LAMBERT_SWEEP_WARM_START,
+                       std::vector<LambertInfo>* infos = NULL) const;
+
+    /// True if EvaluateBatch() is overridden by a kernel that solves several
+    /// problems at once.
+    virtual bool HasBatchKernel() const { return false; }
+
+    /// Solves the problem starting from the solution of a nearby problem,
+    /// given as the LambertInfo::x reported by a solver of the same type.
+    /// The default implementation ignores the guess and calls Evaluate().
+    /// Solvers that use the guess implement both Evaluate() and
+    /// EvaluateWarmStart() with a protected Solve(), which takes the guess
+    /// as a pointer that is NULL for a cold start.
+    virtual void EvaluateWarmStart(const Vector3& initialPosition,
+                                   const Vector3& finalPosition,
+                                   double timeOfFlight,
+                                   OrbitDirection orbitDirection,
+                                   int numberRevolutions,
+                                   double initialGuess,
+                                   Vector3* initialVelocity,
+                                   Vector3* finalVelocity,
+                                   LambertInfo* info = NULL) const;
 };
 
 class ExpSinusoidLambert : public Lambert
@@ -67,12 +201,40 @@ public:
                           OrbitDirection orbitDirection,
                           int numberRevolutions,
                           Vector3* initialVelocity,
-                          Vector3* finalVelocity);
+                          Vector3* finalVelocity,
+                          LambertInfo* info = NULL) const;
+
+    virtual void EvaluateWarmStart(const Vector3& initialPosition,
+                                   const Vector3& finalPosition,
+                                   double timeOfFlight,
+                                   OrbitDirection orbitDirection,
+                                   int numberRevolutions,
+                                   double initialGuess,
+                                   Vector3* initialVelocity,
+                                   Vector3* finalVelocity,
+                                   LambertInfo* info = NULL) const;
+
+    virtual void EvaluateBatch(LambertBatch* batch, size_t begin, size_t end) const;
+    virtual bool HasBatchKernel() const { return true; }
 
 protected:
-    void CalculateTimeOfFlight(double x, double s, double c, int longway, double N, double* tof);
+    void Solve(const Vector3& initialPosition,
+               const Vector3& finalPosition,
+               double timeOfFlight,
+               OrbitDirection orbitDirection,
+               int numberRevolutions,
+               const double* initialGuess,
+               Vector3* initialVelocity,
+               Vector3* finalVelocity,
+               LambertInfo* info) const;
+
+    void CalculateTimeOfFlight(double x, double s, double c, int longway, double N, double* tof) const;
 };
 
+/// Battin's method (Vallado Algorithm 61). Multi-revolution transfers are
+/// solved with Halley iterations on Lagrange's time of flight equation
+/// written in the same Lancaster-Battin variable. LambertInfo::x is Battin's
+/// x for single revolution transfers and the Lancaster-Battin x otherwise.
 class BattinsLambert : public Lambert
 {
 public:
@@ -82,9 +244,33 @@ public:
                           OrbitDirection orbitDirection,
                           int numberRevolutions,
                           Vector3* initialVelocity,
-                          Vector3* finalVelocity);
+                          Vector3* finalVelocity,
+                          LambertInfo* info = NULL) const;
+
+    virtual void EvaluateWarmStart(const Vector3& initialPosition,
+                                   const Vector3& finalPosition,
+                                   double timeOfFlight,
+                                   OrbitDirection orbitDirection,
+                                   int numberRevolutions,
+                                   double initialGuess,
+                                   Vector3* initialVelocity,
+                                   Vector3* finalVelocity,
+                                   LambertInfo* info = NULL) const;
+
+protected:
+    void Solve(const Vector3& initialPosition,
+               const Vector3& finalPosition,
+               double timeOfFlight,
+               OrbitDirection orbitDirection,
+               int numberRevolutions,
+               const double* initialGuess,
+               Vector3* initialVelocity,
+               Vector3* finalVelocity,
+               LambertInfo* info) const;
 };
 
+/// Universal variable method (Vallado Algorithm 58, Curtis Algorithm 5.2)
+/// using safeguarded Newton iterations on psi.
 class UniversalVarLambert : public Lambert
 {
 public:
@@ -94,10 +280,48 @@ public:
                           OrbitDirection orbitDirection,
                           int numberRevolutions,
                           Vector3* initialVelocity,
-                          Vector3* finalVelocity);
+                          Vector3* finalVelocity,
+                          LambertInfo* info = NULL) const;
+
+    virtual void EvaluateWarmStart(const Vector3& initialPosition,
+                                   const Vector3& finalPosition,
+                                   double timeOfFlight,
+                                   OrbitDirection orbitDirection,
+                                   int numberRevolutions,
+                                   double initialGuess,
+                                   Vector3* initialVelocity,
+                                   Vector3* finalVelocity,
+                                   LambertInfo* info = NULL) const;
+
+protected:
+    void Solve(const Vector3& initialPosition,
+               const Vector3& finalPosition,
+               double timeOfFlight,
+               OrbitDirection orbitDirection,
+               int numberRevolutions,
+               const double* initialGuess,
+               Vector3* initialVelocity,
+               Vector3* finalVelocity,
+               LambertInfo* info) const;
+};
+
+/// Universal variable method for large batches. Evaluate() is the scalar
+/// solver, EvaluateBatch() iterates LAMBERT_BATCH_WIDTH problems at a time in
+/// a vectorized kernel, refilling each lane as its problem converges. Pair
+/// with LambertBulkQueue to spread queued batches over a thread pool.
+class UniversalVarBulkLambert : public UniversalVarLambert
+{
+public:
+    virtual void EvaluateBatch(LambertBatch* batch, size_t begin, size_t end) const;
+    virtual bool HasBatchKernel() const { return true; }
 };
 
-class UniversalVarGpuLambert : public Lambert
+/// Izzo's method (Izzo, "Revisiting Lambert's problem", CMDA 121, 2015).
+/// Householder iterations on Lagrange's equation in the Lancaster-Battin
+/// variable from Izzo's initial guesses, typically converging in two or three
+/// iterations and never taking more than fifteen (plus at most twelve to
+/// locate the minimum time of flight of a multi-revolution transfer).
+class IzzoLambert : public Lambert
 {
 public:
     virtual void Evaluate(const Vector3& initialPosition,
@@ -106,5 +330,43 @@ public:
                           OrbitDirection orbitDirection,
                           int numberRevolutions,
                           Vector3* initialVelocity,
-                          Vector3* finalVelocity);
-};
\ No newline at end of file
+                          Vector3* finalVelocity,
+                          LambertInfo* info = NULL) const;
+
+    /// Iterates from the guess instead of Izzo's initial guess. If that does
+    /// not converge, or converges to the right branch of a multi-revolution
+    /// transfer, the cold start of Evaluate() follows, so the worst case is
+    /// fifteen iterations from the guess, twelve to locate the minimum time
+    /// of flight and fifteen from the cold start, i.e. 42 in total.
+    virtual void EvaluateWarmStart(const Vector3& initialPosition,
+                                   const Vector3& finalPosition,
+                                   double timeOfFlight,
+                                   OrbitDirection orbitDirection,
+                                   int numberRevolutions,
+                                   double initialGuess,
+                                   Vector3* initialVelocity,
+                                   Vector3* finalVelocity,
+                                   LambertInfo* info = NULL) const;
+
+    /// Computes every solution of the problem, the single revolution transfer
+    /// first followed by the left and right branch of each multi-revolution
+    /// transfer, i.e. 2 * Nmax + 1 solutions. Returns Nmax.
+    int EvaluateAll(const Vector3& initialPosition,
+                    const Vector3& finalPosition,
+                    double timeOfFlight,
+                    OrbitDirection orbitDirection,
+                    std::vector<Vector3>* initialVelocities,
+                    std::vector<Vector3>* finalVelocities,
+                    std::vector<LambertInfo>* infos = NULL) const;
+
+protected:
+    void Solve(const Vector3& initialPosition,
+               const Vector3& finalPosition,
+               double timeOfFlight,
+               OrbitDirection orbitDirection,
+               int numberRevolutions,
+               const double* initialGuess,
+               Vector3* initialVelocity,
+               Vector3* finalVelocity,
+               LambertInfo* info) const;
+};
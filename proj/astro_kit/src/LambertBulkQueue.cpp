@@ -0,0 +1,146 @@
+/*****************************************************************************
+ *   IGATO - Interplanetary Gravity Assist Trajectory Optimizer              *
+ *   Copyright (C) 2012 Jason Bryan (Jmbryan10@gmail.com)                    *
+ *                                                                           *
+ *   IGATO is free software; you can redistribute it and/or modify           *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   IGATO is distributed in the hope that it will be useful,                *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with IGATO; if not, see http://www.gnu.org/licenses/              *
+ *****************************************************************************/
+
+#include "LambertBulkQueue.h"
+#include "ThreadPool.h"
+
+/// Completion state of one submitted batch, shared by its blocks.
+struct LambertBulkQueue::Job
+{
+    LambertBatch* batch;
+    Callback onComplete;
+    std::promise<void> promise;
+    std::atomic<size_t> remaining;
+
+    std::mutex errorMutex;
+    std::exception_ptr error;
+};
+
+LambertBulkQueue::LambertBulkQueue(const Lambert* solver, ThreadPool* threadPool, size_t blockSize) :
+    _solver(solver),
+    _threadPool(threadPool),
+    _numberPending(0)
+{
+    assert(solver != NULL);
+    assert(threadPool != NULL);
+
+    _blockSize = LAMBERT_BATCH_WIDTH * Max<size_t>(1, (blockSize + LAMBERT_BATCH_WIDTH - 1) / LAMBERT_BATCH_WIDTH);
+}
+
+LambertBulkQueue::~LambertBulkQueue()
+{
+    Wait();
+}
+
+std::future<void> LambertBulkQueue::Submit(LambertBatch* batch, const Callback& onComplete)
+{
+    const size_t count = batch->Size();
+    batch->initialVelocity.Resize(count);
+    batch->finalVelocity.Resize(count);
+
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->batch = batch;
+    job->onComplete = onComplete;
+    job->remaining = Max<size_t>(1, (count + _blockSize - 1) / _blockSize);
+    std::future<void> future = job->promise.get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _numberPending++;
+    }
+
+    if (count == 0)
+    {
+        RunBlock(job, 0, 0);
+        return future;
+    }
+
+    for (size_t begin = 0; begin < count; begin += _blockSize)
+    {
+        size_t end = Min(begin + _blockSize, count);
+        _threadPool->Enqueue([=]()
+        {
+            RunBlock(job, begin, end);
+        });
+    }
+    return future;
+}
+
+void LambertBulkQueue::RunBlock(const std::shared_ptr<Job>& job, size_t begin, size_t end)
+{
+    try
+    {
+        _solver->EvaluateBatch(job->batch, begin, end);
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(job->errorMutex);
+        if (!job->error)
+        {
+            job->error = std::current_exception();
+        }
+    }
+
+    if (--job->remaining > 0)
+    {
+        return;
+    }
+
+    // Last block of the batch, every other block has published its results.
+    if (!job->error && job->onComplete)
+    {
+        try
+        {
+            job->onComplete(job->batch);
+        }
+        catch (...)
+        {
+            job->error = std::current_exception();
+        }
+    }
+
+    if (job->error)
+    {
+        job->promise.set_exception(job->error);
+    }
+    else
+    {
+        job->promise.set_value();
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (--_numberPending == 0)
+    {
+        _condition.notify_all();
+    }
+}
+
+void LambertBulkQueue::Wait()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (_numberPending > 0)
+    {
+        _condition.wait(lock);
+    }
+}
+
+size_t LambertBulkQueue::GetNumberPending() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _numberPending;
+}
@@ -0,0 +1,75 @@
+/*****************************************************************************
+ *   IGATO - Interplanetary Gravity Assist Trajectory Optimizer              *
+ *   Copyright (C) 2012 Jason Bryan (Jmbryan10@gmail.com)                    *
+ *                                                                           *
+ *   IGATO is free software; you can redistribute it and/or modify           *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   IGATO is distributed in the hope that it will be useful,                *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with IGATO; if not, see http://www.gnu.org/licenses/              *
+ *****************************************************************************/
+
+#pragma once
+#include "Lambert.h"
+
+#include <future>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+/// Queue for solving large Lambert batches asynchronously.
+/// Each submitted batch is cut into blocks that are solved by the workers of
+/// a persistent thread pool, so a grid search pays one submission per batch
+/// rather than one dispatch per problem. Completion is reported through the
+/// returned future and, optionally, a callback.
+class LambertBulkQueue
+{
+public:
+    /// Called on the worker that finishes the last block of a batch.
+    typedef std::function<void(LambertBatch*)> Callback;
+
+    /// The solver and the pool must outlive the queue. The block size is the
+    /// number of problems per pool task, rounded up to a multiple of
+    /// LAMBERT_BATCH_WIDTH.
+    LambertBulkQueue(const Lambert* solver, ThreadPool* threadPool, size_t blockSize = 512);
+
+    /// Waits for every submitted batch to complete.
+    ~LambertBulkQueue();
+
+    /// Queues every problem of the batch and returns immediately. The batch
+    /// must stay alive and unmodified until the returned future is ready.
+    /// An exception thrown by the solver or the callback is stored in the
+    /// future.
+    std::future<void> Submit(LambertBatch* batch, const Callback& onComplete = Callback());
+
+    /// Blocks until every submitted batch has completed. Must not be called
+    /// from a callback or any other task running on the same pool.
+    void Wait();
+
+    /// Number of submitted batches that have not completed yet.
+    size_t GetNumberPending() const;
+
+private:
+    LambertBulkQueue(const LambertBulkQueue&);
+    LambertBulkQueue& operator=(const LambertBulkQueue&);
+
+    struct Job;
+    void RunBlock(const std::shared_ptr<Job>& job, size_t begin, size_t end);
+
+private:
+    const Lambert* _solver;
+    ThreadPool* _threadPool;
+    size_t _blockSize;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _condition;
+    size_t _numberPending;
+};
@@ -0,0 +1,232 @@
+/*****************************************************************************
+ *   IGATO - Interplanetary Gravity Assist Trajectory Optimizer              *
+ *   Copyright (C) 2012 Jason Bryan (Jmbryan10@gmail.com)                    *
+ *                                                                           *
+ *   IGATO is free software; you can redistribute it and/or modify           *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   IGATO is distributed in the hope that it will be useful,                *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with IGATO; if not, see http://www.gnu.org/licenses/              *
+ *****************************************************************************/
+
+#include "LambertCache.h"
+
+bool LambertCache::Key::operator==(const Key& rhs) const
+{
+    for (int i = 0; i < 6; ++i)
+    {
+        if (position[i] != rhs.position[i])
+        {
+            return false;
+        }
+    }
+    return (timeOfFlight == rhs.timeOfFlight &&
+            orbitDirection == rhs.orbitDirection &&
+            numberRevolutions == rhs.numberRevolutions);
+}
+
+size_t LambertCache::KeyHash::operator()(const Key& key) const
+{
+    // FNV-1a over the key fields
+    unsigned long long hash = 14695981039346656037ULL;
+    const unsigned long long prime = 1099511628211ULL;
+    for (int i = 0; i < 6; ++i)
+    {
+        hash = (hash ^ (unsigned long long)key.position[i]) * prime;
+    }
+    hash = (hash ^ (unsigned long long)key.timeOfFlight) * prime;
+    hash = (hash ^ (unsigned long long)key.orbitDirection) * prime;
+    hash = (hash ^ (unsigned long long)key.numberRevolutions) * prime;
+    return (size_t)hash;
+}
+
+const LambertCache::Entry* LambertCache::Table::Find(const Key& key)
+{
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash>::iterator it = index.find(key);
+    if (it == index.end())
+    {
+        return NULL;
+    }
+
+    // Move to the front, iterators stay valid
+    entries.splice(entries.begin(), entries, it->second);
+    return &entries.front();
+}
+
+void LambertCache::Table::Insert(const Entry& entry, size_t capacity)
+{
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash>::iterator it = index.find(entry.key);
+    if (it != index.end())
+    {
+        *it->second = entry;
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+    }
+
+    if (entries.size() >= capacity)
+    {
+        index.erase(entries.back().key);
+        entries.pop_back();
+    }
+
+    entries.push_front(entry);
+    index[entry.key] = entries.begin();
+}
+
+void LambertCache::Table::Clear()
+{
+    entries.clear();
+    index.clear();
+}
+
+LambertCache::LambertCache(const Lambert* solver, size_t capacity, double resolution, double warmStartResolution) :
+    _solver(solver),
+    _capacity(Max<size_t>(1, capacity)),
+    _resolution(resolution),
+    _warmStartResolution(warmStartResolution),
+    _numberHits(0),
+    _numberMisses(0),
+    _numberWarmStarts(0)
+{
+    assert(solver != NULL);
+    assert(resolution > 0.0 && warmStartResolution > 0.0);
+}
+
+LambertCache::Key LambertCache::MakeKey(const Vector3& initialPosition,
+                                        const Vector3& finalPosition,
+                                        double timeOfFlight,
+                                        OrbitDirection orbitDirection,
+                                        int numberRevolutions,
+                                        double resolution)
+{
+    const double scale = 1.0 / resolution;
+
+    Key key;
+    key.position[0] = (long long)floor(initialPosition.x * scale + 0.5);
+    key.position[1] = (long long)floor(initialPosition.y * scale + 0.5);
+    key.position[2] = (long long)floor(initialPosition.z * scale + 0.5);
+    key.position[3] = (long long)floor(finalPosition.x * scale + 0.5);
+    key.position[4] = (long long)floor(finalPosition.y * scale + 0.5);
+    key.position[5] = (long long)floor(finalPosition.z * scale + 0.5);
+    key.timeOfFlight = (long long)floor(timeOfFlight * scale + 0.5);
+    key.orbitDirection = (int)orbitDirection;
+    key.numberRevolutions = numberRevolutions;
+    return key;
+}
+
+void LambertCache::Evaluate(const Vector3& initialPosition,
+                            const Vector3& finalPosition,
+                            double timeOfFlight,
+                            OrbitDirection orbitDirection,
+                            int numberRevolutions,
+                            Vector3* initialVelocity,
+                            Vector3* finalVelocity,
+                            LambertInfo* info)
+{
+    Entry entry;
+    entry.key = MakeKey(initialPosition, finalPosition, timeOfFlight, orbitDirection, numberRevolutions, _resolution);
+    Key warmStartKey = MakeKey(initialPosition, finalPosition, timeOfFlight, orbitDirection, numberRevolutions, _warmStartResolution);
+
+    bool warmStart = false;
+    double initialGuess = 0.0;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        const Entry* cached = _solutions.Find(entry.key);
+        if (cached != NULL)
+        {
+            _numberHits++;
+            *initialVelocity = cached->initialVelocity;
+            *finalVelocity = cached->finalVelocity;
+            if (info != NULL)
+            {
+                *info = cached->info;
+                info->iterations = 0;
+            }
+            return;
+        }
+        _numberMisses++;
+
+        const Entry* neighbour = _warmStarts.Find(warmStartKey);
+        if (neighbour != NULL)
+        {
+            _numberWarmStarts++;
+            warmStart = true;
+            initialGuess = neighbour->info.x;
+        }
+    }
+
+    // Solve outside the lock so that concurrent misses do not serialize
+    if (warmStart)
+    {
+        _solver->EvaluateWarmStart(initialPosition, finalPosition, timeOfFlight, orbitDirection, numberRevolutions,
+                                   initialGuess, &entry.initialVelocity, &entry.finalVelocity, &entry.info);
+    }
+    else
+    {
+        _solver->Evaluate(initialPosition, finalPosition, timeOfFlight, orbitDirection, numberRevolutions,
+                          &entry.initialVelocity, &entry.finalVelocity, &entry.info);
+    }
+
+    *initialVelocity = entry.initialVelocity;
+    *finalVelocity = entry.finalVelocity;
+    if (info != NULL)
+    {
+        *info = entry.info;
+    }
+
+    if (entry.info.converged)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _solutions.Insert(entry, _capacity);
+
+        entry.key = warmStartKey;
+        _warmStarts.Insert(entry, _capacity);
+    }
+}
+
+void LambertCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _solutions.Clear();
+    _warmStarts.Clear();
+    _numberHits = 0;
+    _numberMisses = 0;
+    _numberWarmStarts = 0;
+}
+
+size_t LambertCache::GetCapacity() const
+{
+    return _capacity;
+}
+
+size_t LambertCache::GetSize() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _solutions.entries.size();
+}
+
+size_t LambertCache::GetNumberHits() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _numberHits;
+}
+
+size_t LambertCache::GetNumberMisses() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _numberMisses;
+}
+
+size_t LambertCache::GetNumberWarmStarts() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _numberWarmStarts;
+}
@@ -0,0 +1,121 @@
+/*****************************************************************************
+ *   IGATO - Interplanetary Gravity Assist Trajectory Optimizer              *
+ *   Copyright (C) 2012 Jason Bryan (Jmbryan10@gmail.com)                    *
+ *                                                                           *
+ *   IGATO is free software; you can redistribute it and/or modify           *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   IGATO is distributed in the hope that it will be useful,                *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with IGATO; if not, see http://www.gnu.org/licenses/              *
+ *****************************************************************************/
+
+#pragma once
+#include "Lambert.h"
+
+#include <list>
+#include <unordered_map>
+#include <mutex>
+
+/// Bounded, thread-safe cache of Lambert solutions.
+/// Problems are keyed on their positions and time of flight rounded to a
+/// fixed resolution, together with the direction and number of revolutions.
+/// A lookup that matches a cached key returns the cached solution. A lookup
+/// that misses but matches a coarser key warm starts the solver from the
+/// cached iteration variable of that neighbour. Both tables evict the least
+/// recently used entry once full. Only converged solutions are cached.
+class LambertCache
+{
+public:
+    /// The solver must outlive the cache. Resolutions are in canonical units;
+    /// problems closer than the resolution are treated as identical.
+    LambertCache(const Lambert* solver,
+                 size_t capacity = 4096,
+                 double resolution = 1.0e-9,
+                 double warmStartResolution = 1.0e-3);
+
+    /// Same contract as Lambert::Evaluate(). May be called from any number
+    /// of threads at once. A cache hit reports zero iterations.
+    void Evaluate(const Vector3& initialPosition,
+                  const Vector3& finalPosition,
+                  double timeOfFlight,
+                  OrbitDirection orbitDirection,
+                  int numberRevolutions,
+                  Vector3* initialVelocity,
+                  Vector3* finalVelocity,
+                  LambertInfo* info = NULL);
+
+    /// Removes every entry and resets the counters.
+    void Clear();
+
+    size_t GetCapacity() const;
+    size_t GetSize() const;
+    size_t GetNumberHits() const;
+    size_t GetNumberMisses() const;
+    size_t GetNumberWarmStarts() const; /// Misses solved from a cached neighbour
+
+private:
+    LambertCache(const LambertCache&);
+    LambertCache& operator=(const LambertCache&);
+
+    /// Problem rounded to the resolution of a table.
+    struct Key
+    {
+        long long position[6];
+        long long timeOfFlight;
+        int orbitDirection;
+        int numberRevolutions;
+
+        bool operator==(const Key& rhs) const;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Entry
+    {
+        Key key;
+        Vector3 initialVelocity;
+        Vector3 finalVelocity;
+        LambertInfo info;
+    };
+
+    /// Least recently used table, the front of the list is the most recent.
+    struct Table
+    {
+        std::list<Entry> entries;
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+
+        const Entry* Find(const Key& key);
+        void Insert(const Entry& entry, size_t capacity);
+        void Clear();
+    };
+
+    static Key MakeKey(const Vector3& initialPosition,
+                       const Vector3& finalPosition,
+                       double timeOfFlight,
+                       OrbitDirection orbitDirection,
+                       int numberRevolutions,
+                       double resolution);
+
+private:
+    const Lambert* _solver;
+    size_t _capacity;
+    double _resolution;
+    double _warmStartResolution;
+
+    mutable std::mutex _mutex;
+    Table _solutions;
+    Table _warmStarts;
+    size_t _numberHits;
+    size_t _numberMisses;
+    size_t _numberWarmStarts;
+};
@@ -22,31 +22,37 @@
 
 Orbit::Orbit(double mu)
 {
-    _init = false;
-    _type = ORBIT_INVALID_TYPE;
-    _orbitalElementsState = STATE_DIRTY;
-    _stateVectorState = STATE_DIRTY;
-    _mu = mu;
+    Initialize(mu);
 }
 
 Orbit::Orbit(const StateVector& stateVector, double mu)
 {
-    _mu = mu;
+    Initialize(mu);
     SetStateVector(stateVector);
 }
 
 Orbit::Orbit(const Vector3& position, const Vector3& velocity, double mu)
 {
-    _mu = mu;
+    Initialize(mu);
     SetStateVector(position, velocity);
 }
 
 Orbit::Orbit(const OrbitalElements& orbitalElements, double mu)
 {
-    _mu = mu;
+    Initialize(mu);
     SetOrbitalElements(orbitalElements);
 }
 
+void Orbit::Initialize(double mu)
+{
+    _init = false;
+    _type = ORBIT_INVALID_TYPE;
+    _orbitalElementsState = STATE_DIRTY;
+    _stateVectorState = STATE_DIRTY;
+    _mu = mu;
+    _radius = 0.0;
+}
+
 void Orbit::SetStateVector(const StateVector& stateVector)
 {
     SetStateVector(stateVector.position, stateVector.velocity);
@@ -54,12 +60,14 @@ void Orbit::SetStateVector(const StateVector& stateVector)
 
 void Orbit::SetStateVector(const Vector3& position, const Vector3& velocity)
 {
-    if (position == _stateVector.position && velocity == _stateVector.velocity)
+    // A dirty state vector may still hold an old value, so only a clean one can be compared.
+    if (_stateVectorState == STATE_CLEAN && position == _stateVector.position && velocity == _stateVector.velocity)
         return;
 
     _stateVector.position = position;
     _stateVector.velocity = velocity;
 
+    _stateVectorState = STATE_CLEAN;
     _orbitalElementsState = STATE_DIRTY;
 
     _init = true; 
@@ -67,11 +75,12 @@ void Orbit::SetStateVector(const Vector3& position, const Vector3& velocity)
 
 void Orbit::SetOrbitalElements(const OrbitalElements& orbitalElements)
 {
-    if (orbitalElements == _orbitalElements)
+    if (_orbitalElementsState == STATE_CLEAN && orbitalElements == _orbitalElements)
         return;
 
     _orbitalElements = orbitalElements;
 
+    _orbitalElementsState = STATE_CLEAN;
     _stateVectorState = STATE_DIRTY;
     _init = true;
 }
@@ -149,5 +158,149 @@ void Orbit::Propagate(double timeOfFlight)
 {
     assert(_init);
 
+    if (_orbitalElementsState == STATE_CLEAN && _orbitalElements.eccentricity != ASTRO_ECC_PARABOLIC)
+    {
+        PropagateOrbitalElements(timeOfFlight);
+    }
+    else
+    {
+        PropagateStateVector(timeOfFlight);
+    }
+}
+
+void Orbit::Propagate(double timeOfFlight, PropagateType propagateType)
+{
+    assert(_init);
+
+    switch (propagateType)
+    {
+    case PROPAGATE_COES:
+        if (GetOrbitalElements().eccentricity != ASTRO_ECC_PARABOLIC)
+        {
+            PropagateOrbitalElements(timeOfFlight);
+        }
+        else
+        {
+            PropagateStateVector(timeOfFlight);
+        }
+        break;
+
+    case PROPAGATE_RV:
+        PropagateStateVector(timeOfFlight);
+        break;
+
+    default:
+        throw "Invalid propagation algorithm type";
+    }
+}
+
+void Orbit::PropagateOrbitalElements(double timeOfFlight)
+{
+    if (_orbitalElementsState == STATE_DIRTY)
+    {
+        UpdateOrbitalElements();
+    }
+
+    double semimajorAxis = _orbitalElements.semimajorAxis;
+    double eccentricity = _orbitalElements.eccentricity;
+    double trueAnomaly = _orbitalElements.trueAnomaly;
+    double meanMotion = sqrt(_mu / fabs(semimajorAxis*semimajorAxis*semimajorAxis));
+
+    if (eccentricity < ASTRO_ECC_PARABOLIC)
+    {
+        // Only the fraction of the last revolution matters.
+        double sqrtOneMinusE2 = sqrt(1.0 - SQR(eccentricity));
+        double E = atan2(sqrtOneMinusE2*sin(trueAnomaly), eccentricity + cos(trueAnomaly));
+        double M = fmod(E - eccentricity*sin(E) + meanMotion*timeOfFlight, MATH_2_PI);
+        E = SolveKeplersEquationE(eccentricity, M);
+        trueAnomaly = atan2(sqrtOneMinusE2*sin(E), cos(E) - eccentricity);
+    }
+    else
+    {
+        double H = 2.0 * atanh(sqrt((eccentricity - 1.0)/(eccentricity + 1.0)) * tan(0.5*trueAnomaly));
+        double M = eccentricity*sinh(H) - H + meanMotion*timeOfFlight;
+        H = SolveKeplersEquationH(eccentricity, M);
+        trueAnomaly = 2.0 * atan(sqrt((eccentricity + 1.0)/(eccentricity - 1.0)) * tanh(0.5*H));
+    }
+
+    // Keep the [0, 2pi) range of ConvertStateVector2OrbitalElements().
+    if (trueAnomaly < 0.0)
+    {
+        trueAnomaly += MATH_2_PI;
+    }
+
+    _orbitalElements.trueAnomaly = trueAnomaly;
+    _stateVectorState = STATE_DIRTY;
+}
+
+/// Reference: Fundamentals of Astrodynamics and Applications 3rd Edition, David Vallado, Algorithm 8.
+void Orbit::PropagateStateVector(double timeOfFlight)
+{
+    if (_stateVectorState == STATE_DIRTY)
+    {
+        UpdateStateVector();
+    }
+
+    const Vector3& Pos0 = _stateVector.position;
+    const Vector3& Vel0 = _stateVector.velocity;
+    double pos0 = Pos0.length();
+    double sqrtMu = sqrt(_mu);
+    double posDotVel = Pos0.dot(Vel0) / sqrtMu;
+    double alpha = 2.0/pos0 - Vel0.lengthSquared()/_mu; // reciprocal of the semimajor axis
+
+    // Initial guess of the universal variable chi.
+    double chi;
+    if (alpha > 1.0e-6) // elliptical, only the fraction of the last revolution matters
+    {
+        double period = MATH_2_PI / (sqrtMu * alpha * sqrt(alpha));
+        timeOfFlight = fmod(timeOfFlight, period);
+        chi = sqrtMu * timeOfFlight * alpha;
+    }
+    else if (alpha < -1.0e-6) // hyperbolic
+    {
+        double a = 1.0 / alpha;
+        double sign = Sign(timeOfFlight);
+        chi = sign * sqrt(-a) * log(-2.0*_mu*alpha*timeOfFlight /
+              (posDotVel*sqrtMu + sign*sqrt(-_mu*a)*(1.0 - pos0*alpha)));
+    }
+    else // near parabolic
+    {
+        chi = sqrtMu * timeOfFlight / pos0;
+    }
 
-}
\ No newline at end of file
+    // Newton-Raphson iteration on the universal Kepler's Equation, at least one step.
+    const int MAX_COUNTER = 100; // The max number of iteration attempts allowed.
+    int counter = 0;
+    double psi, c2, c3, pos, ratio;
+    do
+    {
+        psi = chi*chi*alpha;
+        CalculateStumpffFunctions(psi, &c2, &c3);
+        pos = chi*chi*c2 + posDotVel*chi*(1.0 - psi*c3) + pos0*(1.0 - psi*c2);
+        ratio = (sqrtMu*timeOfFlight - chi*chi*chi*c3 - posDotVel*chi*chi*c2 - pos0*chi*(1.0 - psi*c3)) / pos;
+        chi += ratio;
+        counter++;
+    } while (fabs(ratio) > 1.0e-12 * Max(1.0, fabs(chi)) && counter < MAX_COUNTER);
+
+    if (counter >= MAX_COUNTER)
+    {
+        // log error
+        throw "Iteration limit exceeded.";
+    }
+
+    psi = chi*chi*alpha;
+    CalculateStumpffFunctions(psi, &c2, &c3);
+    pos = chi*chi*c2 + posDotVel*chi*(1.0 - psi*c3) + pos0*(1.0 - psi*c2);
+
+    // Lagrange coefficients
+    double f = 1.0 - chi*chi/pos0*c2;
+    double g = timeOfFlight - chi*chi*chi/sqrtMu*c3;
+    double fDot = sqrtMu/(pos*pos0)*chi*(psi*c3 - 1.0);
+    double gDot = 1.0 - chi*chi/pos*c2;
+
+    Vector3 Pos = f*Pos0 + g*Vel0;
+    Vector3 Vel = fDot*Pos0 + gDot*Vel0;
+    _stateVector.position = Pos;
+    _stateVector.velocity = Vel;
+    _orbitalElementsState = STATE_DIRTY;
+}
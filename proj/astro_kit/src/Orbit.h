@@ -37,13 +37,35 @@ public:
     OrbitType GetType() const;
 
     bool IsInit() const;
-    
+
+    /// Propagates the orbit along a two-body trajectory.
+    /**
+     The representation that is currently up to date is propagated and the other one is marked dirty, so it
+     is only converted if it is requested. The mean anomaly is advanced when the orbital elements are clean,
+     otherwise the state vector is advanced with the universal variable form of the Lagrange coefficients.
+
+     @param timeOfFlight : The time of flight, which may be negative.
+    */
     void Propagate(double timeOfFlight);
 
+    /// Propagates the orbit with the given propagator.
+    /**
+     PROPAGATE_COES advances the mean anomaly of the orbital elements and PROPAGATE_RV advances the state
+     vector with the Lagrange coefficients, converting the orbit first if needed. Parabolic orbits are
+     always propagated as state vectors.
+
+     @param timeOfFlight : The time of flight, which may be negative.
+     @param propagateType : The propagator to use.
+    */
+    void Propagate(double timeOfFlight, PropagateType propagateType);
+
 private:
     Orbit(); /// Standard ctor;
+    void Initialize(double mu);
     void UpdateStateVector() const;
     void UpdateOrbitalElements() const;
+    void PropagateOrbitalElements(double timeOfFlight);
+    void PropagateStateVector(double timeOfFlight);
 
 private:
     bool _init;
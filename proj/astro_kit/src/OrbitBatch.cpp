@@ -0,0 +1,260 @@
+/*****************************************************************************
+ *   IGATO - Interplanetary Gravity Assist Trajectory Optimizer              *
+ *   Copyright (C) 2012 Jason Bryan (Jmbryan10@gmail.com)                    *
+ *                                                                           *
+ *   IGATO is free software; you can redistribute it and/or modify           *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   IGATO is distributed in the hope that it will be useful,                *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with IGATO; if not, see http://www.gnu.org/licenses/              *
+ *****************************************************************************/
+
+#include "OrbitBatch.h"
+#include "Orbit.h"
+#include "KeplersEquations.h"
+#include "Conversions.h"
+
+OrbitBatch::OrbitBatch(double mu)
+{
+    _mu = mu;
+}
+
+void OrbitBatch::Resize(size_t count)
+{
+    _orbitalElements.Resize(count);
+    _positions.Resize(count);
+    _velocities.Resize(count);
+    _orbitalElementsValid.resize(count, false);
+    _stateVectorsValid.resize(count, false);
+}
+
+void OrbitBatch::SetStateVector(size_t index, const StateVector& stateVector)
+{
+    _positions.Set(index, stateVector.position);
+    _velocities.Set(index, stateVector.velocity);
+    _stateVectorsValid[index] = true;
+    _orbitalElementsValid[index] = false;
+}
+
+void OrbitBatch::SetOrbitalElements(size_t index, const OrbitalElements& orbitalElements)
+{
+    _orbitalElements.Set(index, orbitalElements);
+    _orbitalElementsValid[index] = true;
+    _stateVectorsValid[index] = false;
+}
+
+void OrbitBatch::SetStateVectors(const Vector3Array& positions, const Vector3Array& velocities)
+{
+    assert(positions.Size() == velocities.Size());
+    const size_t count = positions.Size();
+
+    _positions = positions;
+    _velocities = velocities;
+    _orbitalElements.Resize(count);
+    _stateVectorsValid.assign(count, true);
+    _orbitalElementsValid.assign(count, false);
+}
+
+void OrbitBatch::SetOrbitalElements(const OrbitalElementsArray& orbitalElements)
+{
+    const size_t count = orbitalElements.Size();
+
+    _orbitalElements = orbitalElements;
+    _positions.Resize(count);
+    _velocities.Resize(count);
+    _orbitalElementsValid.assign(count, true);
+    _stateVectorsValid.assign(count, false);
+}
+
+void OrbitBatch::GetStates(Vector3Array* positions, Vector3Array* velocities) const
+{
+    positions->Resize(Size());
+    velocities->Resize(Size());
+    GetStates(0, Size(), positions, velocities);
+}
+
+void OrbitBatch::GetStates(size_t begin, size_t end, Vector3Array* positions, Vector3Array* velocities) const
+{
+    assert(end <= Size() && end <= positions->Size() && end <= velocities->Size());
+
+    UpdateStateVectors(begin, end);
+    std::copy(_positions.x.begin() + begin, _positions.x.begin() + end, positions->x.begin() + begin);
+    std::copy(_positions.y.begin() + begin, _positions.y.begin() + end, positions->y.begin() + begin);
+    std::copy(_positions.z.begin() + begin, _positions.z.begin() + end, positions->z.begin() + begin);
+    std::copy(_velocities.x.begin() + begin, _velocities.x.begin() + end, velocities->x.begin() + begin);
+    std::copy(_velocities.y.begin() + begin, _velocities.y.begin() + end, velocities->y.begin() + begin);
+    std::copy(_velocities.z.begin() + begin, _velocities.z.begin() + end, velocities->z.begin() + begin);
+}
+
+const OrbitalElementsArray& OrbitBatch::GetOrbitalElements() const
+{
+    UpdateOrbitalElements(0, Size());
+    return _orbitalElements;
+}
+
+void OrbitBatch::PropagateAll(double timeOfFlight)
+{
+    const size_t count = Size();
+    UpdateOrbitalElements(0, count);
+
+    const double* semimajorAxis = count ? &_orbitalElements.semimajorAxis[0] : NULL;
+    const double* eccentricity = count ? &_orbitalElements.eccentricity[0] : NULL;
+    double* trueAnomaly = count ? &_orbitalElements.trueAnomaly[0] : NULL;
+
+    // Elliptical orbits: gather the mean anomalies and solve them in one call.
+    _indices.clear();
+    _eccentricity.clear();
+    _meanAnomaly.clear();
+    for (size_t i = 0; i < count; ++i)
+    {
+        double e = eccentricity[i];
+        if (e >= ASTRO_ECC_CIRCULAR && e < ASTRO_ECC_PARABOLIC)
+        {
+            double a = semimajorAxis[i];
+            double meanMotion = sqrt(_mu / (a*a*a));
+            double E = atan2(sqrt(1.0 - e*e)*sin(trueAnomaly[i]), e + cos(trueAnomaly[i]));
+            _indices.push_back(i);
+            _eccentricity.push_back(e);
+            _meanAnomaly.push_back(E - e*sin(E) + meanMotion*timeOfFlight);
+        }
+    }
+
+    size_t numberElliptical = _indices.size();
+    _anomaly.resize(numberElliptical);
+    if (numberElliptical > 0)
+    {
+        SolveKeplersEquationE(numberElliptical, &_eccentricity[0], &_meanAnomaly[0], &_anomaly[0]);
+    }
+
+    for (size_t k = 0; k < numberElliptical; ++k)
+    {
+        size_t i = _indices[k];
+        double e = _eccentricity[k];
+        double E = _anomaly[k];
+        double nu = atan2(sqrt(1.0 - e*e)*sin(E), cos(E) - e);
+        trueAnomaly[i] = (nu < 0.0) ? nu + MATH_2_PI : nu;
+        _stateVectorsValid[i] = false;
+    }
+
+    // Hyperbolic orbits
+    _indices.clear();
+    _eccentricity.clear();
+    _meanAnomaly.clear();
+    for (size_t i = 0; i < count; ++i)
+    {
+        double e = eccentricity[i];
+        if (e > ASTRO_ECC_PARABOLIC)
+        {
+            double a = semimajorAxis[i];
+            double meanMotion = sqrt(-_mu / (a*a*a));
+            double H = 2.0 * atanh(sqrt((e - 1.0)/(e + 1.0)) * tan(0.5*trueAnomaly[i]));
+            _indices.push_back(i);
+            _eccentricity.push_back(e);
+            _meanAnomaly.push_back(e*sinh(H) - H + meanMotion*timeOfFlight);
+        }
+    }
+
+    size_t numberHyperbolic = _indices.size();
+    _anomaly.resize(numberHyperbolic);
+    if (numberHyperbolic > 0)
+    {
+        SolveKeplersEquationH(numberHyperbolic, &_eccentricity[0], &_meanAnomaly[0], &_anomaly[0]);
+    }
+
+    for (size_t k = 0; k < numberHyperbolic; ++k)
+    {
+        size_t i = _indices[k];
+        double e = _eccentricity[k];
+        double nu = 2.0 * atan(sqrt((e + 1.0)/(e - 1.0)) * tanh(0.5*_anomaly[k]));
+        trueAnomaly[i] = (nu < 0.0) ? nu + MATH_2_PI : nu;
+        _stateVectorsValid[i] = false;
+    }
+
+    // Parabolic orbits have no finite semimajor axis, propagate their state vectors instead.
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (eccentricity[i] == ASTRO_ECC_PARABOLIC)
+        {
+            UpdateStateVectors(i, i + 1);
+
+            StateVector stateVector;
+            _positions.Get(i, &stateVector.position);
+            _velocities.Get(i, &stateVector.velocity);
+            Orbit orbit(stateVector, _mu);
+            orbit.Propagate(timeOfFlight, PROPAGATE_RV);
+
+            SetStateVector(i, orbit.GetStateVector());
+        }
+    }
+}
+
+void OrbitBatch::Classify(std::vector<OrbitType>* types) const
+{
+    const size_t count = Size();
+    UpdateOrbitalElements(0, count);
+
+    types->resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        double e = _orbitalElements.eccentricity[i];
+        (*types)[i] = (e == ASTRO_ECC_CIRCULAR) ? ORBIT_CIRCULAR :
+                      (e > ASTRO_ECC_CIRCULAR && e < ASTRO_ECC_PARABOLIC) ? ORBIT_ELLIPTICAL :
+                      (e == ASTRO_ECC_PARABOLIC) ? ORBIT_PARABOLIC :
+                      (e > ASTRO_ECC_PARABOLIC) ? ORBIT_HYPERBOLIC : ORBIT_INVALID_TYPE;
+    }
+}
+
+void OrbitBatch::UpdateStateVectors(size_t begin, size_t end) const
+{
+    size_t i = begin;
+    while (i < end)
+    {
+        if (_stateVectorsValid[i])
+        {
+            ++i;
+            continue;
+        }
+
+        // Convert the whole run of stale orbits at once.
+        size_t runEnd = i;
+        while (runEnd < end && !_stateVectorsValid[runEnd])
+        {
+            assert(_orbitalElementsValid[runEnd]);
+            _stateVectorsValid[runEnd] = true;
+            ++runEnd;
+        }
+        ConvertOrbitalElements2StateVectors(_orbitalElements, i, runEnd, &_positions, &_velocities);
+        i = runEnd;
+    }
+}
+
+void OrbitBatch::UpdateOrbitalElements(size_t begin, size_t end) const
+{
+    size_t i = begin;
+    while (i < end)
+    {
+        if (_orbitalElementsValid[i])
+        {
+            ++i;
+            continue;
+        }
+
+        // Convert the whole run of stale orbits at once.
+        size_t runEnd = i;
+        while (runEnd < end && !_orbitalElementsValid[runEnd])
+        {
+            assert(_stateVectorsValid[runEnd]);
+            _orbitalElementsValid[runEnd] = true;
+            ++runEnd;
+        }
+        ConvertStateVectors2OrbitalElements(_positions, _velocities, i, runEnd, &_orbitalElements);
+        i = runEnd;
+    }
+}
@@ -0,0 +1,110 @@
+/*****************************************************************************
+ *   IGATO - Interplanetary Gravity Assist Trajectory Optimizer              *
+ *   Copyright (C) 2012 Jason Bryan (Jmbryan10@gmail.com)                    *
+ *                                                                           *
+ *   IGATO is free software; you can redistribute it and/or modify           *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   IGATO is distributed in the hope that it will be useful,                *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with IGATO; if not, see http://www.gnu.org/licenses/              *
+ *****************************************************************************/
+
+#pragma once
+#include "Base.h"
+
+/// Many two-body orbits about the same central body, stored by column.
+/// This is the batch counterpart of Orbit. The orbital elements and the state vectors are kept in
+/// structure-of-arrays form, and one validity bit per orbit and representation replaces the dirty
+/// flags of Orbit. Stale orbits are converted in contiguous runs by the batch conversion kernels, only
+/// when the representation is requested.
+///
+/// Queries update the cached representations, so an OrbitBatch must not be used from more than one
+/// thread at a time.
+class OrbitBatch
+{
+public:
+    explicit OrbitBatch(double mu);
+
+    /// Changes the number of orbits. New orbits are invalid until they are set.
+    void Resize(size_t count);
+    size_t Size() const;
+    double GetMu() const;
+
+    void SetStateVector(size_t index, const StateVector& stateVector);
+    void SetOrbitalElements(size_t index, const OrbitalElements& orbitalElements);
+
+    /// Replaces every orbit, resizing the batch to the number of states.
+    void SetStateVectors(const Vector3Array& positions, const Vector3Array& velocities);
+    /// Replaces every orbit, resizing the batch to the number of orbital elements.
+    void SetOrbitalElements(const OrbitalElementsArray& orbitalElements);
+
+    /// Copies the state vectors of every orbit, resizing the outputs.
+    void GetStates(Vector3Array* positions, Vector3Array* velocities) const;
+
+    /// Copies the state vectors of the orbits [begin, end) to the same indices of the outputs, which
+    /// must already be large enough to hold them.
+    void GetStates(size_t begin, size_t end, Vector3Array* positions, Vector3Array* velocities) const;
+
+    /// Returns the orbital elements of every orbit, converting the stale ones first.
+    const OrbitalElementsArray& GetOrbitalElements() const;
+
+    /// Propagates every orbit along its two-body trajectory.
+    /**
+     The mean anomalies are advanced and Kepler's Equation is solved with the array solvers, one call
+     for the elliptical orbits and one for the hyperbolic orbits. Parabolic orbits are propagated as
+     state vectors by Orbit. Afterwards the state vectors of the non-parabolic orbits are stale.
+
+     @param timeOfFlight : The time of flight, which may be negative.
+    */
+    void PropagateAll(double timeOfFlight);
+
+    /// Computes the type of every orbit, as Orbit::GetType() does.
+    /**
+     Orbits with a negative or undefined eccentricity are reported as ORBIT_INVALID_TYPE instead of
+     throwing.
+
+     @param [out] types : The orbit types, resized to the number of orbits.
+    */
+    void Classify(std::vector<OrbitType>* types) const;
+
+private:
+    OrbitBatch(const OrbitBatch&);
+    OrbitBatch& operator=(const OrbitBatch&);
+
+    void UpdateStateVectors(size_t begin, size_t end) const;
+    void UpdateOrbitalElements(size_t begin, size_t end) const;
+
+private:
+    double _mu;
+
+    mutable OrbitalElementsArray _orbitalElements;
+    mutable Vector3Array _positions;
+    mutable Vector3Array _velocities;
+
+    mutable std::vector<bool> _orbitalElementsValid;
+    mutable std::vector<bool> _stateVectorsValid;
+
+    // Scratch space of PropagateAll(), kept to avoid reallocating it on every call.
+    std::vector<size_t> _indices;
+    std::vector<double> _eccentricity;
+    std::vector<double> _meanAnomaly;
+    std::vector<double> _anomaly;
+};
+
+// Inline Methods
+inline size_t OrbitBatch::Size() const
+{
+    return _orbitalElements.Size();
+}
+
+inline double OrbitBatch::GetMu() const
+{
+    return _mu;
+}
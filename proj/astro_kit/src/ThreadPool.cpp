@@ -0,0 +1,142 @@
+/*****************************************************************************
+ *   IGATO - Interplanetary Gravity Assist Trajectory Optimizer              *
+ *   Copyright (C) 2012 Jason Bryan (Jmbryan10@gmail.com)                    *
+ *                                                                           *
+ *   IGATO is free software; you can redistribute it and/or modify           *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   IGATO is distributed in the hope that it will be useful,                *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with IGATO; if not, see http://www.gnu.org/licenses/              *
+ *****************************************************************************/
+
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(size_t numberThreads) :
+    _stop(false)
+{
+    if (numberThreads == 0)
+    {
+        numberThreads = Max<size_t>(1, std::thread::hardware_concurrency());
+    }
+
+    _threads.reserve(numberThreads);
+    for (size_t i = 0; i < numberThreads; ++i)
+    {
+        _threads.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _condition.notify_all();
+
+    for (size_t i = 0; i < _threads.size(); ++i)
+    {
+        _threads[i].join();
+    }
+}
+
+void ThreadPool::Enqueue(const std::function<void()>& task)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tasks.push_back(task);
+    }
+    _condition.notify_one();
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& task)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    grainSize = Max<size_t>(1, grainSize);
+
+    size_t numberChunks = (count + grainSize - 1) / grainSize;
+    if (numberChunks == 1)
+    {
+        task(0, count);
+        return;
+    }
+
+    // Completion state shared by the chunks of this call only.
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+    size_t remaining = numberChunks;
+    std::exception_ptr error;
+
+    for (size_t begin = 0; begin < count; begin += grainSize)
+    {
+        size_t end = Min(begin + grainSize, count);
+        Enqueue([&, begin, end]()
+        {
+            std::exception_ptr chunkError;
+            try
+            {
+                task(begin, end);
+            }
+            catch (...)
+            {
+                chunkError = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(doneMutex);
+            if (chunkError && !error)
+            {
+                error = chunkError;
+            }
+            if (--remaining == 0)
+            {
+                doneCondition.notify_one();
+            }
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(doneMutex);
+    while (remaining > 0)
+    {
+        doneCondition.wait(lock);
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::WorkerLoop()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (!_stop && _tasks.empty())
+            {
+                _condition.wait(lock);
+            }
+
+            if (_stop && _tasks.empty())
+            {
+                return;
+            }
+
+            task = _tasks.front();
+            _tasks.pop_front();
+        }
+
+        task();
+    }
+}
@@ -0,0 +1,70 @@
+/*****************************************************************************
+ *   IGATO - Interplanetary Gravity Assist Trajectory Optimizer              *
+ *   Copyright (C) 2012 Jason Bryan (Jmbryan10@gmail.com)                    *
+ *                                                                           *
+ *   IGATO is free software; you can redistribute it and/or modify           *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   IGATO is distributed in the hope that it will be useful,                *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with IGATO; if not, see http://www.gnu.org/licenses/              *
+ *****************************************************************************/
+
+#pragma once
+#include "Base.h"
+
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+/// Fixed-size pool of persistent worker threads.
+/// Workers are started once in the constructor and wait for tasks until the
+/// pool is destroyed, so dispatching work costs a queue push rather than a
+/// thread creation.
+class ThreadPool
+{
+public:
+    /// Creates a pool with the given number of workers. Zero selects the
+    /// number of hardware threads.
+    explicit ThreadPool(size_t numberThreads = 0);
+    ~ThreadPool();
+
+    size_t GetNumberThreads() const;
+
+    /// Queues a task for asynchronous execution on one of the workers.
+    void Enqueue(const std::function<void()>& task);
+
+    /// Splits [0, count) into chunks of at most grainSize items and calls
+    /// task(begin, end) for each chunk on the workers. Blocks until every
+    /// chunk has finished. An exception thrown by a chunk is rethrown here.
+    /// Must not be called from a task running on the same pool.
+    void ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& task);
+
+private:
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    void WorkerLoop();
+
+private:
+    std::vector<std::thread> _threads;
+    std::deque<std::function<void()> > _tasks;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _stop;
+};
+
+// Inline Methods
+inline size_t ThreadPool::GetNumberThreads() const
+{
+    return _threads.size();
+}
@@ -21,15 +21,15 @@
 void TransformPerifocal2Inertial(const Vector3& perifocalVector, double inclination, double raan, double argPerigee, Vector3* inertialVector)
 {
     // Precalculate common trig functions.
-    float cosRAAN = cos(raan);
-    float sinRAAN = sin(raan);
-    float cosOmega = cos(argPerigee);
-    float sinOmega = sin(argPerigee);
-    float cosIncl = cos(inclination);
-    float sinIncl = sin(inclination);
+    double cosRAAN = cos(raan);
+    double sinRAAN = sin(raan);
+    double cosOmega = cos(argPerigee);
+    double sinOmega = sin(argPerigee);
+    double cosIncl = cos(inclination);
+    double sinIncl = sin(inclination);
 
     // Build the rotation matrix
-    static Vector3 row1, row2, row3;
+    Vector3 row1, row2, row3;
     row1.x =  (cosRAAN * cosOmega) - (sinRAAN * sinOmega * cosIncl);
     row1.y = -(cosRAAN * sinOmega) - (sinRAAN * cosIncl * cosOmega);
     row1.z =  (sinRAAN * sinIncl);
@@ -0,0 +1,403 @@
+/*****************************************************************************
+ *   IGATO - Interplanetary Gravity Assist Trajectory Optimizer              *
+ *   Copyright (C) 2012 Jason Bryan (Jmbryan10@gmail.com)                    *
+ *                                                                           *
+ *   IGATO is free software; you can redistribute it and/or modify           *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   IGATO is distributed in the hope that it will be useful,                *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with IGATO; if not, see http://www.gnu.org/licenses/              *
+ *****************************************************************************/
+
+// Lambert solver benchmark.
+// Runs every LambertType over the same randomized problem sets and reports,
+// per regime, the time per solve, the iteration counts and the residual
+// error of the solutions. The residual is the distance between the final
+// position and the initial state propagated by the time of flight. The
+// batched interface is checked against the single problem interface by the
+// largest difference of the departure velocities of converged problems.
+// Porkchop grids then compare cold solves with warm started sweeps and the
+// throughput of the two interfaces.
+
+#include "Lambert.h"
+#include "KeplersEquations.h"
+#include "Base.h"
+
+#include <chrono>
+
+/// Problem set sharing one transfer regime.
+struct Regime
+{
+    const char* name;
+    double minTimeOfFlight;
+    double maxTimeOfFlight;
+    int numberRevolutions;
+};
+
+static const char* LambertTypeName(LambertType lambertType)
+{
+    switch (lambertType)
+    {
+    case LAMBERT_EXP_SINUSOID:       return "ExpSinusoid";
+    case LAMBERT_BATTIN:             return "Battin";
+    case LAMBERT_UNIVERSAL_VAR:      return "UniversalVar";
+    case LAMBERT_UNIVERSAL_VAR_BULK: return "UniversalVarBulk";
+    case LAMBERT_IZZO:               return "Izzo";
+    default:                         return "Unknown";
+    }
+}
+
+/// Universal variable Kepler time of flight and radius for the given chi.
+static void KeplerTime(double chi, double r0, double rv, double alpha, double* t, double* r)
+{
+    double c2, c3;
+    double psi = chi * chi * alpha;
+    CalculateStumpffFunctions(psi, &c2, &c3);
+    *r = chi*chi*c2 + rv*chi*(1.0 - psi*c3) + r0*(1.0 - psi*c2);
+    *t = chi*chi*chi*c3 + rv*chi*chi*c2 + r0*chi*(1.0 - psi*c3);
+}
+
+/// Propagates a state forward by the time of flight with the universal
+/// variable Kepler solution (canonical units, mu = 1) and returns the final
+/// position. Newton iterations on chi are safeguarded by bisection so the
+/// reference stays reliable for every orbit the solvers may return.
+static Vector3 PropagateKepler(const Vector3& position, const Vector3& velocity, double timeOfFlight)
+{
+    double r0 = position.length();
+    double rv = position.dot(velocity);
+    double alpha = 2.0 / r0 - velocity.lengthSquared();
+
+    // Whole periods do not change the final position
+    double dt = timeOfFlight;
+    if (alpha > 0.0)
+    {
+        double period = MATH_2_PI / (alpha * sqrt(alpha));
+        dt = fmod(dt, period);
+    }
+
+    // Time of flight is monotonic in chi, bracket the root
+    double t, r;
+    double lower = 0.0, upper = Max(dt / r0, 1.0e-3);
+    KeplerTime(upper, r0, rv, alpha, &t, &r);
+    while (t < dt)
+    {
+        lower = upper;
+        upper *= 2.0;
+        KeplerTime(upper, r0, rv, alpha, &t, &r);
+    }
+
+    double chi = 0.5 * (lower + upper);
+    for (int i = 0; i < 200; ++i)
+    {
+        KeplerTime(chi, r0, rv, alpha, &t, &r);
+        if (t < dt) lower = chi; else upper = chi;
+
+        double next = chi - (t - dt) / r;
+        if (next <= lower || next >= upper)
+        {
+            next = 0.5 * (lower + upper);
+        }
+        if (fabs(next - chi) < 1.0e-15 * Max(1.0, chi))
+        {
+            chi = next;
+            break;
+        }
+        chi = next;
+    }
+
+    double c2, c3;
+    CalculateStumpffFunctions(chi * chi * alpha, &c2, &c3);
+    double f = 1.0 - chi*chi*c2 / r0;
+    double g = dt - chi*chi*chi*c3;
+    return f * position + g * velocity;
+}
+
+static void GenerateProblems(const Regime& regime, size_t count, LambertBatch* batch)
+{
+    batch->Resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        double r1 = 0.4 + 1.6 * Random0_1();
+        double r2 = 0.4 + 1.6 * Random0_1();
+        double angle1 = MATH_2_PI * Random0_1();
+        double angle2 = MATH_2_PI * Random0_1();
+        Vector3 initialPosition(r1 * cos(angle1), r1 * sin(angle1), 0.05 * r1 * RandomMinus1_1());
+        Vector3 finalPosition(r2 * cos(angle2), r2 * sin(angle2), 0.05 * r2 * RandomMinus1_1());
+        double timeOfFlight = regime.minTimeOfFlight + (regime.maxTimeOfFlight - regime.minTimeOfFlight) * Random0_1();
+        OrbitDirection orbitDirection = (i % 2 == 0) ? ORBIT_DIR_PROGRADE : ORBIT_DIR_RETROGRADE;
+
+        batch->SetProblem(i, initialPosition, finalPosition, timeOfFlight, orbitDirection, regime.numberRevolutions);
+    }
+}
+
+static void RunSolver(LambertType lambertType, LambertBatch* batch)
+{
+    typedef std::chrono::high_resolution_clock Clock;
+
+    Lambert* solver = LambertManager::CreateLambertSolver(lambertType);
+    const size_t count = batch->Size();
+
+    // Single problem interface, collecting diagnostics
+    Vector3 initialPosition, finalPosition;
+    Vector3 initialVelocity, finalVelocity;
+    std::vector<LambertInfo> infos(count);
+
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < count; ++i)
+    {
+        batch->initialPosition.Get(i, &initialPosition);
+        batch->finalPosition.Get(i, &finalPosition);
+        infos[i].iterations = 0;
+        infos[i].converged = false;
+
+        solver->Evaluate(initialPosition, finalPosition,
+                         batch->timeOfFlight[i],
+                         batch->orbitDirection[i],
+                         batch->numberRevolutions[i],
+                         &initialVelocity, &finalVelocity,
+                         &infos[i]);
+
+        batch->initialVelocity.Set(i, initialVelocity);
+    }
+    double scalarTime = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Batched interface
+    LambertBatch batchCopy = *batch;
+    start = Clock::now();
+    solver->EvaluateBatch(&batchCopy, 0, count);
+    double batchTime = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Diagnostics
+    int totalIterations = 0, maxIterations = 0;
+    size_t converged = 0, accurate = 0;
+    double totalResidual = 0.0, maxResidual = 0.0, maxBatchDifference = 0.0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        totalIterations += infos[i].iterations;
+        maxIterations = Max(maxIterations, infos[i].iterations);
+        if (!infos[i].converged)
+        {
+            continue;
+        }
+        converged++;
+
+        Vector3 batchVelocity;
+        batch->initialVelocity.Get(i, &initialVelocity);
+        batchCopy.initialVelocity.Get(i, &batchVelocity);
+        maxBatchDifference = Max(maxBatchDifference, batchVelocity.distance(initialVelocity));
+
+        batch->initialPosition.Get(i, &initialPosition);
+        batch->finalPosition.Get(i, &finalPosition);
+        Vector3 propagated = PropagateKepler(initialPosition, initialVelocity, batch->timeOfFlight[i]);
+        double residual = propagated.distance(finalPosition) / finalPosition.length();
+        if (residual == residual) // skip NaN
+        {
+            accurate += (residual < 1.0e-8) ? 1 : 0;
+            totalResidual += residual;
+            maxResidual = Max(maxResidual, residual);
+        }
+    }
+
+    printf("  %-16s %10.1f %10.1f %8.2f %6d %9.1f%% %9.1f%% %12.2e %12.2e %12.2e\n",
+           LambertTypeName(lambertType),
+           1.0e9 * scalarTime / count,
+           1.0e9 * batchTime / count,
+           (double)totalIterations / count,
+           maxIterations,
+           100.0 * converged / count,
+           100.0 * accurate / count,
+           (converged > 0) ? totalResidual / converged : 0.0,
+           maxResidual,
+           maxBatchDifference);
+
+    delete solver;
+}
+
+/// Porkchop style grid: departure from a circular orbit at 1 DU to one at
+/// 1.5 DU, spaced about a day apart in departure epoch and time of flight.
+static void GenerateGrid(size_t numberRows, size_t numberColumns, LambertBatch* batch)
+{
+    batch->Resize(numberRows * numberColumns);
+    for (size_t row = 0; row < numberRows; ++row)
+    {
+        for (size_t column = 0; column < numberColumns; ++column)
+        {
+            double departure = 0.02 * row;
+            double timeOfFlight = 1.0 + 0.02 * column;
+            double arrivalAngle = 1.0 + (departure + timeOfFlight) / (1.5 * sqrt(1.5));
+            batch->SetProblem(row * numberColumns + column,
+                              Vector3(cos(departure), sin(departure), 0.0),
+                              Vector3(1.5 * cos(arrivalAngle), 1.5 * sin(arrivalAngle), 0.01),
+                              timeOfFlight, ORBIT_DIR_PROGRADE, 0);
+        }
+    }
+}
+
+/// Times cold solves of every cell of a grid against Lambert::EvaluateSweep()
+/// and the batched interface, taking the best of a few repetitions of each
+/// so that the order of the runs does not favour one of them.
+static void RunSweep(LambertType lambertType, LambertBatch* batch, size_t numberRows, size_t numberColumns)
+{
+    typedef std::chrono::high_resolution_clock Clock;
+    const int numberRepetitions = 5;
+
+    Lambert* solver = LambertManager::CreateLambertSolver(lambertType);
+    const size_t count = batch->Size();
+
+    Vector3 initialPosition, finalPosition, initialVelocity, finalVelocity;
+    LambertInfo info;
+    std::vector<LambertInfo> infos;
+    int coldIterations = 0;
+    double coldTime = 1.0e30, sweepTime = 1.0e30, batchTime = 1.0e30;
+
+    for (int repetition = 0; repetition < numberRepetitions; ++repetition)
+    {
+        coldIterations = 0;
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < count; ++i)
+        {
+            batch->initialPosition.Get(i, &initialPosition);
+            batch->finalPosition.Get(i, &finalPosition);
+            solver->Evaluate(initialPosition, finalPosition,
+                             batch->timeOfFlight[i],
+                             batch->orbitDirection[i],
+                             batch->numberRevolutions[i],
+                             &initialVelocity, &finalVelocity,
+                             &info);
+            coldIterations += info.iterations;
+        }
+        coldTime = Min(coldTime, std::chrono::duration<double>(Clock::now() - start).count());
+
+        start = Clock::now();
+        solver->EvaluateSweep(batch, numberRows, numberColumns);
+        sweepTime = Min(sweepTime, std::chrono::duration<double>(Clock::now() - start).count());
+
+        start = Clock::now();
+        solver->EvaluateBatch(batch, 0, count);
+        batchTime = Min(batchTime, std::chrono::duration<double>(Clock::now() - start).count());
+    }
+
+    solver->EvaluateSweep(batch, numberRows, numberColumns, LAMBERT_SWEEP_WARM_START, &infos);
+    int sweepIterations = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        sweepIterations += infos[i].iterations;
+    }
+
+    printf("  %-16s %10.1f %10.1f %10.1f %10.2f %10.2f\n",
+           LambertTypeName(lambertType),
+           1.0e9 * coldTime / count,
+           1.0e9 * sweepTime / count,
+           1.0e9 * batchTime / count,
+           (double)coldIterations / count,
+           (double)sweepIterations / count);
+
+    delete solver;
+}
+
+/// Times the single problem interface against the batched interface over a
+/// whole grid.
+static void RunThroughput(LambertType lambertType, LambertBatch* batch)
+{
+    typedef std::chrono::high_resolution_clock Clock;
+
+    Lambert* solver = LambertManager::CreateLambertSolver(lambertType);
+    const size_t count = batch->Size();
+
+    Vector3 initialPosition, finalPosition, initialVelocity, finalVelocity;
+
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < count; ++i)
+    {
+        batch->initialPosition.Get(i, &initialPosition);
+        batch->finalPosition.Get(i, &finalPosition);
+        solver->Evaluate(initialPosition, finalPosition,
+                         batch->timeOfFlight[i],
+                         batch->orbitDirection[i],
+                         batch->numberRevolutions[i],
+                         &initialVelocity, &finalVelocity);
+        batch->initialVelocity.Set(i, initialVelocity);
+        batch->finalVelocity.Set(i, finalVelocity);
+    }
+    double scalarTime = std::chrono::duration<double>(Clock::now() - start).count();
+
+    start = Clock::now();
+    solver->EvaluateBatch(batch, 0, count);
+    double batchTime = std::chrono::duration<double>(Clock::now() - start).count();
+
+    printf("  %-16s %10.3f %10.3f %10.2f\n",
+           LambertTypeName(lambertType),
+           scalarTime,
+           batchTime,
+           batchTime / scalarTime);
+
+    delete solver;
+}
+
+/**
+ * Main entry point. The optional arguments set the number of problems per regime
+ * and the size of the square throughput grid.
+ */
+int main(int argc, char *argv[])
+{
+    size_t count = (argc > 1) ? (size_t)atoi(argv[1]) : 10000;
+    size_t gridSize = (argc > 2) ? (size_t)atoi(argv[2]) : 1000;
+
+    const Regime regimes[] =
+    {
+        { "Short transfers (0.5 - 3 TU, 0 rev)",   0.5,  3.0, 0 },
+        { "Long transfers (3 - 15 TU, 0 rev)",     3.0, 15.0, 0 },
+        { "Multi-revolution (8 - 30 TU, 1 rev)",   8.0, 30.0, 1 },
+        { "Multi-revolution (15 - 45 TU, 2 rev)", 15.0, 45.0, 2 },
+    };
+    const int numberRegimes = sizeof(regimes) / sizeof(regimes[0]);
+
+    for (int r = 0; r < numberRegimes; ++r)
+    {
+        // Every solver sees the same problems
+        srand(2012 + r);
+        LambertBatch batch;
+        GenerateProblems(regimes[r], count, &batch);
+
+        printf("%s, %u problems\n", regimes[r].name, (unsigned)count);
+        printf("  %-16s %10s %10s %8s %6s %10s %10s %12s %12s %12s\n",
+               "Solver", "ns/solve", "ns/batch", "iter", "max", "converged", "accurate", "mean resid", "max resid", "batch dv");
+
+        for (int lambertType = 0; lambertType < LAMBERT_COUNT; ++lambertType)
+        {
+            RunSolver((LambertType)lambertType, &batch);
+        }
+        printf("\n");
+    }
+
+    const size_t numberRows = 100, numberColumns = Max<size_t>(1, count / 100);
+    LambertBatch grid;
+    GenerateGrid(numberRows, numberColumns, &grid);
+
+    printf("Porkchop grid sweep, %u x %u problems\n", (unsigned)numberRows, (unsigned)numberColumns);
+    printf("  %-16s %10s %10s %10s %10s %10s\n", "Solver", "ns/cold", "ns/sweep", "ns/batch", "iter/cold", "iter/sweep");
+    for (int lambertType = 0; lambertType < LAMBERT_COUNT; ++lambertType)
+    {
+        RunSweep((LambertType)lambertType, &grid, numberRows, numberColumns);
+    }
+    printf("\n");
+
+    LambertBatch throughputGrid;
+    GenerateGrid(gridSize, gridSize, &throughputGrid);
+
+    printf("Porkchop grid throughput, %u x %u problems\n", (unsigned)gridSize, (unsigned)gridSize);
+    printf("  %-16s %10s %10s %10s\n", "Solver", "s/solve", "s/batch", "batch/solve");
+    for (int lambertType = 0; lambertType < LAMBERT_COUNT; ++lambertType)
+    {
+        RunThroughput((LambertType)lambertType, &throughputGrid);
+    }
+
+    return 0;
+}
@@ -38,4 +38,72 @@ TEST(ConversionsTest, EarthUnitsTest)
     EXPECT_NEAR(0.62, velocityCanonical.x, TEST_VU_TOLERANCE);
     EXPECT_NEAR(0.7, velocityCanonical.y, TEST_VU_TOLERANCE);
     EXPECT_NEAR(-0.25, velocityCanonical.z, TEST_VU_TOLERANCE);
-}
\ No newline at end of file
+}
+
+TEST(ConversionsTest, BatchConversionsMatchScalar)
+{
+    // General, hyperbolic, equatorial, circular inclined and circular equatorial orbits.
+    const int count = 6;
+    const double positions[count][3] = {{0.8, 0.5, 0.1}, {1.0, 0.0, 0.0}, {1.0, 0.0, 0.0}, {1.0, 0.0, 0.0}, {1.0, 0.0, 0.0}, {-0.3, 1.2, 0.0}};
+    const double velocities[count][3] = {{-0.4, 0.9, 0.2}, {0.3, 1.6, 0.4}, {0.0, 1.2, 0.0}, {0.0, 0.6, 0.8}, {0.0, 1.0, 0.0}, {-0.9, -0.2, 0.0}};
+
+    Vector3Array batchPositions, batchVelocities;
+    batchPositions.Resize(count);
+    batchVelocities.Resize(count);
+    for (int i = 0; i < count; ++i)
+    {
+        batchPositions.Set(i, Vector3(positions[i][0], positions[i][1], positions[i][2]));
+        batchVelocities.Set(i, Vector3(velocities[i][0], velocities[i][1], velocities[i][2]));
+    }
+
+    OrbitalElementsArray batchElements;
+    ConvertStateVectors2OrbitalElements(batchPositions, batchVelocities, &batchElements);
+    ASSERT_EQ(static_cast<size_t>(count), batchElements.Size());
+
+    Vector3Array newPositions, newVelocities;
+    ConvertOrbitalElements2StateVectors(batchElements, &newPositions, &newVelocities);
+    ASSERT_EQ(static_cast<size_t>(count), newPositions.Size());
+
+    for (int i = 0; i < count; ++i)
+    {
+        StateVector stateVector;
+        batchPositions.Get(i, &stateVector.position);
+        batchVelocities.Get(i, &stateVector.velocity);
+        OrbitalElements orbitalElements;
+        ConvertStateVector2OrbitalElements(stateVector, &orbitalElements);
+
+        EXPECT_NEAR(orbitalElements.semimajorAxis, batchElements.semimajorAxis[i], 1.0e-12);
+        EXPECT_NEAR(orbitalElements.eccentricity, batchElements.eccentricity[i], 1.0e-12);
+        EXPECT_NEAR(orbitalElements.argPerigee, batchElements.argPerigee[i], 1.0e-12);
+        EXPECT_NEAR(orbitalElements.inclination, batchElements.inclination[i], 1.0e-12);
+        EXPECT_NEAR(orbitalElements.raan, batchElements.raan[i], 1.0e-12);
+        EXPECT_NEAR(orbitalElements.trueAnomaly, batchElements.trueAnomaly[i], 1.0e-12);
+
+        ConvertOrbitalElements2StateVector(orbitalElements, &stateVector);
+        EXPECT_NEAR(stateVector.position.x, newPositions.x[i], 1.0e-12);
+        EXPECT_NEAR(stateVector.position.y, newPositions.y[i], 1.0e-12);
+        EXPECT_NEAR(stateVector.position.z, newPositions.z[i], 1.0e-12);
+        EXPECT_NEAR(stateVector.velocity.x, newVelocities.x[i], 1.0e-12);
+        EXPECT_NEAR(stateVector.velocity.y, newVelocities.y[i], 1.0e-12);
+        EXPECT_NEAR(stateVector.velocity.z, newVelocities.z[i], 1.0e-12);
+
+        // Circular and equatorial orbits measure angles from different references, so only
+        // the round trip of the general and hyperbolic orbits recovers the original state.
+        if (i < 2)
+        {
+            EXPECT_NEAR(positions[i][0], newPositions.x[i], 1.0e-12);
+            EXPECT_NEAR(positions[i][1], newPositions.y[i], 1.0e-12);
+            EXPECT_NEAR(positions[i][2], newPositions.z[i], 1.0e-12);
+            EXPECT_NEAR(velocities[i][0], newVelocities.x[i], 1.0e-12);
+            EXPECT_NEAR(velocities[i][1], newVelocities.y[i], 1.0e-12);
+            EXPECT_NEAR(velocities[i][2], newVelocities.z[i], 1.0e-12);
+        }
+    }
+
+    // Hyperbolic case
+    EXPECT_GT(batchElements.eccentricity[1], 1.0);
+    EXPECT_LT(batchElements.semimajorAxis[1], 0.0);
+    // Circular equatorial case
+    EXPECT_EQ(0.0, batchElements.eccentricity[4]);
+    EXPECT_EQ(0.0, batchElements.inclination[4]);
+}
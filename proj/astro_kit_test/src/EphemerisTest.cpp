@@ -18,6 +18,9 @@
 
 #include "gtest/gtest.h"
 #include "Ephemeris.h"
+#include "ThreadPool.h"
+#include "jpleph.h"
+#include "jpl_int.h"
 #include "Base.h"
 
 // Analytical Ephemeris Fixture
@@ -58,4 +61,741 @@ TEST_F(AnalyticalEphemerisTest, EarthOrbitTest)
     EXPECT_NEAR(-1.006694, stateVector.velocity.x, TEST_VU_TOLERANCE);
     EXPECT_NEAR(-0.142867, stateVector.velocity.y, TEST_VU_TOLERANCE);
     EXPECT_NEAR(0.0, stateVector.velocity.z, TEST_VU_TOLERANCE);
-}
\ No newline at end of file
+}
+
+TEST_F(AnalyticalEphemerisTest, ConcurrentQueriesMatchSerial)
+{
+    const int numberEpochs = 500;
+    const size_t count = PLANET_COUNT * numberEpochs;
+    const Ephemeris* ephemeris = EphemerisManager::GetEphemeris();
+    ASSERT_TRUE(ephemeris != NULL);
+
+    std::vector<StateVector> serial(count), parallel(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        ephemeris->GetOrbitAtEpoch(i % PLANET_COUNT, epoch + i / PLANET_COUNT, NULL, &serial[i]);
+    }
+
+    ThreadPool threadPool(4);
+    threadPool.ParallelFor(count, 16, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            ephemeris->GetOrbitAtEpoch(i % PLANET_COUNT, epoch + i / PLANET_COUNT, NULL, &parallel[i]);
+        }
+    });
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        EXPECT_EQ(serial[i].position.x, parallel[i].position.x);
+        EXPECT_EQ(serial[i].position.y, parallel[i].position.y);
+        EXPECT_EQ(serial[i].position.z, parallel[i].position.z);
+        EXPECT_EQ(serial[i].velocity.x, parallel[i].velocity.x);
+        EXPECT_EQ(serial[i].velocity.y, parallel[i].velocity.y);
+        EXPECT_EQ(serial[i].velocity.z, parallel[i].velocity.z);
+    }
+}
+
+TEST_F(AnalyticalEphemerisTest, AllPlanetsMatchSerial)
+{
+    AnalyticalEphemeris ephemeris;
+    for (int i = 0; i < 100; ++i)
+    {
+        const double queryEpoch = epoch + 36.525 * i;
+        OrbitalElements allElements[PLANET_COUNT];
+        StateVector allStates[PLANET_COUNT];
+        ephemeris.GetAllPlanetsAtEpoch(queryEpoch, allElements, allStates);
+
+        for (int planetId = 0; planetId < PLANET_COUNT; ++planetId)
+        {
+            ephemeris.GetOrbitAtEpoch(planetId, queryEpoch, &orbitalElements, &stateVector);
+            EXPECT_NEAR(orbitalElements.semimajorAxis, allElements[planetId].semimajorAxis, 1.0e-12);
+            EXPECT_NEAR(orbitalElements.eccentricity, allElements[planetId].eccentricity, 1.0e-12);
+            EXPECT_NEAR(orbitalElements.inclination, allElements[planetId].inclination, 1.0e-12);
+            EXPECT_NEAR(orbitalElements.raan, allElements[planetId].raan, 1.0e-12);
+            EXPECT_NEAR(orbitalElements.argPerigee, allElements[planetId].argPerigee, 1.0e-12);
+            EXPECT_NEAR(orbitalElements.trueAnomaly, allElements[planetId].trueAnomaly, 1.0e-12);
+            EXPECT_NEAR(stateVector.position.x, allStates[planetId].position.x, 1.0e-12);
+            EXPECT_NEAR(stateVector.position.y, allStates[planetId].position.y, 1.0e-12);
+            EXPECT_NEAR(stateVector.position.z, allStates[planetId].position.z, 1.0e-12);
+            EXPECT_NEAR(stateVector.velocity.x, allStates[planetId].velocity.x, 1.0e-12);
+            EXPECT_NEAR(stateVector.velocity.y, allStates[planetId].velocity.y, 1.0e-12);
+            EXPECT_NEAR(stateVector.velocity.z, allStates[planetId].velocity.z, 1.0e-12);
+        }
+    }
+}
+
+TEST_F(AnalyticalEphemerisTest, ChebyshevFitMatchesSource)
+{
+    const double startEpoch = epoch;
+    const double endEpoch = epoch + 3652.5;
+    const double tolerance = 1.0e-9;
+    const Ephemeris* source = EphemerisManager::GetEphemeris();
+    ChebyshevEphemeris ephemeris(source, startEpoch, endEpoch, tolerance);
+
+    for (int planetId = 0; planetId < PLANET_COUNT; ++planetId)
+    {
+        double positionError, velocityError;
+        ephemeris.GetFitError(planetId, &positionError, &velocityError);
+        EXPECT_LE(positionError, tolerance);
+        EXPECT_LE(velocityError, tolerance);
+
+        // Check well away from the points used to fit and measure the error.
+        const int numberEpochs = 1000;
+        for (int i = 0; i < numberEpochs; ++i)
+        {
+            double queryEpoch = startEpoch + (endEpoch - startEpoch) * (i + 0.3) / numberEpochs;
+            source->GetOrbitAtEpoch(planetId, queryEpoch, NULL, &stateVector);
+            StateVector fitted;
+            ephemeris.GetOrbitAtEpoch(planetId, queryEpoch, NULL, &fitted);
+            EXPECT_NEAR(stateVector.position.x, fitted.position.x, 2.0 * tolerance);
+            EXPECT_NEAR(stateVector.position.y, fitted.position.y, 2.0 * tolerance);
+            EXPECT_NEAR(stateVector.position.z, fitted.position.z, 2.0 * tolerance);
+            EXPECT_NEAR(stateVector.velocity.x, fitted.velocity.x, 2.0 * tolerance);
+            EXPECT_NEAR(stateVector.velocity.y, fitted.velocity.y, 2.0 * tolerance);
+            EXPECT_NEAR(stateVector.velocity.z, fitted.velocity.z, 2.0 * tolerance);
+        }
+    }
+
+    // Outside the window the source is used.
+    StateVector fitted;
+    source->GetOrbitAtEpoch(PLANET_MARS, endEpoch + 10.0, NULL, &stateVector);
+    ephemeris.GetOrbitAtEpoch(PLANET_MARS, endEpoch + 10.0, NULL, &fitted);
+    EXPECT_EQ(stateVector.position.x, fitted.position.x);
+    EXPECT_EQ(stateVector.velocity.z, fitted.velocity.z);
+}
+
+TEST_F(AnalyticalEphemerisTest, FitEphemerisReplacesCurrent)
+{
+    StateVector direct;
+    EphemerisManager::GetOrbitAtEpoch(PLANET_EARTH, epoch + 100.25, NULL, &direct);
+
+    EphemerisManager::FitEphemeris(epoch, epoch + 365.25, 1.0e-10);
+    ASSERT_TRUE(dynamic_cast<const ChebyshevEphemeris*>(EphemerisManager::GetEphemeris()) != NULL);
+
+    EphemerisManager::GetOrbitAtEpoch(PLANET_EARTH, epoch + 100.25, &orbitalElements, &stateVector);
+    EXPECT_NEAR(direct.position.x, stateVector.position.x, 1.0e-9);
+    EXPECT_NEAR(direct.velocity.y, stateVector.velocity.y, 1.0e-9);
+    EXPECT_NEAR(1.0, orbitalElements.semimajorAxis, TEST_DU_TOLERANCE);
+    EXPECT_NEAR(0.016705, orbitalElements.eccentricity, TEST_ECC_TOLERANCE);
+
+    EphemerisManager::SetEphemerisType(EPHEMERIS_ANALYTICAL);
+}
+
+TEST_F(AnalyticalEphemerisTest, FitEphemerisInvalidWindowKeepsCurrent)
+{
+    const Ephemeris* current = EphemerisManager::GetEphemeris();
+    EXPECT_ANY_THROW(EphemerisManager::FitEphemeris(epoch, epoch - 365.25, 1.0e-10));
+    EXPECT_ANY_THROW(EphemerisManager::FitEphemeris(epoch, epoch + 365.25, 0.0));
+    ASSERT_EQ(current, EphemerisManager::GetEphemeris());
+
+    EphemerisManager::GetOrbitAtEpoch(PLANET_EARTH, epoch, &orbitalElements, &stateVector);
+    EXPECT_NEAR(1.0, orbitalElements.semimajorAxis, TEST_DU_TOLERANCE);
+    EXPECT_NEAR(0.016705, orbitalElements.eccentricity, TEST_ECC_TOLERANCE);
+}
+
+TEST(JplEphemerisTest, FileNotSetThrows)
+{
+    JplEphemeris ephemeris;
+    StateVector stateVector;
+    try
+    {
+        ephemeris.GetOrbitAtEpoch(PLANET_EARTH, 2455195, NULL, &stateVector);
+        FAIL() << "Expected JplEphemerisFileError";
+    }
+    catch (const JplEphemerisFileError& error)
+    {
+        EXPECT_EQ(JPL_INIT_NOT_CALLED, error.GetErrorCode());
+    }
+}
+
+TEST(JplEphemerisTest, MissingFileThrowsOnFirstQuery)
+{
+    JplEphemeris ephemeris;
+    EXPECT_NO_THROW(ephemeris.SetEphemerisFile("missing_ephemeris_file.405"));
+
+    StateVector stateVector;
+    try
+    {
+        ephemeris.GetOrbitAtEpoch(PLANET_EARTH, 2455195, NULL, &stateVector);
+        FAIL() << "Expected JplEphemerisFileError";
+    }
+    catch (const JplEphemerisFileError& error)
+    {
+        EXPECT_EQ(JPL_INIT_FILE_NOT_FOUND, error.GetErrorCode());
+    }
+}
+
+// A small synthetic JPL ephemeris in the DE binary format, so that the JPL reader can be tested without
+// a real DE file. Record 0 holds states that are known exactly: planet p sits at p + 1 AU along the
+// ecliptic pole (given in the equatorial frame of the file) and moves at 1 AU/day along x, with the
+// Sun and Moon at the barycenter. The other records hold pseudo-random Chebyshev series for every
+// body, with several sub-intervals for some of them as in the real files.
+static const double TEST_JPL_START             = 2451536.5;
+static const double TEST_JPL_STEP              = 32.0;
+static const int    TEST_JPL_NUMBER_RECORDS    = 6;
+static const double TEST_JPL_END               = TEST_JPL_START + TEST_JPL_NUMBER_RECORDS * TEST_JPL_STEP;
+static const double TEST_JPL_OBLIQUITY         = 23.4392911111 * MATH_PI / 180.0;
+static const int    TEST_JPL_LAYOUT[11][2]     = {{14, 4}, {10, 2}, {13, 2}, {11, 1}, {8, 1}, {7, 1},
+                                                  {6, 1}, {6, 1}, {6, 1}, {13, 8}, {11, 2}}; // coefficients, sub-intervals
+
+class JplEphemerisFileTest : public ::testing::Test
+{
+protected:
+
+    JplEphemerisFileTest() : filename("test_ephemeris.405") {}
+    virtual ~JplEphemerisFileTest() {}
+
+    virtual void SetUp()
+    {
+        WriteEphemeris(filename, false);
+    }
+
+    virtual void TearDown()
+    {
+        remove(filename.c_str());
+    }
+
+    // Writes the ephemeris, in the opposite byte order to this machine if swapBytes is set.
+    static void WriteEphemeris(const std::string& filepath, bool swapBytes)
+    {
+        int ipt[13][3] = {};
+        int numberCoefficients = 2;
+        for (int body = 0; body < 11; ++body)
+        {
+            ipt[body][0] = numberCoefficients + 1;
+            ipt[body][1] = TEST_JPL_LAYOUT[body][0];
+            ipt[body][2] = TEST_JPL_LAYOUT[body][1];
+            numberCoefficients += 3 * ipt[body][1] * ipt[body][2];
+        }
+        const size_t recordSize = RecordSize();
+        std::vector<char> file((TEST_JPL_NUMBER_RECORDS + 2) * recordSize, 0);
+
+        // Header record: three title lines, the constant names, then the numbers. The reader tells
+        // the byte order from the number of constants, so there must be some.
+        const char title[] = "JPL Planetary Ephemeris DE405/LE405";
+        const char names[] = "DENUM AU    EMRAT ";
+        const double values[3] = {405.0, ASTRO_AU_TO_KM, 81.30056};
+        memset(&file[0], ' ', 3 * 84);
+        memcpy(&file[0], title, sizeof(title) - 1);
+        memcpy(&file[3 * 84], names, sizeof(names) - 1);
+        size_t offset = 2652;
+        PutDouble(&file, &offset, TEST_JPL_START, swapBytes);
+        PutDouble(&file, &offset, TEST_JPL_END, swapBytes);
+        PutDouble(&file, &offset, TEST_JPL_STEP, swapBytes);
+        PutInt(&file, &offset, 3, swapBytes);
+        PutDouble(&file, &offset, values[1], swapBytes);
+        PutDouble(&file, &offset, values[2], swapBytes);
+        for (int body = 0; body < 12; ++body)
+        {
+            for (int i = 0; i < 3; ++i)
+            {
+                PutInt(&file, &offset, ipt[body][i], swapBytes);
+            }
+        }
+        PutInt(&file, &offset, 405, swapBytes);
+        for (int i = 0; i < 3; ++i)
+        {
+            PutInt(&file, &offset, ipt[12][i], swapBytes);
+        }
+
+        offset = recordSize;
+        for (int i = 0; i < 3; ++i)
+        {
+            PutDouble(&file, &offset, values[i], swapBytes);
+        }
+
+        // Data records, after the header and constants records
+        const double pole[3] = {0.0, -sin(TEST_JPL_OBLIQUITY), cos(TEST_JPL_OBLIQUITY)};
+        unsigned int seed = 12345;
+        for (int record = 0; record < TEST_JPL_NUMBER_RECORDS; ++record)
+        {
+            offset = (record + 2) * recordSize;
+            PutDouble(&file, &offset, TEST_JPL_START + record * TEST_JPL_STEP, swapBytes);
+            PutDouble(&file, &offset, TEST_JPL_START + (record + 1) * TEST_JPL_STEP, swapBytes);
+            for (int body = 0; body < 11; ++body)
+            {
+                const int n = TEST_JPL_LAYOUT[body][0];
+                const int na = TEST_JPL_LAYOUT[body][1];
+                for (int interval = 0; interval < na; ++interval)
+                {
+                    for (int component = 0; component < 3; ++component)
+                    {
+                        for (int k = 0; k < n; ++k)
+                        {
+                            double coefficient = 0.0;
+                            if (record > 0)
+                            {
+                                seed = 1103515245 * seed + 12345;
+                                coefficient = ASTRO_AU_TO_KM * (body + 1) * ((seed >> 8) / 8388608.0 - 1.0) / ((k + 1) * (k + 1));
+                            }
+                            else if (body < 9)
+                            {
+                                // x = v (t - middle of the record) with v = 1 AU/day, on each sub-interval
+                                const double interval_length = TEST_JPL_STEP / na;
+                                if (k == 0)
+                                {
+                                    coefficient = (body + 1) * ASTRO_AU_TO_KM * pole[component];
+                                    if (component == 0)
+                                    {
+                                        coefficient += ASTRO_AU_TO_KM * interval_length * (interval + 0.5 - 0.5 * na);
+                                    }
+                                }
+                                else if (k == 1 && component == 0)
+                                {
+                                    coefficient = ASTRO_AU_TO_KM * 0.5 * interval_length;
+                                }
+                            }
+                            PutDouble(&file, &offset, coefficient, swapBytes);
+                        }
+                    }
+                }
+            }
+        }
+
+        FILE* output = fopen(filepath.c_str(), "wb");
+        ASSERT_TRUE(output != NULL);
+        ASSERT_EQ(1u, fwrite(&file[0], file.size(), 1, output));
+        fclose(output);
+    }
+
+    // Size in bytes of each record of the file, the header and constants records included.
+    static size_t RecordSize()
+    {
+        int numberCoefficients = 2;
+        for (int body = 0; body < 11; ++body)
+        {
+            numberCoefficients += 3 * TEST_JPL_LAYOUT[body][0] * TEST_JPL_LAYOUT[body][1];
+        }
+        return numberCoefficients * sizeof(double);
+    }
+
+    // Cuts the file down to its first size bytes.
+    static void TruncateEphemeris(const std::string& filepath, size_t size)
+    {
+        std::vector<char> file(size);
+        FILE* input = fopen(filepath.c_str(), "rb");
+        ASSERT_TRUE(input != NULL);
+        ASSERT_EQ(1u, fread(&file[0], size, 1, input));
+        fclose(input);
+
+        FILE* output = fopen(filepath.c_str(), "wb");
+        ASSERT_TRUE(output != NULL);
+        ASSERT_EQ(1u, fwrite(&file[0], size, 1, output));
+        fclose(output);
+    }
+
+    static void PutBytes(std::vector<char>* file, size_t* offset, const void* value, size_t size, bool swapBytes)
+    {
+        const char* bytes = static_cast<const char*>(value);
+        for (size_t i = 0; i < size; ++i)
+        {
+            (*file)[*offset + i] = swapBytes ? bytes[size - 1 - i] : bytes[i];
+        }
+        *offset += size;
+    }
+
+    static void PutDouble(std::vector<char>* file, size_t* offset, double value, bool swapBytes)
+    {
+        PutBytes(file, offset, &value, sizeof(value), swapBytes);
+    }
+
+    static void PutInt(std::vector<char>* file, size_t* offset, int32_t value, bool swapBytes)
+    {
+        PutBytes(file, offset, &value, sizeof(value), swapBytes);
+    }
+
+    // Sorted epochs over the whole file, including both ends and the record boundaries.
+    static std::vector<double> TestEpochs()
+    {
+        std::vector<double> epochs;
+        for (int i = 0; i <= 8 * TEST_JPL_NUMBER_RECORDS; ++i)
+        {
+            epochs.push_back(TEST_JPL_START + i * TEST_JPL_STEP / 8.0);
+            if (i < 8 * TEST_JPL_NUMBER_RECORDS)
+            {
+                epochs.push_back(TEST_JPL_START + (i + 0.3183) * TEST_JPL_STEP / 8.0);
+            }
+        }
+        return epochs;
+    }
+
+    std::string filename;
+};
+
+TEST_F(JplEphemerisFileTest, BatchMatchesSingleQueries)
+{
+    void* ephemeris = jpl_init_ephemeris(filename.c_str(), NULL, NULL);
+    ASSERT_TRUE(ephemeris != NULL);
+    void* context = jpl_init_context(ephemeris);
+    void* batchContext = jpl_init_context(ephemeris);
+
+    // Every planet, the Moon and the Earth-Moon barycenter, relative to the Sun and to the Earth
+    const std::vector<double> epochs = TestEpochs();
+    const long numberEpochs = static_cast<long>(epochs.size());
+    const int centers[2] = {11, 3};
+    for (int c = 0; c < 2; ++c)
+    {
+        const int center = centers[c];
+        std::vector<double> columns(13 * 6 * numberEpochs);
+        double* pv[13][6] = {};
+        unsigned int targetMask = 0;
+        for (int target = 1; target <= 13; ++target)
+        {
+            if (target != center && target != 11 && target != 12)
+            {
+                targetMask |= 1u << (target - 1);
+                for (int i = 0; i < 6; ++i)
+                {
+                    pv[target - 1][i] = &columns[((target - 1) * 6 + i) * numberEpochs];
+                }
+            }
+        }
+        ASSERT_EQ(0, jpl_pleph_batch(ephemeris, batchContext, &epochs[0], numberEpochs, targetMask, center, pv, 1));
+
+        for (int target = 1; target <= 13; ++target)
+        {
+            if ((targetMask & (1u << (target - 1))) == 0)
+            {
+                continue;
+            }
+            for (long e = 0; e < numberEpochs; ++e)
+            {
+                double rv[6];
+                ASSERT_EQ(0, jpl_pleph_r(ephemeris, context, epochs[e], target, center, rv, 1));
+                for (int i = 0; i < 6; ++i)
+                {
+                    EXPECT_EQ(rv[i], pv[target - 1][i][e]) << "target " << target << " center " << center << " epoch " << epochs[e];
+                }
+            }
+        }
+    }
+
+    jpl_close_context(batchContext);
+    jpl_close_context(context);
+    jpl_close_ephemeris(ephemeris);
+}
+
+TEST_F(JplEphemerisFileTest, StateVectorsAtEpochsMatchSingleQueries)
+{
+    JplEphemeris ephemeris;
+    ephemeris.SetEphemerisFile(filename);
+
+    const int objectIds[4] = {PLANET_VENUS, PLANET_EARTH, PLANET_MARS, PLANET_PLUTO};
+    const std::vector<double> epochs = TestEpochs();
+    Vector3Array positions, velocities;
+    ephemeris.GetStateVectorsAtEpochs(objectIds, 4, &epochs[0], epochs.size(), &positions, &velocities);
+    ASSERT_EQ(4 * epochs.size(), positions.Size());
+    ASSERT_EQ(4 * epochs.size(), velocities.Size());
+
+    for (size_t i = 0; i < 4; ++i)
+    {
+        for (size_t j = 0; j < epochs.size(); ++j)
+        {
+            StateVector stateVector;
+            ephemeris.GetOrbitAtEpoch(objectIds[i], epochs[j], NULL, &stateVector);
+            const size_t k = i * epochs.size() + j;
+            EXPECT_EQ(stateVector.position.x, positions.x[k]) << "object " << objectIds[i] << " epoch " << epochs[j];
+            EXPECT_EQ(stateVector.position.y, positions.y[k]) << "object " << objectIds[i] << " epoch " << epochs[j];
+            EXPECT_EQ(stateVector.position.z, positions.z[k]) << "object " << objectIds[i] << " epoch " << epochs[j];
+            EXPECT_EQ(stateVector.velocity.x, velocities.x[k]) << "object " << objectIds[i] << " epoch " << epochs[j];
+            EXPECT_EQ(stateVector.velocity.y, velocities.y[k]) << "object " << objectIds[i] << " epoch " << epochs[j];
+            EXPECT_EQ(stateVector.velocity.z, velocities.z[k]) << "object " << objectIds[i] << " epoch " << epochs[j];
+        }
+    }
+}
+
+// Compares jpl_pleph_r() on two readers of the same ephemeris for every target at every test epoch.
+static void ExpectSameQueries(void* expectedEphemeris, void* ephemeris, const std::vector<double>& epochs)
+{
+    void* expectedContext = jpl_init_context(expectedEphemeris);
+    void* context = jpl_init_context(ephemeris);
+    for (size_t e = 0; e < epochs.size(); ++e)
+    {
+        for (int target = 1; target <= 13; ++target)
+        {
+            double expected[6], rv[6];
+            const int expectedResult = jpl_pleph_r(expectedEphemeris, expectedContext, epochs[e], target, 11, expected, 1);
+            ASSERT_EQ(expectedResult, jpl_pleph_r(ephemeris, context, epochs[e], target, 11, rv, 1)) << "target " << target << " epoch " << epochs[e];
+            for (int i = 0; i < 6; ++i)
+            {
+                EXPECT_EQ(expected[i], rv[i]) << "target " << target << " epoch " << epochs[e];
+            }
+        }
+    }
+    jpl_close_context(context);
+    jpl_close_context(expectedContext);
+}
+
+TEST_F(JplEphemerisFileTest, MappedMatchesBuffered)
+{
+    void* buffered = jpl_init_ephemeris(filename.c_str(), NULL, NULL);
+    void* mapped = jpl_init_ephemeris_mapped(filename.c_str(), NULL, NULL);
+    ASSERT_TRUE(buffered != NULL && mapped != NULL);
+    EXPECT_TRUE(static_cast<jpl_eph_data*>(buffered)->records == NULL);
+    EXPECT_TRUE(static_cast<jpl_eph_data*>(mapped)->records != NULL);
+    ExpectSameQueries(buffered, mapped, TestEpochs());
+
+    // A file in the other byte order is swapped on every read by the buffered reader, and once
+    // into a resident copy by the mapped one.
+    const std::string swappedFilename = "test_ephemeris_swapped.405";
+    WriteEphemeris(swappedFilename, true);
+    void* swappedBuffered = jpl_init_ephemeris(swappedFilename.c_str(), NULL, NULL);
+    void* swappedMapped = jpl_init_ephemeris_mapped(swappedFilename.c_str(), NULL, NULL);
+    ASSERT_TRUE(swappedBuffered != NULL && swappedMapped != NULL);
+    EXPECT_TRUE(static_cast<jpl_eph_data*>(swappedMapped)->records != NULL);
+    ExpectSameQueries(buffered, swappedBuffered, TestEpochs());
+    ExpectSameQueries(buffered, swappedMapped, TestEpochs());
+
+    jpl_close_ephemeris(swappedMapped);
+    jpl_close_ephemeris(swappedBuffered);
+    remove(swappedFilename.c_str());
+    jpl_close_ephemeris(mapped);
+    jpl_close_ephemeris(buffered);
+}
+
+TEST_F(JplEphemerisFileTest, MappedTruncatedFileMatchesBuffered)
+{
+    // The last record is cut in half, so only the others can be read.
+    TruncateEphemeris(filename, (TEST_JPL_NUMBER_RECORDS + 1) * RecordSize() + RecordSize() / 2);
+    void* buffered = jpl_init_ephemeris(filename.c_str(), NULL, NULL);
+    void* mapped = jpl_init_ephemeris_mapped(filename.c_str(), NULL, NULL);
+    ASSERT_TRUE(buffered != NULL && mapped != NULL);
+    EXPECT_TRUE(static_cast<jpl_eph_data*>(mapped)->records != NULL);
+    ExpectSameQueries(buffered, mapped, TestEpochs());
+
+    double rv[6];
+    EXPECT_EQ(JPL_EPH_READ_ERROR, jpl_pleph(mapped, TEST_JPL_END - 1.0, 4, 11, rv, 1));
+    EXPECT_EQ(JPL_EPH_READ_ERROR, jpl_pleph(buffered, TEST_JPL_END - 1.0, 4, 11, rv, 1));
+
+    jpl_close_ephemeris(mapped);
+    jpl_close_ephemeris(buffered);
+}
+
+TEST_F(JplEphemerisFileTest, MappedFallsBackToBufferedReader)
+{
+    // Without a whole data record there is nothing to map, and the buffered reader is used.
+    TruncateEphemeris(filename, 2 * RecordSize() + RecordSize() / 2);
+    void* buffered = jpl_init_ephemeris(filename.c_str(), NULL, NULL);
+    void* mapped = jpl_init_ephemeris_mapped(filename.c_str(), NULL, NULL);
+    ASSERT_TRUE(buffered != NULL && mapped != NULL);
+    EXPECT_TRUE(static_cast<jpl_eph_data*>(mapped)->records == NULL);
+    EXPECT_TRUE(static_cast<jpl_eph_data*>(mapped)->map_base == NULL);
+    ExpectSameQueries(buffered, mapped, TestEpochs());
+
+    double rv[6];
+    EXPECT_EQ(JPL_EPH_READ_ERROR, jpl_pleph(mapped, TEST_JPL_START + 1.0, 4, 11, rv, 1));
+
+    jpl_close_ephemeris(mapped);
+    jpl_close_ephemeris(buffered);
+}
+
+TEST_F(JplEphemerisFileTest, MappedRejectsEpochsOutOfRange)
+{
+    void* buffered = jpl_init_ephemeris(filename.c_str(), NULL, NULL);
+    void* mapped = jpl_init_ephemeris_mapped(filename.c_str(), NULL, NULL);
+    ASSERT_TRUE(buffered != NULL && mapped != NULL);
+
+    std::vector<double> epochs;
+    epochs.push_back(TEST_JPL_START - TEST_JPL_STEP);
+    epochs.push_back(TEST_JPL_START - 1.0e-6);
+    epochs.push_back(TEST_JPL_END + 1.0e-6);
+    epochs.push_back(TEST_JPL_END + TEST_JPL_STEP);
+    ExpectSameQueries(buffered, mapped, epochs);
+
+    void* context = jpl_init_context(mapped);
+    for (size_t e = 0; e < epochs.size(); ++e)
+    {
+        double rv[6];
+        EXPECT_EQ(JPL_EPH_OUTSIDE_RANGE, jpl_pleph_r(mapped, context, epochs[e], 4, 11, rv, 1));
+
+        double x[1], y[1], z[1];
+        double* pv[13][6] = {};
+        pv[3][0] = x;  pv[3][1] = y;  pv[3][2] = z;
+        EXPECT_EQ(JPL_EPH_OUTSIDE_RANGE, jpl_pleph_batch(mapped, context, &epochs[e], 1, 1u << 3, 11, pv, 0));
+    }
+    jpl_close_context(context);
+
+    jpl_close_ephemeris(mapped);
+    jpl_close_ephemeris(buffered);
+}
+
+TEST_F(JplEphemerisFileTest, SubEphemerisMatchesSource)
+{
+    void* source = jpl_init_ephemeris(filename.c_str(), NULL, NULL);
+    ASSERT_TRUE(source != NULL);
+
+    // The window is widened to whole records, here the second to the fifth.
+    const std::string subFilename = "test_ephemeris.sub";
+    ASSERT_EQ(0, make_sub_ephem(source, subFilename.c_str(), TEST_JPL_START + 1.5 * TEST_JPL_STEP, TEST_JPL_START + 4.5 * TEST_JPL_STEP));
+    const double subStart = TEST_JPL_START + TEST_JPL_STEP;
+    const double subEnd = TEST_JPL_START + 5.0 * TEST_JPL_STEP;
+
+    void* sub = jpl_init_ephemeris(subFilename.c_str(), NULL, NULL);
+    void* subMapped = jpl_init_ephemeris_mapped(subFilename.c_str(), NULL, NULL);
+    ASSERT_TRUE(sub != NULL && subMapped != NULL);
+    EXPECT_EQ(subStart, jpl_get_double(sub, JPL_EPHEM_START_JD));
+    EXPECT_EQ(subEnd, jpl_get_double(sub, JPL_EPHEM_END_JD));
+    EXPECT_EQ(TEST_JPL_STEP, jpl_get_double(sub, JPL_EPHEM_STEP));
+
+    // The records are copied whole, so the results are the same. At the end of the window the
+    // source already uses the next record, which the sub-ephemeris doesn't have.
+    const std::vector<double> allEpochs = TestEpochs();
+    std::vector<double> epochs;
+    for (size_t e = 0; e < allEpochs.size(); ++e)
+    {
+        if (allEpochs[e] >= subStart && allEpochs[e] < subEnd)
+        {
+            epochs.push_back(allEpochs[e]);
+        }
+    }
+    ASSERT_FALSE(epochs.empty());
+    ExpectSameQueries(source, sub, epochs);
+    ExpectSameQueries(source, subMapped, epochs);
+
+    const double outside[] = {TEST_JPL_START, subStart - 1.0e-6, subEnd + 1.0e-6, TEST_JPL_END};
+    for (size_t e = 0; e < sizeof(outside) / sizeof(outside[0]); ++e)
+    {
+        double rv[6];
+        EXPECT_EQ(0, jpl_pleph(source, outside[e], 4, 11, rv, 1));
+        EXPECT_EQ(JPL_EPH_OUTSIDE_RANGE, jpl_pleph(sub, outside[e], 4, 11, rv, 1)) << "epoch " << outside[e];
+        EXPECT_EQ(JPL_EPH_OUTSIDE_RANGE, jpl_pleph(subMapped, outside[e], 4, 11, rv, 1)) << "epoch " << outside[e];
+    }
+
+    jpl_close_ephemeris(subMapped);
+    jpl_close_ephemeris(sub);
+    remove(subFilename.c_str());
+    jpl_close_ephemeris(source);
+}
+
+TEST_F(JplEphemerisFileTest, JplEphemerisConvertsToEclipticCanonicalUnits)
+{
+    JplEphemeris ephemeris;
+    ephemeris.SetEphemerisFile(filename);
+
+    // 6 days before the middle of the first record, each planet is 6 AU behind the ecliptic pole
+    // and moves at 1 AU/day, i.e. TU / 1 day in canonical units.
+    const double epoch = TEST_JPL_START + 0.5 * TEST_JPL_STEP - 6.0;
+    const double timeUnit = sqrt(ASTRO_AU_TO_KM * ASTRO_AU_TO_KM * ASTRO_AU_TO_KM / ASTRO_MU_SUN);
+    const double speed = timeUnit / MATH_DAY_TO_SEC;
+    for (int planet = PLANET_MERCURY; planet < PLANET_COUNT; ++planet)
+    {
+        StateVector stateVector;
+        ephemeris.GetOrbitAtEpoch(planet, epoch, NULL, &stateVector);
+        EXPECT_NEAR(-6.0, stateVector.position.x, 1.0e-11) << "planet " << planet;
+        EXPECT_NEAR(0.0, stateVector.position.y, 1.0e-11) << "planet " << planet;
+        EXPECT_NEAR(planet + 1.0, stateVector.position.z, 1.0e-11) << "planet " << planet;
+        EXPECT_NEAR(speed, stateVector.velocity.x, 1.0e-12 * speed) << "planet " << planet;
+        EXPECT_NEAR(0.0, stateVector.velocity.y, 1.0e-12 * speed) << "planet " << planet;
+        EXPECT_NEAR(0.0, stateVector.velocity.z, 1.0e-12 * speed) << "planet " << planet;
+    }
+}
+
+TEST_F(JplEphemerisFileTest, JplEphemerisMissingBodyThrows)
+{
+    // A sub-ephemeris holding the Earth (target 3) but not Jupiter
+    void* source = jpl_init_ephemeris(filename.c_str(), NULL, NULL);
+    ASSERT_TRUE(source != NULL);
+    const std::string subFilename = "test_ephemeris_earth.sub";
+    ASSERT_EQ(0, make_sub_ephem_targets(source, subFilename.c_str(), TEST_JPL_START, TEST_JPL_END, 1u << 2));
+    jpl_close_ephemeris(source);
+
+    JplEphemeris ephemeris;
+    ephemeris.SetEphemerisFile(subFilename);
+    const double epoch = TEST_JPL_START + 0.5 * TEST_JPL_STEP;
+    StateVector stateVector;
+    EXPECT_NO_THROW(ephemeris.GetOrbitAtEpoch(PLANET_EARTH, epoch, NULL, &stateVector));
+    EXPECT_NEAR(3.0, stateVector.position.z, 1.0e-11);
+    try
+    {
+        ephemeris.GetOrbitAtEpoch(PLANET_JUPITER, epoch, NULL, &stateVector);
+        FAIL() << "Expected JplEphemerisQueryError";
+    }
+    catch (const JplEphemerisQueryError& error)
+    {
+        EXPECT_EQ(JPL_EPH_BODY_NOT_IN_EPHEMERIS, error.GetErrorCode());
+    }
+
+    const int planets[2] = {PLANET_EARTH, PLANET_JUPITER};
+    Vector3Array positions, velocities;
+    try
+    {
+        ephemeris.GetStateVectorsAtEpochs(planets, 2, &epoch, 1, &positions, &velocities);
+        FAIL() << "Expected JplEphemerisQueryError";
+    }
+    catch (const JplEphemerisQueryError& error)
+    {
+        EXPECT_EQ(JPL_EPH_BODY_NOT_IN_EPHEMERIS, error.GetErrorCode());
+    }
+
+    // Close the sub-ephemeris before removing it
+    ephemeris.SetEphemerisFile(filename);
+    remove(subFilename.c_str());
+}
+
+TEST_F(JplEphemerisFileTest, JplEphemerisEpochOutOfRangeThrows)
+{
+    JplEphemeris ephemeris;
+    ephemeris.SetEphemerisFile(filename);
+
+    const double epochs[2] = {TEST_JPL_START - 1.0, TEST_JPL_END + 1.0};
+    for (int e = 0; e < 2; ++e)
+    {
+        StateVector stateVector;
+        try
+        {
+            ephemeris.GetOrbitAtEpoch(PLANET_MARS, epochs[e], NULL, &stateVector);
+            FAIL() << "Expected JplEphemerisQueryError";
+        }
+        catch (const JplEphemerisQueryError& error)
+        {
+            EXPECT_EQ(JPL_EPH_OUTSIDE_RANGE, error.GetErrorCode());
+        }
+
+        const int planet = PLANET_MARS;
+        Vector3Array positions, velocities;
+        try
+        {
+            ephemeris.GetStateVectorsAtEpochs(&planet, 1, &epochs[e], 1, &positions, &velocities);
+            FAIL() << "Expected JplEphemerisQueryError";
+        }
+        catch (const JplEphemerisQueryError& error)
+        {
+            EXPECT_EQ(JPL_EPH_OUTSIDE_RANGE, error.GetErrorCode());
+        }
+    }
+}
+
+TEST_F(JplEphemerisFileTest, JplEphemerisConcurrentQueriesMatchSerial)
+{
+    JplEphemeris ephemeris;
+    ephemeris.SetEphemerisFile(filename);
+
+    // More threads than context slots, so that some contexts are closed rather than kept
+    const std::vector<double> epochs = TestEpochs();
+    const size_t count = PLANET_COUNT * epochs.size();
+    std::vector<StateVector> serial(count), parallel(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        ephemeris.GetOrbitAtEpoch(i % PLANET_COUNT, epochs[i / PLANET_COUNT], NULL, &serial[i]);
+    }
+
+    ThreadPool threadPool(JPL_NUMBER_CONTEXT_SLOTS + 4);
+    threadPool.ParallelFor(count, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            ephemeris.GetOrbitAtEpoch(i % PLANET_COUNT, epochs[i / PLANET_COUNT], NULL, &parallel[i]);
+        }
+    });
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        EXPECT_EQ(serial[i].position.x, parallel[i].position.x);
+        EXPECT_EQ(serial[i].position.y, parallel[i].position.y);
+        EXPECT_EQ(serial[i].position.z, parallel[i].position.z);
+        EXPECT_EQ(serial[i].velocity.x, parallel[i].velocity.x);
+        EXPECT_EQ(serial[i].velocity.y, parallel[i].velocity.y);
+        EXPECT_EQ(serial[i].velocity.z, parallel[i].velocity.z);
+    }
+}
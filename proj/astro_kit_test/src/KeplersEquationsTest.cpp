@@ -50,4 +50,89 @@ TEST(KeplersEquationHDeathTest, EccentricityIsNotValid)
     double eccentricity = 0.9;
     double M = 0.0;
     EXPECT_DEBUG_DEATH(SolveKeplersEquationH(eccentricity, M), "Assertion failed: eccentricity >= 1.0");
-}
\ No newline at end of file
+}
+
+TEST(KeplersEquationE, ArraySolvesAllEccentricities)
+{
+    const double eccentricities[] = { 0.0, 0.1, 0.5, 0.9, 0.99, 0.999999 };
+    std::vector<double> e, M;
+    for (int i = 0; i < 6; ++i)
+    {
+        for (int j = -200; j <= 200; ++j)
+        {
+            e.push_back(eccentricities[i]);
+            M.push_back(j * 0.1);
+        }
+    }
+
+    std::vector<double> E(e.size());
+    SolveKeplersEquationE(e.size(), &e[0], &M[0], &E[0]);
+    for (size_t i = 0; i < e.size(); ++i)
+    {
+        EXPECT_NEAR(M[i], E[i] - e[i]*sin(E[i]), 1e-13);
+        if (e[i] < 0.99)
+        {
+            EXPECT_NEAR(SolveKeplersEquationE(e[i], M[i]), E[i], 1e-8);
+        }
+    }
+
+    double valladoE;
+    double valladoM = 235.4 * MATH_DEG_TO_RAD;
+    double valladoEccentricity = 0.4;
+    SolveKeplersEquationE(1, &valladoEccentricity, &valladoM, &valladoE);
+    EXPECT_NEAR(3.8486971, valladoE, 1e-4);
+}
+
+TEST(KeplersEquationH, ArraySolvesAllEccentricities)
+{
+    const double eccentricities[] = { 1.0, 1.000001, 1.01, 1.5, 2.4, 10.0, 100.0 };
+    std::vector<double> e, M;
+    for (int i = 0; i < 7; ++i)
+    {
+        for (int j = -100; j <= 100; ++j)
+        {
+            e.push_back(eccentricities[i]);
+            M.push_back(Sign(j) * pow(10.0, abs(j) * 0.1 - 8.0));
+        }
+    }
+
+    std::vector<double> H(e.size());
+    SolveKeplersEquationH(e.size(), &e[0], &M[0], &H[0]);
+    for (size_t i = 0; i < e.size(); ++i)
+    {
+        EXPECT_NEAR(M[i], e[i]*sinh(H[i]) - H[i], 1e-14 * Max(1.0, fabs(M[i])));
+    }
+
+    double valladoH;
+    double valladoM = 235.4 * MATH_DEG_TO_RAD;
+    double valladoEccentricity = 2.4;
+    SolveKeplersEquationH(1, &valladoEccentricity, &valladoM, &valladoH);
+    EXPECT_NEAR(SolveKeplersEquationH(valladoEccentricity, valladoM), valladoH, 1e-10);
+}
+
+TEST(StumpffFunctions, AreContinuousAcrossSeriesThreshold)
+{
+    double c2, c3;
+    CalculateStumpffFunctions(0.0, &c2, &c3);
+    EXPECT_DOUBLE_EQ(0.5, c2);
+    EXPECT_DOUBLE_EQ(1.0 / 6.0, c3);
+
+    const double threshold = 0.1;
+    const double sides[] = { -1.0, 1.0 };
+    for (int i = 0; i < 2; ++i)
+    {
+        double c2Series, c3Series, c2Closed, c3Closed;
+        CalculateStumpffFunctions(sides[i] * threshold * (1.0 - 1.0e-12), &c2Series, &c3Series);
+        CalculateStumpffFunctions(sides[i] * threshold * (1.0 + 1.0e-12), &c2Closed, &c3Closed);
+        EXPECT_NEAR(c2Series, c2Closed, 1.0e-14);
+        EXPECT_NEAR(c3Series, c3Closed, 1.0e-14);
+    }
+
+    // Elliptic and hyperbolic closed forms
+    CalculateStumpffFunctions(MATH_PI * MATH_PI, &c2, &c3);
+    EXPECT_NEAR(2.0 / (MATH_PI * MATH_PI), c2, 1.0e-12);
+    EXPECT_NEAR(1.0 / (MATH_PI * MATH_PI), c3, 1.0e-12);
+    CalculateStumpffFunctions(-1.0, &c2, &c3);
+    EXPECT_NEAR(cosh(1.0) - 1.0, c2, 1.0e-12);
+    EXPECT_NEAR(sinh(1.0) - 1.0, c3, 1.0e-12);
+}
@@ -0,0 +1,167 @@
+/*****************************************************************************
+ *   IGATO - Interplanetary Gravity Assist Trajectory Optimizer              *
+ *   Copyright (C) 2012 Jason Bryan (Jmbryan10@gmail.com)                    *
+ *                                                                           *
+ *   IGATO is free software; you can redistribute it and/or modify           *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   IGATO is distributed in the hope that it will be useful,                *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with IGATO; if not, see http://www.gnu.org/licenses/              *
+ *****************************************************************************/
+
+#include "gtest/gtest.h"
+#include "LambertCache.h"
+#include "Arcs.h"
+#include "ThreadPool.h"
+#include "Base.h"
+
+TEST(LambertCacheTest, RepeatedQueryHitsCache)
+{
+    IzzoLambert solver;
+    LambertCache cache(&solver);
+
+    Vector3 initialPosition(1.0, 0.2, 0.0);
+    Vector3 finalPosition(-0.5, 1.3, 0.1);
+    Vector3 initialVelocity1, finalVelocity1, initialVelocity2, finalVelocity2;
+    LambertInfo info1, info2;
+
+    cache.Evaluate(initialPosition, finalPosition, 3.0, ORBIT_DIR_PROGRADE, 0, &initialVelocity1, &finalVelocity1, &info1);
+    cache.Evaluate(initialPosition, finalPosition, 3.0, ORBIT_DIR_PROGRADE, 0, &initialVelocity2, &finalVelocity2, &info2);
+
+    EXPECT_EQ(1, cache.GetNumberHits());
+    EXPECT_EQ(1, cache.GetNumberMisses());
+    EXPECT_EQ(1, cache.GetSize());
+    EXPECT_TRUE(info2.converged);
+    EXPECT_EQ(0, info2.iterations);
+    EXPECT_EQ(initialVelocity1, initialVelocity2);
+    EXPECT_EQ(finalVelocity1, finalVelocity2);
+
+    // Direction and number of revolutions are part of the key
+    cache.Evaluate(initialPosition, finalPosition, 3.0, ORBIT_DIR_RETROGRADE, 0, &initialVelocity2, &finalVelocity2);
+    EXPECT_EQ(2, cache.GetNumberMisses());
+
+    cache.Clear();
+    EXPECT_EQ(0, cache.GetSize());
+    EXPECT_EQ(0, cache.GetNumberHits());
+    EXPECT_EQ(0, cache.GetNumberMisses());
+}
+
+TEST(LambertCacheTest, EvictsLeastRecentlyUsed)
+{
+    IzzoLambert solver;
+    LambertCache cache(&solver, 2);
+
+    Vector3 initialPosition(1.0, 0.0, 0.0);
+    Vector3 finalPosition(0.0, 1.5, 0.0);
+    Vector3 initialVelocity, finalVelocity;
+
+    cache.Evaluate(initialPosition, finalPosition, 2.0, ORBIT_DIR_PROGRADE, 0, &initialVelocity, &finalVelocity);
+    cache.Evaluate(initialPosition, finalPosition, 3.0, ORBIT_DIR_PROGRADE, 0, &initialVelocity, &finalVelocity);
+    cache.Evaluate(initialPosition, finalPosition, 2.0, ORBIT_DIR_PROGRADE, 0, &initialVelocity, &finalVelocity); // hit, now most recent
+    cache.Evaluate(initialPosition, finalPosition, 4.0, ORBIT_DIR_PROGRADE, 0, &initialVelocity, &finalVelocity); // evicts 3.0
+    EXPECT_EQ(1, cache.GetNumberHits());
+    EXPECT_EQ(2, cache.GetSize());
+
+    cache.Evaluate(initialPosition, finalPosition, 2.0, ORBIT_DIR_PROGRADE, 0, &initialVelocity, &finalVelocity);
+    EXPECT_EQ(2, cache.GetNumberHits());
+    cache.Evaluate(initialPosition, finalPosition, 3.0, ORBIT_DIR_PROGRADE, 0, &initialVelocity, &finalVelocity);
+    EXPECT_EQ(2, cache.GetNumberHits());
+    EXPECT_EQ(4, cache.GetNumberMisses());
+}
+
+TEST(LambertCacheTest, NearMissWarmStartsSolver)
+{
+    IzzoLambert solver;
+    LambertCache cache(&solver);
+
+    Vector3 initialPosition(1.0, 0.2, 0.0);
+    Vector3 finalPosition(-1.2, -0.9, 0.1);
+    Vector3 initialVelocity, finalVelocity;
+    LambertInfo info;
+
+    for (int N = 0; N <= 1; ++N)
+    {
+        double timeOfFlight = 4.0 + 12.0 * N;
+        cache.Evaluate(initialPosition, finalPosition, timeOfFlight, ORBIT_DIR_PROGRADE, N, &initialVelocity, &finalVelocity);
+
+        // Closer than the warm start resolution, further than the key resolution
+        timeOfFlight += 1.0e-6;
+        cache.Evaluate(initialPosition, finalPosition, timeOfFlight, ORBIT_DIR_PROGRADE, N, &initialVelocity, &finalVelocity, &info);
+        EXPECT_EQ(N + 1, cache.GetNumberWarmStarts());
+
+        Vector3 expectedInitialVelocity, expectedFinalVelocity;
+        LambertInfo expectedInfo;
+        solver.Evaluate(initialPosition, finalPosition, timeOfFlight, ORBIT_DIR_PROGRADE, N, &expectedInitialVelocity, &expectedFinalVelocity, &expectedInfo);
+
+        EXPECT_TRUE(info.converged);
+        EXPECT_LT(info.iterations, expectedInfo.iterations);
+        EXPECT_NEAR(0.0, initialVelocity.distance(expectedInitialVelocity), 1.0e-12);
+        EXPECT_NEAR(0.0, finalVelocity.distance(expectedFinalVelocity), 1.0e-12);
+    }
+    EXPECT_EQ(0, cache.GetNumberHits());
+}
+
+TEST(LambertCacheTest, ConcurrentQueriesAreCounted)
+{
+    IzzoLambert solver;
+    LambertCache cache(&solver, 64);
+
+    const size_t count = 4000;
+    ThreadPool threadPool(4);
+    threadPool.ParallelFor(count, 50, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            // 100 distinct problems, each queried many times
+            Vector3 initialPosition(1.0, 0.0, 0.0);
+            Vector3 finalPosition(0.0, 1.5, 0.0);
+            Vector3 initialVelocity, finalVelocity;
+            cache.Evaluate(initialPosition, finalPosition, 1.0 + 0.1 * (i % 100), ORBIT_DIR_PROGRADE, 0, &initialVelocity, &finalVelocity);
+        }
+    });
+
+    EXPECT_EQ(count, cache.GetNumberHits() + cache.GetNumberMisses());
+    EXPECT_LE(100u, cache.GetNumberMisses());
+    EXPECT_EQ(64, cache.GetSize());
+}
+
+TEST(LambertCacheTest, LambertArcUsesManagerCache)
+{
+    LambertManager::SetLambertType(LAMBERT_IZZO);
+    LambertManager::EnableCache(16);
+
+    LambertArc arc(ORBIT_DIR_PROGRADE, 0);
+    arc.SetInitialConditions(Vector3(2.5, 0.0, 0.0), Vector3(1.915111, 1.606969, 0.0));
+    arc.Evaluate(5.6519);
+    arc.Evaluate(5.6519);
+
+    StateVector initialState, finalState;
+    arc.GetInitialStateVector(&initialState);
+    arc.GetFinalStateVector(&finalState);
+
+    EXPECT_NEAR(2.5, initialState.position.x, TEST_VU_TOLERANCE);
+    EXPECT_NEAR(1.606969, finalState.position.y, TEST_VU_TOLERANCE);
+    EXPECT_NEAR(0.2604450, initialState.velocity.x, TEST_VU_TOLERANCE);
+    EXPECT_NEAR(0.3688589, initialState.velocity.y, TEST_VU_TOLERANCE);
+    EXPECT_NEAR(-0.4366104, finalState.velocity.x, TEST_VU_TOLERANCE);
+    EXPECT_NEAR(0.1151515, finalState.velocity.y, TEST_VU_TOLERANCE);
+
+    ASSERT_TRUE(LambertManager::GetCache() != NULL);
+    EXPECT_EQ(1, LambertManager::GetCache()->GetNumberHits());
+    EXPECT_EQ(1, LambertManager::GetCache()->GetNumberMisses());
+
+    // Changing the solver keeps an empty cache
+    LambertManager::SetLambertType(LAMBERT_BATTIN);
+    ASSERT_TRUE(LambertManager::GetCache() != NULL);
+    EXPECT_EQ(0, LambertManager::GetCache()->GetSize());
+
+    LambertManager::DisableCache();
+    EXPECT_TRUE(LambertManager::GetCache() == NULL);
+}
@@ -18,6 +18,8 @@
 
 #include "gtest/gtest.h"
 #include "Lambert.h"
+#include "LambertBulkQueue.h"
+#include "ThreadPool.h"
 #include "Base.h"
 
 TEST(LambertTest, ExponentialSinusoidValladoTestCase)
@@ -37,4 +39,570 @@ TEST(LambertTest, ExponentialSinusoidValladoTestCase)
     EXPECT_NEAR(-0.4366104, finalVelocity.x, TEST_VU_TOLERANCE);
     EXPECT_NEAR(0.1151515, finalVelocity.y, TEST_VU_TOLERANCE);
     EXPECT_NEAR(0.0, finalVelocity.z, TEST_VU_TOLERANCE);
-}
\ No newline at end of file
+}
+
+TEST(LambertTest, ExponentialSinusoidBatchMatchesScalar)
+{
+    const size_t count = 37; // not a multiple of the batch width
+    LambertBatch batch;
+    batch.Resize(count);
+
+    srand(1234);
+    for (size_t i = 0; i < count; ++i)
+    {
+        Vector3 initialPosition(1.0 + Random0_1(), RandomMinus1_1(), 0.1 * RandomMinus1_1());
+        Vector3 finalPosition(RandomMinus1_1(), 1.0 + Random0_1(), 0.1 * RandomMinus1_1());
+        double timeOfFlight = 2.0 + 8.0 * Random0_1();
+        OrbitDirection orbitDirection = (i % 3 == 0) ? ORBIT_DIR_RETROGRADE : ORBIT_DIR_PROGRADE;
+        batch.SetProblem(i, initialPosition, finalPosition, timeOfFlight, orbitDirection, 0);
+    }
+
+    LambertManager::SetLambertType(LAMBERT_EXP_SINUSOID);
+    LambertManager::EvaluateBatch(&batch);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        Vector3 initialPosition, finalPosition;
+        batch.initialPosition.Get(i, &initialPosition);
+        batch.finalPosition.Get(i, &finalPosition);
+
+        Vector3 initialVelocity, finalVelocity;
+        LambertManager::Evaluate(initialPosition, finalPosition, batch.timeOfFlight[i], batch.orbitDirection[i], batch.numberRevolutions[i], &initialVelocity, &finalVelocity);
+
+        Vector3 batchInitialVelocity, batchFinalVelocity;
+        batch.GetSolution(i, &batchInitialVelocity, &batchFinalVelocity);
+
+        EXPECT_NEAR(initialVelocity.x, batchInitialVelocity.x, 1.0e-10);
+        EXPECT_NEAR(initialVelocity.y, batchInitialVelocity.y, 1.0e-10);
+        EXPECT_NEAR(initialVelocity.z, batchInitialVelocity.z, 1.0e-10);
+        EXPECT_NEAR(finalVelocity.x, batchFinalVelocity.x, 1.0e-10);
+        EXPECT_NEAR(finalVelocity.y, batchFinalVelocity.y, 1.0e-10);
+        EXPECT_NEAR(finalVelocity.z, batchFinalVelocity.z, 1.0e-10);
+    }
+}
+
+TEST(LambertTest, ExponentialSinusoidBatchMatchesScalarMixedRegimes)
+{
+    // Hyperbolic, elliptic and one revolution transfers interleaved, so the
+    // batch lanes converge after different numbers of iterations and are
+    // refilled out of step with each other.
+    const size_t count = 203;
+    LambertBatch batch;
+    batch.Resize(count);
+
+    srand(5678);
+    for (size_t i = 0; i < count; ++i)
+    {
+        Vector3 initialPosition(1.0 + Random0_1(), RandomMinus1_1(), 0.1 * RandomMinus1_1());
+        Vector3 finalPosition(RandomMinus1_1(), 1.0 + Random0_1(), 0.1 * RandomMinus1_1());
+        int numberRevolutions = (i % 3 == 2) ? 1 : 0;
+        double timeOfFlight = (numberRevolutions > 0) ? 10.0 + 20.0 * Random0_1() : ((i % 3 == 0) ? 0.2 + 0.5 * Random0_1() : 2.0 + 8.0 * Random0_1());
+        OrbitDirection orbitDirection = (i % 4 == 0) ? ORBIT_DIR_RETROGRADE : ORBIT_DIR_PROGRADE;
+        batch.SetProblem(i, initialPosition, finalPosition, timeOfFlight, orbitDirection, numberRevolutions);
+    }
+
+    LambertManager::SetLambertType(LAMBERT_EXP_SINUSOID);
+    LambertManager::EvaluateBatch(&batch);
+
+    size_t converged = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        Vector3 initialPosition, finalPosition;
+        batch.initialPosition.Get(i, &initialPosition);
+        batch.finalPosition.Get(i, &finalPosition);
+
+        Vector3 initialVelocity, finalVelocity;
+        LambertInfo info;
+        LambertManager::Evaluate(initialPosition, finalPosition, batch.timeOfFlight[i], batch.orbitDirection[i], batch.numberRevolutions[i], &initialVelocity, &finalVelocity, &info);
+        if (!info.converged)
+        {
+            continue;
+        }
+        converged++;
+
+        Vector3 batchInitialVelocity, batchFinalVelocity;
+        batch.GetSolution(i, &batchInitialVelocity, &batchFinalVelocity);
+
+        EXPECT_NEAR(initialVelocity.x, batchInitialVelocity.x, 1.0e-10);
+        EXPECT_NEAR(initialVelocity.y, batchInitialVelocity.y, 1.0e-10);
+        EXPECT_NEAR(initialVelocity.z, batchInitialVelocity.z, 1.0e-10);
+        EXPECT_NEAR(finalVelocity.x, batchFinalVelocity.x, 1.0e-10);
+        EXPECT_NEAR(finalVelocity.y, batchFinalVelocity.y, 1.0e-10);
+        EXPECT_NEAR(finalVelocity.z, batchFinalVelocity.z, 1.0e-10);
+    }
+    EXPECT_GT(converged, count / 2);
+}
+
+TEST(LambertTest, ParallelMatchesSerial)
+{
+    const size_t count = 1000;
+    LambertBatch serialBatch;
+    serialBatch.Resize(count);
+
+    srand(4321);
+    for (size_t i = 0; i < count; ++i)
+    {
+        Vector3 initialPosition(1.0 + Random0_1(), RandomMinus1_1(), 0.1 * RandomMinus1_1());
+        Vector3 finalPosition(RandomMinus1_1(), 1.0 + Random0_1(), 0.1 * RandomMinus1_1());
+        double timeOfFlight = 2.0 + 8.0 * Random0_1();
+        serialBatch.SetProblem(i, initialPosition, finalPosition, timeOfFlight, ORBIT_DIR_PROGRADE, 0);
+    }
+    LambertBatch parallelBatch = serialBatch;
+
+    ThreadPool threadPool(4);
+    LambertManager::SetLambertType(LAMBERT_EXP_SINUSOID);
+    LambertManager::EvaluateBatch(&serialBatch);
+    LambertManager::EvaluateParallel(&parallelBatch, &threadPool);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        EXPECT_EQ(serialBatch.initialVelocity.x[i], parallelBatch.initialVelocity.x[i]);
+        EXPECT_EQ(serialBatch.initialVelocity.y[i], parallelBatch.initialVelocity.y[i]);
+        EXPECT_EQ(serialBatch.initialVelocity.z[i], parallelBatch.initialVelocity.z[i]);
+        EXPECT_EQ(serialBatch.finalVelocity.x[i], parallelBatch.finalVelocity.x[i]);
+        EXPECT_EQ(serialBatch.finalVelocity.y[i], parallelBatch.finalVelocity.y[i]);
+        EXPECT_EQ(serialBatch.finalVelocity.z[i], parallelBatch.finalVelocity.z[i]);
+    }
+}
+
+static void ExpectValladoTestCase(LambertType lambertType)
+{
+    Vector3 initialPosition(2.5, 0.0, 0.0); // units are ER
+    Vector3 finalPosition(1.915111, 1.606969, 0.0); // units are ER
+    double timeOfFlight = 5.6519; // units are TU
+    Vector3 initialVelocity, finalVelocity;
+    LambertInfo info;
+
+    LambertManager::SetLambertType(lambertType);
+    LambertManager::Evaluate(initialPosition, finalPosition, timeOfFlight, ORBIT_DIR_PROGRADE, 0, &initialVelocity, &finalVelocity, &info);
+
+    EXPECT_TRUE(info.converged);
+    EXPECT_NEAR(0.2604450, initialVelocity.x, TEST_VU_TOLERANCE);
+    EXPECT_NEAR(0.3688589, initialVelocity.y, TEST_VU_TOLERANCE);
+    EXPECT_NEAR(0.0, initialVelocity.z, TEST_VU_TOLERANCE);
+    EXPECT_NEAR(-0.4366104, finalVelocity.x, TEST_VU_TOLERANCE);
+    EXPECT_NEAR(0.1151515, finalVelocity.y, TEST_VU_TOLERANCE);
+    EXPECT_NEAR(0.0, finalVelocity.z, TEST_VU_TOLERANCE);
+}
+
+TEST(LambertTest, UniversalVariableValladoTestCase)
+{
+    ExpectValladoTestCase(LAMBERT_UNIVERSAL_VAR);
+}
+
+TEST(LambertTest, BattinValladoTestCase)
+{
+    ExpectValladoTestCase(LAMBERT_BATTIN);
+}
+
+static void ExpectSolversAgree(LambertType lambertType1, LambertType lambertType2, int numberRevolutions)
+{
+    Lambert* solver1 = LambertManager::CreateLambertSolver(lambertType1);
+    Lambert* solver2 = LambertManager::CreateLambertSolver(lambertType2);
+
+    srand(2012);
+    for (int i = 0; i < 200; ++i)
+    {
+        Vector3 initialPosition(0.5 + Random0_1(), 0.5 * RandomMinus1_1(), 0.2 * RandomMinus1_1());
+        Vector3 finalPosition(2.0 * RandomMinus1_1(), 2.0 * RandomMinus1_1(), 0.2 * RandomMinus1_1());
+        double timeOfFlight = (numberRevolutions + 0.2) * MATH_2_PI + 20.0 * Random0_1();
+        OrbitDirection orbitDirection = (i % 2 == 0) ? ORBIT_DIR_PROGRADE : ORBIT_DIR_RETROGRADE;
+
+        Vector3 initialVelocity1, finalVelocity1, initialVelocity2, finalVelocity2;
+        LambertInfo info1, info2;
+        solver1->Evaluate(initialPosition, finalPosition, timeOfFlight, orbitDirection, numberRevolutions, &initialVelocity1, &finalVelocity1, &info1);
+        solver2->Evaluate(initialPosition, finalPosition, timeOfFlight, orbitDirection, numberRevolutions, &initialVelocity2, &finalVelocity2, &info2);
+
+        EXPECT_EQ(info1.converged, info2.converged) << "problem " << i;
+        if (info1.converged && info2.converged)
+        {
+            EXPECT_NEAR(initialVelocity1.x, initialVelocity2.x, 1.0e-8) << "problem " << i;
+            EXPECT_NEAR(initialVelocity1.y, initialVelocity2.y, 1.0e-8) << "problem " << i;
+            EXPECT_NEAR(initialVelocity1.z, initialVelocity2.z, 1.0e-8) << "problem " << i;
+            EXPECT_NEAR(finalVelocity1.x, finalVelocity2.x, 1.0e-8) << "problem " << i;
+            EXPECT_NEAR(finalVelocity1.y, finalVelocity2.y, 1.0e-8) << "problem " << i;
+            EXPECT_NEAR(finalVelocity1.z, finalVelocity2.z, 1.0e-8) << "problem " << i;
+        }
+    }
+
+    delete solver1;
+    delete solver2;
+}
+
+TEST(LambertTest, UniversalVariableAgreesWithBattin)
+{
+    ExpectSolversAgree(LAMBERT_UNIVERSAL_VAR, LAMBERT_BATTIN, 0);
+}
+
+TEST(LambertTest, UniversalVariableAgreesWithBattinMultiRev)
+{
+    ExpectSolversAgree(LAMBERT_UNIVERSAL_VAR, LAMBERT_BATTIN, 1);
+    ExpectSolversAgree(LAMBERT_UNIVERSAL_VAR, LAMBERT_BATTIN, 2);
+}
+
+// Long way transfers a few degrees short of a full revolution, where the
+// time of flight is most sensitive to the iteration variable. Izzo's solver
+// is the reference.
+static void ExpectConvergesNearFullRevolution(LambertType lambertType, int numberRevolutions)
+{
+    Lambert* solver = LambertManager::CreateLambertSolver(lambertType);
+    IzzoLambert reference;
+
+    srand(444);
+    for (int i = 0; i < 500; ++i)
+    {
+        double r1 = 0.4 + 1.6 * Random0_1();
+        double r2 = 0.4 + 1.6 * Random0_1();
+        double angle = 0.1 * Random0_1();
+        Vector3 initialPosition(r1, 0.0, 0.0);
+        Vector3 finalPosition(r2 * cos(angle), -r2 * sin(angle), 0.0);
+        double timeOfFlight = (3.0 + 12.0 * Random0_1()) * (numberRevolutions + 1);
+
+        Vector3 initialVelocity1, finalVelocity1, initialVelocity2, finalVelocity2;
+        LambertInfo info1, info2;
+        solver->Evaluate(initialPosition, finalPosition, timeOfFlight, ORBIT_DIR_PROGRADE, numberRevolutions, &initialVelocity1, &finalVelocity1, &info1);
+        reference.Evaluate(initialPosition, finalPosition, timeOfFlight, ORBIT_DIR_PROGRADE, numberRevolutions, &initialVelocity2, &finalVelocity2, &info2);
+
+        EXPECT_EQ(info2.converged, info1.converged) << "problem " << i;
+        if (info1.converged && info2.converged)
+        {
+            EXPECT_NEAR(initialVelocity2.x, initialVelocity1.x, 1.0e-8) << "problem " << i;
+            EXPECT_NEAR(initialVelocity2.y, initialVelocity1.y, 1.0e-8) << "problem " << i;
+            EXPECT_NEAR(finalVelocity2.x, finalVelocity1.x, 1.0e-8) << "problem " << i;
+            EXPECT_NEAR(finalVelocity2.y, finalVelocity1.y, 1.0e-8) << "problem " << i;
+        }
+    }
+
+    delete solver;
+}
+
+TEST(LambertTest, BattinConvergesNearFullRevolution)
+{
+    ExpectConvergesNearFullRevolution(LAMBERT_BATTIN, 0);
+}
+
+TEST(LambertTest, UniversalVariableConvergesNearFullRevolution)
+{
+    ExpectConvergesNearFullRevolution(LAMBERT_UNIVERSAL_VAR, 0);
+    ExpectConvergesNearFullRevolution(LAMBERT_UNIVERSAL_VAR, 1);
+    ExpectConvergesNearFullRevolution(LAMBERT_UNIVERSAL_VAR, 2);
+}
+
+TEST(LambertTest, ManagerReportsConvergence)
+{
+    Vector3 initialPosition(1.0, 0.0, 0.0);
+    Vector3 finalPosition(0.0, 1.5, 0.0);
+    Vector3 initialVelocity, finalVelocity;
+
+    LambertManager::SetLambertType(LAMBERT_UNIVERSAL_VAR);
+    EXPECT_TRUE(LambertManager::Evaluate(initialPosition, finalPosition, 3.0, ORBIT_DIR_PROGRADE, 0, &initialVelocity, &finalVelocity));
+
+    // Far below the minimum time of flight of a two revolution transfer
+    EXPECT_FALSE(LambertManager::Evaluate(initialPosition, finalPosition, 3.0, ORBIT_DIR_PROGRADE, 2, &initialVelocity, &finalVelocity));
+
+    LambertInfo info;
+    EXPECT_FALSE(LambertManager::Evaluate(initialPosition, finalPosition, 3.0, ORBIT_DIR_PROGRADE, 2, &initialVelocity, &finalVelocity, &info));
+    EXPECT_FALSE(info.converged);
+}
+
+TEST(LambertTest, IzzoValladoTestCase)
+{
+    ExpectValladoTestCase(LAMBERT_IZZO);
+}
+
+TEST(LambertTest, IzzoAgreesWithBattin)
+{
+    ExpectSolversAgree(LAMBERT_IZZO, LAMBERT_BATTIN, 0);
+    ExpectSolversAgree(LAMBERT_IZZO, LAMBERT_BATTIN, 1);
+    ExpectSolversAgree(LAMBERT_IZZO, LAMBERT_BATTIN, 2);
+}
+
+TEST(LambertTest, IzzoSingleRevolutionIterationBound)
+{
+    IzzoLambert solver;
+
+    srand(1111);
+    for (int i = 0; i < 1000; ++i)
+    {
+        Vector3 initialPosition(0.5 + Random0_1(), 0.5 * RandomMinus1_1(), 0.2 * RandomMinus1_1());
+        Vector3 finalPosition(2.0 * RandomMinus1_1(), 2.0 * RandomMinus1_1(), 0.2 * RandomMinus1_1());
+        double timeOfFlight = 0.1 + 20.0 * Random0_1();
+
+        Vector3 initialVelocity, finalVelocity;
+        LambertInfo info;
+        solver.Evaluate(initialPosition, finalPosition, timeOfFlight, ORBIT_DIR_PROGRADE, 0, &initialVelocity, &finalVelocity, &info);
+
+        EXPECT_TRUE(info.converged) << "problem " << i;
+        EXPECT_GE(3, info.iterations) << "problem " << i;
+    }
+}
+
+/// Time of flight along an elliptic arc (mu = 1) from Kepler's equation,
+/// given the number of complete revolutions.
+static double EllipticTimeOfFlight(const Vector3& initialPosition, const Vector3& initialVelocity,
+                                   const Vector3& finalPosition, const Vector3& finalVelocity,
+                                   int numberRevolutions)
+{
+    double a = 1.0 / (2.0 / initialPosition.length() - initialVelocity.lengthSquared());
+    Vector3 angularMomentum;
+    Vector3::cross(initialPosition, initialVelocity, &angularMomentum);
+    double e = sqrt(1.0 - angularMomentum.lengthSquared() / a);
+
+    double E1 = atan2(initialPosition.dot(initialVelocity) / sqrt(a), 1.0 - initialPosition.length() / a);
+    double E2 = atan2(finalPosition.dot(finalVelocity) / sqrt(a), 1.0 - finalPosition.length() / a);
+    double dE = fmod(E2 - E1 + 2.0 * MATH_2_PI, MATH_2_PI) + MATH_2_PI * numberRevolutions;
+
+    return a * sqrt(a) * (dE - e * (sin(E2) - sin(E1)));
+}
+
+TEST(LambertTest, IzzoEvaluateAllFindsEveryBranch)
+{
+    Vector3 initialPosition(1.0, 0.0, 0.0);
+    Vector3 finalPosition(-0.8, 1.2, 0.1);
+    double timeOfFlight = 30.0;
+
+    IzzoLambert solver;
+    std::vector<Vector3> initialVelocities, finalVelocities;
+    std::vector<LambertInfo> infos;
+    int Nmax = solver.EvaluateAll(initialPosition, finalPosition, timeOfFlight, ORBIT_DIR_PROGRADE, &initialVelocities, &finalVelocities, &infos);
+
+    ASSERT_EQ(3, Nmax);
+    ASSERT_EQ(2u * Nmax + 1, initialVelocities.size());
+    ASSERT_EQ(2u * Nmax + 1, finalVelocities.size());
+    ASSERT_EQ(2u * Nmax + 1, infos.size());
+
+    for (size_t i = 0; i < initialVelocities.size(); ++i)
+    {
+        int N = (int)(i + 1) / 2;
+        EXPECT_TRUE(infos[i].converged) << "solution " << i;
+        EXPECT_NEAR(timeOfFlight, EllipticTimeOfFlight(initialPosition, initialVelocities[i], finalPosition, finalVelocities[i], N), 1.0e-9) << "solution " << i;
+
+        // Evaluate() returns the single revolution and left branch solutions
+        if (i % 2 == 0 && i > 0)
+        {
+            continue;
+        }
+        Vector3 initialVelocity, finalVelocity;
+        solver.Evaluate(initialPosition, finalPosition, timeOfFlight, ORBIT_DIR_PROGRADE, N, &initialVelocity, &finalVelocity);
+        EXPECT_NEAR(initialVelocity.distance(initialVelocities[i]), 0.0, 1.0e-12) << "solution " << i;
+        EXPECT_NEAR(finalVelocity.distance(finalVelocities[i]), 0.0, 1.0e-12) << "solution " << i;
+    }
+}
+
+static void FillRandomBatch(LambertBatch* batch, size_t count)
+{
+    batch->Resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        int numberRevolutions = (int)(i % 3);
+        Vector3 initialPosition(0.5 + Random0_1(), 0.5 * RandomMinus1_1(), 0.2 * RandomMinus1_1());
+        Vector3 finalPosition(2.0 * RandomMinus1_1(), 2.0 * RandomMinus1_1(), 0.2 * RandomMinus1_1());
+        double timeOfFlight = (numberRevolutions + 0.2) * MATH_2_PI + 20.0 * Random0_1();
+        OrbitDirection orbitDirection = (i % 2 == 0) ? ORBIT_DIR_PROGRADE : ORBIT_DIR_RETROGRADE;
+        batch->SetProblem(i, initialPosition, finalPosition, timeOfFlight, orbitDirection, numberRevolutions);
+    }
+}
+
+TEST(LambertTest, UniversalVariableBulkMatchesScalar)
+{
+    const size_t count = 301; // not a multiple of the batch width
+    LambertBatch batch;
+    srand(5678);
+    FillRandomBatch(&batch, count);
+
+    Lambert* scalarSolver = LambertManager::CreateLambertSolver(LAMBERT_UNIVERSAL_VAR);
+    LambertManager::SetLambertType(LAMBERT_UNIVERSAL_VAR_BULK);
+    LambertManager::EvaluateBatch(&batch);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        Vector3 initialPosition, finalPosition;
+        batch.initialPosition.Get(i, &initialPosition);
+        batch.finalPosition.Get(i, &finalPosition);
+
+        Vector3 initialVelocity, finalVelocity;
+        LambertInfo info;
+        scalarSolver->Evaluate(initialPosition, finalPosition, batch.timeOfFlight[i], batch.orbitDirection[i], batch.numberRevolutions[i], &initialVelocity, &finalVelocity, &info);
+        if (!info.converged)
+        {
+            continue; // no multi-revolution solution for this time of flight
+        }
+
+        // The batch kernel evaluates the Stumpff functions with its own
+        // elementary functions, so the iterates differ in the last digits.
+        Vector3 batchInitialVelocity, batchFinalVelocity;
+        batch.GetSolution(i, &batchInitialVelocity, &batchFinalVelocity);
+
+        EXPECT_NEAR(initialVelocity.x, batchInitialVelocity.x, 1.0e-10) << "problem " << i;
+        EXPECT_NEAR(initialVelocity.y, batchInitialVelocity.y, 1.0e-10) << "problem " << i;
+        EXPECT_NEAR(initialVelocity.z, batchInitialVelocity.z, 1.0e-10) << "problem " << i;
+        EXPECT_NEAR(finalVelocity.x, batchFinalVelocity.x, 1.0e-10) << "problem " << i;
+        EXPECT_NEAR(finalVelocity.y, batchFinalVelocity.y, 1.0e-10) << "problem " << i;
+        EXPECT_NEAR(finalVelocity.z, batchFinalVelocity.z, 1.0e-10) << "problem " << i;
+    }
+
+    delete scalarSolver;
+}
+
+/// Compares the bit patterns of the solutions, problems without a solution
+/// hold NaN.
+static void ExpectSameSolutions(const LambertBatch& batch1, const LambertBatch& batch2)
+{
+    const size_t bytes = batch1.Size() * sizeof(double);
+    EXPECT_EQ(0, memcmp(&batch1.initialVelocity.x[0], &batch2.initialVelocity.x[0], bytes));
+    EXPECT_EQ(0, memcmp(&batch1.initialVelocity.y[0], &batch2.initialVelocity.y[0], bytes));
+    EXPECT_EQ(0, memcmp(&batch1.initialVelocity.z[0], &batch2.initialVelocity.z[0], bytes));
+    EXPECT_EQ(0, memcmp(&batch1.finalVelocity.x[0], &batch2.finalVelocity.x[0], bytes));
+    EXPECT_EQ(0, memcmp(&batch1.finalVelocity.y[0], &batch2.finalVelocity.y[0], bytes));
+    EXPECT_EQ(0, memcmp(&batch1.finalVelocity.z[0], &batch2.finalVelocity.z[0], bytes));
+}
+
+TEST(LambertTest, BulkQueueMatchesSerial)
+{
+    const size_t count = 2000;
+    LambertBatch serialBatch;
+    srand(8765);
+    FillRandomBatch(&serialBatch, count);
+    LambertBatch futureBatch = serialBatch;
+    LambertBatch callbackBatch = serialBatch;
+
+    Lambert* solver = LambertManager::CreateLambertSolver(LAMBERT_UNIVERSAL_VAR_BULK);
+    solver->EvaluateBatch(&serialBatch, 0, count);
+
+    ThreadPool threadPool(4);
+    int numberCallbacks = 0;
+    {
+        LambertBulkQueue queue(solver, &threadPool, 100);
+        std::future<void> future = queue.Submit(&futureBatch);
+        queue.Submit(&callbackBatch, [&](LambertBatch* batch)
+        {
+            EXPECT_EQ(&callbackBatch, batch);
+            numberCallbacks++;
+        });
+
+        future.get();
+        queue.Wait();
+        EXPECT_EQ(0u, queue.GetNumberPending());
+    }
+    EXPECT_EQ(1, numberCallbacks);
+
+    ExpectSameSolutions(serialBatch, futureBatch);
+    ExpectSameSolutions(serialBatch, callbackBatch);
+
+    delete solver;
+}
+
+TEST(LambertTest, WarmStartMatchesColdStart)
+{
+    for (int lambertType = 0; lambertType < LAMBERT_COUNT; ++lambertType)
+    {
+        Lambert* solver = LambertManager::CreateLambertSolver((LambertType)lambertType);
+        int coldIterations = 0, warmIterations = 0;
+
+        srand(2468);
+        for (int i = 0; i < 100; ++i)
+        {
+            Vector3 initialPosition(0.5 + Random0_1(), 0.5 * RandomMinus1_1(), 0.2 * RandomMinus1_1());
+            Vector3 finalPosition(2.0 * RandomMinus1_1(), 2.0 * RandomMinus1_1(), 0.2 * RandomMinus1_1());
+            double timeOfFlight = 0.5 + 10.0 * Random0_1();
+
+            // Guess from a neighbouring time of flight
+            Vector3 initialVelocity, finalVelocity;
+            LambertInfo neighbourInfo, coldInfo, warmInfo;
+            solver->Evaluate(initialPosition, finalPosition, 1.001 * timeOfFlight, ORBIT_DIR_PROGRADE, 0, &initialVelocity, &finalVelocity, &neighbourInfo);
+            ASSERT_TRUE(neighbourInfo.converged);
+
+            Vector3 coldInitialVelocity, coldFinalVelocity;
+            solver->Evaluate(initialPosition, finalPosition, timeOfFlight, ORBIT_DIR_PROGRADE, 0, &coldInitialVelocity, &coldFinalVelocity, &coldInfo);
+            solver->EvaluateWarmStart(initialPosition, finalPosition, timeOfFlight, ORBIT_DIR_PROGRADE, 0, neighbourInfo.x, &initialVelocity, &finalVelocity, &warmInfo);
+
+            EXPECT_TRUE(warmInfo.converged) << "type " << lambertType << " problem " << i;
+            EXPECT_NEAR(0.0, initialVelocity.distance(coldInitialVelocity), 1.0e-8) << "type " << lambertType << " problem " << i;
+            EXPECT_NEAR(0.0, finalVelocity.distance(coldFinalVelocity), 1.0e-8) << "type " << lambertType << " problem " << i;
+            coldIterations += coldInfo.iterations;
+            warmIterations += warmInfo.iterations;
+        }
+
+        EXPECT_LT(warmIterations, coldIterations) << "type " << lambertType;
+        delete solver;
+    }
+}
+
+TEST(LambertTest, SweepMatchesIndependentSolves)
+{
+    // Departure from a circular orbit at 1 DU to one at 1.5 DU
+    const size_t numberRows = 20;    // departure epochs
+    const size_t numberColumns = 30; // times of flight
+    LambertBatch batch;
+    batch.Resize(numberRows * numberColumns);
+    for (size_t row = 0; row < numberRows; ++row)
+    {
+        for (size_t column = 0; column < numberColumns; ++column)
+        {
+            double departure = 0.02 * row;
+            double timeOfFlight = 1.0 + 0.02 * column;
+            double arrivalAngle = 1.0 + (departure + timeOfFlight) / (1.5 * sqrt(1.5));
+            batch.SetProblem(row * numberColumns + column,
+                             Vector3(cos(departure), sin(departure), 0.0),
+                             Vector3(1.5 * cos(arrivalAngle), 1.5 * sin(arrivalAngle), 0.01),
+                             timeOfFlight, ORBIT_DIR_PROGRADE, 0);
+        }
+    }
+
+    for (int lambertType = 0; lambertType < LAMBERT_COUNT; ++lambertType)
+    {
+        Lambert* solver = LambertManager::CreateLambertSolver((LambertType)lambertType);
+
+        std::vector<LambertInfo> infos;
+        LambertBatch sweepBatch = batch;
+        solver->EvaluateSweep(&sweepBatch, numberRows, numberColumns, LAMBERT_SWEEP_WARM_START, &infos);
+
+        int coldIterations = 0, warmIterations = 0;
+        for (size_t i = 0; i < batch.Size(); ++i)
+        {
+            Vector3 initialPosition, finalPosition, initialVelocity, finalVelocity;
+            batch.initialPosition.Get(i, &initialPosition);
+            batch.finalPosition.Get(i, &finalPosition);
+
+            LambertInfo info;
+            solver->Evaluate(initialPosition, finalPosition, batch.timeOfFlight[i], batch.orbitDirection[i], 0, &initialVelocity, &finalVelocity, &info);
+            coldIterations += info.iterations;
+            warmIterations += infos[i].iterations;
+
+            Vector3 sweepInitialVelocity, sweepFinalVelocity;
+            sweepBatch.GetSolution(i, &sweepInitialVelocity, &sweepFinalVelocity);
+            EXPECT_TRUE(infos[i].converged) << "type " << lambertType << " problem " << i;
+            EXPECT_NEAR(0.0, initialVelocity.distance(sweepInitialVelocity), 1.0e-8) << "type " << lambertType << " problem " << i;
+            EXPECT_NEAR(0.0, finalVelocity.distance(sweepFinalVelocity), 1.0e-8) << "type " << lambertType << " problem " << i;
+        }
+
+        // Izzo's own initial guess already converges in two iterations here
+        if (lambertType == LAMBERT_IZZO)
+        {
+            EXPECT_GE(2 * (int)batch.Size(), warmIterations);
+        }
+        else
+        {
+            EXPECT_LT(warmIterations, 0.8 * coldIterations) << "type " << lambertType;
+        }
+
+        // Without infos the warm started sweep is unchanged, and the batch
+        // mode solves the grid cold to the same solutions
+        LambertBatch plainBatch = batch;
+        solver->EvaluateSweep(&plainBatch, numberRows, numberColumns);
+        LambertBatch coldBatch = batch;
+        solver->EvaluateSweep(&coldBatch, numberRows, numberColumns, LAMBERT_SWEEP_BATCH);
+        for (size_t i = 0; i < batch.Size(); ++i)
+        {
+            Vector3 initialVelocity, finalVelocity, plainInitialVelocity, plainFinalVelocity, coldInitialVelocity, coldFinalVelocity;
+            sweepBatch.GetSolution(i, &initialVelocity, &finalVelocity);
+            plainBatch.GetSolution(i, &plainInitialVelocity, &plainFinalVelocity);
+            coldBatch.GetSolution(i, &coldInitialVelocity, &coldFinalVelocity);
+            EXPECT_EQ(0.0, initialVelocity.distance(plainInitialVelocity)) << "type " << lambertType << " problem " << i;
+            EXPECT_EQ(0.0, finalVelocity.distance(plainFinalVelocity)) << "type " << lambertType << " problem " << i;
+            EXPECT_NEAR(0.0, initialVelocity.distance(coldInitialVelocity), 1.0e-8) << "type " << lambertType << " problem " << i;
+            EXPECT_NEAR(0.0, finalVelocity.distance(coldFinalVelocity), 1.0e-8) << "type " << lambertType << " problem " << i;
+        }
+        delete solver;
+    }
+}
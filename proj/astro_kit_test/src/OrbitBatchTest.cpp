@@ -0,0 +1,134 @@
+/*****************************************************************************
+ *   IGATO - Interplanetary Gravity Assist Trajectory Optimizer              *
+ *   Copyright (C) 2012 Jason Bryan (Jmbryan10@gmail.com)                    *
+ *                                                                           *
+ *   IGATO is free software; you can redistribute it and/or modify           *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   IGATO is distributed in the hope that it will be useful,                *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with IGATO; if not, see http://www.gnu.org/licenses/              *
+ *****************************************************************************/
+
+#include "gtest/gtest.h"
+#include "OrbitBatch.h"
+#include "Orbit.h"
+#include "Base.h"
+
+// Orbit Batch Fixture
+class OrbitBatchTest : public ::testing::Test 
+{
+protected:
+
+    OrbitBatchTest() : batch(1.0) {}
+    virtual ~OrbitBatchTest() {}
+
+    virtual void SetUp()
+    {
+        // A mix of elliptical, hyperbolic and circular orbits, half of them
+        // given as state vectors and half as orbital elements.
+        const int count = 200;
+        batch.Resize(count);
+        orbits.clear();
+        for (int i = 0; i < count; ++i)
+        {
+            double t = i / static_cast<double>(count);
+            OrbitalElements orbitalElements;
+            orbitalElements.eccentricity = (i % 5 == 4) ? 1.1 + t : 0.9 * t;
+            orbitalElements.semimajorAxis = (orbitalElements.eccentricity > 1.0) ? -1.0 - t : 0.5 + 3.0 * t;
+            orbitalElements.inclination = 0.1 + 2.5 * t;
+            orbitalElements.raan = 6.0 * t;
+            orbitalElements.argPerigee = 1.0 + 4.0 * t;
+            orbitalElements.trueAnomaly = (orbitalElements.eccentricity > 1.0) ? 0.5 - t : 5.0 * t;
+            orbitalElements.timePerigee = 0.0;
+
+            Orbit orbit(orbitalElements, 1.0);
+            if (i % 2 == 0)
+            {
+                batch.SetOrbitalElements(i, orbitalElements);
+            }
+            else
+            {
+                batch.SetStateVector(i, orbit.GetStateVector());
+                orbit.SetStateVector(orbit.GetStateVector());
+            }
+            orbits.push_back(orbit);
+        }
+    }
+
+    OrbitBatch batch;
+    std::vector<Orbit> orbits;
+};
+
+TEST_F(OrbitBatchTest, PropagateAllMatchesOrbit)
+{
+    const double timesOfFlight[] = {0.7, -2.0, 25.0};
+    Vector3Array positions, velocities;
+    for (int j = 0; j < 3; ++j)
+    {
+        batch.PropagateAll(timesOfFlight[j]);
+        batch.GetStates(&positions, &velocities);
+        ASSERT_EQ(orbits.size(), positions.Size());
+
+        for (size_t i = 0; i < orbits.size(); ++i)
+        {
+            orbits[i].Propagate(timesOfFlight[j], PROPAGATE_RV);
+            const StateVector& stateVector = orbits[i].GetStateVector();
+            EXPECT_NEAR(stateVector.position.x, positions.x[i], 1.0e-8);
+            EXPECT_NEAR(stateVector.position.y, positions.y[i], 1.0e-8);
+            EXPECT_NEAR(stateVector.position.z, positions.z[i], 1.0e-8);
+            EXPECT_NEAR(stateVector.velocity.x, velocities.x[i], 1.0e-8);
+            EXPECT_NEAR(stateVector.velocity.y, velocities.y[i], 1.0e-8);
+            EXPECT_NEAR(stateVector.velocity.z, velocities.z[i], 1.0e-8);
+        }
+    }
+}
+
+TEST_F(OrbitBatchTest, GetStatesOfRange)
+{
+    batch.PropagateAll(1.5);
+
+    Vector3Array all, allVelocities, part, partVelocities;
+    batch.GetStates(&all, &allVelocities);
+    part.Resize(batch.Size());
+    partVelocities.Resize(batch.Size());
+    batch.GetStates(50, 120, &part, &partVelocities);
+
+    for (size_t i = 50; i < 120; ++i)
+    {
+        EXPECT_EQ(all.x[i], part.x[i]);
+        EXPECT_EQ(all.z[i], part.z[i]);
+        EXPECT_EQ(allVelocities.y[i], partVelocities.y[i]);
+    }
+    EXPECT_EQ(0.0, part.x[0]);
+    EXPECT_EQ(0.0, part.x[120]);
+}
+
+TEST_F(OrbitBatchTest, ClassifyMatchesOrbit)
+{
+    OrbitalElements circular;
+    circular.semimajorAxis = 1.0;
+    circular.eccentricity = 0.0;
+    circular.inclination = 0.2;
+    circular.raan = 0.3;
+    circular.argPerigee = 0.0;
+    circular.trueAnomaly = 1.0;
+    circular.timePerigee = 0.0;
+    batch.SetOrbitalElements(0, circular);
+    orbits[0].SetOrbitalElements(circular);
+
+    std::vector<OrbitType> types;
+    batch.Classify(&types);
+    ASSERT_EQ(orbits.size(), types.size());
+    EXPECT_EQ(ORBIT_CIRCULAR, types[0]);
+    for (size_t i = 0; i < orbits.size(); ++i)
+    {
+        EXPECT_EQ(orbits[i].GetType(), types[i]);
+    }
+}
@@ -126,4 +126,89 @@ TEST(OrbitalElements2StateVectorTest, SolvesCurtisTestCase)
     EXPECT_NEAR(-1.314297, stateVector.velocity.x, TEST_VU_TOLERANCE);
     EXPECT_NEAR(-0.603641, stateVector.velocity.y, TEST_VU_TOLERANCE);
     EXPECT_NEAR(0.220610, stateVector.velocity.z, TEST_VU_TOLERANCE);
-}
\ No newline at end of file
+}
+
+TEST_F(OrbitTest, SetStateVectorAfterOrbitalElements)
+{
+    StateVector stateVector;
+    stateVector.position = Vector3(1.023, 1.076, 1.011);
+    stateVector.velocity = Vector3(0.62, 0.7, -0.25);
+    OrbitalElements orbitalElements;
+    ConvertStateVector2OrbitalElements(stateVector, &orbitalElements);
+
+    Orbit canonical(stateVector, 1.0);
+    OrbitalElements other = orbitalElements;
+    other.trueAnomaly += 1.0;
+    canonical.SetOrbitalElements(other);
+    EXPECT_EQ(other.trueAnomaly, canonical.GetOrbitalElements().trueAnomaly);
+
+    // The cached state vector is stale, setting it back to the same value must not be skipped.
+    canonical.SetStateVector(stateVector);
+    EXPECT_NEAR(orbitalElements.trueAnomaly, canonical.GetOrbitalElements().trueAnomaly, 1.0e-12);
+    EXPECT_EQ(stateVector.position.x, canonical.GetStateVector().position.x);
+}
+
+TEST(OrbitPropagateTest, PropagatorsAgree)
+{
+    // Elliptical (Vallado Example 2-5) and hyperbolic orbits, forwards and backwards.
+    const int count = 2;
+    const Vector3 positions[count] = {Vector3(1.023, 1.076, 1.011), Vector3(-0.947769, -0.547182, 0.391964)};
+    const Vector3 velocities[count] = {Vector3(0.62, 0.7, -0.25), Vector3(-0.8, 1.2, 0.5)};
+    const double timesOfFlight[] = {0.5, -3.0, 40.0};
+
+    for (int i = 0; i < count; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            Orbit orbitRV(positions[i], velocities[i], 1.0);
+            orbitRV.Propagate(timesOfFlight[j], PROPAGATE_RV);
+            Orbit orbitCOES(positions[i], velocities[i], 1.0);
+            orbitCOES.Propagate(timesOfFlight[j], PROPAGATE_COES);
+
+            const StateVector& stateRV = orbitRV.GetStateVector();
+            const StateVector& stateCOES = orbitCOES.GetStateVector();
+            EXPECT_NEAR(stateRV.position.x, stateCOES.position.x, 1.0e-9);
+            EXPECT_NEAR(stateRV.position.y, stateCOES.position.y, 1.0e-9);
+            EXPECT_NEAR(stateRV.position.z, stateCOES.position.z, 1.0e-9);
+            EXPECT_NEAR(stateRV.velocity.x, stateCOES.velocity.x, 1.0e-9);
+            EXPECT_NEAR(stateRV.velocity.y, stateCOES.velocity.y, 1.0e-9);
+            EXPECT_NEAR(stateRV.velocity.z, stateCOES.velocity.z, 1.0e-9);
+        }
+    }
+}
+
+TEST(OrbitPropagateTest, PropagatesOneRevolution)
+{
+    StateVector stateVector;
+    stateVector.position = Vector3(1.023, 1.076, 1.011);
+    stateVector.velocity = Vector3(0.62, 0.7, -0.25);
+    OrbitalElements orbitalElements;
+    ConvertStateVector2OrbitalElements(stateVector, &orbitalElements);
+    double period = MATH_2_PI * sqrt(orbitalElements.semimajorAxis * orbitalElements.semimajorAxis * orbitalElements.semimajorAxis);
+
+    Orbit orbit(orbitalElements, 1.0);
+    for (int i = 0; i < 10; ++i)
+    {
+        orbit.Propagate(0.1 * period);
+    }
+
+    // Only the true anomaly is advanced, the other elements are never converted back.
+    const OrbitalElements& propagated = orbit.GetOrbitalElements();
+    EXPECT_EQ(orbitalElements.semimajorAxis, propagated.semimajorAxis);
+    EXPECT_EQ(orbitalElements.eccentricity, propagated.eccentricity);
+    EXPECT_EQ(orbitalElements.inclination, propagated.inclination);
+    EXPECT_NEAR(orbitalElements.trueAnomaly, propagated.trueAnomaly, 1.0e-9);
+
+    const StateVector& final = orbit.GetStateVector();
+    EXPECT_NEAR(stateVector.position.x, final.position.x, 1.0e-9);
+    EXPECT_NEAR(stateVector.position.y, final.position.y, 1.0e-9);
+    EXPECT_NEAR(stateVector.position.z, final.position.z, 1.0e-9);
+    EXPECT_NEAR(stateVector.velocity.x, final.velocity.x, 1.0e-9);
+    EXPECT_NEAR(stateVector.velocity.y, final.velocity.y, 1.0e-9);
+    EXPECT_NEAR(stateVector.velocity.z, final.velocity.z, 1.0e-9);
+
+    Orbit orbitRV(stateVector, 1.0);
+    orbitRV.Propagate(period, PROPAGATE_RV);
+    EXPECT_NEAR(stateVector.position.x, orbitRV.GetStateVector().position.x, 1.0e-9);
+    EXPECT_NEAR(stateVector.velocity.z, orbitRV.GetStateVector().velocity.z, 1.0e-9);
+}
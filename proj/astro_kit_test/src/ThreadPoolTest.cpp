@@ -0,0 +1,53 @@
+/*****************************************************************************
+ *   IGATO - Interplanetary Gravity Assist Trajectory Optimizer              *
+ *   Copyright (C) 2012 Jason Bryan (Jmbryan10@gmail.com)                    *
+ *                                                                           *
+ *   IGATO is free software; you can redistribute it and/or modify           *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation; either version 2 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   IGATO is distributed in the hope that it will be useful,                *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with IGATO; if not, see http://www.gnu.org/licenses/              *
+ *****************************************************************************/
+
+#include "gtest/gtest.h"
+#include "ThreadPool.h"
+#include "Base.h"
+
+TEST(ThreadPoolTest, ParallelForVisitsEveryIndexOnce)
+{
+    ThreadPool threadPool(4);
+    EXPECT_EQ(4, threadPool.GetNumberThreads());
+
+    std::vector<int> visits(1003, 0);
+    threadPool.ParallelFor(visits.size(), 10, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            visits[i]++;
+        }
+    });
+
+    for (size_t i = 0; i < visits.size(); ++i)
+    {
+        EXPECT_EQ(1, visits[i]);
+    }
+}
+
+TEST(ThreadPoolTest, ParallelForRethrowsTaskException)
+{
+    ThreadPool threadPool(2);
+    EXPECT_ANY_THROW(threadPool.ParallelFor(100, 10, [](size_t begin, size_t)
+    {
+        if (begin == 50)
+        {
+            throw "Task failed";
+        }
+    }));
+}